@@ -1,51 +1,18 @@
 #pragma once
 #include <iostream>
+#include <sstream>
 #include <mutex>
-
-class REDebugStream {
-public:
-    REDebugStream() {
-        isWriting.lock();
-    }
-
-    ~REDebugStream() {
-        std::cout << std::endl;
-        isWriting.unlock();
-    }
-
-    template <typename T>
-    REDebugStream& operator<<(const T& arg) {
-        if constexpr (std::is_same_v<T, const char*> || std::is_same_v<T, std::string>) {
-            std::cout << arg; // 输入类型为文本时不加逗号
-        } else {
-            if (_outputCount) {
-                std::cout << ", " << arg;
-            } else {
-                std::cout << arg;
-            }
-        }
-        _outputCount++;
-        return *this;
-    }
-
-    REDebugStream& operator<<(std::ostream& (*manipulator)(std::ostream&)) {
-        manipulator(std::cout);
-        return *this;
-    }
-
-private:
-    static std::mutex isWriting;
-    size_t _outputCount = 0;
-};
-
-std::mutex REDebugStream::isWriting;
-
-void reBlank() {
-    std::cout << std::endl;
-}
-
-#define REDebug REDebugStream()
-#define REBlank reBlank()
+#include <condition_variable>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <memory>
+#include <vector>
+#include <string>
+#include <string_view>
+#include <cstring>
+#include <algorithm>
+#include <type_traits>
 
 #ifdef GLM_ENABLE_EXPERIMENTAL
 
@@ -77,7 +44,7 @@ std::ostream& operator<<(std::ostream& os, const glm::vec<L, uint8_t, Q>& vec) {
 }
 
 // 重载输出运算符<<以支持将mat4对象输出到ostream
-std::ostream& operator<<(std::ostream& os, const glm::mat4& m) {
+inline std::ostream& operator<<(std::ostream& os, const glm::mat4& m) {
     for (int i = 0; i < 4; ++i) {
         for (int j = 0; j < 4; ++j) {
             os << m[i][j] << " ";
@@ -87,4 +54,467 @@ std::ostream& operator<<(std::ostream& os, const glm::mat4& m) {
     return os;
 }
 
-#endif // GLM_ENABLE_EXPERIMENTAL
\ No newline at end of file
+#endif // GLM_ENABLE_EXPERIMENTAL
+
+// 编译期日志级别：低于该级别的日志语句整条被消除（参数也不会求值）
+// 0 trace, 1 debug, 2 info, 3 warning, 4 error, 5 全部关闭
+#ifndef RE_LOG_LEVEL
+#define RE_LOG_LEVEL 0
+#endif
+
+namespace RE::logging {
+    enum class Level : uint8_t {
+        trace = 0,
+        debug,
+        info,
+        warning,
+        error,
+        off,
+    };
+
+    // 参数的格式化函数，在后台线程执行
+    using FormatFn = void (*)(std::ostream& os, const uint8_t* data, size_t size);
+
+    // 单生产者单消费者的字节环形缓冲，每个写日志的线程一个，写入端无锁
+    // 记录格式：8 字节头（长度）+ 数据，按 8 字节对齐；尾部放不下时写回绕标记从头开始
+    class LogRing {
+    public:
+        static constexpr size_t CAPACITY = 1 << 16;
+        static constexpr uint32_t WRAP = 0xffffffffu;
+
+        LogRing();
+        // 空间不足时返回 false
+        bool write(const uint8_t* data, size_t size);
+        // 读出所有已提交的记录，fn(const uint8_t* data, size_t size)
+        template <typename F>
+        void read(F&& fn);
+        bool empty() const;
+
+        std::atomic<bool> retired{false}; // 所属线程已退出，读空后可以回收
+
+    private:
+        std::unique_ptr<uint8_t[]> buffer;
+        alignas(64) std::atomic<size_t> head{0}; // 单调递增的写位置
+        alignas(64) std::atomic<size_t> tail{0}; // 单调递增的读位置
+    };
+
+    // 异步日志：各线程把未格式化的参数写进自己的环形缓冲，后台线程定期取出、按时间排序、格式化后一次性输出
+    class Logger {
+    public:
+        static Logger& instance();
+
+        Logger();
+        ~Logger();
+        Logger(const Logger&) = delete;
+        Logger& operator=(const Logger&) = delete;
+
+        void setOutput(std::ostream* output);
+        void setFlushInterval(std::chrono::milliseconds interval);
+        // 缓冲满时等待后台线程腾出空间（默认），否则丢弃并计数
+        void setBlockWhenFull(bool block);
+        // 阻塞到调用前写入的日志全部输出
+        void flush();
+        uint64_t dropped() const;
+
+        void submit(const uint8_t* record, size_t size);
+
+    private:
+        struct RingHandle {
+            std::shared_ptr<LogRing> ring;
+            ~RingHandle();
+        };
+
+        LogRing& localRing();
+        void run();
+        void drain();
+
+        std::ostream* output = &std::cout;
+        std::chrono::milliseconds interval{5};
+        std::atomic<bool> blockWhenFull{true};
+        std::atomic<uint64_t> _dropped{0};
+
+        std::mutex registryMutex;
+        std::vector<std::shared_ptr<LogRing>> rings;
+
+        std::mutex wakeMutex;
+        std::condition_variable wake;
+        std::condition_variable done;
+        uint64_t requested = 0;
+        uint64_t completed = 0;
+        bool stop = false;
+        std::thread worker;
+    };
+
+    // 一条日志语句，析构时把整条记录提交到本线程的环形缓冲
+    // 可平凡复制的参数按值保存，格式化推迟到后台线程；字符串拷贝内容；其他类型在当前线程先格式化成文本
+    // 注意：按值保存的类型里若含有指向外部内存的指针，格式化时该内存可能已失效
+    class LogStream {
+    public:
+        explicit LogStream(Level level, bool prefix = true);
+        ~LogStream();
+        LogStream(const LogStream&) = delete;
+        LogStream& operator=(const LogStream&) = delete;
+
+        template <typename T>
+        LogStream& operator<<(const T& arg);
+        LogStream& operator<<(std::ostream& (*manipulator)(std::ostream&));
+
+    private:
+        size_t start;
+        size_t _outputCount = 0;
+
+        static std::vector<uint8_t>& staging();
+        void push(FormatFn fn, const void* data, size_t size);
+        void pushText(const char* text, size_t size);
+    };
+
+    void blank();
+}
+
+namespace RE::logging {
+    namespace detail {
+        constexpr size_t align8(size_t n) {
+            return (n + 7) & ~size_t(7);
+        }
+
+        struct RecordHeader {
+            uint64_t timestamp;
+            uint8_t level;
+            uint8_t prefix;
+        };
+
+        inline void formatText(std::ostream& os, const uint8_t* data, size_t size) {
+            os.write(reinterpret_cast<const char*>(data), size);
+        }
+
+        template <typename T>
+        void formatValue(std::ostream& os, const uint8_t* data, size_t) {
+            T value;
+            memcpy(&value, data, sizeof(T));
+            os << value;
+        }
+
+        inline void formatManipulator(std::ostream& os, const uint8_t* data, size_t) {
+            std::ostream& (*manipulator)(std::ostream&);
+            memcpy(&manipulator, data, sizeof(manipulator));
+            manipulator(os);
+        }
+
+        inline const char* levelName(uint8_t level) {
+            static const char* names[] = {"[trace] ", "[debug] ", "[info] ", "[warning] ", "[error] ", ""};
+            return names[std::min<uint8_t>(level, 5)];
+        }
+    }
+
+    inline LogRing::LogRing() : buffer(new uint8_t[CAPACITY]) {}
+
+    inline bool LogRing::write(const uint8_t* data, size_t size) {
+        const size_t total = detail::align8(8 + size);
+        if (total > CAPACITY / 2) {
+            return false;
+        }
+        size_t h = head.load(std::memory_order_relaxed);
+        const size_t t = tail.load(std::memory_order_acquire);
+        size_t offset = h & (CAPACITY - 1);
+        const size_t contiguous = CAPACITY - offset;
+        const size_t needed = total + (contiguous < total ? contiguous : 0);
+        if (h + needed - t > CAPACITY) {
+            return false;
+        }
+        if (contiguous < total) {
+            const uint32_t wrap = WRAP;
+            memcpy(buffer.get() + offset, &wrap, sizeof(wrap));
+            h += contiguous;
+            offset = 0;
+        }
+        const uint32_t length = static_cast<uint32_t>(size);
+        memcpy(buffer.get() + offset, &length, sizeof(length));
+        memcpy(buffer.get() + offset + 8, data, size);
+        head.store(h + total, std::memory_order_release);
+        return true;
+    }
+
+    template <typename F>
+    void LogRing::read(F&& fn) {
+        size_t t = tail.load(std::memory_order_relaxed);
+        const size_t h = head.load(std::memory_order_acquire);
+        while (t < h) {
+            const size_t offset = t & (CAPACITY - 1);
+            uint32_t length;
+            memcpy(&length, buffer.get() + offset, sizeof(length));
+            if (length == WRAP) {
+                t += CAPACITY - offset;
+                continue;
+            }
+            fn(buffer.get() + offset + 8, static_cast<size_t>(length));
+            t += detail::align8(8 + length);
+        }
+        tail.store(t, std::memory_order_release);
+    }
+
+    inline bool LogRing::empty() const {
+        return tail.load(std::memory_order_acquire) == head.load(std::memory_order_acquire);
+    }
+
+    inline Logger& Logger::instance() {
+        static Logger logger;
+        return logger;
+    }
+
+    inline Logger::Logger() {
+        worker = std::thread([this]() { run(); });
+    }
+
+    inline Logger::~Logger() {
+        {
+            std::lock_guard<std::mutex> lock(wakeMutex);
+            stop = true;
+        }
+        wake.notify_one();
+        worker.join();
+    }
+
+    inline void Logger::setOutput(std::ostream* out) {
+        flush();
+        std::lock_guard<std::mutex> lock(wakeMutex);
+        output = out;
+    }
+
+    inline void Logger::setFlushInterval(std::chrono::milliseconds value) {
+        std::lock_guard<std::mutex> lock(wakeMutex);
+        interval = value;
+    }
+
+    inline void Logger::setBlockWhenFull(bool block) {
+        blockWhenFull.store(block, std::memory_order_relaxed);
+    }
+
+    inline void Logger::flush() {
+        std::unique_lock<std::mutex> lock(wakeMutex);
+        const uint64_t ticket = ++requested;
+        wake.notify_one();
+        done.wait(lock, [&]() { return completed >= ticket || stop; });
+    }
+
+    inline uint64_t Logger::dropped() const {
+        return _dropped.load(std::memory_order_relaxed);
+    }
+
+    inline Logger::RingHandle::~RingHandle() {
+        if (ring) {
+            ring->retired.store(true, std::memory_order_release);
+        }
+    }
+
+    inline LogRing& Logger::localRing() {
+        thread_local RingHandle handle;
+        if (!handle.ring) {
+            handle.ring = std::make_shared<LogRing>();
+            std::lock_guard<std::mutex> lock(registryMutex);
+            rings.push_back(handle.ring);
+        }
+        return *handle.ring;
+    }
+
+    inline void Logger::submit(const uint8_t* record, size_t size) {
+        LogRing& ring = localRing();
+        while (!ring.write(record, size)) {
+            if (size + 8 > LogRing::CAPACITY / 2 || !blockWhenFull.load(std::memory_order_relaxed)) {
+                _dropped.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+            // 缓冲满：和 flush 一样提交请求，让后台线程立即读一轮，在 done 上等待而不是空转
+            std::unique_lock<std::mutex> lock(wakeMutex);
+            if (stop) {
+                _dropped.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+            const uint64_t ticket = ++requested;
+            wake.notify_one();
+            done.wait(lock, [&]() { return completed >= ticket || stop; });
+        }
+    }
+
+    inline void Logger::run() {
+        for (;;) {
+            uint64_t ticket;
+            bool stopping;
+            {
+                std::unique_lock<std::mutex> lock(wakeMutex);
+                wake.wait_for(lock, interval, [&]() { return stop || requested > completed; });
+                ticket = requested;
+                stopping = stop;
+            }
+            drain();
+            {
+                std::lock_guard<std::mutex> lock(wakeMutex);
+                completed = std::max(completed, ticket);
+            }
+            done.notify_all();
+            if (stopping) {
+                return;
+            }
+        }
+    }
+
+    inline void Logger::drain() {
+        std::vector<std::shared_ptr<LogRing>> snapshot;
+        {
+            std::lock_guard<std::mutex> lock(registryMutex);
+            snapshot = rings;
+        }
+
+        // 各线程内部有序，线程之间按时间戳合并
+        struct Line {
+            uint64_t timestamp;
+            size_t begin, end;
+        };
+        static thread_local std::ostringstream formatter;
+        std::string text;
+        std::vector<Line> lines;
+        for (const auto& ring : snapshot) {
+            ring->read([&](const uint8_t* data, size_t size) {
+                detail::RecordHeader header;
+                memcpy(&header, data, sizeof(header));
+                formatter.str(std::string());
+                formatter.clear();
+                if (header.prefix) {
+                    formatter << detail::levelName(header.level);
+                }
+                size_t offset = detail::align8(sizeof(header));
+                while (offset + 16 <= size) {
+                    FormatFn fn;
+                    uint32_t length;
+                    memcpy(&fn, data + offset, sizeof(fn));
+                    memcpy(&length, data + offset + 8, sizeof(length));
+                    fn(formatter, data + offset + 16, length);
+                    offset += 16 + detail::align8(length);
+                }
+                formatter << '\n';
+                const std::string line = formatter.str();
+                lines.push_back({header.timestamp, text.size(), text.size() + line.size()});
+                text += line;
+            });
+        }
+
+        const uint64_t droppedNow = _dropped.exchange(0, std::memory_order_relaxed);
+        if (!lines.empty() || droppedNow) {
+            std::stable_sort(lines.begin(), lines.end(), [](const Line& a, const Line& b) { return a.timestamp < b.timestamp; });
+            std::string ordered;
+            ordered.reserve(text.size());
+            for (const Line& line : lines) {
+                ordered.append(text, line.begin, line.end - line.begin);
+            }
+            if (droppedNow) {
+                ordered += "[RE log] " + std::to_string(droppedNow) + " messages dropped\n";
+            }
+            output->write(ordered.data(), ordered.size());
+            output->flush();
+        }
+
+        // 线程已退出且读空的缓冲不再需要
+        std::lock_guard<std::mutex> lock(registryMutex);
+        rings.erase(std::remove_if(rings.begin(), rings.end(),
+                                   [](const std::shared_ptr<LogRing>& ring) { return ring->retired.load(std::memory_order_acquire) && ring->empty(); }),
+                    rings.end());
+    }
+
+    inline std::vector<uint8_t>& LogStream::staging() {
+        thread_local std::vector<uint8_t> buffer;
+        return buffer;
+    }
+
+    inline LogStream::LogStream(Level level, bool prefix) {
+        // 参数求值过程中可能嵌套另一条日志，记录从当前末尾开始，提交后截回
+        std::vector<uint8_t>& buffer = staging();
+        start = buffer.size();
+        detail::RecordHeader header;
+        header.timestamp = static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+        header.level = static_cast<uint8_t>(level);
+        header.prefix = prefix ? 1 : 0;
+        buffer.resize(start + detail::align8(sizeof(header)));
+        memcpy(buffer.data() + start, &header, sizeof(header));
+    }
+
+    inline LogStream::~LogStream() {
+        std::vector<uint8_t>& buffer = staging();
+        Logger::instance().submit(buffer.data() + start, buffer.size() - start);
+        buffer.resize(start);
+    }
+
+    inline void LogStream::push(FormatFn fn, const void* data, size_t size) {
+        std::vector<uint8_t>& buffer = staging();
+        const size_t offset = buffer.size();
+        const uint32_t length = static_cast<uint32_t>(size);
+        buffer.resize(offset + 16 + detail::align8(size));
+        memcpy(buffer.data() + offset, &fn, sizeof(fn));
+        memcpy(buffer.data() + offset + 8, &length, sizeof(length));
+        if (size) {
+            memcpy(buffer.data() + offset + 16, data, size);
+        }
+    }
+
+    inline void LogStream::pushText(const char* text, size_t size) {
+        push(&detail::formatText, text, size);
+    }
+
+    template <typename T>
+    LogStream& LogStream::operator<<(const T& arg) {
+        using U = std::decay_t<T>;
+        constexpr bool isText = std::is_same_v<U, const char*> || std::is_same_v<U, char*> || std::is_same_v<T, std::string> || std::is_same_v<T, std::string_view>;
+        if constexpr (isText) {
+            // 输入类型为文本时不加逗号
+            if constexpr (std::is_same_v<T, std::string> || std::is_same_v<T, std::string_view>) {
+                pushText(arg.data(), arg.size());
+            } else {
+                pushText(arg, strlen(arg));
+            }
+        } else {
+            if (_outputCount) {
+                pushText(", ", 2);
+            }
+            if constexpr (std::is_trivially_copyable_v<T> && !std::is_pointer_v<T> && !std::is_array_v<T>) {
+                push(&detail::formatValue<T>, &arg, sizeof(T));
+            } else {
+                std::ostringstream os;
+                os << arg;
+                const std::string s = os.str();
+                pushText(s.data(), s.size());
+            }
+        }
+        _outputCount++;
+        return *this;
+    }
+
+    inline LogStream& LogStream::operator<<(std::ostream& (*manipulator)(std::ostream&)) {
+        push(&detail::formatManipulator, &manipulator, sizeof(manipulator));
+        return *this;
+    }
+
+    inline void blank() {
+        LogStream(Level::debug, false);
+    }
+}
+
+using REDebugStream = RE::logging::LogStream;
+
+// 低于 RE_LOG_LEVEL 的语句在编译期被丢弃，整条语句（包括参数求值）没有任何开销
+#define RE_LOG(level)                                                                      \
+    if constexpr (static_cast<int>(RE::logging::Level::level) < RE_LOG_LEVEL) {           \
+    } else                                                                                 \
+        RE::logging::LogStream(RE::logging::Level::level)
+
+#define RELogTrace RE_LOG(trace)
+#define RELogInfo RE_LOG(info)
+#define RELogWarning RE_LOG(warning)
+#define RELogError RE_LOG(error)
+
+// 保持原有输出格式：不加级别前缀，非文本参数之间用逗号分隔
+#define REDebug                                                                            \
+    if constexpr (static_cast<int>(RE::logging::Level::debug) < RE_LOG_LEVEL) {           \
+    } else                                                                                 \
+        RE::logging::LogStream(RE::logging::Level::debug, false)
+#define REBlank                                                                            \
+    if constexpr (static_cast<int>(RE::logging::Level::debug) < RE_LOG_LEVEL) {           \
+    } else                                                                                 \
+        RE::logging::blank()
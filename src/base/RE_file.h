@@ -0,0 +1,138 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <iostream>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace RE {
+    // 只读文件映射，页面在首次访问时才由系统调入
+    // copyOnWrite 为 true 时映射可写，写入只影响本进程的私有副本，不会写回文件
+    class MappedFile {
+    public:
+        MappedFile() = default;
+        ~MappedFile() { close(); }
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        bool open(const char* filename, bool copyOnWrite = false) {
+            close();
+#ifdef _WIN32
+            _file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_RANDOM_ACCESS, nullptr);
+            if (_file == INVALID_HANDLE_VALUE) {
+                std::cerr << "CreateFile Error: " << filename << std::endl;
+                return false;
+            }
+            LARGE_INTEGER size;
+            GetFileSizeEx(_file, &size);
+            _size = static_cast<size_t>(size.QuadPart);
+            if (_size == 0) {
+                close();
+                return false;
+            }
+            _mapping = CreateFileMappingA(_file, nullptr, copyOnWrite ? PAGE_WRITECOPY : PAGE_READONLY, 0, 0, nullptr);
+            if (_mapping == nullptr) {
+                std::cerr << "CreateFileMapping Error: " << filename << std::endl;
+                close();
+                return false;
+            }
+            _data = static_cast<uint8_t*>(MapViewOfFile(_mapping, copyOnWrite ? FILE_MAP_COPY : FILE_MAP_READ, 0, 0, 0));
+            if (_data == nullptr) {
+                std::cerr << "MapViewOfFile Error: " << filename << std::endl;
+                close();
+                return false;
+            }
+#else
+            _fd = ::open(filename, O_RDONLY);
+            if (_fd < 0) {
+                std::cerr << "open Error: " << filename << std::endl;
+                return false;
+            }
+            struct stat st;
+            fstat(_fd, &st);
+            _size = static_cast<size_t>(st.st_size);
+            if (_size == 0) {
+                close();
+                return false;
+            }
+            const int prot = copyOnWrite ? (PROT_READ | PROT_WRITE) : PROT_READ;
+            void* p = mmap(nullptr, _size, prot, MAP_PRIVATE, _fd, 0);
+            if (p == MAP_FAILED) {
+                std::cerr << "mmap Error: " << filename << std::endl;
+                close();
+                return false;
+            }
+            _data = static_cast<uint8_t*>(p);
+#endif
+            return true;
+        }
+
+        void close() {
+#ifdef _WIN32
+            if (_data != nullptr) {
+                UnmapViewOfFile(_data);
+            }
+            if (_mapping != nullptr) {
+                CloseHandle(_mapping);
+            }
+            if (_file != INVALID_HANDLE_VALUE) {
+                CloseHandle(_file);
+            }
+            _mapping = nullptr;
+            _file = INVALID_HANDLE_VALUE;
+#else
+            if (_data != nullptr) {
+                munmap(_data, _size);
+            }
+            if (_fd >= 0) {
+                ::close(_fd);
+            }
+            _fd = -1;
+#endif
+            _data = nullptr;
+            _size = 0;
+        }
+
+        uint8_t* data() { return _data; }
+        const uint8_t* data() const { return _data; }
+        size_t size() const { return _size; }
+        bool isOpen() const { return _data != nullptr; }
+
+    private:
+        uint8_t* _data = nullptr;
+        size_t _size = 0;
+#ifdef _WIN32
+        HANDLE _file = INVALID_HANDLE_VALUE;
+        HANDLE _mapping = nullptr;
+#else
+        int _fd = -1;
+#endif
+    };
+
+    // 向文件追加 count 个 0 字节直到 offset 对齐到 alignment
+    inline size_t padFileTo(FILE* file, size_t offset, size_t alignment) {
+        static const uint8_t zeros[4096] = {};
+        size_t padding = (alignment - offset % alignment) % alignment;
+        offset += padding;
+        while (padding > 0) {
+            const size_t n = padding < sizeof(zeros) ? padding : sizeof(zeros);
+            fwrite(zeros, 1, n, file);
+            padding -= n;
+        }
+        return offset;
+    }
+}
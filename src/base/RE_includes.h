@@ -10,19 +10,31 @@
 
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include <stb_image_write.h>
+#define STB_TRUETYPE_IMPLEMENTATION
+#include <stb_truetype.h>
 
 #include <SDL.h>
 #include <iostream>
 #include <vector>
 #include <algorithm>
+#include <bit>
 #include <deque>
 #include <atomic>
 #include <thread>
 #include <mutex>
+#include <condition_variable>
+#include <future>
+#include <memory>
+#include <list>
+#include <string>
+#include <unordered_map>
 #include <cmath>
 #include <cstddef>
 #include <cstdint>
 #include <cstdlib>
+#include <cstring>
 #include <functional>
 #include <initializer_list>
 #include <iterator>
@@ -30,5 +42,7 @@
 #include <random>
 #include <tuple>
 
+#include "RE_simd.h"
 #include "RE_math.h"
-#include "RE_debug.h"
\ No newline at end of file
+#include "RE_debug.h"
+#include "RE_profile.h"
\ No newline at end of file
@@ -30,6 +30,9 @@ namespace RE {
             static_cast<uint8_t>(x1.g + (x2.g - x1.g) * t),
             static_cast<uint8_t>(x1.b + (x2.b - x1.b) * t)};
     }
+    inline glm::f32vec3 lerp(glm::f32vec3 x1, glm::f32vec3 x2, float t) {
+        return x1 + (x2 - x1) * t;
+    }
     inline glm::u64vec2 lerp(glm::u64vec2 x1, glm::u64vec2 x2, float t) {
         return glm::u64vec2{
             static_cast<uint64_t>(x1.x + (x2.x - x1.x) * t),
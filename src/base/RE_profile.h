@@ -0,0 +1,246 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include <algorithm>
+
+// 编译期开关：RE_PROFILE 为 0 时所有 RE_PROFILE_SCOPE 展开为空语句
+#ifndef RE_PROFILE
+#define RE_PROFILE 1
+#endif
+
+namespace RE {
+    struct ProfileEvent {
+        const char* name; // 必须是静态字符串（通常为字面量），只保存指针
+        uint64_t begin;   // 纳秒，steady_clock
+        uint64_t end;
+    };
+
+    struct ProfileZoneStats {
+        const char* name;
+        double total = 0.0; // 毫秒
+        double max = 0.0;
+        uint64_t count = 0;
+    };
+
+    // 每个线程一个的事件环形缓冲，只有所属线程写入，写满后覆盖最旧的事件
+    struct ProfileBuffer {
+        static constexpr size_t CAPACITY = 1 << 16;
+
+        std::unique_ptr<ProfileEvent[]> events{new ProfileEvent[CAPACITY]};
+        std::atomic<uint64_t> count{0};
+        uint32_t threadId = 0;
+        uint64_t frameCursor = 0; // endFrame 已经统计到的位置，只由读取方使用
+
+        void push(const char* name, uint64_t begin, uint64_t end);
+    };
+
+    // CPU 性能分析：记录作用域的开始 / 结束时间，支持导出 Chrome / Perfetto 的 trace JSON 以及每帧的分区统计
+    // 运行期默认关闭，关闭时每个作用域只有一次原子读和一个分支
+    // 导出和 endFrame 读取的是其他线程正在写的缓冲，应在帧之间（工作线程空闲时）调用
+    class Profiler {
+    public:
+        static Profiler& instance();
+
+        static bool enabled();
+        static void setEnabled(bool enabled);
+        static uint64_t now();
+        static void record(const char* name, uint64_t begin, uint64_t end);
+
+        // 统计上一次 endFrame 以来的所有事件，按总耗时降序
+        void endFrame();
+        const std::vector<ProfileZoneStats>& frameSummary() const;
+        std::string summaryText() const;
+        // 导出各线程缓冲里仍保留的全部事件，失败时返回 false
+        bool writeChromeTrace(const char* filename);
+        void clear();
+
+    private:
+        inline static std::atomic<bool> _enabled{false};
+
+        std::mutex registryMutex;
+        std::vector<std::shared_ptr<ProfileBuffer>> buffers;
+        std::vector<ProfileZoneStats> summary;
+
+        ProfileBuffer& localBuffer();
+        std::vector<std::shared_ptr<ProfileBuffer>> snapshot();
+    };
+
+    class ProfileScope {
+    public:
+        explicit ProfileScope(const char* name);
+        ~ProfileScope();
+        ProfileScope(const ProfileScope&) = delete;
+        ProfileScope& operator=(const ProfileScope&) = delete;
+
+    private:
+        const char* name = nullptr;
+        uint64_t begin = 0;
+    };
+}
+
+namespace RE {
+    inline void ProfileBuffer::push(const char* name, uint64_t begin, uint64_t end) {
+        const uint64_t index = count.load(std::memory_order_relaxed);
+        events[index & (CAPACITY - 1)] = ProfileEvent{name, begin, end};
+        count.store(index + 1, std::memory_order_release);
+    }
+
+    inline Profiler& Profiler::instance() {
+        static Profiler profiler;
+        return profiler;
+    }
+
+    inline bool Profiler::enabled() {
+        return _enabled.load(std::memory_order_relaxed);
+    }
+
+    inline void Profiler::setEnabled(bool value) {
+        _enabled.store(value, std::memory_order_relaxed);
+    }
+
+    inline uint64_t Profiler::now() {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+
+    inline void Profiler::record(const char* name, uint64_t begin, uint64_t end) {
+        instance().localBuffer().push(name, begin, end);
+    }
+
+    inline ProfileBuffer& Profiler::localBuffer() {
+        // 缓冲由注册表持有，线程退出后事件仍可导出
+        thread_local ProfileBuffer* buffer = nullptr;
+        if (buffer == nullptr) {
+            auto created = std::make_shared<ProfileBuffer>();
+            std::lock_guard<std::mutex> lock(registryMutex);
+            created->threadId = static_cast<uint32_t>(buffers.size());
+            buffers.push_back(created);
+            buffer = created.get();
+        }
+        return *buffer;
+    }
+
+    inline std::vector<std::shared_ptr<ProfileBuffer>> Profiler::snapshot() {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        return buffers;
+    }
+
+    inline void Profiler::endFrame() {
+        // 同名区域按字符串合并，不同编译单元里的同一个字面量地址可能不同
+        std::unordered_map<std::string_view, size_t> index;
+        summary.clear();
+        for (const auto& buffer : snapshot()) {
+            const uint64_t count = buffer->count.load(std::memory_order_acquire);
+            const uint64_t first = std::max(buffer->frameCursor, count > ProfileBuffer::CAPACITY ? count - ProfileBuffer::CAPACITY : 0);
+            for (uint64_t i = first; i < count; i++) {
+                const ProfileEvent& e = buffer->events[i & (ProfileBuffer::CAPACITY - 1)];
+                auto [it, inserted] = index.try_emplace(e.name, summary.size());
+                if (inserted) {
+                    summary.push_back(ProfileZoneStats{e.name});
+                }
+                ProfileZoneStats& s = summary[it->second];
+                const double ms = (e.end - e.begin) * 1e-6;
+                s.total += ms;
+                s.max = std::max(s.max, ms);
+                s.count++;
+            }
+            buffer->frameCursor = count;
+        }
+        std::sort(summary.begin(), summary.end(), [](const ProfileZoneStats& a, const ProfileZoneStats& b) { return a.total > b.total; });
+    }
+
+    inline const std::vector<ProfileZoneStats>& Profiler::frameSummary() const {
+        return summary;
+    }
+
+    inline std::string Profiler::summaryText() const {
+        std::string text;
+        char line[256];
+        for (const ProfileZoneStats& s : summary) {
+            snprintf(line, sizeof(line), "%-32s %9.3f ms  max %8.3f ms  x%llu\n", s.name, s.total, s.max, static_cast<unsigned long long>(s.count));
+            text += line;
+        }
+        return text;
+    }
+
+    inline bool Profiler::writeChromeTrace(const char* filename) {
+        FILE* file = fopen(filename, "wb");
+        if (file == nullptr) {
+            std::cerr << "Profiler Error: cannot open " << filename << std::endl;
+            return false;
+        }
+        const auto all = snapshot();
+        uint64_t origin = UINT64_MAX;
+        for (const auto& buffer : all) {
+            const uint64_t count = buffer->count.load(std::memory_order_acquire);
+            for (uint64_t i = count > ProfileBuffer::CAPACITY ? count - ProfileBuffer::CAPACITY : 0; i < count; i++) {
+                origin = std::min(origin, buffer->events[i & (ProfileBuffer::CAPACITY - 1)].begin);
+            }
+        }
+
+        fputs("{\"traceEvents\":[\n", file);
+        bool first = true;
+        for (const auto& buffer : all) {
+            const uint64_t count = buffer->count.load(std::memory_order_acquire);
+            for (uint64_t i = count > ProfileBuffer::CAPACITY ? count - ProfileBuffer::CAPACITY : 0; i < count; i++) {
+                const ProfileEvent& e = buffer->events[i & (ProfileBuffer::CAPACITY - 1)];
+                // 区域名是代码里的字面量，只需转义引号和反斜杠
+                std::string name;
+                for (const char* p = e.name; *p; p++) {
+                    if (*p == '"' || *p == '\\') {
+                        name += '\\';
+                    }
+                    name += *p;
+                }
+                fprintf(file, "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":0,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}", first ? "" : ",\n", name.c_str(),
+                        buffer->threadId, (e.begin - origin) * 1e-3, (e.end - e.begin) * 1e-3);
+                first = false;
+            }
+        }
+        fputs("\n],\"displayTimeUnit\":\"ms\"}\n", file);
+        return fclose(file) == 0;
+    }
+
+    inline void Profiler::clear() {
+        for (const auto& buffer : snapshot()) {
+            buffer->frameCursor = buffer->count.load(std::memory_order_acquire);
+        }
+        summary.clear();
+    }
+
+    inline ProfileScope::ProfileScope(const char* n) {
+        if (Profiler::enabled()) {
+            name = n;
+            begin = Profiler::now();
+        }
+    }
+
+    inline ProfileScope::~ProfileScope() {
+        if (name != nullptr) {
+            Profiler::record(name, begin, Profiler::now());
+        }
+    }
+}
+
+#define RE_PROFILE_CONCAT_IMPL(a, b) a##b
+#define RE_PROFILE_CONCAT(a, b) RE_PROFILE_CONCAT_IMPL(a, b)
+
+#if RE_PROFILE
+#define RE_PROFILE_SCOPE(name) RE::ProfileScope RE_PROFILE_CONCAT(reProfileScope, __LINE__)(name)
+#else
+#define RE_PROFILE_SCOPE(name) ((void)0)
+#endif
+
+// 逐像素 / 逐采样这类极细粒度的区域，默认不编译，定义 RE_PROFILE_DETAIL 后启用
+#if RE_PROFILE && defined(RE_PROFILE_DETAIL)
+#define RE_PROFILE_SCOPE_DETAIL(name) RE_PROFILE_SCOPE(name)
+#else
+#define RE_PROFILE_SCOPE_DETAIL(name) ((void)0)
+#endif
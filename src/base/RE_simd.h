@@ -0,0 +1,31 @@
+#pragma once
+// SIMD 指令集检测，所有向量化代码都需要提供 RE_SIMD_NONE 下的标量回退
+
+#if defined(__AVX2__)
+#define RE_SIMD_AVX2 1
+#endif
+
+#if defined(__AVX__) || defined(__SSE4_1__)
+#define RE_SIMD_SSE41 1
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define RE_SIMD_SSE2 1
+#endif
+
+// MSVC 不定义 __F16C__，开启 /arch:AVX2 时 F16C 一定可用
+#if defined(__F16C__) || defined(__AVX2__)
+#define RE_SIMD_F16C 1
+#endif
+
+#if defined(RE_SIMD_SSE2)
+#include <immintrin.h>
+#else
+#define RE_SIMD_NONE 1
+#endif
+
+#if defined(_MSC_VER)
+#define RE_FORCEINLINE __forceinline
+#else
+#define RE_FORCEINLINE inline __attribute__((always_inline))
+#endif
@@ -0,0 +1,447 @@
+#define RE_EXTEND_NOISE_GENERATOR
+#include "RE_Benchmark.hpp"
+#include "RE_Geometry3D.hpp"
+#include "RE_OcclusionBuffer.hpp"
+#include "RE_Painter.hpp"
+#include "drawing/REX_NoiseGenerator.hpp"
+
+// 热点路径的基准测试，每个测试在多个分辨率下运行，名字形如 "Painter/drawLine/800x600"
+// 建立基线：xmake run benchmarks --out=baseline.json
+// 对比：    xmake run benchmarks --out=current.json --baseline=baseline.json
+
+namespace {
+    struct Resolution {
+        size_t width;
+        size_t height;
+    };
+    const Resolution resolutions[] = {{320, 240}, {800, 600}, {1920, 1080}};
+
+    std::string name(const char* group, const Resolution& r) {
+        return std::string(group) + "/" + std::to_string(r.width) + "x" + std::to_string(r.height);
+    }
+
+    // 固定种子，保证每次运行的图元完全一致
+    std::vector<glm::ivec4> randomSegments(const Resolution& r, size_t count) {
+        std::mt19937 gen(1234);
+        std::uniform_int_distribution<int> dx(0, static_cast<int>(r.width) - 1);
+        std::uniform_int_distribution<int> dy(0, static_cast<int>(r.height) - 1);
+        std::vector<glm::ivec4> segments(count);
+        for (auto& s : segments) {
+            s = glm::ivec4(dx(gen), dy(gen), dx(gen), dy(gen));
+        }
+        return segments;
+    }
+
+    RE::Polygon2D makePolygon(const Resolution& r) {
+        const size_t w = r.width, h = r.height;
+        return RE::Polygon2D({
+            {w / 10, h / 6},
+            {w / 2, h / 20},
+            {w * 9 / 10, h / 6},
+            {w * 7 / 10, h * 9 / 10},
+            {w / 4, h * 9 / 10},
+        });
+    }
+
+    // 随机内容的纹理，采样时各通道都有变化
+    void fillRandom(RE::TextureBase<uint8_t>& texture) {
+        std::mt19937 gen(42);
+        for (size_t i = 0; i < texture.length(); i++) {
+            texture.data()[i] = static_cast<uint8_t>(gen());
+        }
+    }
+
+    void registerPainter(const Resolution& r) {
+        RE::bench::add(name("Painter/drawPixel", r), [r](RE::bench::State& state) {
+            RE::ImageView<uint8_t> view(RE::UndersamplingFix::none);
+            RE::Painter<uint8_t> pt(&view);
+            pt.setSize(r.width, r.height, 3);
+            const RE::rgb color(0x20, 0x80, 0xff);
+            while (state.keepRunning()) {
+                for (size_t y = 0; y < r.height; y++) {
+                    for (size_t x = 0; x < r.width; x++) {
+                        pt.drawPixel(x, y, color);
+                    }
+                }
+            }
+            state.setItemsProcessed(r.width * r.height);
+        });
+
+        RE::bench::add(name("Painter/drawPixelBlend", r), [r](RE::bench::State& state) {
+            RE::ImageView<uint8_t> view(RE::UndersamplingFix::none);
+            RE::Painter<uint8_t> pt(&view);
+            pt.setSize(r.width, r.height, 3);
+            const RE::rgba color(0x20, 0x80, 0xff, 0x80);
+            while (state.keepRunning()) {
+                for (size_t y = 0; y < r.height; y++) {
+                    for (size_t x = 0; x < r.width; x++) {
+                        pt.drawPixel(x, y, color);
+                    }
+                }
+            }
+            state.setItemsProcessed(r.width * r.height);
+        });
+
+        RE::bench::add(name("Painter/drawLine", r), [r](RE::bench::State& state) {
+            RE::ImageView<uint8_t> view(RE::UndersamplingFix::none);
+            RE::Painter<uint8_t> pt(&view);
+            pt.setSize(r.width, r.height, 3);
+            const auto segments = randomSegments(r, 1000);
+            while (state.keepRunning()) {
+                for (const auto& s : segments) {
+                    pt.drawLine(s.x, s.y, s.z, s.w, RE::rgb(0xff, 0xff, 0xff));
+                }
+            }
+            state.setItemsProcessed(segments.size());
+        });
+
+        RE::bench::add(name("Painter/drawRect", r), [r](RE::bench::State& state) {
+            RE::ImageView<uint8_t> view(RE::UndersamplingFix::none);
+            RE::Painter<uint8_t> pt(&view);
+            pt.setSize(r.width, r.height, 3);
+            // 线段的两个端点作为矩形的两个角
+            const auto segments = randomSegments(r, 64);
+            while (state.keepRunning()) {
+                for (const auto& s : segments) {
+                    const size_t x = std::min(s.x, s.z), y = std::min(s.y, s.w);
+                    pt.drawRect(x, y, std::abs(s.z - s.x), std::abs(s.w - s.y), RE::rgb(0x40, 0x40, 0x40));
+                }
+            }
+            state.setItemsProcessed(segments.size());
+        });
+
+        RE::bench::add(name("Painter/drawPolygon", r), [r](RE::bench::State& state) {
+            RE::ImageView<uint8_t> view(RE::UndersamplingFix::none);
+            RE::Painter<uint8_t> pt(&view);
+            pt.setSize(r.width, r.height, 3);
+            RE::Polygon2D poly = makePolygon(r);
+            while (state.keepRunning()) {
+                pt.drawPolygon(poly, RE::rgb(0x00, 0xff, 0x00));
+            }
+            state.setItemsProcessed(1);
+        });
+
+        RE::bench::add(name("Painter/drawCircle", r), [r](RE::bench::State& state) {
+            RE::ImageView<uint8_t> view(RE::UndersamplingFix::none);
+            RE::Painter<uint8_t> pt(&view);
+            pt.setSize(r.width, r.height, 3);
+            const int radius = static_cast<int>(r.height / 4);
+            while (state.keepRunning()) {
+                for (int i = 1; i <= 4; i++) {
+                    pt.drawCircle(static_cast<int>(r.width * i / 5), static_cast<int>(r.height / 2), radius, RE::rgb(0xff, 0x00, 0x00));
+                }
+            }
+            state.setItemsProcessed(4);
+        });
+    }
+
+    void registerGeometry(const Resolution& r) {
+        RE::bench::add(name("Polygon2D/intersection", r), [r](RE::bench::State& state) {
+            RE::Polygon2D poly = makePolygon(r);
+            while (state.keepRunning()) {
+                for (size_t y = 0; y < r.height; y++) {
+                    auto points = poly.intersection(static_cast<int>(y));
+                    RE::bench::doNotOptimize(points.data());
+                }
+            }
+            state.setItemsProcessed(r.height);
+        });
+    }
+
+    void registerSampler(const Resolution& r) {
+        const RE::TextureFilter filters[] = {RE::TextureFilter::nearest, RE::TextureFilter::bilinear, RE::TextureFilter::bicubic};
+        const char* filterNames[] = {"nearest", "bilinear", "bicubic"};
+        const RE::TextureWrap wraps[] = {RE::TextureWrap::repeat, RE::TextureWrap::clamp, RE::TextureWrap::mirror};
+        const char* wrapNames[] = {"repeat", "clamp", "mirror"};
+        for (int f = 0; f < 3; f++) {
+            for (int w = 0; w < 3; w++) {
+                const std::string group = std::string("ImageView/getPixel/") + filterNames[f] + "/" + wrapNames[w];
+                const RE::TextureFilter filter = filters[f];
+                const RE::TextureWrap wrap = wraps[w];
+                RE::bench::add(name(group.c_str(), r), [r, filter, wrap](RE::bench::State& state) {
+                    RE::ImageView<uint8_t> view(RE::UndersamplingFix::none, wrap, filter);
+                    view.getTexture().setSize(r.width, r.height, 3);
+                    fillRandom(view.getTexture());
+                    // 256x256 的采样网格覆盖 [-0.5, 1.5]，一半的采样落在纹理外，走 wrap 分支
+                    constexpr size_t GRID = 256;
+                    uint32_t sum = 0;
+                    while (state.keepRunning()) {
+                        for (size_t j = 0; j < GRID; j++) {
+                            const float v = j * (2.0f / GRID) - 0.5f;
+                            for (size_t i = 0; i < GRID; i++) {
+                                const auto c = view.getPixel(i * (2.0f / GRID) - 0.5f, v);
+                                sum += c.r;
+                            }
+                        }
+                    }
+                    RE::bench::doNotOptimize(sum);
+                    state.setItemsProcessed(GRID * GRID);
+                });
+            }
+        }
+    }
+
+    void registerBuffer(const Resolution& r) {
+        RE::bench::add(name("Buffer3D/mix", r), [r](RE::bench::State& state) {
+            RE::Buffer3D<float> a(r.width, r.height, 4), b(r.width, r.height, 4), out(r.width, r.height, 4);
+            std::fill(a.data(), a.data() + a.length(), 0.25f);
+            std::fill(b.data(), b.data() + b.length(), 0.75f);
+            while (state.keepRunning()) {
+                RE::Buffer3D<float>::mix(&a, &b, &out, [](float x, float y) { return x * 0.3f + y * 0.7f; });
+            }
+            RE::bench::doNotOptimize(out.data()[0]);
+            state.setItemsProcessed(out.length());
+        });
+    }
+
+    // N x N 的四边形网格，顶点按行排列，四边形顺序打乱，模拟没有做过缓存优化的导入结果
+    RE::Mesh shuffledGrid(size_t n) {
+        RE::Mesh mesh;
+        mesh.resize((n + 1) * (n + 1), n * n * 6, true, true);
+        for (size_t y = 0; y <= n; y++) {
+            for (size_t x = 0; x <= n; x++) {
+                mesh.setVertex(y * (n + 1) + x, glm::vec3(x, y, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f), glm::vec2(x, y) / static_cast<float>(n));
+            }
+        }
+        std::vector<uint32_t> quads(n * n);
+        std::iota(quads.begin(), quads.end(), 0u);
+        std::shuffle(quads.begin(), quads.end(), std::mt19937(1));
+        uint32_t* indices = mesh.indices();
+        for (uint32_t q : quads) {
+            const uint32_t a = static_cast<uint32_t>(q / n * (n + 1) + q % n), b = a + 1, c = a + static_cast<uint32_t>(n) + 2, d = c - 1;
+            for (uint32_t i : {a, b, c, a, c, d}) {
+                *indices++ = i;
+            }
+        }
+        return mesh;
+    }
+
+    void registerMesh() {
+        // 计时包括每次迭代开始时恢复打乱的下标；counters 给出优化前后的 FIFO-32 ACMR
+        RE::bench::add("Mesh/optimizeVertexCache/300x300", [](RE::bench::State& state) {
+            RE::Mesh mesh = shuffledGrid(300);
+            const std::vector<uint32_t> shuffled(mesh.indices(), mesh.indices() + mesh.indexCount());
+            const float before = mesh.averageCacheMissRatio();
+            while (state.keepRunning()) {
+                std::copy(shuffled.begin(), shuffled.end(), mesh.indices());
+                mesh.optimizeVertexCache();
+            }
+            state.setItemsProcessed(mesh.triangleCount());
+            state.setCounter("acmr_before", before);
+            state.setCounter("acmr_after", mesh.averageCacheMissRatio());
+        });
+    }
+
+    // 固定种子的随机包围盒，分布在以原点为中心的扁平区域内
+    std::vector<RE::AABB> randomBoxes(size_t count) {
+        std::mt19937 gen(7);
+        std::uniform_real_distribution<float> position(-1000.0f, 1000.0f), extent(0.5f, 4.0f);
+        std::vector<RE::AABB> boxes(count);
+        for (auto& box : boxes) {
+            const glm::vec3 center(position(gen), position(gen) * 0.1f, position(gen));
+            const glm::vec3 e(extent(gen));
+            box = RE::AABB(center - e, center + e);
+        }
+        return boxes;
+    }
+
+    void registerCulling() {
+        // 深度范围 [0, w]，与 Frustum::fromMatrix 的约定一致
+        const glm::vec3 eye(0.0f, 0.0f, 100.0f);
+        const glm::mat4 viewProjection =
+            glm::perspectiveRH_ZO(1.0f, 16.0f / 9.0f, 0.1f, 3000.0f) * glm::lookAt(eye, glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+        const RE::Frustum frustum = RE::Frustum::fromMatrix(viewProjection);
+
+        // counters: visible 为可见物体数，mismatched 为与逐个测试包围盒的结果不一致的物体数
+        RE::bench::add("SceneBVH/cull/300k", [eye, frustum](RE::bench::State& state) {
+            const auto boxes = randomBoxes(300000);
+            RE::SceneBVH bvh;
+            bvh.build(boxes);
+            std::vector<uint32_t> visible;
+            while (state.keepRunning()) {
+                visible.clear();
+                bvh.cull(frustum, eye, visible);
+            }
+            std::vector<uint8_t> inside(boxes.size(), 0);
+            for (uint32_t i : visible) {
+                inside[i]++;
+            }
+            size_t mismatched = 0;
+            for (size_t i = 0; i < boxes.size(); i++) {
+                mismatched += inside[i] != (frustum.intersects(boxes[i]) ? 1 : 0);
+            }
+            state.setItemsProcessed(boxes.size());
+            state.setCounter("visible", static_cast<double>(visible.size()));
+            state.setCounter("mismatched", static_cast<double>(mismatched));
+        });
+
+        RE::bench::add("Frustum/intersects/300k", [frustum](RE::bench::State& state) {
+            const auto boxes = randomBoxes(300000);
+            size_t visible = 0;
+            while (state.keepRunning()) {
+                visible = 0;
+                for (const auto& box : boxes) {
+                    visible += frustum.intersects(box);
+                }
+                RE::bench::doNotOptimize(visible);
+            }
+            state.setItemsProcessed(boxes.size());
+            state.setCounter("visible", static_cast<double>(visible));
+        });
+    }
+
+    // 300 个随机的遮挡三角形加一面墙，位于相机前方 z = -8 到 -28 之间
+    void randomOccluders(std::vector<glm::vec3>& positions, std::vector<uint32_t>& indices) {
+        std::mt19937 gen(5);
+        std::uniform_real_distribution<float> u(-1.0f, 1.0f);
+        for (int t = 0; t < 300; t++) {
+            const glm::vec3 center(u(gen) * 15.0f, u(gen) * 8.0f, -8.0f - (u(gen) + 1.0f) * 10.0f);
+            for (int k = 0; k < 3; k++) {
+                indices.push_back(static_cast<uint32_t>(positions.size()));
+                positions.push_back(center + glm::vec3(u(gen) * 6.0f, u(gen) * 6.0f, u(gen) * 2.0f));
+            }
+        }
+        const uint32_t base = static_cast<uint32_t>(positions.size());
+        positions.insert(positions.end(), {{-8.0f, -4.0f, -12.0f}, {8.0f, -4.0f, -12.0f}, {-8.0f, 4.0f, -12.0f}, {8.0f, 4.0f, -12.0f}});
+        for (uint32_t i : {0u, 1u, 2u, 1u, 3u, 2u}) {
+            indices.push_back(base + i);
+        }
+    }
+
+    // 全分辨率的参考深度缓冲：逐像素在像素中心插值 NDC 深度，跨过近平面的三角形与 OcclusionBuffer 一样跳过
+    std::vector<float> referenceDepth(size_t width, size_t height, const glm::mat4& mvp, const std::vector<glm::vec3>& positions,
+                                      const std::vector<uint32_t>& indices) {
+        std::vector<float> depth(width * height, 1.0f);
+        for (size_t t = 0; t < indices.size() / 3; t++) {
+            glm::vec3 s[3];
+            bool visible = true;
+            for (int k = 0; k < 3; k++) {
+                const glm::vec4 c = mvp * glm::vec4(positions[indices[t * 3 + k]], 1.0f);
+                visible = visible && c.w > 1e-6f && c.z >= 0.0f;
+                s[k] = glm::vec3((c.x / c.w * 0.5f + 0.5f) * width, (0.5f - c.y / c.w * 0.5f) * height, c.z / c.w);
+            }
+            const float area = (s[1].x - s[0].x) * (s[2].y - s[0].y) - (s[1].y - s[0].y) * (s[2].x - s[0].x);
+            if (!visible || area == 0.0f) {
+                continue;
+            }
+            for (size_t y = 0; y < height; y++) {
+                for (size_t x = 0; x < width; x++) {
+                    const float px = x + 0.5f, py = y + 0.5f;
+                    const float w0 = ((s[1].x - px) * (s[2].y - py) - (s[1].y - py) * (s[2].x - px)) / area;
+                    const float w1 = ((s[2].x - px) * (s[0].y - py) - (s[2].y - py) * (s[0].x - px)) / area;
+                    const float w2 = 1.0f - w0 - w1;
+                    if (w0 >= 0.0f && w1 >= 0.0f && w2 >= 0.0f) {
+                        float& d = depth[y * width + x];
+                        d = std::min(d, w0 * s[0].z + w1 * s[1].z + w2 * s[2].z);
+                    }
+                }
+            }
+        }
+        return depth;
+    }
+
+    // 包围盒在参考深度缓冲中是否有像素可见（比参考深度更近）
+    bool referenceVisible(const RE::AABB& box, const glm::mat4& viewProjection, const std::vector<float>& depth, size_t width, size_t height) {
+        constexpr float inf = std::numeric_limits<float>::max();
+        float x0 = inf, y0 = inf, x1 = -inf, y1 = -inf, zMin = inf;
+        for (int k = 0; k < 8; k++) {
+            const glm::vec3 p((k & 1) ? box.max.x : box.min.x, (k & 2) ? box.max.y : box.min.y, (k & 4) ? box.max.z : box.min.z);
+            const glm::vec4 c = viewProjection * glm::vec4(p, 1.0f);
+            const float x = (c.x / c.w * 0.5f + 0.5f) * width, y = (0.5f - c.y / c.w * 0.5f) * height;
+            x0 = std::min(x0, x);
+            x1 = std::max(x1, x);
+            y0 = std::min(y0, y);
+            y1 = std::max(y1, y);
+            zMin = std::min(zMin, c.z / c.w);
+        }
+        const int64_t xEnd = std::min<int64_t>(static_cast<int64_t>(width), static_cast<int64_t>(std::ceil(x1)));
+        const int64_t yEnd = std::min<int64_t>(static_cast<int64_t>(height), static_cast<int64_t>(std::ceil(y1)));
+        for (int64_t y = std::max<int64_t>(0, static_cast<int64_t>(std::floor(y0))); y < yEnd; y++) {
+            for (int64_t x = std::max<int64_t>(0, static_cast<int64_t>(std::floor(x0))); x < xEnd; x++) {
+                if (zMin < depth[y * width + x] - 1e-5f) {
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    void registerOcclusion() {
+        // counters: unsafePixels 为保守深度上界比参考深度更近的像素数，
+        // wronglyOccluded 为被判为遮挡、但在参考深度缓冲中可见的包围盒数，两者都应为 0
+        RE::bench::add("OcclusionBuffer/renderOccluder/320x160", [](RE::bench::State& state) {
+            const glm::mat4 viewProjection = glm::perspectiveRH_ZO(1.0f, 2.0f, 0.1f, 100.0f);
+            std::vector<glm::vec3> positions;
+            std::vector<uint32_t> indices;
+            randomOccluders(positions, indices);
+            RE::OcclusionBuffer buffer(320, 160);
+            buffer.setViewProjection(viewProjection);
+            buffer.setCullBackFace(false);
+            while (state.keepRunning()) {
+                buffer.clear();
+                buffer.renderOccluder(positions.data(), indices.data(), indices.size() / 3, viewProjection);
+            }
+            state.setItemsProcessed(indices.size() / 3);
+
+            const size_t w = buffer.width(), h = buffer.height();
+            const auto depth = referenceDepth(w, h, viewProjection, positions, indices);
+            size_t unsafePixels = 0;
+            for (size_t y = 0; y < h; y++) {
+                for (size_t x = 0; x < w; x++) {
+                    unsafePixels += buffer.depthBound(x, y) < depth[y * w + x] - 1e-5f;
+                }
+            }
+            std::mt19937 gen(9);
+            std::uniform_real_distribution<float> u(-1.0f, 1.0f);
+            size_t occluded = 0, wronglyOccluded = 0;
+            for (int i = 0; i < 10000; i++) {
+                const glm::vec3 center(u(gen) * 20.0f, u(gen) * 10.0f, -5.0f - (u(gen) + 1.0f) * 30.0f);
+                const glm::vec3 e(1.2f + u(gen));
+                const RE::AABB box(center - e, center + e);
+                if (buffer.occluded(box)) {
+                    occluded++;
+                    wronglyOccluded += referenceVisible(box, viewProjection, depth, w, h);
+                }
+            }
+            state.setCounter("unsafePixels", static_cast<double>(unsafePixels));
+            state.setCounter("occluded", static_cast<double>(occluded));
+            state.setCounter("wronglyOccluded", static_cast<double>(wronglyOccluded));
+        });
+    }
+
+    void registerNoise(const Resolution& r) {
+        RE::bench::add(name("Noise/generatePerlinNoise", r), [r](RE::bench::State& state) {
+            RE::ImageView<uint8_t> view(RE::UndersamplingFix::none);
+            RE::Painter<uint8_t> pt(&view);
+            pt.setSize(r.width, r.height, 3);
+            while (state.keepRunning()) {
+                RE::generatePerlinNoise(&pt, 16);
+            }
+            state.setItemsProcessed(r.width * r.height);
+        });
+
+        RE::bench::add(name("Noise/generateFractalPerlinNoise", r), [r](RE::bench::State& state) {
+            RE::ImageView<uint8_t> view(RE::UndersamplingFix::none);
+            RE::Painter<uint8_t> pt(&view);
+            pt.setSize(r.width, r.height, 3);
+            while (state.keepRunning()) {
+                RE::generateFractalPerlinNoise(&pt);
+            }
+            state.setItemsProcessed(r.width * r.height);
+        });
+    }
+}
+
+int main(int argc, char* argv[]) {
+    for (const Resolution& r : resolutions) {
+        registerPainter(r);
+        registerGeometry(r);
+        registerSampler(r);
+        registerBuffer(r);
+        registerNoise(r);
+    }
+    registerMesh();
+    registerCulling();
+    registerOcclusion();
+    return RE::bench::runAll(argc, argv);
+}
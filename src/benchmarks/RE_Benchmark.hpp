@@ -0,0 +1,391 @@
+#pragma once
+#include "RE_includes.h"
+#include <chrono>
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+#include <sstream>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// 内置的微基准测试框架，用法与 Google Benchmark 相同：
+//   RE::bench::add("Painter/drawRect/800x600", [](RE::bench::State& state) {
+//       ... 准备数据（不计时）
+//       while (state.keepRunning()) { ... 被测代码 }
+//       state.setItemsProcessed(每次迭代处理的元素数);
+//       state.setCounter("acmr", 质量指标);   // 可选，随结果输出，不参与回退判断
+//   });
+//
+// 命令行参数：
+//   --filter=<子串>      只运行名字包含该子串的测试
+//   --list               只列出测试名
+//   --min-time=<毫秒>    每次重复的最短计时，默认 100
+//   --repetitions=<n>    重复次数，取中位数，默认 5
+//   --out=<文件>         写出 JSON 结果
+//   --baseline=<文件>    与之前写出的 JSON 比较，有回退时返回值为 1
+//   --threshold=<比例>   中位数变慢超过该比例判定为回退，默认 0.1
+namespace RE::bench {
+    using Clock = std::chrono::steady_clock;
+
+    // 单次运行的计时状态，只计 keepRunning 循环内的时间
+    class State {
+    public:
+        explicit State(uint64_t iterations);
+
+        bool keepRunning();
+        // 每次迭代处理的元素数（像素、图元、采样等），用于计算吞吐量
+        void setItemsProcessed(uint64_t itemsPerIteration);
+        // 附加的统计量（缓存未命中率、与参考实现不一致的个数等），同名时覆盖
+        void setCounter(const std::string& name, double value);
+
+        uint64_t iterations() const;
+        uint64_t itemsProcessed() const;
+        double elapsedNs() const;
+        const std::vector<std::pair<std::string, double>>& counters() const;
+
+    private:
+        uint64_t target;
+        uint64_t done = 0;
+        uint64_t items = 0;
+        bool running = false;
+        Clock::time_point start;
+        double elapsed = 0.0;
+        std::vector<std::pair<std::string, double>> _counters;
+    };
+
+    struct Benchmark {
+        std::string name;
+        std::function<void(State&)> fn;
+    };
+
+    struct Result {
+        std::string name;
+        uint64_t iterations = 0;
+        size_t repetitions = 0;
+        double median = 0.0; // 每次迭代的纳秒数
+        double mean = 0.0;
+        double min = 0.0;
+        double stddev = 0.0;
+        double itemsPerSecond = 0.0;
+        std::vector<std::pair<std::string, double>> counters; // 取最后一次重复的值
+    };
+
+    struct Options {
+        std::string filter;
+        std::string output;
+        std::string baseline;
+        double minTime = 100.0; // 毫秒
+        size_t repetitions = 5;
+        double threshold = 0.1;
+        bool list = false;
+    };
+
+    std::vector<Benchmark>& registry();
+    void add(const std::string& name, std::function<void(State&)> fn);
+
+    // 阻止编译器把结果未被使用的计算优化掉
+    template <typename T>
+    RE_FORCEINLINE void doNotOptimize(const T& value);
+
+    bool parseOptions(int argc, char* argv[], Options& options);
+    Result run(const Benchmark& benchmark, const Options& options);
+    bool writeJson(const char* filename, const std::vector<Result>& results);
+    // 读取 writeJson 写出的文件，失败时返回 false
+    bool readBaseline(const char* filename, std::unordered_map<std::string, Result>& baseline);
+    // 打印对比表，返回回退的测试数
+    size_t compare(const std::vector<Result>& results, const std::unordered_map<std::string, Result>& baseline, double threshold);
+    // 解析参数并运行所有已注册的测试，返回进程退出码：0 正常，1 有性能回退，2 参数或文件错误
+    int runAll(int argc, char* argv[]);
+}
+
+namespace RE::bench {
+    inline State::State(uint64_t iterations) : target(std::max<uint64_t>(iterations, 1)) {}
+
+    inline bool State::keepRunning() {
+        if (!running && done == 0) {
+            running = true;
+            start = Clock::now();
+        }
+        if (done < target) {
+            done++;
+            return true;
+        }
+        if (running) {
+            elapsed = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+            running = false;
+        }
+        return false;
+    }
+
+    inline void State::setItemsProcessed(uint64_t itemsPerIteration) {
+        items = itemsPerIteration;
+    }
+
+    inline void State::setCounter(const std::string& name, double value) {
+        for (auto& counter : _counters) {
+            if (counter.first == name) {
+                counter.second = value;
+                return;
+            }
+        }
+        _counters.emplace_back(name, value);
+    }
+
+    inline uint64_t State::iterations() const {
+        return target;
+    }
+
+    inline uint64_t State::itemsProcessed() const {
+        return items;
+    }
+
+    inline double State::elapsedNs() const {
+        return elapsed;
+    }
+
+    inline const std::vector<std::pair<std::string, double>>& State::counters() const {
+        return _counters;
+    }
+
+    inline std::vector<Benchmark>& registry() {
+        static std::vector<Benchmark> benchmarks;
+        return benchmarks;
+    }
+
+    inline void add(const std::string& name, std::function<void(State&)> fn) {
+        registry().push_back(Benchmark{name, std::move(fn)});
+    }
+
+    template <typename T>
+    RE_FORCEINLINE void doNotOptimize(const T& value) {
+#if defined(_MSC_VER) && !defined(__clang__)
+        static volatile const void* sink;
+        sink = &value;
+        _ReadWriteBarrier();
+#else
+        asm volatile("" : : "r,m"(value) : "memory");
+#endif
+    }
+
+    inline bool parseOptions(int argc, char* argv[], Options& options) {
+        for (int i = 1; i < argc; i++) {
+            const std::string arg = argv[i];
+            const size_t eq = arg.find('=');
+            const std::string key = arg.substr(0, eq);
+            const std::string value = eq == std::string::npos ? "" : arg.substr(eq + 1);
+            if (key == "--filter") {
+                options.filter = value;
+            } else if (key == "--list") {
+                options.list = true;
+            } else if (key == "--min-time") {
+                options.minTime = std::max(std::atof(value.c_str()), 1.0);
+            } else if (key == "--repetitions") {
+                options.repetitions = std::max(std::atoi(value.c_str()), 1);
+            } else if (key == "--out") {
+                options.output = value;
+            } else if (key == "--baseline") {
+                options.baseline = value;
+            } else if (key == "--threshold") {
+                options.threshold = std::max(std::atof(value.c_str()), 0.0);
+            } else {
+                std::cerr << "Benchmark Error: unknown option " << arg << std::endl;
+                return false;
+            }
+        }
+        return true;
+    }
+
+    inline Result run(const Benchmark& benchmark, const Options& options) {
+        const double minTime = options.minTime * 1e6;
+        // 从 1 次开始按实测耗时放大迭代次数，直到单次运行达到 minTime
+        uint64_t iterations = 1;
+        for (;;) {
+            State state(iterations);
+            benchmark.fn(state);
+            const double elapsed = std::max(state.elapsedNs(), 1.0);
+            if (elapsed >= minTime || iterations >= (1ull << 30)) {
+                break;
+            }
+            const double predicted = minTime * 1.2 / (elapsed / iterations);
+            iterations = static_cast<uint64_t>(std::clamp(predicted, iterations * 2.0, iterations * 100.0));
+        }
+
+        Result result;
+        result.name = benchmark.name;
+        result.iterations = iterations;
+        result.repetitions = options.repetitions;
+        std::vector<double> samples;
+        uint64_t items = 0;
+        for (size_t r = 0; r < options.repetitions; r++) {
+            State state(iterations);
+            benchmark.fn(state);
+            samples.push_back(state.elapsedNs() / iterations);
+            items = state.itemsProcessed();
+            result.counters = state.counters();
+        }
+        std::sort(samples.begin(), samples.end());
+        const size_t n = samples.size();
+        result.median = n % 2 ? samples[n / 2] : (samples[n / 2 - 1] + samples[n / 2]) * 0.5;
+        result.min = samples.front();
+        result.mean = std::accumulate(samples.begin(), samples.end(), 0.0) / n;
+        double variance = 0.0;
+        for (double s : samples) {
+            variance += (s - result.mean) * (s - result.mean);
+        }
+        result.stddev = n > 1 ? std::sqrt(variance / (n - 1)) : 0.0;
+        result.itemsPerSecond = items > 0 && result.median > 0.0 ? items * 1e9 / result.median : 0.0;
+        return result;
+    }
+
+    inline bool writeJson(const char* filename, const std::vector<Result>& results) {
+        FILE* file = fopen(filename, "wb");
+        if (file == nullptr) {
+            std::cerr << "Benchmark Error: cannot open " << filename << std::endl;
+            return false;
+        }
+        const char* simd =
+#if defined(RE_SIMD_AVX2)
+            "AVX2";
+#elif defined(RE_SIMD_SSE41)
+            "SSE4.1";
+#elif defined(RE_SIMD_SSE2)
+            "SSE2";
+#else
+            "none";
+#endif
+        const std::time_t date = std::time(nullptr);
+        char dateText[32];
+        std::strftime(dateText, sizeof(dateText), "%Y-%m-%dT%H:%M:%S", std::localtime(&date));
+        fprintf(file, "{\n\"context\":{\"date\":\"%s\",\"threads\":%u,\"simd\":\"%s\",\"debug\":%s},\n\"benchmarks\":[\n", dateText,
+                std::thread::hardware_concurrency(), simd,
+#ifdef NDEBUG
+                "false"
+#else
+                "true"
+#endif
+        );
+        // 每个测试一行，便于 diff 以及 readBaseline 解析；counters 放在最后，readBaseline 只读它之前的字段
+        for (size_t i = 0; i < results.size(); i++) {
+            const Result& r = results[i];
+            fprintf(file,
+                    "{\"name\":\"%s\",\"iterations\":%llu,\"repetitions\":%zu,\"median_ns\":%.3f,\"mean_ns\":%.3f,\"min_ns\":%.3f,\"stddev_ns\":%.3f,"
+                    "\"items_per_second\":%.1f",
+                    r.name.c_str(), static_cast<unsigned long long>(r.iterations), r.repetitions, r.median, r.mean, r.min, r.stddev, r.itemsPerSecond);
+            if (!r.counters.empty()) {
+                fputs(",\"counters\":{", file);
+                for (size_t c = 0; c < r.counters.size(); c++) {
+                    fprintf(file, "%s\"%s\":%.6g", c > 0 ? "," : "", r.counters[c].first.c_str(), r.counters[c].second);
+                }
+                fputc('}', file);
+            }
+            fprintf(file, "}%s\n", i + 1 < results.size() ? "," : "");
+        }
+        fputs("]\n}\n", file);
+        return fclose(file) == 0;
+    }
+
+    inline bool readBaseline(const char* filename, std::unordered_map<std::string, Result>& baseline) {
+        std::ifstream file(filename, std::ios::binary);
+        if (!file) {
+            std::cerr << "Benchmark Error: cannot open baseline " << filename << std::endl;
+            return false;
+        }
+        std::stringstream buffer;
+        buffer << file.rdbuf();
+        const std::string text = buffer.str();
+
+        auto number = [&](size_t begin, size_t end, const char* key) {
+            const size_t at = text.find(key, begin);
+            return at < end ? std::strtod(text.c_str() + at + strlen(key), nullptr) : 0.0;
+        };
+        const std::string nameKey = "\"name\":\"";
+        for (size_t at = text.find(nameKey); at != std::string::npos; at = text.find(nameKey, at)) {
+            const size_t nameBegin = at + nameKey.size();
+            const size_t nameEnd = text.find('"', nameBegin);
+            const size_t objectEnd = text.find('}', nameBegin);
+            if (nameEnd == std::string::npos || objectEnd == std::string::npos) {
+                break;
+            }
+            Result r;
+            r.name = text.substr(nameBegin, nameEnd - nameBegin);
+            r.median = number(nameEnd, objectEnd, "\"median_ns\":");
+            r.mean = number(nameEnd, objectEnd, "\"mean_ns\":");
+            r.min = number(nameEnd, objectEnd, "\"min_ns\":");
+            r.stddev = number(nameEnd, objectEnd, "\"stddev_ns\":");
+            r.itemsPerSecond = number(nameEnd, objectEnd, "\"items_per_second\":");
+            baseline[r.name] = r;
+            at = objectEnd;
+        }
+        if (baseline.empty()) {
+            std::cerr << "Benchmark Error: no results in baseline " << filename << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    inline size_t compare(const std::vector<Result>& results, const std::unordered_map<std::string, Result>& baseline, double threshold) {
+        size_t regressions = 0;
+        printf("\n%-48s %14s %14s %9s\n", "benchmark", "baseline ns", "current ns", "change");
+        for (const Result& r : results) {
+            const auto it = baseline.find(r.name);
+            if (it == baseline.end() || it->second.median <= 0.0) {
+                printf("%-48s %14s %14.1f %9s\n", r.name.c_str(), "-", r.median, "new");
+                continue;
+            }
+            const double change = r.median / it->second.median - 1.0;
+            const char* mark = "";
+            if (change > threshold) {
+                mark = "  REGRESSION";
+                regressions++;
+            } else if (change < -threshold) {
+                mark = "  improved";
+            }
+            printf("%-48s %14.1f %14.1f %+8.1f%%%s\n", r.name.c_str(), it->second.median, r.median, change * 100.0, mark);
+        }
+        printf("\n%zu regression(s) over %.0f%%\n", regressions, threshold * 100.0);
+        return regressions;
+    }
+
+    inline int runAll(int argc, char* argv[]) {
+        Options options;
+        if (!parseOptions(argc, argv, options)) {
+            return 2;
+        }
+        std::unordered_map<std::string, Result> baseline;
+        if (!options.baseline.empty() && !readBaseline(options.baseline.c_str(), baseline)) {
+            return 2;
+        }
+
+        std::vector<Result> results;
+        for (const Benchmark& benchmark : registry()) {
+            if (!options.filter.empty() && benchmark.name.find(options.filter) == std::string::npos) {
+                continue;
+            }
+            if (options.list) {
+                printf("%s\n", benchmark.name.c_str());
+                continue;
+            }
+            const Result r = run(benchmark, options);
+            printf("%-48s %14.1f ns  +-%5.1f%%  %12.3f M items/s  x%llu", r.name.c_str(), r.median, r.median > 0.0 ? r.stddev / r.median * 100.0 : 0.0,
+                   r.itemsPerSecond * 1e-6, static_cast<unsigned long long>(r.iterations));
+            for (const auto& counter : r.counters) {
+                printf("  %s=%g", counter.first.c_str(), counter.second);
+            }
+            printf("\n");
+            fflush(stdout);
+            results.push_back(r);
+        }
+        if (options.list) {
+            return 0;
+        }
+
+        if (!options.output.empty() && !writeJson(options.output.c_str(), results)) {
+            return 2;
+        }
+        if (!options.baseline.empty()) {
+            return compare(results, baseline, options.threshold) > 0 ? 1 : 0;
+        }
+        return 0;
+    }
+}
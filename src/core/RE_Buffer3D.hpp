@@ -2,30 +2,87 @@
 #include "RE_includes.h"
 
 namespace RE {
+    template <typename E>
+    struct BufferExpr;
+
+    // Buffer3D 的底层存储，既可以自己持有内存，也可以接管外部分配的内存（如 stbi_load 的结果）
+    template <typename T>
+    class BufferStorage {
+    public:
+        BufferStorage() = default;
+        ~BufferStorage();
+        BufferStorage(const BufferStorage<T>&) = delete;
+        BufferStorage(BufferStorage<T>&& other) noexcept;
+        BufferStorage<T>& operator=(const BufferStorage<T>&) = delete;
+        BufferStorage<T>& operator=(BufferStorage<T>&& other) noexcept;
+
+        T* data();
+        const T* data() const;
+        size_t size() const;
+        T* begin();
+        T* end();
+        T& operator[](size_t index);
+        const T& operator[](size_t index) const;
+
+        // 外部内存 resize 时会先拷贝到自有内存再释放外部内存
+        void resize(size_t length);
+        void clear();
+
+        // 接管 ptr，析构或被替换时调用 release(ptr)
+        void adopt(T* ptr, size_t length, std::function<void(T*)> release);
+        bool external() const;
+
+    private:
+        std::vector<T> _owned;
+        T* _ptr = nullptr;
+        size_t _size = 0;
+        std::function<void(T*)> _release;
+
+        void releaseExternal();
+    };
+
     template <typename T>
     class Buffer3D {
     public:
         Buffer3D(size_t width, size_t height, size_t channel);
         Buffer3D(T* arr, size_t width, size_t height, size_t channel);
         ~Buffer3D(){};
-        Buffer3D(Buffer3D<T>& other);
+        Buffer3D(const Buffer3D<T>& other);
         Buffer3D(Buffer3D<T>&& other) noexcept;
-        Buffer3D<T>& operator=(Buffer3D<T>& other);
-        Buffer3D<T>&& operator=(Buffer3D<T>&& other) noexcept;
+        Buffer3D<T>& operator=(const Buffer3D<T>& other);
+        Buffer3D<T>& operator=(Buffer3D<T>&& other) noexcept;
 
+        // 对表达式求值并写入自身，见 RE_BufferExpr.hpp
+        template <typename E>
+        Buffer3D<T>& operator=(const BufferExpr<E>& expr);
+
+        // 逐元素 result = func(buffer1, buffer2)，多线程且允许编译器向量化 func
+        // 内置运算（调制、加减、插值等）优先用表达式，多个运算可以在一次遍历里完成
         template <typename FN_T>
         static auto mix(Buffer3D<T>* buffer1, Buffer3D<T>* buffer2, Buffer3D<T>* result, FN_T func) {
-            return std::transform(buffer1->_data.begin(), buffer1->_data.end(), buffer2->_data.begin(), result->_data.begin(), func);
+            const T* a = buffer1->_data.data();
+            const T* b = buffer2->_data.data();
+            T* out = result->_data.data();
+            const int64_t n = static_cast<int64_t>(std::min(buffer1->_data.size(), result->_data.size()));
+#pragma omp parallel for simd schedule(static)
+            for (int64_t i = 0; i < n; i++) {
+                out[i] = func(a[i], b[i]);
+            }
+            return result->_data.begin() + n;
         }
 
         void copyFrom(T* arr);
-        void copyFrom(Buffer3D<T>* dst);
+        void copyFrom(Buffer3D<T>* src);
 
         T* data();
+        const T* data() const;
         void clear();
         void setZero();
         void setSize(size_t width, size_t height, size_t channel);
 
+        // 零拷贝接管外部内存作为数据，arr 的长度必须为 width * height * channel
+        void adopt(T* arr, size_t width, size_t height, size_t channel, std::function<void(T*)> release);
+
         // start from 0 , 相当于 y
         size_t getRow(size_t index) const;
 
@@ -48,51 +105,144 @@ namespace RE {
         size_t area() const;
 
     protected:
-        std::vector<T> _data;
+        BufferStorage<T> _data;
 
     private:
         size_t _width, _height, _channel;
         size_t _length;
         size_t _area;
 
-        void attributeCopy(Buffer3D<T>& other);
+        void attributeCopy(const Buffer3D<T>& other);
     };
 }
 
 namespace RE {
+    template <typename T>
+    BufferStorage<T>::~BufferStorage() {
+        releaseExternal();
+    }
 
     template <typename T>
-    Buffer3D<T>::Buffer3D(Buffer3D<T>& other) {
+    BufferStorage<T>::BufferStorage(BufferStorage<T>&& other) noexcept {
+        *this = std::move(other);
+    }
+
+    template <typename T>
+    BufferStorage<T>& BufferStorage<T>::operator=(BufferStorage<T>&& other) noexcept {
+        if (this != &other) {
+            releaseExternal();
+            const bool isExternal = other.external();
+            _owned = std::move(other._owned);
+            _release = std::move(other._release);
+            _ptr = isExternal ? other._ptr : _owned.data();
+            _size = other._size;
+            other._release = nullptr;
+            other._ptr = nullptr;
+            other._size = 0;
+        }
+        return *this;
+    }
+
+    template <typename T>
+    T* BufferStorage<T>::data() { return _ptr; }
+    template <typename T>
+    const T* BufferStorage<T>::data() const { return _ptr; }
+    template <typename T>
+    size_t BufferStorage<T>::size() const { return _size; }
+    template <typename T>
+    T* BufferStorage<T>::begin() { return _ptr; }
+    template <typename T>
+    T* BufferStorage<T>::end() { return _ptr + _size; }
+    template <typename T>
+    T& BufferStorage<T>::operator[](size_t index) { return _ptr[index]; }
+    template <typename T>
+    const T& BufferStorage<T>::operator[](size_t index) const { return _ptr[index]; }
+
+    template <typename T>
+    void BufferStorage<T>::resize(size_t length) {
+        if (external()) {
+            std::vector<T> owned(length);
+            memcpy(owned.data(), _ptr, sizeof(T) * std::min(length, _size));
+            releaseExternal();
+            _owned = std::move(owned);
+        } else {
+            _owned.resize(length);
+        }
+        _ptr = _owned.data();
+        _size = length;
+    }
+
+    template <typename T>
+    void BufferStorage<T>::clear() {
+        releaseExternal();
+        _owned.clear();
+        _ptr = _owned.data();
+        _size = 0;
+    }
+
+    template <typename T>
+    void BufferStorage<T>::adopt(T* ptr, size_t length, std::function<void(T*)> release) {
+        releaseExternal();
+        _owned.clear();
+        _owned.shrink_to_fit();
+        _ptr = ptr;
+        _size = length;
+        _release = std::move(release);
+    }
+
+    template <typename T>
+    bool BufferStorage<T>::external() const {
+        return static_cast<bool>(_release);
+    }
+
+    template <typename T>
+    void BufferStorage<T>::releaseExternal() {
+        if (_release) {
+            _release(_ptr);
+            _release = nullptr;
+            _ptr = nullptr;
+            _size = 0;
+        }
+    }
+
+    template <typename T>
+    Buffer3D<T>::Buffer3D(const Buffer3D<T>& other) {
         attributeCopy(other);
-        memcpy(other.data(), data(), sizeof(T) * _length);
+        _data.resize(_length);
+        memcpy(_data.data(), other.data(), sizeof(T) * _length);
     }
 
     template <typename T>
     Buffer3D<T>::Buffer3D(Buffer3D<T>&& other) noexcept {
         attributeCopy(other);
-        other._data = _data;
+        _data = std::move(other._data);
     }
 
     template <typename T>
-    Buffer3D<T>& Buffer3D<T>::operator=(Buffer3D<T>& other) {
-        attributeCopy(other);
-        memcpy(other.data(), data(), sizeof(T) * _length);
+    Buffer3D<T>& Buffer3D<T>::operator=(const Buffer3D<T>& other) {
+        if (this != &other) {
+            attributeCopy(other);
+            _data.resize(_length);
+            memcpy(_data.data(), other.data(), sizeof(T) * _length);
+        }
+        return *this;
     }
 
     template <typename T>
-    Buffer3D<T>&& Buffer3D<T>::operator=(Buffer3D<T>&& other) noexcept {
+    Buffer3D<T>& Buffer3D<T>::operator=(Buffer3D<T>&& other) noexcept {
         attributeCopy(other);
-        other._data = _data;
+        _data = std::move(other._data);
+        return *this;
     }
 
     template <typename T>
     void Buffer3D<T>::copyFrom(T* arr) {
-        memcpy(arr, _data.data(), sizeof(T) * _length);
+        memcpy(_data.data(), arr, sizeof(T) * _length);
     }
 
     template <typename T>
-    void Buffer3D<T>::copyFrom(Buffer3D<T>* dst) {
-        memcpy(dst->data(), _data.data(), sizeof(T) * _length);
+    void Buffer3D<T>::copyFrom(Buffer3D<T>* src) {
+        memcpy(_data.data(), src->data(), sizeof(T) * _length);
     }
 
     template <typename T>
@@ -100,6 +250,11 @@ namespace RE {
         return _data.data();
     }
 
+    template <typename T>
+    const T* Buffer3D<T>::data() const {
+        return _data.data();
+    }
+
     template <typename T>
     void Buffer3D<T>::clear() {
         _data.clear();
@@ -120,6 +275,16 @@ namespace RE {
         _data.resize(_length);
     }
 
+    template <typename T>
+    void Buffer3D<T>::adopt(T* arr, size_t width, size_t height, size_t channel, std::function<void(T*)> release) {
+        _width = width;
+        _height = height;
+        _channel = channel;
+        _length = width * height * channel;
+        _area = width * height;
+        _data.adopt(arr, _length, std::move(release));
+    }
+
     template <typename T>
     size_t Buffer3D<T>::getRow(size_t index) const {
         return (index / _channel) / _width;
@@ -152,7 +317,7 @@ namespace RE {
     size_t Buffer3D<T>::area() const { return _area; }
 
     template <typename T>
-    void Buffer3D<T>::attributeCopy(Buffer3D<T>& other) {
+    void Buffer3D<T>::attributeCopy(const Buffer3D<T>& other) {
         _width = other._width;
         _height = other._height;
         _channel = other._channel;
@@ -170,8 +335,10 @@ namespace RE {
     template <typename T>
     inline Buffer3D<T>::Buffer3D(T* arr, size_t w, size_t h, size_t c) : _width(w), _height(h), _channel(c) {
         _data.resize(w * h * c);
-        this->copyFrom(arr);
         _length = _width * _height * _channel;
         _area = _width * _height;
+        this->copyFrom(arr);
     }
-}
\ No newline at end of file
+}
+
+#include "RE_BufferExpr.hpp"
@@ -0,0 +1,402 @@
+#pragma once
+#include "RE_includes.h"
+#include "RE_Buffer3D.hpp"
+
+// Buffer3D 的逐元素表达式模板
+// a * b + c 只构建表达式树，赋值给 Buffer3D 时在一个融合的循环里求值（SIMD + 多线程），不产生中间缓冲
+// uint8_t 视为 [0, 255] 表示的 [0, 1]：加减饱和，乘法为归一化调制 a * b / 255，标量同样按 255 = 1 处理
+namespace RE {
+    // 各元素类型的标量 / 向量运算，V 为向量类型，WIDTH 为每个向量的元素数
+    // 没有特化的类型按普通算术运算逐元素求值
+    template <typename T>
+    struct ExprMath {
+        using V = T;
+        static constexpr size_t WIDTH = 1;
+        static V load(const T* p) { return *p; }
+        static void store(T* p, V v) { *p = v; }
+        static V set1(T x) { return x; }
+        static T add(T a, T b) { return a + b; }
+        static T sub(T a, T b) { return a - b; }
+        static T mul(T a, T b) { return a * b; }
+        static T min(T a, T b) { return std::min(a, b); }
+        static T max(T a, T b) { return std::max(a, b); }
+        static T lerp(T a, T b, T t) { return a + (b - a) * t; }
+    };
+
+    template <>
+    struct ExprMath<uint8_t> {
+        static uint8_t add(uint8_t a, uint8_t b) { return static_cast<uint8_t>(std::min(a + b, 255)); }
+        static uint8_t sub(uint8_t a, uint8_t b) { return static_cast<uint8_t>(std::max(a - b, 0)); }
+        static uint8_t div255(uint32_t x) { return static_cast<uint8_t>((x + 128 + ((x + 128) >> 8)) >> 8); }
+        static uint8_t mul(uint8_t a, uint8_t b) { return div255(a * b); }
+        static uint8_t min(uint8_t a, uint8_t b) { return std::min(a, b); }
+        static uint8_t max(uint8_t a, uint8_t b) { return std::max(a, b); }
+        static uint8_t lerp(uint8_t a, uint8_t b, uint8_t t) { return div255(a * (255 - t) + b * t); }
+#if defined(RE_SIMD_AVX2)
+        using V = __m256i;
+        static constexpr size_t WIDTH = 32;
+        static V load(const uint8_t* p) { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)); }
+        static void store(uint8_t* p, V v) { _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), v); }
+        static V set1(uint8_t x) { return _mm256_set1_epi8(static_cast<char>(x)); }
+        static V add(V a, V b) { return _mm256_adds_epu8(a, b); }
+        static V sub(V a, V b) { return _mm256_subs_epu8(a, b); }
+        static V min(V a, V b) { return _mm256_min_epu8(a, b); }
+        static V max(V a, V b) { return _mm256_max_epu8(a, b); }
+        // 16 位下的 (x + 128 + ((x + 128) >> 8)) >> 8，x <= 255 * 255
+        static V div255(V x) {
+            x = _mm256_add_epi16(x, _mm256_set1_epi16(128));
+            return _mm256_srli_epi16(_mm256_add_epi16(x, _mm256_srli_epi16(x, 8)), 8);
+        }
+        static V mul(V a, V b) {
+            const V zero = _mm256_setzero_si256();
+            const V lo = div255(_mm256_mullo_epi16(_mm256_unpacklo_epi8(a, zero), _mm256_unpacklo_epi8(b, zero)));
+            const V hi = div255(_mm256_mullo_epi16(_mm256_unpackhi_epi8(a, zero), _mm256_unpackhi_epi8(b, zero)));
+            return _mm256_packus_epi16(lo, hi); // unpack / pack 都在 128 位 lane 内，顺序保持不变
+        }
+        static V lerp(V a, V b, V t) {
+            const V zero = _mm256_setzero_si256();
+            const V inv = _mm256_sub_epi8(_mm256_set1_epi8(-1), t);
+            const V lo = div255(_mm256_add_epi16(_mm256_mullo_epi16(_mm256_unpacklo_epi8(a, zero), _mm256_unpacklo_epi8(inv, zero)),
+                                                 _mm256_mullo_epi16(_mm256_unpacklo_epi8(b, zero), _mm256_unpacklo_epi8(t, zero))));
+            const V hi = div255(_mm256_add_epi16(_mm256_mullo_epi16(_mm256_unpackhi_epi8(a, zero), _mm256_unpackhi_epi8(inv, zero)),
+                                                 _mm256_mullo_epi16(_mm256_unpackhi_epi8(b, zero), _mm256_unpackhi_epi8(t, zero))));
+            return _mm256_packus_epi16(lo, hi);
+        }
+#elif defined(RE_SIMD_SSE2)
+        using V = __m128i;
+        static constexpr size_t WIDTH = 16;
+        static V load(const uint8_t* p) { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)); }
+        static void store(uint8_t* p, V v) { _mm_storeu_si128(reinterpret_cast<__m128i*>(p), v); }
+        static V set1(uint8_t x) { return _mm_set1_epi8(static_cast<char>(x)); }
+        static V add(V a, V b) { return _mm_adds_epu8(a, b); }
+        static V sub(V a, V b) { return _mm_subs_epu8(a, b); }
+        static V min(V a, V b) { return _mm_min_epu8(a, b); }
+        static V max(V a, V b) { return _mm_max_epu8(a, b); }
+        static V div255(V x) {
+            x = _mm_add_epi16(x, _mm_set1_epi16(128));
+            return _mm_srli_epi16(_mm_add_epi16(x, _mm_srli_epi16(x, 8)), 8);
+        }
+        static V mul(V a, V b) {
+            const V zero = _mm_setzero_si128();
+            const V lo = div255(_mm_mullo_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero)));
+            const V hi = div255(_mm_mullo_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero)));
+            return _mm_packus_epi16(lo, hi);
+        }
+        static V lerp(V a, V b, V t) {
+            const V zero = _mm_setzero_si128();
+            const V inv = _mm_sub_epi8(_mm_set1_epi8(-1), t);
+            const V lo = div255(_mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(inv, zero)),
+                                              _mm_mullo_epi16(_mm_unpacklo_epi8(b, zero), _mm_unpacklo_epi8(t, zero))));
+            const V hi = div255(_mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(inv, zero)),
+                                              _mm_mullo_epi16(_mm_unpackhi_epi8(b, zero), _mm_unpackhi_epi8(t, zero))));
+            return _mm_packus_epi16(lo, hi);
+        }
+#else
+        using V = uint8_t;
+        static constexpr size_t WIDTH = 1;
+        static V load(const uint8_t* p) { return *p; }
+        static void store(uint8_t* p, V v) { *p = v; }
+        static V set1(uint8_t x) { return x; }
+#endif
+    };
+
+#if defined(RE_SIMD_SSE2)
+    template <>
+    struct ExprMath<float> {
+        static float add(float a, float b) { return a + b; }
+        static float sub(float a, float b) { return a - b; }
+        static float mul(float a, float b) { return a * b; }
+        static float min(float a, float b) { return std::min(a, b); }
+        static float max(float a, float b) { return std::max(a, b); }
+        static float lerp(float a, float b, float t) { return a + (b - a) * t; }
+#if defined(RE_SIMD_AVX2)
+        using V = __m256;
+        static constexpr size_t WIDTH = 8;
+        static V load(const float* p) { return _mm256_loadu_ps(p); }
+        static void store(float* p, V v) { _mm256_storeu_ps(p, v); }
+        static V set1(float x) { return _mm256_set1_ps(x); }
+        static V add(V a, V b) { return _mm256_add_ps(a, b); }
+        static V sub(V a, V b) { return _mm256_sub_ps(a, b); }
+        static V mul(V a, V b) { return _mm256_mul_ps(a, b); }
+        static V min(V a, V b) { return _mm256_min_ps(a, b); }
+        static V max(V a, V b) { return _mm256_max_ps(a, b); }
+        static V lerp(V a, V b, V t) { return _mm256_add_ps(a, _mm256_mul_ps(_mm256_sub_ps(b, a), t)); }
+#else
+        using V = __m128;
+        static constexpr size_t WIDTH = 4;
+        static V load(const float* p) { return _mm_loadu_ps(p); }
+        static void store(float* p, V v) { _mm_storeu_ps(p, v); }
+        static V set1(float x) { return _mm_set1_ps(x); }
+        static V add(V a, V b) { return _mm_add_ps(a, b); }
+        static V sub(V a, V b) { return _mm_sub_ps(a, b); }
+        static V mul(V a, V b) { return _mm_mul_ps(a, b); }
+        static V min(V a, V b) { return _mm_min_ps(a, b); }
+        static V max(V a, V b) { return _mm_max_ps(a, b); }
+        static V lerp(V a, V b, V t) { return _mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(b, a), t)); }
+#endif
+    };
+#endif
+
+    // 所有表达式节点的 CRTP 基类
+    // 节点需要提供 value_type、at(i)（标量求值）、load(i)（从 i 开始的一个向量）和 size()
+    template <typename E>
+    struct BufferExpr {
+        const E& self() const { return static_cast<const E&>(*this); }
+    };
+
+    // 不限长度的节点（标量、按通道常量）返回 EXPR_ANY_SIZE
+    constexpr size_t EXPR_ANY_SIZE = static_cast<size_t>(-1);
+
+    template <typename T>
+    struct ExprBuffer : BufferExpr<ExprBuffer<T>> {
+        using value_type = T;
+        using V = typename ExprMath<T>::V;
+        const T* ptr;
+        size_t length;
+
+        ExprBuffer(const Buffer3D<T>& buffer) : ptr(buffer.data()), length(buffer.length()) {}
+        T at(size_t i) const { return ptr[i]; }
+        V load(size_t i) const { return ExprMath<T>::load(ptr + i); }
+        size_t size() const { return length; }
+    };
+
+    template <typename T>
+    struct ExprScalar : BufferExpr<ExprScalar<T>> {
+        using value_type = T;
+        using V = typename ExprMath<T>::V;
+        T value;
+        V vector;
+
+        ExprScalar(T x) : value(x), vector(ExprMath<T>::set1(x)) {}
+        T at(size_t) const { return value; }
+        V load(size_t) const { return vector; }
+        size_t size() const { return EXPR_ANY_SIZE; }
+    };
+
+    // 每个像素都相同的颜色（按通道交错重复），如 channels(rgb(r, g, b))
+    // 向量宽度不一定是通道数的倍数，所以按起始下标对通道数取模预先生成几种相位的向量
+    template <typename T>
+    struct ExprChannels : BufferExpr<ExprChannels<T>> {
+        using value_type = T;
+        using V = typename ExprMath<T>::V;
+        static constexpr size_t MAX_CHANNEL = 4;
+        T values[MAX_CHANNEL];
+        V phases[MAX_CHANNEL];
+        size_t channel;
+
+        ExprChannels(const T* v, size_t c) : channel(std::min(std::max<size_t>(c, 1), MAX_CHANNEL)) {
+            for (size_t k = 0; k < channel; k++) {
+                values[k] = v[k];
+            }
+            for (size_t phase = 0; phase < channel; phase++) {
+                alignas(32) T lanes[ExprMath<T>::WIDTH];
+                for (size_t j = 0; j < ExprMath<T>::WIDTH; j++) {
+                    lanes[j] = values[(phase + j) % channel];
+                }
+                phases[phase] = ExprMath<T>::load(lanes);
+            }
+        }
+        T at(size_t i) const { return values[i % channel]; }
+        V load(size_t i) const { return phases[i % channel]; }
+        size_t size() const { return EXPR_ANY_SIZE; }
+    };
+
+    struct ExprAdd {
+        template <typename M, typename X>
+        static X apply(X a, X b) { return M::add(a, b); }
+    };
+    struct ExprSub {
+        template <typename M, typename X>
+        static X apply(X a, X b) { return M::sub(a, b); }
+    };
+    struct ExprMul {
+        template <typename M, typename X>
+        static X apply(X a, X b) { return M::mul(a, b); }
+    };
+    struct ExprMin {
+        template <typename M, typename X>
+        static X apply(X a, X b) { return M::min(a, b); }
+    };
+    struct ExprMax {
+        template <typename M, typename X>
+        static X apply(X a, X b) { return M::max(a, b); }
+    };
+
+    template <typename OP, typename L, typename R>
+    struct ExprBinary : BufferExpr<ExprBinary<OP, L, R>> {
+        using value_type = typename L::value_type;
+        using M = ExprMath<value_type>;
+        using V = typename M::V;
+        L l;
+        R r;
+
+        ExprBinary(const L& left, const R& right) : l(left), r(right) {}
+        value_type at(size_t i) const { return OP::template apply<M>(l.at(i), r.at(i)); }
+        V load(size_t i) const { return OP::template apply<M>(l.load(i), r.load(i)); }
+        size_t size() const { return std::min(l.size(), r.size()); }
+    };
+
+    template <typename A, typename B, typename W>
+    struct ExprLerp : BufferExpr<ExprLerp<A, B, W>> {
+        using value_type = typename A::value_type;
+        using M = ExprMath<value_type>;
+        using V = typename M::V;
+        A a;
+        B b;
+        W t;
+
+        ExprLerp(const A& a, const B& b, const W& t) : a(a), b(b), t(t) {}
+        value_type at(size_t i) const { return M::lerp(a.at(i), b.at(i), t.at(i)); }
+        V load(size_t i) const { return M::lerp(a.load(i), b.load(i), t.load(i)); }
+        size_t size() const { return std::min(a.size(), std::min(b.size(), t.size())); }
+    };
+
+    // 只声明不定义，用于判断类型是否为（派生自）Buffer3D 并取出元素类型
+    template <typename T>
+    T exprBufferElement(const Buffer3D<T>&);
+
+    template <typename X>
+    concept BufferExprNode = std::is_base_of_v<BufferExpr<X>, X>;
+    template <typename X>
+    concept BufferLike = requires(const X& x) { exprBufferElement(x); };
+    template <typename X>
+    concept BufferOperand = BufferExprNode<X> || BufferLike<X>;
+    template <typename X>
+    concept ScalarOperand = std::is_arithmetic_v<X>;
+
+    // 二元运算至少有一侧是 Buffer3D 或表达式，另一侧可以是标量
+    template <typename A, typename B>
+    concept BufferExprArgs = (BufferOperand<A> || BufferOperand<B>) && (BufferOperand<A> || ScalarOperand<A>) && (BufferOperand<B> || ScalarOperand<B>);
+
+    template <typename X>
+    struct ExprValueOf {
+        using type = void;
+    };
+    template <BufferExprNode X>
+    struct ExprValueOf<X> {
+        using type = typename X::value_type;
+    };
+    template <BufferLike X>
+    struct ExprValueOf<X> {
+        using type = decltype(exprBufferElement(std::declval<const X&>()));
+    };
+
+    // 表达式的元素类型取自第一个非标量的操作数
+    template <typename... X>
+    struct ExprValueOfFirst;
+    template <typename X, typename... Rest>
+    struct ExprValueOfFirst<X, Rest...> {
+        using type = std::conditional_t<BufferOperand<X>, typename ExprValueOf<X>::type, typename ExprValueOfFirst<Rest...>::type>;
+    };
+    template <>
+    struct ExprValueOfFirst<> {
+        using type = void;
+    };
+
+    template <typename T, typename X>
+    auto toExpr(const X& x) {
+        if constexpr (BufferExprNode<X>) {
+            return x;
+        } else if constexpr (BufferLike<X>) {
+            return ExprBuffer<T>(x);
+        } else {
+            return ExprScalar<T>(static_cast<T>(x));
+        }
+    }
+
+    template <typename OP, typename A, typename B>
+    auto makeExprBinary(const A& a, const B& b) {
+        using T = typename ExprValueOfFirst<A, B>::type;
+        using L = decltype(toExpr<T>(a));
+        using R = decltype(toExpr<T>(b));
+        return ExprBinary<OP, L, R>(toExpr<T>(a), toExpr<T>(b));
+    }
+
+    template <typename A, typename B>
+        requires BufferExprArgs<A, B>
+    auto operator+(const A& a, const B& b) { return makeExprBinary<ExprAdd>(a, b); }
+
+    template <typename A, typename B>
+        requires BufferExprArgs<A, B>
+    auto operator-(const A& a, const B& b) { return makeExprBinary<ExprSub>(a, b); }
+
+    template <typename A, typename B>
+        requires BufferExprArgs<A, B>
+    auto operator*(const A& a, const B& b) { return makeExprBinary<ExprMul>(a, b); }
+
+    template <typename A, typename B>
+        requires BufferExprArgs<A, B>
+    auto min(const A& a, const B& b) { return makeExprBinary<ExprMin>(a, b); }
+
+    template <typename A, typename B>
+        requires BufferExprArgs<A, B>
+    auto max(const A& a, const B& b) { return makeExprBinary<ExprMax>(a, b); }
+
+    template <typename A, typename L, typename H>
+        requires BufferOperand<A> && ScalarOperand<L> && ScalarOperand<H>
+    auto clampRange(const A& a, L lo, H hi) { return min(max(a, lo), hi); }
+
+    // a + (b - a) * t，uint8_t 下 t = 255 对应 1
+    template <typename A, typename B, typename W>
+        requires(BufferOperand<A> || BufferOperand<B> || BufferOperand<W>) && (BufferOperand<A> || ScalarOperand<A>) &&
+                (BufferOperand<B> || ScalarOperand<B>) && (BufferOperand<W> || ScalarOperand<W>)
+    auto lerp(const A& a, const B& b, const W& t) {
+        using T = typename ExprValueOfFirst<A, B, W>::type;
+        using EA = decltype(toExpr<T>(a));
+        using EB = decltype(toExpr<T>(b));
+        using EW = decltype(toExpr<T>(t));
+        return ExprLerp<EA, EB, EW>(toExpr<T>(a), toExpr<T>(b), toExpr<T>(t));
+    }
+
+    // 每个像素相同的颜色，通道数为向量维度
+    template <glm::length_t N, typename T>
+    ExprChannels<T> channels(const glm::vec<N, T>& color) {
+        T values[N];
+        for (glm::length_t k = 0; k < N; k++) {
+            values[k] = color[k];
+        }
+        return ExprChannels<T>(values, N);
+    }
+
+    // 按块并行、块内按向量宽度求值，dst 可以同时出现在表达式里（逐元素先读后写）
+    // 表达式中各缓冲的长度必须与 dst 一致
+    template <typename T, typename E>
+    bool evaluate(Buffer3D<T>& dst, const BufferExpr<E>& expr);
+}
+
+namespace RE {
+    template <typename T, typename E>
+    bool evaluate(Buffer3D<T>& dst, const BufferExpr<E>& expr) {
+        static_assert(std::is_same_v<typename E::value_type, T>, "evaluate: element type mismatch");
+        const E& e = expr.self();
+        const size_t n = dst.length();
+        if (e.size() != EXPR_ANY_SIZE && e.size() != n) {
+            std::cerr << "BufferExpr Error: size mismatch " << e.size() << " vs " << n << std::endl;
+            return false;
+        }
+        using M = ExprMath<T>;
+        constexpr size_t BLOCK = 16384; // 每个任务的元素数，是所有向量宽度的倍数
+        const size_t blocks = (n + BLOCK - 1) / BLOCK;
+        T* out = dst.data();
+#pragma omp parallel for schedule(static) if (blocks > 1)
+        for (int64_t b = 0; b < static_cast<int64_t>(blocks); b++) {
+            const size_t begin = b * BLOCK;
+            const size_t end = std::min(begin + BLOCK, n);
+            size_t i = begin;
+            for (; i + M::WIDTH <= end; i += M::WIDTH) {
+                M::store(out + i, e.load(i));
+            }
+            for (; i < end; i++) {
+                out[i] = e.at(i);
+            }
+        }
+        return true;
+    }
+
+    template <typename T>
+    template <typename E>
+    Buffer3D<T>& Buffer3D<T>::operator=(const BufferExpr<E>& expr) {
+        evaluate(*this, expr);
+        return *this;
+    }
+}
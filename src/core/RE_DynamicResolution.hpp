@@ -0,0 +1,119 @@
+#pragma once
+#include "RE_includes.h"
+
+namespace RE {
+    struct DynamicResolutionSettings {
+        float targetFrameTime = 1000.0f / 60.0f; // 目标帧时间（毫秒），通常取 1000 / 刷新率
+        float headroom = 0.9f;                   // 只用预算的这一部分，给呈现和系统调度留余量
+        float minScale = 0.5f;                   // 每个轴上的缩放范围
+        float maxScale = 1.0f;
+        float kp = 0.3f; // 增量式 PID 系数，误差为相对误差 (目标 - 实测) / 目标
+        float ki = 0.05f;
+        float kd = 0.1f;
+        size_t historySize = 8;  // 参与平均的帧数，过滤单帧抖动
+        size_t granularity = 8;  // 视口尺寸对齐到该像素数，避免每帧都重新分配缓冲
+    };
+
+    // 动态分辨率控制器：根据最近若干帧的耗时调节渲染视口的缩放比例
+    // 每帧调用 update(frameTime)，再用 viewport() 得到下一帧的渲染尺寸
+    class DynamicResolution {
+    public:
+        DynamicResolution();
+        explicit DynamicResolution(const DynamicResolutionSettings& settings);
+
+        void setSettings(const DynamicResolutionSettings& settings);
+        const DynamicResolutionSettings& settings() const;
+        void setTargetFrameTime(float milliseconds);
+
+        // 记录一帧的耗时（毫秒，不含为对齐帧率而休眠的时间），返回新的缩放比例
+        float update(float frameTime);
+        void reset(float scale = 1.0f);
+
+        float scale() const;
+        float averageFrameTime() const;
+        // 全分辨率为 width x height 时的渲染视口尺寸，至少为 1 个 granularity
+        glm::uvec2 viewport(size_t width, size_t height) const;
+
+    private:
+        DynamicResolutionSettings _settings;
+        std::vector<float> history;
+        size_t historyHead = 0;
+        size_t historyCount = 0;
+        float _scale = 1.0f;
+        float error1 = 0.0f; // 上一帧与上上帧的误差
+        float error2 = 0.0f;
+    };
+}
+
+namespace RE {
+    inline DynamicResolution::DynamicResolution() {
+        reset(_settings.maxScale);
+    }
+
+    inline DynamicResolution::DynamicResolution(const DynamicResolutionSettings& settings) : _settings(settings) {
+        reset(_settings.maxScale);
+    }
+
+    inline void DynamicResolution::setSettings(const DynamicResolutionSettings& settings) {
+        _settings = settings;
+        reset(_scale);
+    }
+
+    inline const DynamicResolutionSettings& DynamicResolution::settings() const {
+        return _settings;
+    }
+
+    inline void DynamicResolution::setTargetFrameTime(float milliseconds) {
+        _settings.targetFrameTime = milliseconds;
+    }
+
+    inline void DynamicResolution::reset(float scale) {
+        history.assign(std::max<size_t>(_settings.historySize, 1), 0.0f);
+        historyHead = 0;
+        historyCount = 0;
+        _scale = RE::camp(scale, _settings.minScale, _settings.maxScale);
+        error1 = error2 = 0.0f;
+    }
+
+    inline float DynamicResolution::update(float frameTime) {
+        history[historyHead] = frameTime;
+        historyHead = (historyHead + 1) % history.size();
+        historyCount = std::min(historyCount + 1, history.size());
+
+        const float budget = _settings.targetFrameTime * _settings.headroom;
+        if (budget <= 0.0f) {
+            return _scale;
+        }
+        const float error = (budget - averageFrameTime()) / budget;
+        // 增量式 PID：直接输出缩放比例的变化量，缩放被 clamp 时不会积分饱和
+        const float delta = _settings.kp * (error - error1) + _settings.ki * error + _settings.kd * (error - 2.0f * error1 + error2);
+        error2 = error1;
+        error1 = error;
+        _scale = RE::camp(_scale + delta, _settings.minScale, _settings.maxScale);
+        return _scale;
+    }
+
+    inline float DynamicResolution::scale() const {
+        return _scale;
+    }
+
+    inline float DynamicResolution::averageFrameTime() const {
+        if (historyCount == 0) {
+            return 0.0f;
+        }
+        float sum = 0.0f;
+        for (size_t i = 0; i < historyCount; i++) {
+            sum += history[i];
+        }
+        return sum / historyCount;
+    }
+
+    inline glm::uvec2 DynamicResolution::viewport(size_t width, size_t height) const {
+        const size_t g = std::max<size_t>(_settings.granularity, 1);
+        auto align = [&](size_t full) {
+            const size_t scaled = static_cast<size_t>(full * _scale + 0.5f);
+            return static_cast<unsigned int>(std::min(full, std::max(g, (scaled + g / 2) / g * g)));
+        };
+        return glm::uvec2(align(width), align(height));
+    }
+}
@@ -0,0 +1,177 @@
+#pragma once
+#include "RE_includes.h"
+#include <chrono>
+#include <thread>
+
+namespace RE {
+    // 帧时间统计（毫秒），基于最近 historySize 帧的呈现间隔
+    struct FrameStats {
+        double average = 0.0;
+        double p50 = 0.0;
+        double p99 = 0.0;
+        double max = 0.0;
+        size_t count = 0;
+    };
+
+    // 帧率控制：高精度时钟 + 先休眠后自旋的等待，按固定节拍对齐每帧的呈现时间
+    // 用法：每帧开始调用 beginFrame()，呈现前后调用 wait()
+    class FramePacer {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        explicit FramePacer(double targetRate = 60.0, size_t historySize = 240);
+
+        // 目标帧率（Hz），0 表示不限帧，只做统计
+        void setTargetRate(double rate);
+        double targetRate() const;
+        double targetFrameTime() const;
+
+        void beginFrame();
+        // 等到本帧的截止时间并记录帧间隔，返回本帧的工作时间（beginFrame 到调用时，毫秒，不含等待）
+        double wait();
+
+        double lastFrameTime() const; // 上一次 wait 返回时到这一次的间隔
+        double lastWorkTime() const;
+        FrameStats stats() const;
+        void resetStats();
+
+        // 当前时间（毫秒，相对某个固定起点），供其他地方计时使用
+        static double now();
+        // 精确等待到 deadline：剩余时间大于估计的休眠误差时休眠 1 毫秒，其余时间自旋
+        void waitUntil(Clock::time_point deadline);
+
+    private:
+        double _targetRate = 60.0;
+        Clock::duration period{};
+        Clock::time_point frameStart;
+        Clock::time_point deadline;
+        Clock::time_point lastPresent;
+        bool started = false;
+        double _lastFrameTime = 0.0;
+        double _lastWorkTime = 0.0;
+
+        std::vector<double> history;
+        size_t historyHead = 0;
+        size_t historyCount = 0;
+
+        // 1 毫秒休眠的实际耗时统计（Welford），估计值取均值加一个标准差
+        double sleepEstimate = 5.0;
+        double sleepMean = 5.0;
+        double sleepM2 = 0.0;
+        uint64_t sleepCount = 1;
+    };
+}
+
+namespace RE {
+    inline FramePacer::FramePacer(double targetRate, size_t historySize) : history(std::max<size_t>(historySize, 1), 0.0) {
+        setTargetRate(targetRate);
+    }
+
+    inline void FramePacer::setTargetRate(double rate) {
+        _targetRate = std::max(rate, 0.0);
+        period = _targetRate > 0.0 ? std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / _targetRate)) : Clock::duration::zero();
+        started = false;
+    }
+
+    inline double FramePacer::targetRate() const {
+        return _targetRate;
+    }
+
+    inline double FramePacer::targetFrameTime() const {
+        return _targetRate > 0.0 ? 1000.0 / _targetRate : 0.0;
+    }
+
+    inline void FramePacer::beginFrame() {
+        frameStart = Clock::now();
+        if (!started) {
+            deadline = frameStart + period;
+            lastPresent = frameStart;
+            started = true;
+        }
+    }
+
+    inline double FramePacer::wait() {
+        const Clock::time_point workEnd = Clock::now();
+        _lastWorkTime = std::chrono::duration<double, std::milli>(workEnd - frameStart).count();
+
+        if (period > Clock::duration::zero()) {
+            if (workEnd > deadline + period) {
+                // 落后超过一帧时不再追赶，从现在重新对齐，避免之后连续不等待
+                deadline = workEnd;
+            } else {
+                waitUntil(deadline);
+            }
+            deadline += period;
+        }
+
+        const Clock::time_point present = Clock::now();
+        _lastFrameTime = std::chrono::duration<double, std::milli>(present - lastPresent).count();
+        lastPresent = present;
+        history[historyHead] = _lastFrameTime;
+        historyHead = (historyHead + 1) % history.size();
+        historyCount = std::min(historyCount + 1, history.size());
+        return _lastWorkTime;
+    }
+
+    inline void FramePacer::waitUntil(Clock::time_point target) {
+        using Milli = std::chrono::duration<double, std::milli>;
+        for (;;) {
+            const double remaining = Milli(target - Clock::now()).count();
+            if (remaining <= sleepEstimate) {
+                break;
+            }
+            const Clock::time_point start = Clock::now();
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            const double observed = Milli(Clock::now() - start).count();
+
+            sleepCount++;
+            const double delta = observed - sleepMean;
+            sleepMean += delta / sleepCount;
+            sleepM2 += delta * (observed - sleepMean);
+            sleepEstimate = sleepMean + std::sqrt(sleepM2 / (sleepCount - 1));
+        }
+        while (Clock::now() < target) {
+#if defined(RE_SIMD_SSE2)
+            _mm_pause();
+#else
+            std::this_thread::yield();
+#endif
+        }
+    }
+
+    inline double FramePacer::lastFrameTime() const {
+        return _lastFrameTime;
+    }
+
+    inline double FramePacer::lastWorkTime() const {
+        return _lastWorkTime;
+    }
+
+    inline FrameStats FramePacer::stats() const {
+        FrameStats s;
+        s.count = historyCount;
+        if (historyCount == 0) {
+            return s;
+        }
+        std::vector<double> sorted(history.begin(), history.begin() + historyCount);
+        std::sort(sorted.begin(), sorted.end());
+        double sum = 0.0;
+        for (double t : sorted) {
+            sum += t;
+        }
+        s.average = sum / historyCount;
+        s.p50 = sorted[(historyCount - 1) / 2];
+        s.p99 = sorted[std::min(historyCount - 1, static_cast<size_t>(std::ceil(historyCount * 0.99)) - 1)];
+        s.max = sorted.back();
+        return s;
+    }
+
+    inline void FramePacer::resetStats() {
+        historyHead = 0;
+        historyCount = 0;
+    }
+
+    inline double FramePacer::now() {
+        return std::chrono::duration<double, std::milli>(Clock::now().time_since_epoch()).count();
+    }
+}
@@ -77,4 +77,415 @@ namespace RE {
     private:
         std::vector<Point2D> points;
     };
+
+    // 填充规则：非零环绕 / 奇偶
+    enum FillRule {
+        fillNonZero,
+        fillEvenOdd
+    };
+
+    // 矢量路径，坐标为浮点像素坐标，可以为负或超出画布
+    class Path2D {
+    public:
+        enum PathVerb : uint8_t {
+            pathMove,
+            pathLine,
+            pathQuad,
+            pathCubic,
+            pathClose
+        };
+
+        void moveTo(float x, float y);
+        void lineTo(float x, float y);
+        void quadTo(float cx, float cy, float x, float y);
+        void cubicTo(float c1x, float c1y, float c2x, float c2y, float x, float y);
+        void close();
+        void clear();
+        bool empty() const;
+        // 所有控制点的包围盒 (minX, minY, maxX, maxY)，曲线一定在其中
+        glm::vec4 bounds() const;
+
+        // 展平为折线，tolerance 为曲线到折线的最大距离（像素）
+        // 每段曲线按 Wang 公式由控制多边形的二阶差分决定分段数，弯曲大的曲线分得细，平直的曲线只分一段
+        void flatten(float tolerance, std::vector<std::vector<glm::vec2>>& contours) const;
+
+    private:
+        std::vector<PathVerb> verbs;
+        std::vector<glm::vec2> points;
+        glm::vec2 subpathStart{0.0f}; // 最近一次 moveTo 的点，close 之后的新子路径从这里开始
+
+        void ensureStart();
+    };
+
+    // 稀疏扫描线光栅化：每条边只在经过的像素格上累加有向面积 area 和覆盖 cover，
+    // 一行内某像素的覆盖率 = 左侧所有格子的 cover 之和 + 本格的 area。格子按行稀疏存放，
+    // 内部大片区域不产生格子，扫描时按常量覆盖率整段输出
+    class PathRasterizer {
+    public:
+        void reset(size_t width, size_t height);
+        // 路径的每个子路径都会隐式闭合
+        void addPath(const Path2D& path, float tolerance = 0.25f);
+        void addLine(glm::vec2 p0, glm::vec2 p1);
+
+        // 逐行输出覆盖率：span(y, x, count, const float* coverage)，coverage[i] 为像素 (x + i, y) 的覆盖率 [0, 1]
+        // 各行并行扫描，span 可能被多个线程同时调用
+        template <typename Span>
+        void sweep(FillRule rule, Span&& span);
+
+    private:
+        struct Cell {
+            int32_t x; // -1 表示画布左侧的所有格子
+            float area;
+            float cover;
+        };
+
+        std::vector<std::vector<Cell>> rows;
+        size_t _width = 0;
+        size_t _height = 0;
+        size_t rowMin = 0;
+        size_t rowMax = 0;
+
+        void addRowSegment(size_t row, float xa, float ya, float xb, float yb);
+        void addCell(size_t row, int64_t x, float area, float cover);
+        static float fillCoverage(float value, FillRule rule);
+    };
+}
+
+namespace RE {
+    inline void Path2D::ensureStart() {
+        if (verbs.empty() || verbs.back() == pathClose) {
+            verbs.push_back(pathMove);
+            points.push_back(subpathStart);
+        }
+    }
+
+    inline void Path2D::moveTo(float x, float y) {
+        verbs.push_back(pathMove);
+        points.emplace_back(x, y);
+        subpathStart = points.back();
+    }
+
+    inline void Path2D::lineTo(float x, float y) {
+        ensureStart();
+        verbs.push_back(pathLine);
+        points.emplace_back(x, y);
+    }
+
+    inline void Path2D::quadTo(float cx, float cy, float x, float y) {
+        ensureStart();
+        verbs.push_back(pathQuad);
+        points.emplace_back(cx, cy);
+        points.emplace_back(x, y);
+    }
+
+    inline void Path2D::cubicTo(float c1x, float c1y, float c2x, float c2y, float x, float y) {
+        ensureStart();
+        verbs.push_back(pathCubic);
+        points.emplace_back(c1x, c1y);
+        points.emplace_back(c2x, c2y);
+        points.emplace_back(x, y);
+    }
+
+    inline void Path2D::close() {
+        if (!verbs.empty() && verbs.back() != pathClose) {
+            verbs.push_back(pathClose);
+        }
+    }
+
+    inline void Path2D::clear() {
+        verbs.clear();
+        points.clear();
+        subpathStart = glm::vec2(0.0f);
+    }
+
+    inline bool Path2D::empty() const {
+        return verbs.empty();
+    }
+
+    inline glm::vec4 Path2D::bounds() const {
+        if (points.empty()) {
+            return glm::vec4(0.0f);
+        }
+        glm::vec4 out(points[0].x, points[0].y, points[0].x, points[0].y);
+        for (const auto& p : points) {
+            out.x = std::min(out.x, p.x);
+            out.y = std::min(out.y, p.y);
+            out.z = std::max(out.z, p.x);
+            out.w = std::max(out.w, p.y);
+        }
+        return out;
+    }
+
+    inline void Path2D::flatten(float tolerance, std::vector<std::vector<glm::vec2>>& contours) const {
+        RE_PROFILE_SCOPE("Path2D::flatten");
+        contours.clear();
+        tolerance = std::max(tolerance, 1e-3f);
+        // 均匀分成 n 段时弦高误差不超过 max|B''| / (8 n^2)，反解出满足 tolerance 的 n
+        auto segments = [tolerance](float secondDiff, float scale) -> int {
+            const float n = std::ceil(std::sqrt(secondDiff * scale / tolerance));
+            return static_cast<int>(camp(n, 1.0f, 1024.0f));
+        };
+
+        size_t pi = 0;
+        glm::vec2 current(0.0f);
+        for (const PathVerb verb : verbs) {
+            switch (verb) {
+            case pathMove:
+                current = points[pi++];
+                contours.emplace_back();
+                contours.back().push_back(current);
+                break;
+            case pathLine:
+                current = points[pi++];
+                contours.back().push_back(current);
+                break;
+            case pathQuad: {
+                const glm::vec2 p0 = current, p1 = points[pi], p2 = points[pi + 1];
+                pi += 2;
+                // B'' = 2 (p0 - 2 p1 + p2)
+                const int n = segments(glm::length(p0 - 2.0f * p1 + p2), 0.25f);
+                for (int i = 1; i <= n; i++) {
+                    const float t = static_cast<float>(i) / n;
+                    const float s = 1.0f - t;
+                    contours.back().push_back(s * s * p0 + 2.0f * s * t * p1 + t * t * p2);
+                }
+                current = p2;
+                break;
+            }
+            case pathCubic: {
+                const glm::vec2 p0 = current, p1 = points[pi], p2 = points[pi + 1], p3 = points[pi + 2];
+                pi += 3;
+                // max|B''| <= 6 max(|p0 - 2 p1 + p2|, |p1 - 2 p2 + p3|)
+                const float d = std::max(glm::length(p0 - 2.0f * p1 + p2), glm::length(p1 - 2.0f * p2 + p3));
+                const int n = segments(d, 0.75f);
+                for (int i = 1; i <= n; i++) {
+                    const float t = static_cast<float>(i) / n;
+                    const float s = 1.0f - t;
+                    contours.back().push_back(s * s * s * p0 + 3.0f * s * s * t * p1 + 3.0f * s * t * t * p2 + t * t * t * p3);
+                }
+                current = p3;
+                break;
+            }
+            case pathClose:
+                current = contours.back().front();
+                break;
+            }
+        }
+    }
+
+    inline void PathRasterizer::reset(size_t width, size_t height) {
+        for (size_t y = rowMin; y < rowMax; y++) {
+            rows[y].clear();
+        }
+        _width = width;
+        _height = height;
+        rows.resize(height);
+        rowMin = height;
+        rowMax = 0;
+    }
+
+    inline void PathRasterizer::addPath(const Path2D& path, float tolerance) {
+        RE_PROFILE_SCOPE("PathRasterizer::addPath");
+        std::vector<std::vector<glm::vec2>> contours;
+        path.flatten(tolerance, contours);
+        for (const auto& contour : contours) {
+            const size_t n = contour.size();
+            for (size_t i = 0; i < n; i++) {
+                addLine(contour[i], contour[i + 1 == n ? 0 : i + 1]);
+            }
+        }
+    }
+
+    inline void PathRasterizer::addLine(glm::vec2 p0, glm::vec2 p1) {
+        if (p0.y == p1.y || !std::isfinite(p0.x + p0.y + p1.x + p1.y)) {
+            return;
+        }
+        // 先在 y 方向裁剪到画布内，x 方向的裁剪在 addRowSegment 中完成
+        const float h = static_cast<float>(_height);
+        const float dxdy = (p1.x - p0.x) / (p1.y - p0.y);
+        auto atY = [&](float y) -> glm::vec2 {
+            return {p0.x + (y - p0.y) * dxdy, y};
+        };
+        glm::vec2 a = p0, b = p1;
+        const bool down = b.y > a.y;
+        glm::vec2& top = down ? a : b;
+        glm::vec2& bottom = down ? b : a;
+        if (bottom.y <= 0.0f || top.y >= h) {
+            return;
+        }
+        if (top.y < 0.0f) {
+            top = atY(0.0f);
+        }
+        if (bottom.y > h) {
+            bottom = atY(h);
+        }
+
+        const size_t first = static_cast<size_t>(std::floor(top.y));
+        const size_t last = std::min(static_cast<size_t>(std::ceil(bottom.y)), _height);
+        rowMin = std::min(rowMin, first);
+        rowMax = std::max(rowMax, last);
+        for (size_t row = first; row < last; row++) {
+            const float y0 = std::max(top.y, static_cast<float>(row));
+            const float y1 = std::min(bottom.y, static_cast<float>(row + 1));
+            if (y1 <= y0) {
+                continue;
+            }
+            // 保持边的方向，向下的边 cover 为正，向上的为负
+            if (down) {
+                addRowSegment(row, atY(y0).x, y0, atY(y1).x, y1);
+            } else {
+                addRowSegment(row, atY(y1).x, y1, atY(y0).x, y0);
+            }
+        }
+    }
+
+    inline void PathRasterizer::addRowSegment(size_t row, float xa, float ya, float xb, float yb) {
+        // 在 x = 0 和 x = width 处截断，逐格行走的代价只和画布内的宽度有关
+        // 左侧部分只贡献 cover，合并到 x = -1；右侧部分不影响任何可见像素，直接丢弃
+        const float w = static_cast<float>(_width);
+        if (xa >= w && xb >= w) {
+            return;
+        }
+        if (xa <= 0.0f && xb <= 0.0f) {
+            addCell(row, -1, 0.0f, yb - ya);
+            return;
+        }
+        if (xa < 0.0f || xb < 0.0f || xa > w || xb > w) {
+            const float dydx = (yb - ya) / (xb - xa);
+            const float y0 = ya + (0.0f - xa) * dydx;
+            const float yw = ya + (w - xa) * dydx;
+            if (xa < 0.0f) {
+                addCell(row, -1, 0.0f, y0 - ya);
+            } else if (xb < 0.0f) {
+                addCell(row, -1, 0.0f, yb - y0);
+            }
+            if (xa < 0.0f) {
+                xa = 0.0f;
+                ya = y0;
+            } else if (xa > w) {
+                xa = w;
+                ya = yw;
+            }
+            if (xb < 0.0f) {
+                xb = 0.0f;
+                yb = y0;
+            } else if (xb > w) {
+                xb = w;
+                yb = yw;
+            }
+        }
+
+        const float x0f = std::floor(xa);
+        const float x1f = std::floor(xb);
+        // 一个格子内的线段，右侧梯形面积 = dy * (1 - 两端在格内的平均横坐标)
+        if (x0f == x1f) {
+            const float dy = yb - ya;
+            addCell(row, static_cast<int64_t>(x0f), dy * (1.0f - ((xa - x0f) + (xb - x0f)) * 0.5f), dy);
+            return;
+        }
+        const float step = xb > xa ? 1.0f : -1.0f;
+        const float dydx = (yb - ya) / (xb - xa);
+        float cx = x0f;
+        float x = xa, y = ya;
+        while (cx != x1f) {
+            const float nx = step > 0.0f ? cx + 1.0f : cx;
+            const float ny = ya + (nx - xa) * dydx;
+            const float dy = ny - y;
+            addCell(row, static_cast<int64_t>(cx), dy * (1.0f - ((x - cx) + (nx - cx)) * 0.5f), dy);
+            x = nx;
+            y = ny;
+            cx += step;
+        }
+        const float dy = yb - y;
+        addCell(row, static_cast<int64_t>(x1f), dy * (1.0f - ((x - x1f) + (xb - x1f)) * 0.5f), dy);
+    }
+
+    inline void PathRasterizer::addCell(size_t row, int64_t x, float area, float cover) {
+        // 画布右侧的格子不影响任何可见像素；左侧的格子只有 cover 有意义，合并到 x = -1
+        if (x >= static_cast<int64_t>(_width)) {
+            return;
+        }
+        if (x < 0) {
+            x = -1;
+            area = 0.0f;
+        }
+        std::vector<Cell>& cells = rows[row];
+        if (!cells.empty() && cells.back().x == x) {
+            cells.back().area += area;
+            cells.back().cover += cover;
+            return;
+        }
+        cells.push_back({static_cast<int32_t>(x), area, cover});
+    }
+
+    inline float PathRasterizer::fillCoverage(float value, FillRule rule) {
+        value = std::abs(value);
+        if (rule == fillEvenOdd) {
+            value -= 2.0f * std::floor(value * 0.5f);
+            return value > 1.0f ? 2.0f - value : value;
+        }
+        return std::min(value, 1.0f);
+    }
+
+    template <typename Span>
+    void PathRasterizer::sweep(FillRule rule, Span&& span) {
+        RE_PROFILE_SCOPE("PathRasterizer::sweep");
+        const int64_t begin = static_cast<int64_t>(rowMin);
+        const int64_t end = static_cast<int64_t>(rowMax);
+#pragma omp parallel
+        {
+            std::vector<float> line(_width);
+#pragma omp for schedule(dynamic, 8)
+            for (int64_t y = begin; y < end; y++) {
+                std::vector<Cell>& cells = rows[y];
+                if (cells.empty()) {
+                    continue;
+                }
+                std::sort(cells.begin(), cells.end(), [](const Cell& a, const Cell& b) { return a.x < b.x; });
+
+                float cover = 0.0f;
+                int64_t spanBegin = -1;
+                int64_t x = -1;
+                size_t i = 0;
+                while (i < cells.size()) {
+                    const int32_t cx = cells[i].x;
+                    float area = 0.0f, cellCover = 0.0f;
+                    for (; i < cells.size() && cells[i].x == cx; i++) {
+                        area += cells[i].area;
+                        cellCover += cells[i].cover;
+                    }
+                    if (cx >= 0) {
+                        if (spanBegin < 0) {
+                            spanBegin = fillCoverage(cover, rule) > 1.0f / 512.0f ? 0 : cx;
+                            x = spanBegin;
+                        }
+                        // 上一个格子到本格之间的像素覆盖率不变
+                        const float between = fillCoverage(cover, rule);
+                        for (; x < cx; x++) {
+                            line[x] = between;
+                        }
+                        line[x++] = fillCoverage(cover + area, rule);
+                    }
+                    cover += cellCover;
+                }
+                // 闭合路径在行尾的累计 cover 应为 0，否则说明右侧还有被覆盖的区域
+                const float tail = fillCoverage(cover, rule);
+                if (tail > 1.0f / 512.0f) {
+                    if (spanBegin < 0) {
+                        spanBegin = 0;
+                        x = 0;
+                    }
+                    for (; x < static_cast<int64_t>(_width); x++) {
+                        line[x] = tail;
+                    }
+                }
+                cells.clear();
+                if (spanBegin >= 0 && x > spanBegin) {
+                    span(static_cast<size_t>(y), static_cast<size_t>(spanBegin), static_cast<size_t>(x - spanBegin), line.data() + spanBegin);
+                }
+            }
+        }
+        rowMin = _height;
+        rowMax = 0;
+    }
 }
\ No newline at end of file
@@ -0,0 +1,1391 @@
+#pragma once
+#include "RE_includes.h"
+#include "RE_file.h"
+#include "RE_Buffer3D.hpp"
+#include <array>
+#include <charconv>
+#include <filesystem>
+
+namespace RE {
+    // 网格的各个属性流，每个流是一个独立的 float 数组（SoA）
+    enum MeshStream : uint32_t {
+        streamPositionX = 0,
+        streamPositionY,
+        streamPositionZ,
+        streamNormalX,
+        streamNormalY,
+        streamNormalZ,
+        streamTexcoordU,
+        streamTexcoordV,
+        streamCount,
+    };
+
+    // .remesh 文件结构：
+    // | MeshFileHeader | padding | stream 0 | padding | stream 1 | ... | padding | indices
+    // 每个流都按 pageSize 对齐，加载时直接映射成 Mesh 的存储
+    struct MeshFileHeader {
+        char magic[4];
+        uint32_t version;
+        uint64_t vertexCount;
+        uint64_t indexCount;
+        uint32_t streamMask; // 第 i 位表示文件里有第 i 个流
+        uint32_t pageSize;
+        uint64_t streamOffset[streamCount];
+        uint64_t indexOffset;
+    };
+
+    // 三角网格：位置、法线、纹理坐标按分量分开存储，索引为 32 位三角形列表
+    // 顶点阶段可以直接按 SIMD 宽度连续读取同一个分量
+    class Mesh {
+    public:
+        static constexpr char MAGIC[4] = {'R', 'E', 'M', 'S'};
+        static constexpr uint32_t VERSION = 1;
+        static constexpr uint32_t PAGE_SIZE = 4096;
+
+        Mesh() = default;
+        Mesh(const Mesh&) = delete;
+        Mesh& operator=(const Mesh&) = delete;
+        Mesh(Mesh&&) noexcept = default;
+        Mesh& operator=(Mesh&&) noexcept = default;
+
+        void resize(size_t vertexCount, size_t indexCount, bool normals = true, bool texcoords = true);
+        void clear();
+
+        size_t vertexCount() const;
+        size_t indexCount() const;
+        size_t triangleCount() const;
+        bool hasNormals() const;
+        bool hasTexcoords() const;
+
+        float* stream(MeshStream s);
+        const float* stream(MeshStream s) const;
+        uint32_t* indices();
+        const uint32_t* indices() const;
+
+        glm::vec3 position(size_t index) const;
+        glm::vec3 normal(size_t index) const;
+        glm::vec2 texcoord(size_t index) const;
+        void setVertex(size_t index, const glm::vec3& position, const glm::vec3& normal = glm::vec3(0.0f), const glm::vec2& texcoord = glm::vec2(0.0f));
+        void bounds(glm::vec3& min, glm::vec3& max) const;
+
+        // 重排三角形顺序，提高变换后顶点缓存的命中率（Forsyth 算法，按块并行）
+        void optimizeVertexCache(size_t cacheSize = 32);
+        // 按索引中首次出现的顺序重排顶点，顶点读取变为近似顺序访问
+        void optimizeVertexFetch();
+        // 平均每个三角形的缓存未命中次数（FIFO 模拟），越接近 0.5 越好，最差为 3
+        float averageCacheMissRatio(size_t cacheSize = 32) const;
+
+        // 导入 OBJ：文件按行切段并行解析，按 (位置, 法线, 纹理坐标) 下标去重，随后做缓存优化
+        static bool loadOBJ(const char* filename, Mesh& mesh, bool optimize = true);
+        // 二进制缓存：写出各个流，读取时整个文件映射进来，不做解析和拷贝
+        bool writeCache(const char* filename) const;
+        static bool loadCache(const char* filename, Mesh& mesh);
+        // 缓存存在、比 OBJ 新且校验通过时直接映射缓存，否则导入 OBJ 并重新写出缓存
+        static bool load(const char* objFile, const char* cacheFile, Mesh& mesh);
+
+    private:
+        std::array<BufferStorage<float>, streamCount> streams;
+        BufferStorage<uint32_t> _indices;
+        size_t _vertexCount = 0;
+        bool _hasNormals = false;
+        bool _hasTexcoords = false;
+
+        bool streamUsed(size_t s) const;
+    };
+
+    namespace mesh {
+        // Forsyth 线性时间顶点缓存优化，indices 为 [0, vertexCount) 内的紧凑下标
+        void forsythReorder(const uint32_t* indices, size_t triangleCount, size_t vertexCount, size_t cacheSize, uint32_t* out);
+
+        // OBJ 中按行切出的一段文本的解析结果，多边形已按扇形拆成三角形
+        // 正下标是全局的，直接转成 0 起；负下标相对于当前已定义的数量，先记成段内下标，合并时再加上前面各段的数量
+        struct OBJChunk {
+            std::vector<float> positions, normals, texcoords;
+            std::vector<glm::ivec3> corners; // (位置, 法线, 纹理坐标)，缺失为 -1
+            std::vector<uint32_t> relative;  // 需要重定位的分量：corner * 3 + 分量
+            size_t badLine = 0;              // 第一个无法解析的面所在的偏移 + 1，0 表示没有
+
+            void parse(const char* begin, const char* end);
+        };
+    }
+
+    // 轴对齐包围盒，默认构造为空盒（min > max）
+    struct AABB {
+        glm::vec3 min = glm::vec3(std::numeric_limits<float>::max());
+        glm::vec3 max = glm::vec3(-std::numeric_limits<float>::max());
+
+        AABB() = default;
+        AABB(const glm::vec3& min, const glm::vec3& max);
+
+        void expand(const glm::vec3& p);
+        void expand(const AABB& box);
+        bool empty() const;
+        glm::vec3 center() const;
+        // 表面积的一半，只用于 SAH 的相对比较
+        float area() const;
+        // 点到盒子的距离平方，点在盒内时为 0
+        float distance2(const glm::vec3& p) const;
+        // 变换后的包围盒（仍然轴对齐，会略微变大）
+        AABB transformed(const glm::mat4& m) const;
+    };
+
+    // 视锥的 6 个平面，法线朝内：dot(xyz, p) + w >= 0 表示在该平面内侧
+    struct Frustum {
+        glm::vec4 planes[6];
+
+        // 从 projection * view 中提取，深度范围为 [0, w]，与 VertexStage 的裁剪约定一致
+        static Frustum fromMatrix(const glm::mat4& viewProjection);
+        bool intersects(const AABB& box) const;
+    };
+
+    // 场景级 BVH：叶子为物体的包围盒，每个节点有 4 个子节点，包围盒按 SoA 存放，一次测试 4 个子节点
+    // 物体移动后用 update + refit 增量更新，树的质量退化到一定程度后再 rebuild
+    class SceneBVH {
+    public:
+        static constexpr uint32_t INVALID = 0xffffffffu;
+        static constexpr uint32_t LEAF_SIZE = 4;
+
+        // 物体 id 即为其在 boxes 中的下标
+        void build(const AABB* boxes, size_t count);
+        void build(const std::vector<AABB>& boxes);
+        // 用当前的包围盒重新建树
+        void rebuild();
+        void clear();
+
+        // 只记录新的包围盒并标记到根节点的路径，真正的更新在 refit 里统一完成
+        void update(uint32_t object, const AABB& box);
+        void refit();
+        // refit 不改变树的拓扑，物体运动较大时 SAH 代价会上升，超过建树时的 ratio 倍时应重建
+        float cost() const;
+        bool needsRebuild(float ratio = 2.0f) const;
+
+        size_t objectCount() const;
+        size_t nodeCount() const;
+        const AABB& bounds(uint32_t object) const;
+        AABB sceneBounds() const;
+
+        // 视锥剔除，可见物体按由近到远的顺序追加到 visible
+        void cull(const Frustum& frustum, const glm::vec3& eye, std::vector<uint32_t>& visible) const;
+        // 由近到远遍历视锥内的物体：occluded(const AABB&) 返回 true 时跳过该节点（子树）或物体，
+        // visit(uint32_t object) 处理可见物体。遍历时才做遮挡查询，先画的近处物体可以立即成为遮挡体，
+        // 同时光栅化阶段的 early-Z 也能剔除更多片元
+        template <typename Occluded, typename Visit>
+        void traverse(const Frustum& frustum, const glm::vec3& eye, Occluded&& occluded, Visit&& visit) const;
+
+    private:
+        // 第 i 个子节点：count[i] > 0 时为叶子，物体为 order[child[i], child[i] + count[i])；
+        // count[i] == 0 时 child[i] 为内部节点下标，INVALID 表示空槽。子节点下标总是大于父节点
+        struct alignas(16) Node {
+            float minX[4], minY[4], minZ[4];
+            float maxX[4], maxY[4], maxZ[4];
+            uint32_t child[4];
+            uint32_t count[4];
+            uint32_t parent;
+        };
+
+        // 平面系数预先广播，遍历时每个节点只需要读包围盒
+        struct PackedFrustum {
+#if defined(RE_SIMD_AVX2)
+            // 低 4 路为平面 2i，高 4 路为平面 2i + 1，8 路同时测试 4 个子节点和 2 个平面
+            __m256 x[3], y[3], z[3], w[3];
+#elif defined(RE_SIMD_SSE2)
+            __m128 x[6], y[6], z[6], w[6];
+#endif
+            glm::vec4 planes[6];
+
+            explicit PackedFrustum(const Frustum& frustum);
+        };
+
+        std::vector<Node> nodes;
+        std::vector<AABB> boxes;
+        std::vector<glm::vec3> centroids;
+        std::vector<uint32_t> order;
+        std::vector<uint32_t> objectNode; // 物体所在叶子的节点下标
+        std::vector<uint8_t> dirty;
+        float buildCost = 0.0f;
+
+        void buildTree();
+        uint32_t buildNode(uint32_t begin, uint32_t end, uint32_t parent);
+        uint32_t split(uint32_t begin, uint32_t end);
+        void updateNode(uint32_t index);
+        AABB slotBounds(const Node& node, uint32_t slot) const;
+        // outside / intersect 的第 i 位：子节点 i 完全在某个平面外侧 / 与某个平面相交
+        static void testNode(const Node& node, const PackedFrustum& frustum, uint32_t& outside, uint32_t& intersect);
+    };
+}
+
+namespace RE {
+    inline void Mesh::resize(size_t vertexCount, size_t indexCount, bool normals, bool texcoords) {
+        _vertexCount = vertexCount;
+        _hasNormals = normals;
+        _hasTexcoords = texcoords;
+        for (size_t s = 0; s < streamCount; s++) {
+            if (streamUsed(s)) {
+                streams[s].resize(vertexCount);
+            } else {
+                streams[s].clear();
+            }
+        }
+        _indices.resize(indexCount);
+    }
+
+    inline void Mesh::clear() {
+        for (auto& s : streams) {
+            s.clear();
+        }
+        _indices.clear();
+        _vertexCount = 0;
+        _hasNormals = _hasTexcoords = false;
+    }
+
+    inline size_t Mesh::vertexCount() const {
+        return _vertexCount;
+    }
+
+    inline size_t Mesh::indexCount() const {
+        return _indices.size();
+    }
+
+    inline size_t Mesh::triangleCount() const {
+        return _indices.size() / 3;
+    }
+
+    inline bool Mesh::hasNormals() const {
+        return _hasNormals;
+    }
+
+    inline bool Mesh::hasTexcoords() const {
+        return _hasTexcoords;
+    }
+
+    inline float* Mesh::stream(MeshStream s) {
+        return streams[s].data();
+    }
+
+    inline const float* Mesh::stream(MeshStream s) const {
+        return streams[s].data();
+    }
+
+    inline uint32_t* Mesh::indices() {
+        return _indices.data();
+    }
+
+    inline const uint32_t* Mesh::indices() const {
+        return _indices.data();
+    }
+
+    inline bool Mesh::streamUsed(size_t s) const {
+        if (s >= streamNormalX && s <= streamNormalZ) {
+            return _hasNormals;
+        }
+        if (s >= streamTexcoordU) {
+            return _hasTexcoords;
+        }
+        return true;
+    }
+
+    inline glm::vec3 Mesh::position(size_t i) const {
+        return glm::vec3(streams[streamPositionX][i], streams[streamPositionY][i], streams[streamPositionZ][i]);
+    }
+
+    inline glm::vec3 Mesh::normal(size_t i) const {
+        return _hasNormals ? glm::vec3(streams[streamNormalX][i], streams[streamNormalY][i], streams[streamNormalZ][i]) : glm::vec3(0.0f);
+    }
+
+    inline glm::vec2 Mesh::texcoord(size_t i) const {
+        return _hasTexcoords ? glm::vec2(streams[streamTexcoordU][i], streams[streamTexcoordV][i]) : glm::vec2(0.0f);
+    }
+
+    inline void Mesh::setVertex(size_t i, const glm::vec3& p, const glm::vec3& n, const glm::vec2& uv) {
+        streams[streamPositionX][i] = p.x;
+        streams[streamPositionY][i] = p.y;
+        streams[streamPositionZ][i] = p.z;
+        if (_hasNormals) {
+            streams[streamNormalX][i] = n.x;
+            streams[streamNormalY][i] = n.y;
+            streams[streamNormalZ][i] = n.z;
+        }
+        if (_hasTexcoords) {
+            streams[streamTexcoordU][i] = uv.x;
+            streams[streamTexcoordV][i] = uv.y;
+        }
+    }
+
+    inline void Mesh::bounds(glm::vec3& min, glm::vec3& max) const {
+        min = glm::vec3(std::numeric_limits<float>::max());
+        max = glm::vec3(-std::numeric_limits<float>::max());
+        for (size_t i = 0; i < _vertexCount; i++) {
+            const glm::vec3 p = position(i);
+            min = glm::min(min, p);
+            max = glm::max(max, p);
+        }
+    }
+
+    inline void mesh::forsythReorder(const uint32_t* indices, size_t triangleCount, size_t vertexCount, size_t cacheSize, uint32_t* out) {
+        // 参数取自 Tom Forsyth, "Linear-Speed Vertex Cache Optimisation"
+        constexpr size_t MAX_CACHE = 64;
+        constexpr size_t MAX_VALENCE = 32;
+        cacheSize = std::clamp<size_t>(cacheSize, 4, MAX_CACHE - 3);
+        float cacheScore[MAX_CACHE + 3];
+        for (size_t i = 0; i < MAX_CACHE + 3; i++) {
+            // 最近一个三角形的三个顶点分数固定，避免算法总是挑同一条带
+            cacheScore[i] = i < 3 ? 0.75f : i < cacheSize ? std::pow(1.0f - (i - 3.0f) / (cacheSize - 3.0f), 1.5f) : 0.0f;
+        }
+        float valenceScore[MAX_VALENCE];
+        for (size_t i = 1; i < MAX_VALENCE; i++) {
+            valenceScore[i] = 2.0f / std::sqrt(static_cast<float>(i));
+        }
+
+        // 顶点 -> 相邻三角形（CSR），remaining 为尚未输出的相邻三角形数
+        std::vector<uint32_t> offsets(vertexCount + 1, 0), remaining(vertexCount, 0);
+        for (size_t i = 0; i < triangleCount * 3; i++) {
+            remaining[indices[i]]++;
+        }
+        for (size_t v = 0; v < vertexCount; v++) {
+            offsets[v + 1] = offsets[v] + remaining[v];
+        }
+        std::vector<uint32_t> adjacency(triangleCount * 3), fill(offsets.begin(), offsets.end() - 1);
+        for (size_t t = 0; t < triangleCount; t++) {
+            for (size_t k = 0; k < 3; k++) {
+                adjacency[fill[indices[t * 3 + k]]++] = static_cast<uint32_t>(t);
+            }
+        }
+
+        std::vector<int32_t> cachePosition(vertexCount, -1);
+        std::vector<float> vertexScore(vertexCount);
+        std::vector<uint8_t> emitted(triangleCount, 0);
+        auto score = [&](uint32_t v) {
+            const uint32_t n = remaining[v];
+            if (n == 0) {
+                return -1.0f;
+            }
+            const int32_t p = cachePosition[v];
+            return (p >= 0 ? cacheScore[p] : 0.0f) + (n < MAX_VALENCE ? valenceScore[n] : 2.0f / std::sqrt(static_cast<float>(n)));
+        };
+        for (size_t v = 0; v < vertexCount; v++) {
+            vertexScore[v] = score(static_cast<uint32_t>(v));
+        }
+
+        uint32_t cache[MAX_CACHE + 3], next[MAX_CACHE + 3];
+        size_t cacheCount = 0;
+        size_t cursor = 0;
+        int64_t best = -1;
+        for (size_t e = 0; e < triangleCount; e++) {
+            if (best < 0) {
+                // 缓存里的三角形都输出完了，取下一个未输出的三角形重新开始
+                while (emitted[cursor]) {
+                    cursor++;
+                }
+                best = static_cast<int64_t>(cursor);
+            }
+            const uint32_t* tri = indices + best * 3;
+            memcpy(out + e * 3, tri, sizeof(uint32_t) * 3);
+            emitted[best] = 1;
+
+            // 新三角形的顶点移到缓存最前面，其余顶点后移，超出 cacheSize 的被挤出
+            size_t nextCount = 0;
+            for (size_t k = 0; k < 3; k++) {
+                const uint32_t v = tri[k];
+                next[nextCount++] = v;
+                uint32_t* adj = adjacency.data() + offsets[v];
+                const uint32_t n = remaining[v];
+                for (uint32_t j = 0; j < n; j++) {
+                    if (adj[j] == best) {
+                        adj[j] = adj[n - 1];
+                        break;
+                    }
+                }
+                remaining[v] = n - 1;
+            }
+            for (size_t i = 0; i < cacheCount; i++) {
+                const uint32_t v = cache[i];
+                if (v != tri[0] && v != tri[1] && v != tri[2]) {
+                    next[nextCount++] = v;
+                }
+            }
+            for (size_t i = 0; i < nextCount; i++) {
+                cachePosition[next[i]] = i < cacheSize ? static_cast<int32_t>(i) : -1;
+                vertexScore[next[i]] = score(next[i]);
+            }
+
+            // 只有缓存里（以及刚被挤出）顶点的三角形分数会变化
+            best = -1;
+            float bestScore = -1.0f;
+            for (size_t i = 0; i < nextCount; i++) {
+                const uint32_t v = next[i];
+                const uint32_t* adj = adjacency.data() + offsets[v];
+                for (uint32_t j = 0; j < remaining[v]; j++) {
+                    const uint32_t t = adj[j];
+                    const float s = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] + vertexScore[indices[t * 3 + 2]];
+                    if (s > bestScore) {
+                        bestScore = s;
+                        best = t;
+                    }
+                }
+            }
+            cacheCount = std::min(nextCount, cacheSize);
+            memcpy(cache, next, sizeof(uint32_t) * cacheCount);
+        }
+    }
+
+    inline void Mesh::optimizeVertexCache(size_t cacheSize) {
+        RE_PROFILE_SCOPE("Mesh::optimizeVertexCache");
+        // 按块独立优化：块足够大时跨块的损失可以忽略，块内顶点换成紧凑的局部下标
+        constexpr size_t BLOCK = 1 << 18;
+        const size_t triangles = triangleCount();
+        const int64_t blocks = static_cast<int64_t>((triangles + BLOCK - 1) / BLOCK);
+        uint32_t* data = _indices.data();
+#pragma omp parallel
+        {
+            std::vector<uint32_t> unique, local, reordered;
+#pragma omp for schedule(dynamic)
+            for (int64_t b = 0; b < blocks; b++) {
+                const size_t first = b * BLOCK;
+                const size_t count = std::min(BLOCK, triangles - first);
+                uint32_t* block = data + first * 3;
+                unique.assign(block, block + count * 3);
+                std::sort(unique.begin(), unique.end());
+                unique.erase(std::unique(unique.begin(), unique.end()), unique.end());
+                local.resize(count * 3);
+                for (size_t i = 0; i < count * 3; i++) {
+                    local[i] = static_cast<uint32_t>(std::lower_bound(unique.begin(), unique.end(), block[i]) - unique.begin());
+                }
+                reordered.resize(count * 3);
+                mesh::forsythReorder(local.data(), count, unique.size(), cacheSize, reordered.data());
+                for (size_t i = 0; i < count * 3; i++) {
+                    block[i] = unique[reordered[i]];
+                }
+            }
+        }
+    }
+
+    inline void Mesh::optimizeVertexFetch() {
+        RE_PROFILE_SCOPE("Mesh::optimizeVertexFetch");
+        constexpr uint32_t UNUSED = UINT32_MAX;
+        std::vector<uint32_t> remap(_vertexCount, UNUSED);
+        uint32_t next = 0;
+        uint32_t* idx = _indices.data();
+        for (size_t i = 0; i < _indices.size(); i++) {
+            uint32_t& r = remap[idx[i]];
+            if (r == UNUSED) {
+                r = next++;
+            }
+            idx[i] = r;
+        }
+        // 没有被引用的顶点直接丢弃
+        const size_t used = next;
+        for (size_t s = 0; s < streamCount; s++) {
+            if (!streamUsed(s)) {
+                continue;
+            }
+            BufferStorage<float> moved;
+            moved.resize(used);
+            const float* src = streams[s].data();
+            float* dst = moved.data();
+#pragma omp parallel for schedule(static)
+            for (int64_t v = 0; v < static_cast<int64_t>(_vertexCount); v++) {
+                if (remap[v] != UNUSED) {
+                    dst[remap[v]] = src[v];
+                }
+            }
+            streams[s] = std::move(moved);
+        }
+        _vertexCount = used;
+    }
+
+    inline float Mesh::averageCacheMissRatio(size_t cacheSize) const {
+        if (triangleCount() == 0) {
+            return 0.0f;
+        }
+        std::vector<uint32_t> fifo(std::max<size_t>(cacheSize, 1), UINT32_MAX);
+        size_t head = 0, misses = 0;
+        const uint32_t* idx = _indices.data();
+        for (size_t i = 0; i < _indices.size(); i++) {
+            if (std::find(fifo.begin(), fifo.end(), idx[i]) == fifo.end()) {
+                fifo[head] = idx[i];
+                head = (head + 1) % fifo.size();
+                misses++;
+            }
+        }
+        return static_cast<float>(misses) / triangleCount();
+    }
+
+    inline void mesh::OBJChunk::parse(const char* begin, const char* end) {
+        auto skipSpace = [end](const char* p) {
+            while (p < end && (*p == ' ' || *p == '\t' || *p == '\r')) {
+                p++;
+            }
+            return p;
+        };
+        auto readFloat = [&](const char*& p, float& value) {
+            p = skipSpace(p);
+            if (p < end && *p == '+') {
+                p++;
+            }
+            value = 0.0f;
+            const std::from_chars_result r = std::from_chars(p, end, value);
+            if (r.ec == std::errc()) {
+                p = r.ptr;
+            }
+        };
+        // 读取一个面下标并转成 0 起；负下标转成段内下标并标记为需要重定位
+        auto readIndex = [end](const char*& p, size_t defined, int& index, bool& relative) {
+            int value = 0;
+            const std::from_chars_result r = std::from_chars(p, end, value);
+            if (r.ec != std::errc() || value == 0) {
+                return false;
+            }
+            p = r.ptr;
+            relative = value < 0;
+            index = relative ? static_cast<int>(static_cast<int64_t>(defined) + value) : value - 1;
+            return true;
+        };
+
+        std::vector<glm::ivec3> face;
+        std::vector<uint8_t> faceRelative; // 每个角的 3 个分量是否为负下标
+        const char* p = begin;
+        while (p < end) {
+            const char* lineEnd = static_cast<const char*>(memchr(p, '\n', end - p));
+            if (lineEnd == nullptr) {
+                lineEnd = end;
+            }
+            const char* q = skipSpace(p);
+            const size_t length = lineEnd - q;
+            if (length >= 2 && q[0] == 'v' && (q[1] == ' ' || q[1] == '\t')) {
+                q += 2;
+                for (int i = 0; i < 3; i++) {
+                    readFloat(q, positions.emplace_back());
+                }
+            } else if (length >= 3 && q[0] == 'v' && q[1] == 'n' && (q[2] == ' ' || q[2] == '\t')) {
+                q += 3;
+                for (int i = 0; i < 3; i++) {
+                    readFloat(q, normals.emplace_back());
+                }
+            } else if (length >= 3 && q[0] == 'v' && q[1] == 't' && (q[2] == ' ' || q[2] == '\t')) {
+                q += 3;
+                for (int i = 0; i < 2; i++) {
+                    readFloat(q, texcoords.emplace_back());
+                }
+            } else if (length >= 2 && q[0] == 'f' && (q[1] == ' ' || q[1] == '\t')) {
+                // 面的每个角为 v、v/t、v//n 或 v/t/n
+                q = skipSpace(q + 1);
+                face.clear();
+                faceRelative.clear();
+                bool ok = true;
+                while (ok && q < lineEnd) {
+                    glm::ivec3 key(-1);
+                    bool rel[3] = {false, false, false};
+                    ok = readIndex(q, positions.size() / 3, key.x, rel[0]);
+                    if (ok && q < lineEnd && *q == '/') {
+                        q++;
+                        if (q < lineEnd && *q != '/') {
+                            ok = readIndex(q, texcoords.size() / 2, key.z, rel[2]);
+                        }
+                        if (ok && q < lineEnd && *q == '/') {
+                            q++;
+                            ok = readIndex(q, normals.size() / 3, key.y, rel[1]);
+                        }
+                    }
+                    face.push_back(key);
+                    faceRelative.push_back(static_cast<uint8_t>(rel[0] | rel[1] << 1 | rel[2] << 2));
+                    q = skipSpace(q);
+                }
+                if (!ok) {
+                    if (badLine == 0) {
+                        badLine = static_cast<size_t>(p - begin) + 1;
+                    }
+                } else {
+                    for (size_t k = 2; k < face.size(); k++) {
+                        for (size_t c : {size_t(0), k - 1, k}) {
+                            for (uint32_t i = 0; i < 3; i++) {
+                                if (faceRelative[c] >> i & 1u) {
+                                    relative.push_back(static_cast<uint32_t>(corners.size() * 3 + i));
+                                }
+                            }
+                            corners.push_back(face[c]);
+                        }
+                    }
+                }
+            }
+            p = lineEnd + 1;
+        }
+    }
+
+    inline bool Mesh::loadOBJ(const char* filename, Mesh& mesh, bool optimize) {
+        RE_PROFILE_SCOPE("Mesh::loadOBJ");
+        MappedFile file;
+        if (!file.open(filename)) {
+            std::cerr << "Mesh Error: can not open " << filename << std::endl;
+            return false;
+        }
+        const char* text = reinterpret_cast<const char*>(file.data());
+        const size_t size = file.size();
+
+        // 按固定大小切段，每段的起点推到下一行的行首，各段独立解析
+        constexpr size_t CHUNK_BYTES = 1 << 20;
+        const size_t chunkCount = std::max<size_t>(size / CHUNK_BYTES, 1);
+        std::vector<size_t> chunkStart(chunkCount + 1, size);
+        chunkStart[0] = 0;
+        for (size_t i = 1; i < chunkCount; i++) {
+            const size_t from = std::max(i * CHUNK_BYTES, chunkStart[i - 1]);
+            const void* newline = memchr(text + from, '\n', size - from);
+            chunkStart[i] = newline ? static_cast<const char*>(newline) - text + 1 : size;
+        }
+        std::vector<mesh::OBJChunk> chunks(chunkCount);
+        {
+            RE_PROFILE_SCOPE("Mesh::loadOBJ::parse");
+#pragma omp parallel for schedule(dynamic)
+            for (int64_t c = 0; c < static_cast<int64_t>(chunkCount); c++) {
+                chunks[c].parse(text + chunkStart[c], text + chunkStart[c + 1]);
+            }
+        }
+        for (size_t c = 0; c < chunkCount; c++) {
+            if (chunks[c].badLine != 0) {
+                std::cerr << "Mesh Error: bad face at byte " << chunkStart[c] + chunks[c].badLine - 1 << " in " << filename << std::endl;
+                return false;
+            }
+        }
+
+        // 各段的属性和角在合并结果里的起点
+        std::vector<size_t> positionStart(chunkCount + 1, 0), normalStart(chunkCount + 1, 0);
+        std::vector<size_t> texcoordStart(chunkCount + 1, 0), cornerStart(chunkCount + 1, 0);
+        for (size_t c = 0; c < chunkCount; c++) {
+            positionStart[c + 1] = positionStart[c] + chunks[c].positions.size();
+            normalStart[c + 1] = normalStart[c] + chunks[c].normals.size();
+            texcoordStart[c + 1] = texcoordStart[c] + chunks[c].texcoords.size();
+            cornerStart[c + 1] = cornerStart[c] + chunks[c].corners.size();
+        }
+        const size_t cornerCount = cornerStart.back();
+        if (cornerCount == 0) {
+            std::cerr << "Mesh Error: no faces in " << filename << std::endl;
+            return false;
+        }
+
+        // 合并：拷贝属性，负下标加上前面各段的数量，同时给每个角按哈希分区
+        constexpr size_t PARTITIONS = 64;
+        std::vector<float> positions(positionStart.back()), normals(normalStart.back()), texcoords(texcoordStart.back());
+        std::vector<glm::ivec3> corners(cornerCount);
+        std::vector<uint8_t> partition(cornerCount);
+#pragma omp parallel for schedule(dynamic)
+        for (int64_t c = 0; c < static_cast<int64_t>(chunkCount); c++) {
+            mesh::OBJChunk& chunk = chunks[c];
+            std::copy(chunk.positions.begin(), chunk.positions.end(), positions.begin() + positionStart[c]);
+            std::copy(chunk.normals.begin(), chunk.normals.end(), normals.begin() + normalStart[c]);
+            std::copy(chunk.texcoords.begin(), chunk.texcoords.end(), texcoords.begin() + texcoordStart[c]);
+            const int base[3] = {static_cast<int>(positionStart[c] / 3), static_cast<int>(normalStart[c] / 3), static_cast<int>(texcoordStart[c] / 2)};
+            for (uint32_t r : chunk.relative) {
+                chunk.corners[r / 3][r % 3] += base[r % 3];
+            }
+            glm::ivec3* out = corners.data() + cornerStart[c];
+            uint8_t* part = partition.data() + cornerStart[c];
+            for (size_t i = 0; i < chunk.corners.size(); i++) {
+                out[i] = chunk.corners[i];
+                part[i] = static_cast<uint8_t>(std::hash<glm::ivec3>()(out[i]) % PARTITIONS);
+            }
+            chunk = mesh::OBJChunk();
+        }
+
+        // 计数排序把角按分区归类，保持原有顺序
+        std::vector<size_t> partitionStart(PARTITIONS + 1, 0);
+        for (size_t i = 0; i < cornerCount; i++) {
+            partitionStart[partition[i] + 1]++;
+        }
+        std::partial_sum(partitionStart.begin(), partitionStart.end(), partitionStart.begin());
+        std::vector<uint32_t> byPartition(cornerCount);
+        {
+            std::vector<size_t> fill(partitionStart.begin(), partitionStart.end() - 1);
+            for (size_t i = 0; i < cornerCount; i++) {
+                byPartition[fill[partition[i]]++] = static_cast<uint32_t>(i);
+            }
+        }
+
+        // 各分区的键互不相交，可以各自用一张哈希表去重
+        std::vector<uint32_t> localIndex(cornerCount);
+        std::vector<std::vector<glm::ivec3>> uniqueKeys(PARTITIONS);
+#pragma omp parallel for schedule(dynamic)
+        for (int64_t p = 0; p < static_cast<int64_t>(PARTITIONS); p++) {
+            std::unordered_map<glm::ivec3, uint32_t> lookup;
+            lookup.reserve(partitionStart[p + 1] - partitionStart[p]);
+            for (size_t i = partitionStart[p]; i < partitionStart[p + 1]; i++) {
+                const uint32_t corner = byPartition[i];
+                auto [it, inserted] = lookup.try_emplace(corners[corner], static_cast<uint32_t>(uniqueKeys[p].size()));
+                if (inserted) {
+                    uniqueKeys[p].push_back(corners[corner]);
+                }
+                localIndex[corner] = it->second;
+            }
+        }
+        std::vector<size_t> vertexStart(PARTITIONS + 1, 0);
+        for (size_t p = 0; p < PARTITIONS; p++) {
+            vertexStart[p + 1] = vertexStart[p] + uniqueKeys[p].size();
+        }
+        if (vertexStart.back() > UINT32_MAX) {
+            std::cerr << "Mesh Error: too many vertices in " << filename << std::endl;
+            return false;
+        }
+
+        mesh.clear();
+        mesh.resize(vertexStart.back(), cornerCount, !normals.empty(), !texcoords.empty());
+        uint32_t* indices = mesh.indices();
+#pragma omp parallel for schedule(static)
+        for (int64_t i = 0; i < static_cast<int64_t>(cornerCount); i++) {
+            indices[i] = static_cast<uint32_t>(vertexStart[partition[i]] + localIndex[i]);
+        }
+
+        const size_t positionCount = positions.size() / 3;
+        const size_t normalCount = normals.size() / 3;
+        const size_t texcoordCount = texcoords.size() / 2;
+        std::atomic<bool> valid{true};
+#pragma omp parallel for schedule(dynamic)
+        for (int64_t p = 0; p < static_cast<int64_t>(PARTITIONS); p++) {
+            for (size_t j = 0; j < uniqueKeys[p].size(); j++) {
+                const glm::ivec3 key = uniqueKeys[p][j];
+                if (key.x < 0 || static_cast<size_t>(key.x) >= positionCount) {
+                    valid = false;
+                    continue;
+                }
+                // 缺失的法线和纹理坐标补 0
+                const glm::vec3 position(positions[key.x * 3], positions[key.x * 3 + 1], positions[key.x * 3 + 2]);
+                glm::vec3 normal(0.0f);
+                if (key.y >= 0 && static_cast<size_t>(key.y) < normalCount) {
+                    normal = glm::vec3(normals[key.y * 3], normals[key.y * 3 + 1], normals[key.y * 3 + 2]);
+                }
+                glm::vec2 texcoord(0.0f);
+                if (key.z >= 0 && static_cast<size_t>(key.z) < texcoordCount) {
+                    texcoord = glm::vec2(texcoords[key.z * 2], texcoords[key.z * 2 + 1]);
+                }
+                mesh.setVertex(vertexStart[p] + j, position, normal, texcoord);
+            }
+        }
+        if (!valid) {
+            std::cerr << "Mesh Error: vertex index out of range in " << filename << std::endl;
+            mesh.clear();
+            return false;
+        }
+
+        if (optimize) {
+            mesh.optimizeVertexCache();
+            mesh.optimizeVertexFetch();
+        }
+        return true;
+    }
+
+    inline bool Mesh::writeCache(const char* filename) const {
+        FILE* out = fopen(filename, "wb");
+        if (out == nullptr) {
+            std::cerr << "Mesh Error: can not open " << filename << std::endl;
+            return false;
+        }
+        MeshFileHeader header{};
+        memcpy(header.magic, MAGIC, sizeof(MAGIC));
+        header.version = VERSION;
+        header.vertexCount = _vertexCount;
+        header.indexCount = _indices.size();
+        header.pageSize = PAGE_SIZE;
+        uint64_t offset = sizeof(MeshFileHeader);
+        for (size_t s = 0; s < streamCount; s++) {
+            if (streamUsed(s)) {
+                header.streamMask |= 1u << s;
+                offset = (offset + PAGE_SIZE - 1) / PAGE_SIZE * PAGE_SIZE;
+                header.streamOffset[s] = offset;
+                offset += _vertexCount * sizeof(float);
+            }
+        }
+        header.indexOffset = (offset + PAGE_SIZE - 1) / PAGE_SIZE * PAGE_SIZE;
+
+        size_t written = fwrite(&header, sizeof(header), 1, out) * sizeof(header);
+        bool ok = written == sizeof(header);
+        for (size_t s = 0; s < streamCount && ok; s++) {
+            if (header.streamMask & (1u << s)) {
+                written = padFileTo(out, written, PAGE_SIZE);
+                written += fwrite(streams[s].data(), sizeof(float), _vertexCount, out) * sizeof(float);
+                ok = written == header.streamOffset[s] + _vertexCount * sizeof(float);
+            }
+        }
+        if (ok) {
+            written = padFileTo(out, written, PAGE_SIZE);
+            written += fwrite(_indices.data(), sizeof(uint32_t), _indices.size(), out) * sizeof(uint32_t);
+            ok = written == header.indexOffset + _indices.size() * sizeof(uint32_t);
+        }
+        ok = fclose(out) == 0 && ok;
+        if (!ok) {
+            std::cerr << "Mesh Error: write failed " << filename << std::endl;
+        }
+        return ok;
+    }
+
+    inline bool Mesh::loadCache(const char* filename, Mesh& mesh) {
+        RE_PROFILE_SCOPE("Mesh::loadCache");
+        // 写时复制映射：网格可以原地修改（如重排），不会改动文件
+        auto file = std::make_shared<MappedFile>();
+        if (!file->open(filename, true)) {
+            return false;
+        }
+        const size_t size = file->size();
+        if (size < sizeof(MeshFileHeader)) {
+            std::cerr << "Mesh Error: truncated header " << filename << std::endl;
+            return false;
+        }
+        const MeshFileHeader& h = *reinterpret_cast<const MeshFileHeader*>(file->data());
+        if (memcmp(h.magic, MAGIC, sizeof(MAGIC)) != 0 || h.version != VERSION || (h.streamMask & 7u) != 7u || (h.streamMask >> streamCount) != 0 ||
+            h.vertexCount > UINT32_MAX || h.indexCount % 3 != 0) {
+            std::cerr << "Mesh Error: bad header " << filename << std::endl;
+            return false;
+        }
+        // offset + count * elementSize <= size，按除法比较避免溢出，同时要求按元素对齐
+        auto fits = [size](uint64_t offset, uint64_t count, size_t elementSize) {
+            return offset % elementSize == 0 && offset <= size && count <= (size - offset) / elementSize;
+        };
+        for (size_t s = 0; s < streamCount; s++) {
+            if ((h.streamMask & (1u << s)) && !fits(h.streamOffset[s], h.vertexCount, sizeof(float))) {
+                std::cerr << "Mesh Error: truncated stream " << s << " in " << filename << std::endl;
+                return false;
+            }
+        }
+        if (!fits(h.indexOffset, h.indexCount, sizeof(uint32_t))) {
+            std::cerr << "Mesh Error: truncated indices in " << filename << std::endl;
+            return false;
+        }
+        // 下标越界的缓存不能直接交给顶点阶段
+        const uint32_t* fileIndices = reinterpret_cast<const uint32_t*>(file->data() + h.indexOffset);
+        std::atomic<bool> inRange{true};
+#pragma omp parallel for schedule(static)
+        for (int64_t i = 0; i < static_cast<int64_t>(h.indexCount); i++) {
+            if (fileIndices[i] >= h.vertexCount) {
+                inRange.store(false, std::memory_order_relaxed);
+            }
+        }
+        if (!inRange) {
+            std::cerr << "Mesh Error: index out of range in " << filename << std::endl;
+            return false;
+        }
+
+        // 每个流都持有映射的引用，全部释放后才解除映射
+        mesh.clear();
+        mesh._vertexCount = h.vertexCount;
+        mesh._hasNormals = (h.streamMask >> streamNormalX & 7u) == 7u;
+        mesh._hasTexcoords = (h.streamMask >> streamTexcoordU & 3u) == 3u;
+        for (size_t s = 0; s < streamCount; s++) {
+            if (mesh.streamUsed(s)) {
+                float* ptr = reinterpret_cast<float*>(file->data() + h.streamOffset[s]);
+                mesh.streams[s].adopt(ptr, h.vertexCount, [file](float*) {});
+            }
+        }
+        uint32_t* indices = reinterpret_cast<uint32_t*>(file->data() + h.indexOffset);
+        mesh._indices.adopt(indices, h.indexCount, [file](uint32_t*) {});
+        return true;
+    }
+
+    inline bool Mesh::load(const char* objFile, const char* cacheFile, Mesh& mesh) {
+        std::error_code ec;
+        const auto objTime = std::filesystem::last_write_time(objFile, ec);
+        const bool objExists = !ec;
+        const auto cacheTime = std::filesystem::last_write_time(cacheFile, ec);
+        if (!ec && (!objExists || cacheTime >= objTime) && loadCache(cacheFile, mesh)) {
+            return true;
+        }
+        if (!loadOBJ(objFile, mesh)) {
+            return false;
+        }
+        // 缓存写失败不影响本次加载
+        mesh.writeCache(cacheFile);
+        return true;
+    }
+
+    inline AABB::AABB(const glm::vec3& min, const glm::vec3& max) : min(min), max(max) {}
+
+    inline void AABB::expand(const glm::vec3& p) {
+        min = glm::min(min, p);
+        max = glm::max(max, p);
+    }
+
+    inline void AABB::expand(const AABB& box) {
+        min = glm::min(min, box.min);
+        max = glm::max(max, box.max);
+    }
+
+    inline bool AABB::empty() const {
+        return min.x > max.x || min.y > max.y || min.z > max.z;
+    }
+
+    inline glm::vec3 AABB::center() const {
+        return (min + max) * 0.5f;
+    }
+
+    inline float AABB::area() const {
+        const glm::vec3 e = max - min;
+        return e.x * e.y + e.y * e.z + e.z * e.x;
+    }
+
+    inline float AABB::distance2(const glm::vec3& p) const {
+        const float dx = std::max({min.x - p.x, p.x - max.x, 0.0f});
+        const float dy = std::max({min.y - p.y, p.y - max.y, 0.0f});
+        const float dz = std::max({min.z - p.z, p.z - max.z, 0.0f});
+        return dx * dx + dy * dy + dz * dz;
+    }
+
+    inline AABB AABB::transformed(const glm::mat4& m) const {
+        // Arvo: 中心直接变换，半径乘以矩阵各元素的绝对值
+        const glm::vec3 c = glm::vec3(m * glm::vec4(center(), 1.0f));
+        const glm::vec3 e = (max - min) * 0.5f;
+        glm::vec3 r(0.0f);
+        for (int i = 0; i < 3; i++) {
+            for (int j = 0; j < 3; j++) {
+                r[i] += std::abs(m[j][i]) * e[j];
+            }
+        }
+        return AABB(c - r, c + r);
+    }
+
+    inline Frustum Frustum::fromMatrix(const glm::mat4& m) {
+        // Gribb-Hartmann：平面为矩阵行向量的组合，glm 按列存储
+        const glm::vec4 row0(m[0][0], m[1][0], m[2][0], m[3][0]);
+        const glm::vec4 row1(m[0][1], m[1][1], m[2][1], m[3][1]);
+        const glm::vec4 row2(m[0][2], m[1][2], m[2][2], m[3][2]);
+        const glm::vec4 row3(m[0][3], m[1][3], m[2][3], m[3][3]);
+        Frustum f;
+        f.planes[0] = row3 + row0;
+        f.planes[1] = row3 - row0;
+        f.planes[2] = row3 + row1;
+        f.planes[3] = row3 - row1;
+        f.planes[4] = row2;
+        f.planes[5] = row3 - row2;
+        for (auto& p : f.planes) {
+            const float len = std::sqrt(p.x * p.x + p.y * p.y + p.z * p.z);
+            if (len > 0.0f) {
+                p /= len;
+            }
+        }
+        return f;
+    }
+
+    inline bool Frustum::intersects(const AABB& box) const {
+        for (const auto& p : planes) {
+            // 只需测试沿法线方向最远的顶点
+            const float d = std::max(p.x * box.min.x, p.x * box.max.x) + std::max(p.y * box.min.y, p.y * box.max.y) +
+                            std::max(p.z * box.min.z, p.z * box.max.z) + p.w;
+            if (d < 0.0f) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    inline SceneBVH::PackedFrustum::PackedFrustum(const Frustum& frustum) {
+        std::copy(frustum.planes, frustum.planes + 6, planes);
+#if defined(RE_SIMD_AVX2)
+        for (int i = 0; i < 3; i++) {
+            const glm::vec4& a = planes[i * 2];
+            const glm::vec4& b = planes[i * 2 + 1];
+            x[i] = _mm256_setr_ps(a.x, a.x, a.x, a.x, b.x, b.x, b.x, b.x);
+            y[i] = _mm256_setr_ps(a.y, a.y, a.y, a.y, b.y, b.y, b.y, b.y);
+            z[i] = _mm256_setr_ps(a.z, a.z, a.z, a.z, b.z, b.z, b.z, b.z);
+            w[i] = _mm256_setr_ps(a.w, a.w, a.w, a.w, b.w, b.w, b.w, b.w);
+        }
+#elif defined(RE_SIMD_SSE2)
+        for (int i = 0; i < 6; i++) {
+            x[i] = _mm_set1_ps(planes[i].x);
+            y[i] = _mm_set1_ps(planes[i].y);
+            z[i] = _mm_set1_ps(planes[i].z);
+            w[i] = _mm_set1_ps(planes[i].w);
+        }
+#endif
+    }
+
+    inline void SceneBVH::testNode(const Node& node, const PackedFrustum& frustum, uint32_t& outside, uint32_t& intersect) {
+        // 最远顶点在平面外侧 -> 完全在外；最近顶点在平面外侧 -> 与平面相交
+#if defined(RE_SIMD_AVX2)
+        const __m256 minX = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(node.minX));
+        const __m256 minY = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(node.minY));
+        const __m256 minZ = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(node.minZ));
+        const __m256 maxX = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(node.maxX));
+        const __m256 maxY = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(node.maxY));
+        const __m256 maxZ = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(node.maxZ));
+        const __m256 zero = _mm256_setzero_ps();
+        __m256 out = zero, part = zero;
+        for (int i = 0; i < 3; i++) {
+            const __m256 x0 = _mm256_mul_ps(frustum.x[i], minX), x1 = _mm256_mul_ps(frustum.x[i], maxX);
+            const __m256 y0 = _mm256_mul_ps(frustum.y[i], minY), y1 = _mm256_mul_ps(frustum.y[i], maxY);
+            const __m256 z0 = _mm256_mul_ps(frustum.z[i], minZ), z1 = _mm256_mul_ps(frustum.z[i], maxZ);
+            const __m256 farDist = _mm256_add_ps(_mm256_add_ps(_mm256_max_ps(x0, x1), _mm256_max_ps(y0, y1)), _mm256_add_ps(_mm256_max_ps(z0, z1), frustum.w[i]));
+            const __m256 nearDist = _mm256_add_ps(_mm256_add_ps(_mm256_min_ps(x0, x1), _mm256_min_ps(y0, y1)), _mm256_add_ps(_mm256_min_ps(z0, z1), frustum.w[i]));
+            out = _mm256_or_ps(out, _mm256_cmp_ps(farDist, zero, _CMP_LT_OQ));
+            part = _mm256_or_ps(part, _mm256_cmp_ps(nearDist, zero, _CMP_LT_OQ));
+        }
+        const uint32_t o = static_cast<uint32_t>(_mm256_movemask_ps(out));
+        const uint32_t p = static_cast<uint32_t>(_mm256_movemask_ps(part));
+        outside = (o | (o >> 4)) & 0xF;
+        intersect = (p | (p >> 4)) & 0xF;
+#elif defined(RE_SIMD_SSE2)
+        const __m128 minX = _mm_load_ps(node.minX), minY = _mm_load_ps(node.minY), minZ = _mm_load_ps(node.minZ);
+        const __m128 maxX = _mm_load_ps(node.maxX), maxY = _mm_load_ps(node.maxY), maxZ = _mm_load_ps(node.maxZ);
+        const __m128 zero = _mm_setzero_ps();
+        __m128 out = zero, part = zero;
+        for (int i = 0; i < 6; i++) {
+            const __m128 x0 = _mm_mul_ps(frustum.x[i], minX), x1 = _mm_mul_ps(frustum.x[i], maxX);
+            const __m128 y0 = _mm_mul_ps(frustum.y[i], minY), y1 = _mm_mul_ps(frustum.y[i], maxY);
+            const __m128 z0 = _mm_mul_ps(frustum.z[i], minZ), z1 = _mm_mul_ps(frustum.z[i], maxZ);
+            const __m128 farDist = _mm_add_ps(_mm_add_ps(_mm_max_ps(x0, x1), _mm_max_ps(y0, y1)), _mm_add_ps(_mm_max_ps(z0, z1), frustum.w[i]));
+            const __m128 nearDist = _mm_add_ps(_mm_add_ps(_mm_min_ps(x0, x1), _mm_min_ps(y0, y1)), _mm_add_ps(_mm_min_ps(z0, z1), frustum.w[i]));
+            out = _mm_or_ps(out, _mm_cmplt_ps(farDist, zero));
+            part = _mm_or_ps(part, _mm_cmplt_ps(nearDist, zero));
+        }
+        outside = static_cast<uint32_t>(_mm_movemask_ps(out));
+        intersect = static_cast<uint32_t>(_mm_movemask_ps(part));
+#else
+        outside = intersect = 0;
+        for (uint32_t s = 0; s < 4; s++) {
+            for (const auto& p : frustum.planes) {
+                const float x0 = p.x * node.minX[s], x1 = p.x * node.maxX[s];
+                const float y0 = p.y * node.minY[s], y1 = p.y * node.maxY[s];
+                const float z0 = p.z * node.minZ[s], z1 = p.z * node.maxZ[s];
+                if (std::max(x0, x1) + std::max(y0, y1) + std::max(z0, z1) + p.w < 0.0f) {
+                    outside |= 1u << s;
+                }
+                if (std::min(x0, x1) + std::min(y0, y1) + std::min(z0, z1) + p.w < 0.0f) {
+                    intersect |= 1u << s;
+                }
+            }
+        }
+#endif
+    }
+
+    inline void SceneBVH::build(const AABB* objects, size_t count) {
+        boxes.assign(objects, objects + count);
+        buildTree();
+    }
+
+    inline void SceneBVH::build(const std::vector<AABB>& objects) {
+        build(objects.data(), objects.size());
+    }
+
+    inline void SceneBVH::rebuild() {
+        buildTree();
+    }
+
+    inline void SceneBVH::clear() {
+        nodes.clear();
+        boxes.clear();
+        centroids.clear();
+        order.clear();
+        objectNode.clear();
+        dirty.clear();
+        buildCost = 0.0f;
+    }
+
+    inline void SceneBVH::buildTree() {
+        RE_PROFILE_SCOPE("SceneBVH::build");
+        const size_t count = boxes.size();
+        nodes.clear();
+        nodes.reserve(count / 2 + 1);
+        centroids.resize(count);
+        order.resize(count);
+        objectNode.assign(count, INVALID);
+#pragma omp parallel for schedule(static)
+        for (int64_t i = 0; i < static_cast<int64_t>(count); i++) {
+            centroids[i] = boxes[i].center();
+            order[i] = static_cast<uint32_t>(i);
+        }
+        if (count > 0) {
+            buildNode(0, static_cast<uint32_t>(count), INVALID);
+        }
+        dirty.assign(nodes.size(), 0);
+        buildCost = cost();
+    }
+
+    inline uint32_t SceneBVH::buildNode(uint32_t begin, uint32_t end, uint32_t parent) {
+        const uint32_t index = static_cast<uint32_t>(nodes.size());
+        nodes.emplace_back();
+        nodes[index].parent = parent;
+
+        // 反复二分当前最大的区间，直到凑满 4 个子节点或者都已不超过叶子容量
+        uint32_t ranges[4][2] = {{begin, end}};
+        uint32_t n = 1;
+        while (n < 4) {
+            uint32_t pick = n, largest = LEAF_SIZE;
+            for (uint32_t r = 0; r < n; r++) {
+                if (ranges[r][1] - ranges[r][0] > largest) {
+                    largest = ranges[r][1] - ranges[r][0];
+                    pick = r;
+                }
+            }
+            if (pick == n) {
+                break;
+            }
+            const uint32_t mid = split(ranges[pick][0], ranges[pick][1]);
+            ranges[n][0] = mid;
+            ranges[n][1] = ranges[pick][1];
+            ranges[pick][1] = mid;
+            n++;
+        }
+
+        for (uint32_t s = 0; s < 4; s++) {
+            uint32_t child = INVALID, count = 0;
+            if (s < n) {
+                const uint32_t size = ranges[s][1] - ranges[s][0];
+                if (size <= LEAF_SIZE) {
+                    child = ranges[s][0];
+                    count = size;
+                    for (uint32_t i = ranges[s][0]; i < ranges[s][1]; i++) {
+                        objectNode[order[i]] = index;
+                    }
+                } else {
+                    // 递归时 nodes 可能扩容，不能持有节点的引用
+                    child = buildNode(ranges[s][0], ranges[s][1], index);
+                }
+            }
+            nodes[index].child[s] = child;
+            nodes[index].count[s] = count;
+        }
+        updateNode(index);
+        return index;
+    }
+
+    inline uint32_t SceneBVH::split(uint32_t begin, uint32_t end) {
+        // 分桶 SAH：三个轴各 16 个桶，在桶边界中选代价最小的划分
+        constexpr int BINS = 16;
+        AABB centerBounds;
+        for (uint32_t i = begin; i < end; i++) {
+            centerBounds.expand(centroids[order[i]]);
+        }
+        const glm::vec3 extent = centerBounds.max - centerBounds.min;
+        float bestCost = std::numeric_limits<float>::max();
+        int bestAxis = -1, bestBin = 0;
+        for (int axis = 0; axis < 3; axis++) {
+            if (!(extent[axis] > 0.0f)) {
+                continue;
+            }
+            const float scale = BINS / extent[axis];
+            AABB bins[BINS];
+            uint32_t counts[BINS] = {};
+            for (uint32_t i = begin; i < end; i++) {
+                const int b = std::min(BINS - 1, static_cast<int>((centroids[order[i]][axis] - centerBounds.min[axis]) * scale));
+                bins[b].expand(boxes[order[i]]);
+                counts[b]++;
+            }
+            float rightArea[BINS];
+            uint32_t rightCount[BINS];
+            AABB acc;
+            uint32_t accCount = 0;
+            for (int b = BINS - 1; b > 0; b--) {
+                acc.expand(bins[b]);
+                accCount += counts[b];
+                rightArea[b] = acc.area();
+                rightCount[b] = accCount;
+            }
+            acc = AABB();
+            accCount = 0;
+            for (int b = 0; b < BINS - 1; b++) {
+                acc.expand(bins[b]);
+                accCount += counts[b];
+                if (accCount == 0 || rightCount[b + 1] == 0) {
+                    continue;
+                }
+                const float c = acc.area() * accCount + rightArea[b + 1] * rightCount[b + 1];
+                if (c < bestCost) {
+                    bestCost = c;
+                    bestAxis = axis;
+                    bestBin = b;
+                }
+            }
+        }
+
+        if (bestAxis < 0) {
+            // 所有中心重合，按数量对半分
+            return begin + (end - begin) / 2;
+        }
+        const float scale = BINS / extent[bestAxis];
+        const float origin = centerBounds.min[bestAxis];
+        const auto mid = std::partition(order.begin() + begin, order.begin() + end, [&](uint32_t o) {
+            return std::min(BINS - 1, static_cast<int>((centroids[o][bestAxis] - origin) * scale)) <= bestBin;
+        });
+        return static_cast<uint32_t>(mid - order.begin());
+    }
+
+    inline AABB SceneBVH::slotBounds(const Node& node, uint32_t s) const {
+        return AABB(glm::vec3(node.minX[s], node.minY[s], node.minZ[s]), glm::vec3(node.maxX[s], node.maxY[s], node.maxZ[s]));
+    }
+
+    inline void SceneBVH::updateNode(uint32_t index) {
+        Node& node = nodes[index];
+        for (uint32_t s = 0; s < 4; s++) {
+            AABB box;
+            if (node.child[s] != INVALID) {
+                if (node.count[s] > 0) {
+                    for (uint32_t i = 0; i < node.count[s]; i++) {
+                        box.expand(boxes[order[node.child[s] + i]]);
+                    }
+                } else {
+                    const Node& child = nodes[node.child[s]];
+                    for (uint32_t c = 0; c < 4; c++) {
+                        if (child.child[c] != INVALID) {
+                            box.expand(slotBounds(child, c));
+                        }
+                    }
+                }
+            }
+            node.minX[s] = box.min.x;
+            node.minY[s] = box.min.y;
+            node.minZ[s] = box.min.z;
+            node.maxX[s] = box.max.x;
+            node.maxY[s] = box.max.y;
+            node.maxZ[s] = box.max.z;
+        }
+    }
+
+    inline void SceneBVH::update(uint32_t object, const AABB& box) {
+        boxes[object] = box;
+        uint32_t index = objectNode[object];
+        while (index != INVALID && !dirty[index]) {
+            dirty[index] = 1;
+            index = nodes[index].parent;
+        }
+    }
+
+    inline void SceneBVH::refit() {
+        RE_PROFILE_SCOPE("SceneBVH::refit");
+        // 子节点下标总是大于父节点，倒序遍历保证子节点先更新
+        for (size_t i = nodes.size(); i-- > 0;) {
+            if (dirty[i]) {
+                updateNode(static_cast<uint32_t>(i));
+                dirty[i] = 0;
+            }
+        }
+    }
+
+    inline float SceneBVH::cost() const {
+        const float root = sceneBounds().area();
+        if (!(root > 0.0f)) {
+            return 0.0f;
+        }
+        double sum = 0.0;
+        for (const Node& node : nodes) {
+            for (uint32_t s = 0; s < 4; s++) {
+                if (node.child[s] != INVALID) {
+                    sum += slotBounds(node, s).area();
+                }
+            }
+        }
+        return static_cast<float>(sum / root);
+    }
+
+    inline bool SceneBVH::needsRebuild(float ratio) const {
+        return cost() > buildCost * ratio;
+    }
+
+    inline size_t SceneBVH::objectCount() const {
+        return boxes.size();
+    }
+
+    inline size_t SceneBVH::nodeCount() const {
+        return nodes.size();
+    }
+
+    inline const AABB& SceneBVH::bounds(uint32_t object) const {
+        return boxes[object];
+    }
+
+    inline AABB SceneBVH::sceneBounds() const {
+        AABB box;
+        if (!nodes.empty()) {
+            for (uint32_t s = 0; s < 4; s++) {
+                if (nodes[0].child[s] != INVALID) {
+                    box.expand(slotBounds(nodes[0], s));
+                }
+            }
+        }
+        return box;
+    }
+
+    inline void SceneBVH::cull(const Frustum& frustum, const glm::vec3& eye, std::vector<uint32_t>& visible) const {
+        RE_PROFILE_SCOPE("SceneBVH::cull");
+        traverse(
+            frustum, eye, [](const AABB&) { return false; }, [&](uint32_t object) { visible.push_back(object); });
+    }
+
+    template <typename Occluded, typename Visit>
+    void SceneBVH::traverse(const Frustum& frustum, const glm::vec3& eye, Occluded&& occluded, Visit&& visit) const {
+        if (nodes.empty()) {
+            return;
+        }
+        const PackedFrustum packed(frustum);
+        // inside 表示该子树已经完全在视锥内，不必再做平面测试
+        struct Entry {
+            uint32_t node;
+            uint32_t slot;
+            bool inside;
+        };
+        std::vector<Entry> stack;
+        stack.reserve(64);
+
+        auto pushChildren = [&](uint32_t index, bool inside) {
+            const Node& node = nodes[index];
+            uint32_t outside = 0, intersect = 0;
+            if (!inside) {
+                testNode(node, packed, outside, intersect);
+            }
+            // 可见的子节点按到视点的距离插入排序，远的先入栈，近的先出栈
+            uint32_t slots[4];
+            float keys[4];
+            int n = 0;
+            for (uint32_t s = 0; s < 4; s++) {
+                if (node.child[s] == INVALID || (outside >> s) & 1) {
+                    continue;
+                }
+                const float key = slotBounds(node, s).distance2(eye);
+                int j = n++;
+                for (; j > 0 && keys[j - 1] > key; j--) {
+                    keys[j] = keys[j - 1];
+                    slots[j] = slots[j - 1];
+                }
+                keys[j] = key;
+                slots[j] = s;
+            }
+            for (int i = n - 1; i >= 0; i--) {
+                stack.push_back({index, slots[i], inside || !((intersect >> slots[i]) & 1)});
+            }
+        };
+
+        pushChildren(0, false);
+        while (!stack.empty()) {
+            const Entry e = stack.back();
+            stack.pop_back();
+            const Node& node = nodes[e.node];
+            if (occluded(static_cast<const AABB&>(slotBounds(node, e.slot)))) {
+                continue;
+            }
+            if (node.count[e.slot] == 0) {
+                pushChildren(node.child[e.slot], e.inside);
+                continue;
+            }
+            const uint32_t first = node.child[e.slot], count = node.count[e.slot];
+            if (count == 1) {
+                // 叶子里只有一个物体时，它的包围盒就是刚测试过的槽
+                visit(order[first]);
+                continue;
+            }
+            uint32_t objects[LEAF_SIZE];
+            float keys[LEAF_SIZE];
+            int n = 0;
+            for (uint32_t i = 0; i < count; i++) {
+                const uint32_t object = order[first + i];
+                if (!e.inside && !frustum.intersects(boxes[object])) {
+                    continue;
+                }
+                const float key = boxes[object].distance2(eye);
+                int j = n++;
+                for (; j > 0 && keys[j - 1] > key; j--) {
+                    keys[j] = keys[j - 1];
+                    objects[j] = objects[j - 1];
+                }
+                keys[j] = key;
+                objects[j] = object;
+            }
+            for (int i = 0; i < n; i++) {
+                if (!occluded(static_cast<const AABB&>(boxes[objects[i]]))) {
+                    visit(objects[i]);
+                }
+            }
+        }
+    }
+}
@@ -1,9 +1,24 @@
 #include "RE_Fixpoint.h"
-// #include "REThreadPool.h"
+#include "RE_ThreadPool.h"
 #include "RE_Geometry2D.hpp"
+#include "RE_Geometry3D.hpp"
 #include "RE_Painter.hpp"
+#include "RE_Text.hpp"
 #include "RE_Buffer3D.hpp"
 #include "RE_Texture.hpp"
+#include "RE_TextureLoader.hpp"
+#include "RE_TextureFile.hpp"
+#include "RE_VirtualTexture.hpp"
+#include "RE_ToneMapping.hpp"
+#include "RE_PackedTexture.hpp"
+#include "RE_OIT.hpp"
+#include "RE_RenderTarget.hpp"
+#include "RE_Renderer.hpp"
+#include "RE_VertexStage.hpp"
+#include "RE_OcclusionBuffer.hpp"
+#include "RE_RayTracer.hpp"
+#include "RE_DynamicResolution.hpp"
+#include "RE_FramePacer.hpp"
 
 #include "MainWindow.hpp"
 
@@ -12,4 +27,8 @@
 // #endif
 // #ifdef RE_EXTEND_NOISE_GENERATOR
 #include "drawing/REX_NoiseGenerator.hpp"
-// #endif
\ No newline at end of file
+// #endif
+#include "postprocess/REX_LUT3D.hpp"
+#include "postprocess/REX_Blur.hpp"
+#include "postprocess/REX_TAA.hpp"
+#include "postprocess/REX_Upscale.hpp"
@@ -0,0 +1,187 @@
+#pragma once
+#include "RE_includes.h"
+#include "RE_Texture.hpp"
+
+namespace RE {
+    // 顺序无关透明（OIT）：半透明片元先按像素挂到链表上，最后统一排序合成
+    // 插入是无锁的（原子递增分配 + 原子交换链表头），多个线程可以同时往同一个缓冲里绘制
+    struct OITFragment {
+        hrgba color; // 非预乘，uint8_t 纹理的颜色归一化到 [0, 1]
+        float depth; // 越小越近
+        uint32_t next;
+    };
+
+    class OITBuffer {
+    public:
+        static constexpr uint32_t EMPTY = 0xffffffffu;
+        static constexpr size_t MAX_LAYERS = 64; // 每个像素参与排序的最大片元数，超出部分丢弃最远的
+        // 片元池满后计数器最多再被并发线程各多加一次，池容量留出这部分余量，保证 32 位计数器不会回绕
+        static constexpr uint32_t COUNTER_HEADROOM = 1u << 20;
+
+        OITBuffer();
+        // capacity 为 0 时按平均每像素 4 层分配
+        OITBuffer(size_t width, size_t height, size_t capacity = 0);
+        OITBuffer(const OITBuffer&) = delete;
+        OITBuffer& operator=(const OITBuffer&) = delete;
+
+        void setSize(size_t width, size_t height, size_t capacity = 0);
+        // 清空所有链表，不释放内存
+        void clear();
+
+        // 线程安全，片元池用完时返回 false 并记录 overflowed
+        bool insert(size_t x, size_t y, hrgba color, float depth);
+        bool insert(size_t x, size_t y, rgba color, float depth);
+
+        // 把每个像素的片元按深度从远到近合成到 target 已有的颜色上（标准 over 混合），按行多线程
+        template <typename T>
+        void resolve(TextureBase<T>& target) const;
+
+        size_t width() const;
+        size_t height() const;
+        size_t capacity() const;
+        size_t fragmentCount() const;
+        bool overflowed() const;
+
+    private:
+        size_t _width = 0, _height = 0;
+        std::unique_ptr<std::atomic<uint32_t>[]> heads;
+        std::vector<OITFragment> fragments;
+        std::atomic<uint32_t> counter{0};
+        std::atomic<bool> _overflowed{false};
+    };
+}
+
+namespace RE {
+    inline OITBuffer::OITBuffer() {}
+
+    inline OITBuffer::OITBuffer(size_t width, size_t height, size_t capacity) {
+        setSize(width, height, capacity);
+    }
+
+    inline void OITBuffer::setSize(size_t width, size_t height, size_t capacity) {
+        _width = width;
+        _height = height;
+        if (capacity == 0) {
+            capacity = width * height * 4;
+        }
+        capacity = std::min<size_t>(capacity, EMPTY - COUNTER_HEADROOM); // 下标是 32 位的
+        heads.reset(new std::atomic<uint32_t>[width * height]);
+        fragments.resize(capacity);
+        clear();
+    }
+
+    inline void OITBuffer::clear() {
+        const int64_t n = static_cast<int64_t>(_width * _height);
+#pragma omp parallel for
+        for (int64_t i = 0; i < n; i++) {
+            heads[i].store(EMPTY, std::memory_order_relaxed);
+        }
+        counter.store(0, std::memory_order_relaxed);
+        _overflowed.store(false, std::memory_order_relaxed);
+    }
+
+    inline bool OITBuffer::insert(size_t x, size_t y, hrgba color, float depth) {
+        if (x >= _width || y >= _height || color.a <= 0.0f) {
+            return false;
+        }
+        // 池满之后不再递增：否则大量重绘会让计数器回绕，分配出仍在链表中的片元，形成环
+        if (counter.load(std::memory_order_relaxed) >= fragments.size()) {
+            _overflowed.store(true, std::memory_order_relaxed);
+            return false;
+        }
+        const uint32_t index = counter.fetch_add(1, std::memory_order_relaxed);
+        if (index >= fragments.size()) {
+            _overflowed.store(true, std::memory_order_relaxed);
+            return false;
+        }
+        OITFragment& f = fragments[index];
+        f.color = color;
+        f.depth = depth;
+        // 交换之后其他线程才可能看到该片元，片元内容需要在此之前写完
+        f.next = heads[y * _width + x].exchange(index, std::memory_order_acq_rel);
+        return true;
+    }
+
+    inline bool OITBuffer::insert(size_t x, size_t y, rgba color, float depth) {
+        return insert(x, y, hrgba(color) / 255.0f, depth);
+    }
+
+    template <typename T>
+    void OITBuffer::resolve(TextureBase<T>& target) const {
+        const size_t w = std::min(_width, target.width());
+        const size_t h = std::min(_height, target.height());
+        const size_t c = target.channel();
+        const float unit = std::is_integral_v<T> ? 255.0f : 1.0f;
+        T* out = target.data();
+
+#pragma omp parallel for schedule(dynamic, 4)
+        for (int64_t y = 0; y < static_cast<int64_t>(h); y++) {
+            OITFragment layers[MAX_LAYERS];
+            for (size_t x = 0; x < w; x++) {
+                uint32_t node = heads[y * _width + x].load(std::memory_order_acquire);
+                if (node == EMPTY) {
+                    continue;
+                }
+                // 收集并按深度从远到近插入排序，层数很少时比通用排序快
+                size_t count = 0;
+                for (; node != EMPTY && node < fragments.size(); node = fragments[node].next) {
+                    const OITFragment& f = fragments[node];
+                    if (count == MAX_LAYERS) {
+                        if (f.depth >= layers[0].depth) {
+                            continue; // 比已收集的都远，丢弃
+                        }
+                        std::copy(layers + 1, layers + count, layers);
+                        count--;
+                    }
+                    size_t i = count++;
+                    while (i > 0 && layers[i - 1].depth < f.depth) {
+                        layers[i] = layers[i - 1];
+                        i--;
+                    }
+                    layers[i] = f;
+                }
+
+                T* p = out + target.getIndex(x, y);
+                hrgba dst(0.0f, 0.0f, 0.0f, 1.0f);
+                for (size_t k = 0; k < std::min<size_t>(c, 4); k++) {
+                    dst[k] = p[k] / unit;
+                }
+                for (size_t i = 0; i < count; i++) {
+                    const hrgba& s = layers[i].color;
+                    const float a = std::min(s.a, 1.0f);
+                    dst.r = s.r * a + dst.r * (1.0f - a);
+                    dst.g = s.g * a + dst.g * (1.0f - a);
+                    dst.b = s.b * a + dst.b * (1.0f - a);
+                    dst.a = a + dst.a * (1.0f - a);
+                }
+                for (size_t k = 0; k < std::min<size_t>(c, 4); k++) {
+                    if constexpr (std::is_integral_v<T>) {
+                        p[k] = static_cast<T>(RE::camp(dst[k], 0.0f, 1.0f) * unit + 0.5f);
+                    } else {
+                        p[k] = dst[k];
+                    }
+                }
+            }
+        }
+    }
+
+    inline size_t OITBuffer::width() const {
+        return _width;
+    }
+
+    inline size_t OITBuffer::height() const {
+        return _height;
+    }
+
+    inline size_t OITBuffer::capacity() const {
+        return fragments.size();
+    }
+
+    inline size_t OITBuffer::fragmentCount() const {
+        return std::min<size_t>(counter.load(std::memory_order_relaxed), fragments.size());
+    }
+
+    inline bool OITBuffer::overflowed() const {
+        return _overflowed.load(std::memory_order_relaxed);
+    }
+}
@@ -0,0 +1,354 @@
+#pragma once
+#include "RE_includes.h"
+#include "RE_Geometry3D.hpp"
+
+namespace RE {
+    // 软件遮挡缓冲（Masked Occlusion Culling）：低分辨率，按 32x8 像素分 tile，
+    // 每个 tile 只存一个 256 位覆盖掩码和两层最远深度，不保存逐像素深度
+    // 每帧先 clear，画少量大的遮挡体，再用物体的包围盒查询，被完全挡住的物体不提交给光栅化
+    // 与 SceneBVH::traverse 配合：occluded 回调直接使用 OcclusionBuffer::occluded
+    // 深度与 VertexStage 一致：NDC [0, 1]，越小越近
+    class OcclusionBuffer {
+    public:
+        static constexpr size_t TILE_W = 32;
+        static constexpr size_t TILE_H = 8;
+
+        OcclusionBuffer() = default;
+        OcclusionBuffer(size_t width, size_t height);
+
+        // 尺寸向上取整到 tile 的整数倍，通常为屏幕分辨率的 1/4 左右
+        void setSize(size_t width, size_t height);
+        size_t width() const;
+        size_t height() const;
+        void clear();
+        // 剔除背面遮挡体（屏幕空间面积为负，与 Rasterizer 的约定一致），遮挡体为封闭网格时可以减少一半的工作量
+        void setCullBackFace(bool cull);
+
+        // positions 为物体空间坐标，mvp 为 projection * view * model
+        // 跨过近平面的三角形直接跳过（少画遮挡体总是保守的）
+        void renderOccluder(const glm::vec3* positions, const uint32_t* indices, size_t triangleCount, const glm::mat4& mvp);
+        void renderOccluder(const Mesh& mesh, const glm::mat4& mvp);
+
+        // 查询包围盒使用的 projection * view，包围盒为世界空间
+        void setViewProjection(const glm::mat4& viewProjection);
+        // 包围盒被完全遮挡时返回 true；跨过近平面或在屏幕外时返回 false，交给视锥剔除处理
+        bool occluded(const AABB& box) const;
+        // 遮挡缓冲像素坐标的矩形 [x0, x1) x [y0, y1)，物体最近深度为 zMin
+        bool occludedRect(float x0, float y0, float x1, float y1, float zMin) const;
+        // 像素的保守深度上界（调试显示用）
+        float depthBound(size_t x, size_t y) const;
+
+    private:
+        // mask 的第 row 个元素的第 col 位对应 tile 内的像素 (col, row)
+        // zMax0：整个 tile 的深度上界；zMax1：mask 覆盖的工作层的深度上界
+        struct alignas(32) Tile {
+            uint32_t mask[TILE_H];
+            float zMax0;
+            float zMax1;
+        };
+
+        std::vector<Tile> tiles;
+        size_t _width = 0;
+        size_t _height = 0;
+        size_t tilesX = 0;
+        size_t tilesY = 0;
+        bool cullBackFace = true;
+        glm::mat4 viewProjection = glm::mat4(1.0f);
+
+        // 屏幕坐标（遮挡缓冲像素，y 向下），z 为 NDC 深度
+        void rasterizeTriangle(glm::vec3 v0, glm::vec3 v1, glm::vec3 v2);
+        // 三条边 a * x + b * y + c >= 0 在 tile 内 8 行像素中心的覆盖掩码
+        static void tileCoverage(const float* a, const float* b, const float* c, float x0, float y0, uint32_t* coverage);
+        static void updateTile(Tile& tile, const uint32_t* coverage, float z);
+    };
+}
+
+namespace RE {
+    inline OcclusionBuffer::OcclusionBuffer(size_t width, size_t height) {
+        setSize(width, height);
+    }
+
+    inline void OcclusionBuffer::setSize(size_t width, size_t height) {
+        tilesX = (width + TILE_W - 1) / TILE_W;
+        tilesY = (height + TILE_H - 1) / TILE_H;
+        _width = tilesX * TILE_W;
+        _height = tilesY * TILE_H;
+        tiles.resize(tilesX * tilesY);
+        clear();
+    }
+
+    inline size_t OcclusionBuffer::width() const {
+        return _width;
+    }
+
+    inline size_t OcclusionBuffer::height() const {
+        return _height;
+    }
+
+    inline void OcclusionBuffer::clear() {
+        for (Tile& t : tiles) {
+            std::fill(t.mask, t.mask + TILE_H, 0u);
+            t.zMax0 = 1.0f;
+            t.zMax1 = 0.0f;
+        }
+    }
+
+    inline void OcclusionBuffer::setCullBackFace(bool cull) {
+        cullBackFace = cull;
+    }
+
+    inline void OcclusionBuffer::setViewProjection(const glm::mat4& vp) {
+        viewProjection = vp;
+    }
+
+    inline void OcclusionBuffer::renderOccluder(const Mesh& mesh, const glm::mat4& mvp) {
+        // Mesh 按 SoA 存放，先拼成 AoS 位置；遮挡体通常只有几百个三角形
+        std::vector<glm::vec3> positions(mesh.vertexCount());
+        for (size_t i = 0; i < positions.size(); i++) {
+            positions[i] = mesh.position(i);
+        }
+        renderOccluder(positions.data(), mesh.indices(), mesh.triangleCount(), mvp);
+    }
+
+    inline void OcclusionBuffer::renderOccluder(const glm::vec3* positions, const uint32_t* indices, size_t triangleCount, const glm::mat4& mvp) {
+        RE_PROFILE_SCOPE("OcclusionBuffer::renderOccluder");
+        const float w = static_cast<float>(_width), h = static_cast<float>(_height);
+        for (size_t t = 0; t < triangleCount; t++) {
+            glm::vec3 screen[3];
+            bool clipped = false;
+            for (int k = 0; k < 3; k++) {
+                const glm::vec4 c = mvp * glm::vec4(positions[indices[t * 3 + k]], 1.0f);
+                if (!(c.w > 1e-6f) || c.z < 0.0f) {
+                    clipped = true;
+                    break;
+                }
+                const float invW = 1.0f / c.w;
+                screen[k] = glm::vec3((c.x * invW * 0.5f + 0.5f) * w, (0.5f - c.y * invW * 0.5f) * h, c.z * invW);
+            }
+            if (!clipped) {
+                rasterizeTriangle(screen[0], screen[1], screen[2]);
+            }
+        }
+    }
+
+    inline void OcclusionBuffer::rasterizeTriangle(glm::vec3 v0, glm::vec3 v1, glm::vec3 v2) {
+        float area = (v1.x - v0.x) * (v2.y - v0.y) - (v1.y - v0.y) * (v2.x - v0.x);
+        if (!(area != 0.0f) || (cullBackFace && area < 0.0f)) {
+            return;
+        }
+        if (area < 0.0f) {
+            std::swap(v1, v2);
+            area = -area;
+        }
+
+        const float minX = std::max(0.0f, std::floor(std::min({v0.x, v1.x, v2.x})));
+        const float maxX = std::min(static_cast<float>(_width), std::ceil(std::max({v0.x, v1.x, v2.x})));
+        const float minY = std::max(0.0f, std::floor(std::min({v0.y, v1.y, v2.y})));
+        const float maxY = std::min(static_cast<float>(_height), std::ceil(std::max({v0.y, v1.y, v2.y})));
+        if (minX >= maxX || minY >= maxY) {
+            return;
+        }
+
+        // 边函数 E(x, y) = a * x + b * y + c，三角形内部三条边都 >= 0
+        const glm::vec3* v[3] = {&v0, &v1, &v2};
+        float a[3], b[3], c[3];
+        for (int e = 0; e < 3; e++) {
+            const glm::vec3& p = *v[e];
+            const glm::vec3& q = *v[(e + 1) % 3];
+            a[e] = p.y - q.y;
+            b[e] = q.x - p.x;
+            c[e] = -(a[e] * p.x + b[e] * p.y);
+        }
+        // 深度平面 z = zA * x + zB * y + zC，tile 内的深度上界取矩形角点的最大值，再不超过三角形的最远深度
+        const float zA = ((v1.z - v0.z) * (v2.y - v0.y) - (v2.z - v0.z) * (v1.y - v0.y)) / area;
+        const float zB = ((v2.z - v0.z) * (v1.x - v0.x) - (v1.z - v0.z) * (v2.x - v0.x)) / area;
+        const float zC = v0.z - zA * v0.x - zB * v0.y;
+        const float zTriangle = std::max({v0.z, v1.z, v2.z});
+
+        const size_t tx0 = static_cast<size_t>(minX) / TILE_W, tx1 = (static_cast<size_t>(maxX) - 1) / TILE_W;
+        const size_t ty0 = static_cast<size_t>(minY) / TILE_H, ty1 = (static_cast<size_t>(maxY) - 1) / TILE_H;
+        alignas(32) uint32_t coverage[TILE_H];
+        for (size_t ty = ty0; ty <= ty1; ty++) {
+            const float y0 = static_cast<float>(ty * TILE_H);
+            const float cy0 = std::max(y0, minY) + 0.5f, cy1 = std::min(y0 + TILE_H, maxY) - 0.5f;
+            for (size_t tx = tx0; tx <= tx1; tx++) {
+                Tile& tile = tiles[ty * tilesX + tx];
+                const float x0 = static_cast<float>(tx * TILE_W);
+                const float cx0 = std::max(x0, minX) + 0.5f, cx1 = std::min(x0 + TILE_W, maxX) - 0.5f;
+                const float z = std::min(zTriangle, std::max(zA * cx0, zA * cx1) + std::max(zB * cy0, zB * cy1) + zC);
+                if (z >= tile.zMax0) {
+                    continue;
+                }
+                tileCoverage(a, b, c, x0, y0, coverage);
+                updateTile(tile, coverage, z);
+            }
+        }
+    }
+
+    inline void OcclusionBuffer::tileCoverage(const float* a, const float* b, const float* c, float x0, float y0, uint32_t* coverage) {
+        // 每一行内一条边覆盖的像素是一个区间的一侧：a > 0 时为 [start, 32)，a < 0 时为 [0, end]，用移位得到掩码
+#if defined(RE_SIMD_AVX2)
+        const __m256 py = _mm256_add_ps(_mm256_set1_ps(y0 + 0.5f), _mm256_setr_ps(0, 1, 2, 3, 4, 5, 6, 7));
+        const __m256i ones = _mm256_set1_epi32(-1);
+        __m256i mask = ones;
+        for (int e = 0; e < 3; e++) {
+            // 每行第一个像素中心处的边函数值
+            const __m256 e0 = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(b[e]), py), _mm256_set1_ps(a[e] * (x0 + 0.5f) + c[e]));
+            if (a[e] > 0.0f) {
+                __m256 start = _mm256_ceil_ps(_mm256_div_ps(_mm256_sub_ps(_mm256_setzero_ps(), e0), _mm256_set1_ps(a[e])));
+                start = _mm256_min_ps(_mm256_max_ps(start, _mm256_setzero_ps()), _mm256_set1_ps(32.0f));
+                mask = _mm256_and_si256(mask, _mm256_sllv_epi32(ones, _mm256_cvttps_epi32(start)));
+            } else if (a[e] < 0.0f) {
+                __m256 end = _mm256_floor_ps(_mm256_div_ps(e0, _mm256_set1_ps(-a[e])));
+                end = _mm256_min_ps(_mm256_max_ps(end, _mm256_set1_ps(-1.0f)), _mm256_set1_ps(31.0f));
+                const __m256i shift = _mm256_sub_epi32(_mm256_set1_epi32(31), _mm256_cvttps_epi32(end));
+                mask = _mm256_and_si256(mask, _mm256_srlv_epi32(ones, shift));
+            } else {
+                mask = _mm256_and_si256(mask, _mm256_castps_si256(_mm256_cmp_ps(e0, _mm256_setzero_ps(), _CMP_GE_OQ)));
+            }
+        }
+        _mm256_store_si256(reinterpret_cast<__m256i*>(coverage), mask);
+#else
+        for (size_t row = 0; row < TILE_H; row++) {
+            const float py = y0 + row + 0.5f;
+            uint32_t mask = ~0u;
+            for (int e = 0; e < 3; e++) {
+                const float e0 = a[e] * (x0 + 0.5f) + b[e] * py + c[e];
+                if (a[e] > 0.0f) {
+                    const float start = std::min(std::max(std::ceil(-e0 / a[e]), 0.0f), 32.0f);
+                    mask &= start >= 32.0f ? 0u : ~0u << static_cast<uint32_t>(start);
+                } else if (a[e] < 0.0f) {
+                    const float end = std::min(std::max(std::floor(e0 / -a[e]), -1.0f), 31.0f);
+                    mask &= end < 0.0f ? 0u : ~0u >> (31 - static_cast<uint32_t>(end));
+                } else if (!(e0 >= 0.0f)) {
+                    mask = 0;
+                }
+            }
+            coverage[row] = mask;
+        }
+#endif
+    }
+
+    inline void OcclusionBuffer::updateTile(Tile& tile, const uint32_t* coverage, float z) {
+        // Hasselgren et al., "Masked Software Occlusion Culling" 的两层合并启发式
+#if defined(RE_SIMD_AVX2)
+        const __m256i cov = _mm256_load_si256(reinterpret_cast<const __m256i*>(coverage));
+        if (_mm256_testz_si256(cov, cov)) {
+            return;
+        }
+        __m256i mask = _mm256_load_si256(reinterpret_cast<const __m256i*>(tile.mask));
+        // 新三角形比工作层近得多：丢弃工作层，从新三角形重新开始
+        if (tile.zMax1 - z > tile.zMax0 - tile.zMax1) {
+            tile.zMax1 = 0.0f;
+            mask = _mm256_setzero_si256();
+        }
+        tile.zMax1 = std::max(tile.zMax1, z);
+        mask = _mm256_or_si256(mask, cov);
+        // 工作层覆盖了整个 tile，成为新的 tile 深度上界
+        if (_mm256_testc_si256(mask, _mm256_set1_epi32(-1))) {
+            tile.zMax0 = tile.zMax1;
+            tile.zMax1 = 0.0f;
+            mask = _mm256_setzero_si256();
+        }
+        _mm256_store_si256(reinterpret_cast<__m256i*>(tile.mask), mask);
+#else
+        uint32_t any = 0;
+        for (size_t row = 0; row < TILE_H; row++) {
+            any |= coverage[row];
+        }
+        if (any == 0) {
+            return;
+        }
+        if (tile.zMax1 - z > tile.zMax0 - tile.zMax1) {
+            tile.zMax1 = 0.0f;
+            std::fill(tile.mask, tile.mask + TILE_H, 0u);
+        }
+        tile.zMax1 = std::max(tile.zMax1, z);
+        uint32_t full = ~0u;
+        for (size_t row = 0; row < TILE_H; row++) {
+            tile.mask[row] |= coverage[row];
+            full &= tile.mask[row];
+        }
+        if (full == ~0u) {
+            tile.zMax0 = tile.zMax1;
+            tile.zMax1 = 0.0f;
+            std::fill(tile.mask, tile.mask + TILE_H, 0u);
+        }
+#endif
+    }
+
+    inline bool OcclusionBuffer::occluded(const AABB& box) const {
+        if (tiles.empty()) {
+            return false;
+        }
+        // 8 个角点 = min 角点 + 各轴边长向量的组合，只需要一次矩阵乘法
+        const glm::vec4 origin = viewProjection * glm::vec4(box.min, 1.0f);
+        const glm::vec4 ex = viewProjection[0] * (box.max.x - box.min.x);
+        const glm::vec4 ey = viewProjection[1] * (box.max.y - box.min.y);
+        const glm::vec4 ez = viewProjection[2] * (box.max.z - box.min.z);
+        float minX = std::numeric_limits<float>::max(), maxX = -minX, minY = minX, maxY = -minX, zMin = minX;
+        for (int k = 0; k < 8; k++) {
+            glm::vec4 c = origin;
+            if (k & 1) {
+                c += ex;
+            }
+            if (k & 2) {
+                c += ey;
+            }
+            if (k & 4) {
+                c += ez;
+            }
+            if (!(c.w > 1e-6f) || c.z < 0.0f) {
+                return false;
+            }
+            const float invW = 1.0f / c.w;
+            const float x = (c.x * invW * 0.5f + 0.5f) * _width, y = (0.5f - c.y * invW * 0.5f) * _height;
+            minX = std::min(minX, x);
+            maxX = std::max(maxX, x);
+            minY = std::min(minY, y);
+            maxY = std::max(maxY, y);
+            zMin = std::min(zMin, c.z * invW);
+        }
+        return occludedRect(minX, minY, maxX, maxY, zMin);
+    }
+
+    inline bool OcclusionBuffer::occludedRect(float x0, float y0, float x1, float y1, float zMin) const {
+        // 矩形接触到的所有像素都要被挡住
+        const float fx0 = std::max(0.0f, std::floor(x0)), fx1 = std::min(static_cast<float>(_width), std::ceil(x1));
+        const float fy0 = std::max(0.0f, std::floor(y0)), fy1 = std::min(static_cast<float>(_height), std::ceil(y1));
+        if (!(fx0 < fx1) || !(fy0 < fy1)) {
+            return false;
+        }
+        const size_t px0 = static_cast<size_t>(fx0), px1 = static_cast<size_t>(fx1);
+        const size_t py0 = static_cast<size_t>(fy0), py1 = static_cast<size_t>(fy1);
+        for (size_t ty = py0 / TILE_H; ty <= (py1 - 1) / TILE_H; ty++) {
+            const size_t row0 = std::max(py0, ty * TILE_H) - ty * TILE_H;
+            const size_t row1 = std::min(py1, (ty + 1) * TILE_H) - ty * TILE_H;
+            for (size_t tx = px0 / TILE_W; tx <= (px1 - 1) / TILE_W; tx++) {
+                const Tile& tile = tiles[ty * tilesX + tx];
+                if (zMin < std::min(tile.zMax0, tile.zMax1)) {
+                    return false;
+                }
+                if (zMin >= tile.zMax0) {
+                    continue;
+                }
+                // zMax1 <= zMin < zMax0：只有矩形完全落在工作层掩码内才被挡住
+                const size_t col0 = std::max(px0, tx * TILE_W) - tx * TILE_W;
+                const size_t col1 = std::min(px1, (tx + 1) * TILE_W) - tx * TILE_W;
+                const uint32_t cols = (col1 - col0 >= 32 ? ~0u : ((1u << (col1 - col0)) - 1)) << col0;
+                for (size_t row = row0; row < row1; row++) {
+                    if (cols & ~tile.mask[row]) {
+                        return false;
+                    }
+                }
+            }
+        }
+        return true;
+    }
+
+    inline float OcclusionBuffer::depthBound(size_t x, size_t y) const {
+        const Tile& tile = tiles[(y / TILE_H) * tilesX + x / TILE_W];
+        const bool masked = (tile.mask[y % TILE_H] >> (x % TILE_W)) & 1;
+        return masked ? std::min(tile.zMax0, tile.zMax1) : tile.zMax0;
+    }
+}
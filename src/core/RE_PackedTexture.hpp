@@ -0,0 +1,530 @@
+#pragma once
+#include "RE_includes.h"
+#include "RE_Texture.hpp"
+
+namespace RE {
+    // IEEE 754 半精度，只做存储，运算前先批量转换成 float
+    struct half {
+        uint16_t bits;
+    };
+
+    // 每像素 32 位的无符号 HDR 格式，r/g 为 5 位指数 6 位尾数，b 为 5 位指数 5 位尾数，最大 65024
+    struct r11g11b10f {
+        uint32_t bits;
+    };
+
+    // 每像素 32 位，三个 9 位尾数共享一个 5 位指数，最大 65408
+    struct rgb9e5 {
+        uint32_t bits;
+    };
+
+    // 各格式与 float 之间的批量转换，SIMD 主循环之外的余数用标量版本
+    // FLOATS 为每个存储单元解码出的 float 个数
+    template <typename T>
+    struct PackedFormat;
+
+    template <>
+    struct PackedFormat<half> {
+        static constexpr size_t FLOATS = 1;
+        static float toFloat(half h);
+        static half fromFloat(float f);
+        static void decode(const half* in, float* out, size_t count);
+        static void encode(const float* in, half* out, size_t count);
+    };
+
+    template <>
+    struct PackedFormat<r11g11b10f> {
+        static constexpr size_t FLOATS = 3;
+        static hrgb toFloat(r11g11b10f p);
+        static r11g11b10f fromFloat(hrgb c);
+        static void decode(const r11g11b10f* in, float* out, size_t count);
+        static void encode(const float* in, r11g11b10f* out, size_t count);
+    };
+
+    template <>
+    struct PackedFormat<rgb9e5> {
+        static constexpr size_t FLOATS = 3;
+        static hrgb toFloat(rgb9e5 p);
+        static rgb9e5 fromFloat(hrgb c);
+        static void decode(const rgb9e5* in, float* out, size_t count);
+        static void encode(const float* in, rgb9e5* out, size_t count);
+    };
+
+    // 压缩格式纹理的公共实现：像素读写、双线性采样和按行的 float 转换
+    // half 纹理的 channel 为实际通道数；r11g11b10f/rgb9e5 每像素一个存储单元，channel 为 1，解码后为 RGB
+    template <typename T>
+    class PackedTexture : public Buffer3D<T> {
+    public:
+        PackedTexture(size_t width, size_t height, size_t channel);
+
+        // 解码后每像素的 float 个数
+        size_t floatChannel() const;
+
+        hrgb getRGB(size_t x, size_t y) const;
+        hrgba getRGBA(size_t x, size_t y) const;
+        void setPixel(size_t x, size_t y, hrgb color);
+        void setPixel(size_t x, size_t y, hrgba color);
+
+        // 双线性采样，uv 范围 [0, 1]，边缘 clamp
+        hrgb sample(float u, float v) const;
+
+        // 把 y 行从 x 开始的 count 个像素解码到 out（count * floatChannel 个 float）
+        void loadRow(size_t y, size_t x, size_t count, float* out) const;
+        void storeRow(size_t y, size_t x, size_t count, const float* in);
+
+        // 与 HDRTexture 互相转换，按行多线程，通道数需与 floatChannel 一致
+        void copyFrom(const HDRTexture& src);
+        void copyTo(HDRTexture& dst) const;
+
+        // 逐行解码 -> fn(float* row, size_t width, size_t y) -> 编码，用于后处理链中的混合等操作
+        template <typename FN_T>
+        void transformRows(FN_T fn);
+
+        void init();
+    };
+
+    template <>
+    class TextureBase<half> : public PackedTexture<half> {
+    public:
+        TextureBase() : PackedTexture<half>(0, 0, 0) {}
+        TextureBase(size_t width, size_t height, size_t channel) : PackedTexture<half>(width, height, channel) {}
+        ~TextureBase() {}
+    };
+
+    template <>
+    class TextureBase<r11g11b10f> : public PackedTexture<r11g11b10f> {
+    public:
+        TextureBase() : PackedTexture<r11g11b10f>(0, 0, 0) {}
+        TextureBase(size_t width, size_t height, size_t channel = 1) : PackedTexture<r11g11b10f>(width, height, 1) {}
+        ~TextureBase() {}
+    };
+
+    template <>
+    class TextureBase<rgb9e5> : public PackedTexture<rgb9e5> {
+    public:
+        TextureBase() : PackedTexture<rgb9e5>(0, 0, 0) {}
+        TextureBase(size_t width, size_t height, size_t channel = 1) : PackedTexture<rgb9e5>(width, height, 1) {}
+        ~TextureBase() {}
+    };
+
+    using HalfTexture = TextureBase<half>;
+    using R11G11B10FTexture = TextureBase<r11g11b10f>;
+    using RGB9E5Texture = TextureBase<rgb9e5>;
+}
+
+namespace RE {
+    inline float PackedFormat<half>::toFloat(half h) {
+        // 把半精度的指数和尾数直接移到单精度的位置，再乘 2^112 修正指数偏移（非规格化数也成立）
+        const uint32_t sign = static_cast<uint32_t>(h.bits & 0x8000) << 16;
+        uint32_t bits = static_cast<uint32_t>(h.bits & 0x7fff) << 13;
+        float f;
+        if ((h.bits & 0x7c00) == 0x7c00) {
+            bits |= 0x7f800000; // inf / nan
+            memcpy(&f, &bits, sizeof(f));
+        } else {
+            memcpy(&f, &bits, sizeof(f));
+            f *= 5.192296858534828e+33f; // 2^112
+        }
+        memcpy(&bits, &f, sizeof(f));
+        bits |= sign;
+        memcpy(&f, &bits, sizeof(f));
+        return f;
+    }
+
+    inline half PackedFormat<half>::fromFloat(float value) {
+        // 就近舍入到偶数，溢出为 inf
+        uint32_t f;
+        memcpy(&f, &value, sizeof(f));
+        const uint32_t sign = f & 0x80000000u;
+        f ^= sign;
+        uint16_t o;
+        if (f >= 0x47800000u) {
+            o = (f > 0x7f800000u) ? 0x7e00 : 0x7c00;
+        } else if (f < 0x38800000u) {
+            float tmp;
+            memcpy(&tmp, &f, sizeof(tmp));
+            tmp += 0.5f; // 非规格化：借助浮点加法完成舍入
+            uint32_t t;
+            memcpy(&t, &tmp, sizeof(t));
+            o = static_cast<uint16_t>(t - 0x3f000000u);
+        } else {
+            const uint32_t mantOdd = (f >> 13) & 1;
+            f += 0xc8000fffu; // ((15 - 127) << 23) + 0xfff
+            f += mantOdd;
+            o = static_cast<uint16_t>(f >> 13);
+        }
+        return half{static_cast<uint16_t>(o | (sign >> 16))};
+    }
+
+    inline void PackedFormat<half>::decode(const half* in, float* out, size_t count) {
+        size_t i = 0;
+#if defined(RE_SIMD_F16C)
+        for (; i + 8 <= count; i += 8) {
+            _mm256_storeu_ps(out + i, _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i))));
+        }
+#elif defined(RE_SIMD_SSE2)
+        const __m128i magnitude = _mm_set1_epi32(0x7fff);
+        const __m128i infNan = _mm_set1_epi32(0x7c00);
+        const __m128 scale = _mm_set1_ps(5.192296858534828e+33f);
+        for (; i + 4 <= count; i += 4) {
+            const __m128i h = _mm_unpacklo_epi16(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(in + i)), _mm_setzero_si128());
+            const __m128i sign = _mm_slli_epi32(_mm_andnot_si128(magnitude, h), 16);
+            const __m128i bits = _mm_slli_epi32(_mm_and_si128(h, magnitude), 13);
+            const __m128i special = _mm_cmpeq_epi32(_mm_and_si128(h, infNan), infNan);
+            const __m128 normal = _mm_mul_ps(_mm_castsi128_ps(bits), scale);
+            const __m128 inf = _mm_castsi128_ps(_mm_or_si128(bits, _mm_set1_epi32(0x7f800000)));
+            const __m128 value = _mm_or_ps(_mm_and_ps(_mm_castsi128_ps(special), inf), _mm_andnot_ps(_mm_castsi128_ps(special), normal));
+            _mm_storeu_ps(out + i, _mm_or_ps(value, _mm_castsi128_ps(sign)));
+        }
+#endif
+        for (; i < count; i++) {
+            out[i] = toFloat(in[i]);
+        }
+    }
+
+    inline void PackedFormat<half>::encode(const float* in, half* out, size_t count) {
+        size_t i = 0;
+#if defined(RE_SIMD_F16C)
+        for (; i + 8 <= count; i += 8) {
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm256_cvtps_ph(_mm256_loadu_ps(in + i), _MM_FROUND_TO_NEAREST_INT));
+        }
+#elif defined(RE_SIMD_SSE2)
+        // 与 fromFloat 相同的算法，三个分支用掩码选择
+        const __m128i signMask = _mm_set1_epi32(static_cast<int>(0x80000000u));
+        const __m128i f16max = _mm_set1_epi32(0x47800000);
+        const __m128i f32inf = _mm_set1_epi32(0x7f800000);
+        const __m128i denormLimit = _mm_set1_epi32(0x38800000);
+        for (; i + 4 <= count; i += 4) {
+            const __m128i bits = _mm_castps_si128(_mm_loadu_ps(in + i));
+            const __m128i sign = _mm_and_si128(bits, signMask);
+            const __m128i f = _mm_xor_si128(bits, sign);
+
+            const __m128i overflow = _mm_cmpgt_epi32(f, _mm_sub_epi32(f16max, _mm_set1_epi32(1)));
+            const __m128i isNan = _mm_cmpgt_epi32(f, f32inf);
+            const __m128i big = _mm_or_si128(_mm_and_si128(isNan, _mm_set1_epi32(0x7e00)), _mm_andnot_si128(isNan, _mm_set1_epi32(0x7c00)));
+
+            const __m128i denorm = _mm_cmplt_epi32(f, denormLimit);
+            const __m128i small = _mm_sub_epi32(_mm_castps_si128(_mm_add_ps(_mm_castsi128_ps(f), _mm_set1_ps(0.5f))), _mm_set1_epi32(0x3f000000));
+
+            const __m128i mantOdd = _mm_and_si128(_mm_srli_epi32(f, 13), _mm_set1_epi32(1));
+            const __m128i normal = _mm_srli_epi32(_mm_add_epi32(_mm_add_epi32(f, _mm_set1_epi32(static_cast<int>(0xc8000fffu))), mantOdd), 13);
+
+            __m128i o = _mm_or_si128(_mm_and_si128(denorm, small), _mm_andnot_si128(denorm, normal));
+            o = _mm_or_si128(_mm_and_si128(overflow, big), _mm_andnot_si128(overflow, o));
+            o = _mm_or_si128(o, _mm_srli_epi32(sign, 16));
+            // 先符号扩展 16 位再做有符号饱和打包，保持原始位模式
+            o = _mm_srai_epi32(_mm_slli_epi32(o, 16), 16);
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(out + i), _mm_packs_epi32(o, o));
+        }
+#endif
+        for (; i < count; i++) {
+            out[i] = fromFloat(in[i]);
+        }
+    }
+
+    inline hrgb PackedFormat<r11g11b10f>::toFloat(r11g11b10f p) {
+        // 与 half 相同的移位 + 2^112 技巧，11 位左移 17、10 位左移 18 对齐到单精度
+        auto unpack = [](uint32_t bits, int shift) {
+            const uint32_t u = bits << shift;
+            float f;
+            memcpy(&f, &u, sizeof(f));
+            return f * 5.192296858534828e+33f;
+        };
+        return hrgb(unpack(p.bits & 0x7ff, 17), unpack((p.bits >> 11) & 0x7ff, 17), unpack(p.bits >> 22, 18));
+    }
+
+    inline r11g11b10f PackedFormat<r11g11b10f>::fromFloat(hrgb c) {
+        auto pack = [](float f, float maxValue, int shift, uint32_t maxBits) -> uint32_t {
+            f = RE::camp(f, 0.0f, maxValue) * 1.925929944387236e-34f; // 2^-112
+            uint32_t u;
+            memcpy(&u, &f, sizeof(u));
+            const uint32_t half = (1u << (shift - 1)) - 1;
+            u = (u + half + ((u >> shift) & 1)) >> shift;
+            return std::min(u, maxBits);
+        };
+        if (!(c.r == c.r)) c.r = 0.0f; // NaN 当 0 处理
+        if (!(c.g == c.g)) c.g = 0.0f;
+        if (!(c.b == c.b)) c.b = 0.0f;
+        return r11g11b10f{pack(c.r, 65024.0f, 17, 0x7bf) | (pack(c.g, 65024.0f, 17, 0x7bf) << 11) | (pack(c.b, 64512.0f, 18, 0x3df) << 22)};
+    }
+
+#if defined(RE_SIMD_SSE2)
+    // 交错的 RGB float 与 SoA 之间的转换：每次处理 4 个像素，读写都会多碰一个 float，调用者保证余量
+    RE_FORCEINLINE void loadRGB4(const float* in, __m128& r, __m128& g, __m128& b) {
+        __m128 p0 = _mm_loadu_ps(in);
+        __m128 p1 = _mm_loadu_ps(in + 3);
+        __m128 p2 = _mm_loadu_ps(in + 6);
+        __m128 p3 = _mm_loadu_ps(in + 9);
+        _MM_TRANSPOSE4_PS(p0, p1, p2, p3);
+        r = p0;
+        g = p1;
+        b = p2;
+    }
+
+    RE_FORCEINLINE void storeRGB4(float* out, __m128 r, __m128 g, __m128 b) {
+        __m128 a = _mm_setzero_ps();
+        _MM_TRANSPOSE4_PS(r, g, b, a);
+        _mm_storeu_ps(out, r);
+        _mm_storeu_ps(out + 3, g);
+        _mm_storeu_ps(out + 6, b);
+        _mm_storeu_ps(out + 9, a);
+    }
+
+    // x 为非负 float，按 5 位指数 + mantBits 位尾数就近舍入到偶数
+    RE_FORCEINLINE __m128i packSmallFloat(__m128 x, float maxValue, int shift, int maxBits) {
+        x = _mm_min_ps(_mm_max_ps(x, _mm_setzero_ps()), _mm_set1_ps(maxValue)); // max 会把 NaN 变成 0
+        const __m128i u = _mm_castps_si128(_mm_mul_ps(x, _mm_set1_ps(1.925929944387236e-34f)));
+        const __m128i odd = _mm_and_si128(_mm_srli_epi32(u, shift), _mm_set1_epi32(1));
+        const __m128i rounded = _mm_srli_epi32(_mm_add_epi32(_mm_add_epi32(u, _mm_set1_epi32((1 << (shift - 1)) - 1)), odd), shift);
+        const __m128i limit = _mm_set1_epi32(maxBits);
+        const __m128i over = _mm_cmpgt_epi32(rounded, limit);
+        return _mm_or_si128(_mm_and_si128(over, limit), _mm_andnot_si128(over, rounded));
+    }
+#endif
+
+    inline void PackedFormat<r11g11b10f>::decode(const r11g11b10f* in, float* out, size_t count) {
+        size_t i = 0;
+#if defined(RE_SIMD_SSE2)
+        const __m128 scale = _mm_set1_ps(5.192296858534828e+33f);
+        const __m128i mask11 = _mm_set1_epi32(0x7ff);
+        for (; i + 5 <= count; i += 4) { // 留一个像素的余量给 storeRGB4
+            const __m128i p = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+            const __m128 r = _mm_mul_ps(_mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(p, mask11), 17)), scale);
+            const __m128 g = _mm_mul_ps(_mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(_mm_srli_epi32(p, 11), mask11), 17)), scale);
+            const __m128 b = _mm_mul_ps(_mm_castsi128_ps(_mm_slli_epi32(_mm_srli_epi32(p, 22), 18)), scale);
+            storeRGB4(out + i * 3, r, g, b);
+        }
+#endif
+        for (; i < count; i++) {
+            const hrgb c = toFloat(in[i]);
+            out[i * 3] = c.r;
+            out[i * 3 + 1] = c.g;
+            out[i * 3 + 2] = c.b;
+        }
+    }
+
+    inline void PackedFormat<r11g11b10f>::encode(const float* in, r11g11b10f* out, size_t count) {
+        size_t i = 0;
+#if defined(RE_SIMD_SSE2)
+        for (; i + 5 <= count; i += 4) {
+            __m128 r, g, b;
+            loadRGB4(in + i * 3, r, g, b);
+            const __m128i pr = packSmallFloat(r, 65024.0f, 17, 0x7bf);
+            const __m128i pg = packSmallFloat(g, 65024.0f, 17, 0x7bf);
+            const __m128i pb = packSmallFloat(b, 64512.0f, 18, 0x3df);
+            const __m128i p = _mm_or_si128(_mm_or_si128(pr, _mm_slli_epi32(pg, 11)), _mm_slli_epi32(pb, 22));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), p);
+        }
+#endif
+        for (; i < count; i++) {
+            out[i] = fromFloat(hrgb(in[i * 3], in[i * 3 + 1], in[i * 3 + 2]));
+        }
+    }
+
+    inline hrgb PackedFormat<rgb9e5>::toFloat(rgb9e5 p) {
+        const int exponent = static_cast<int>(p.bits >> 27) - 15 - 9;
+        const float scale = std::ldexp(1.0f, exponent);
+        return hrgb((p.bits & 0x1ff) * scale, ((p.bits >> 9) & 0x1ff) * scale, ((p.bits >> 18) & 0x1ff) * scale);
+    }
+
+    inline rgb9e5 PackedFormat<rgb9e5>::fromFloat(hrgb c) {
+        // EXT_texture_shared_exponent 中的编码流程
+        constexpr float MAX_VALUE = 65408.0f;
+        const float r = (c.r > 0.0f) ? std::min(c.r, MAX_VALUE) : 0.0f;
+        const float g = (c.g > 0.0f) ? std::min(c.g, MAX_VALUE) : 0.0f;
+        const float b = (c.b > 0.0f) ? std::min(c.b, MAX_VALUE) : 0.0f;
+        const float maxc = std::max(r, std::max(g, b));
+
+        uint32_t bits;
+        memcpy(&bits, &maxc, sizeof(bits));
+        int shared = std::max(-16, static_cast<int>((bits >> 23) & 0xff) - 127) + 1 + 15;
+        float scale = std::ldexp(1.0f, 24 - shared);
+        if (static_cast<uint32_t>(maxc * scale + 0.5f) == 512) {
+            shared++;
+            scale *= 0.5f;
+        }
+        const uint32_t rm = static_cast<uint32_t>(r * scale + 0.5f);
+        const uint32_t gm = static_cast<uint32_t>(g * scale + 0.5f);
+        const uint32_t bm = static_cast<uint32_t>(b * scale + 0.5f);
+        return rgb9e5{rm | (gm << 9) | (bm << 18) | (static_cast<uint32_t>(shared) << 27)};
+    }
+
+    inline void PackedFormat<rgb9e5>::decode(const rgb9e5* in, float* out, size_t count) {
+        size_t i = 0;
+#if defined(RE_SIMD_SSE2)
+        const __m128i mask9 = _mm_set1_epi32(0x1ff);
+        for (; i + 5 <= count; i += 4) {
+            const __m128i p = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+            // 2^(e - 24)：直接拼出单精度的指数位
+            const __m128 scale = _mm_castsi128_ps(_mm_slli_epi32(_mm_add_epi32(_mm_srli_epi32(p, 27), _mm_set1_epi32(127 - 24)), 23));
+            const __m128 r = _mm_mul_ps(_mm_cvtepi32_ps(_mm_and_si128(p, mask9)), scale);
+            const __m128 g = _mm_mul_ps(_mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(p, 9), mask9)), scale);
+            const __m128 b = _mm_mul_ps(_mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(p, 18), mask9)), scale);
+            storeRGB4(out + i * 3, r, g, b);
+        }
+#endif
+        for (; i < count; i++) {
+            const hrgb c = toFloat(in[i]);
+            out[i * 3] = c.r;
+            out[i * 3 + 1] = c.g;
+            out[i * 3 + 2] = c.b;
+        }
+    }
+
+    inline void PackedFormat<rgb9e5>::encode(const float* in, rgb9e5* out, size_t count) {
+        size_t i = 0;
+#if defined(RE_SIMD_SSE2)
+        const __m128 maxValue = _mm_set1_ps(65408.0f);
+        const __m128 zero = _mm_setzero_ps();
+        const __m128 half = _mm_set1_ps(0.5f);
+        for (; i + 5 <= count; i += 4) {
+            __m128 r, g, b;
+            loadRGB4(in + i * 3, r, g, b);
+            r = _mm_min_ps(_mm_max_ps(r, zero), maxValue);
+            g = _mm_min_ps(_mm_max_ps(g, zero), maxValue);
+            b = _mm_min_ps(_mm_max_ps(b, zero), maxValue);
+            const __m128 maxc = _mm_max_ps(r, _mm_max_ps(g, b));
+
+            // shared = max(-16, floor(log2(maxc))) + 16，floor(log2) 直接取单精度指数
+            const __m128i log2 = _mm_sub_epi32(_mm_srli_epi32(_mm_castps_si128(maxc), 23), _mm_set1_epi32(127));
+            const __m128i lo = _mm_set1_epi32(-16);
+            __m128i shared = _mm_add_epi32(_mm_or_si128(_mm_and_si128(_mm_cmpgt_epi32(log2, lo), log2), _mm_andnot_si128(_mm_cmpgt_epi32(log2, lo), lo)), _mm_set1_epi32(16));
+            __m128 scale = _mm_castsi128_ps(_mm_slli_epi32(_mm_sub_epi32(_mm_set1_epi32(127 + 24), shared), 23));
+
+            // 最大分量舍入后溢出到 512 时指数加一
+            const __m128i maxm = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(maxc, scale), half));
+            const __m128i carry = _mm_cmpeq_epi32(maxm, _mm_set1_epi32(512));
+            shared = _mm_sub_epi32(shared, carry);
+            scale = _mm_or_ps(_mm_and_ps(_mm_castsi128_ps(carry), _mm_mul_ps(scale, half)), _mm_andnot_ps(_mm_castsi128_ps(carry), scale));
+
+            const __m128i rm = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(r, scale), half));
+            const __m128i gm = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(g, scale), half));
+            const __m128i bm = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(b, scale), half));
+            __m128i p = _mm_or_si128(rm, _mm_slli_epi32(gm, 9));
+            p = _mm_or_si128(p, _mm_slli_epi32(bm, 18));
+            p = _mm_or_si128(p, _mm_slli_epi32(shared, 27));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), p);
+        }
+#endif
+        for (; i < count; i++) {
+            out[i] = fromFloat(hrgb(in[i * 3], in[i * 3 + 1], in[i * 3 + 2]));
+        }
+    }
+
+    template <typename T>
+    PackedTexture<T>::PackedTexture(size_t width, size_t height, size_t channel) : Buffer3D<T>(width, height, channel) {}
+
+    template <typename T>
+    size_t PackedTexture<T>::floatChannel() const {
+        return this->channel() * PackedFormat<T>::FLOATS;
+    }
+
+    template <typename T>
+    hrgb PackedTexture<T>::getRGB(size_t x, size_t y) const {
+        float c[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+        loadRow(y, x, 1, c);
+        return hrgb(c[0], c[1], c[2]);
+    }
+
+    template <typename T>
+    hrgba PackedTexture<T>::getRGBA(size_t x, size_t y) const {
+        float c[4] = {0.0f, 0.0f, 0.0f, 1.0f};
+        loadRow(y, x, 1, c);
+        return hrgba(c[0], c[1], c[2], c[3]);
+    }
+
+    template <typename T>
+    void PackedTexture<T>::setPixel(size_t x, size_t y, hrgb color) {
+        float c[4] = {color.r, color.g, color.b, 1.0f};
+        storeRow(y, x, 1, c);
+    }
+
+    template <typename T>
+    void PackedTexture<T>::setPixel(size_t x, size_t y, hrgba color) {
+        float c[4] = {color.r, color.g, color.b, color.a};
+        storeRow(y, x, 1, c);
+    }
+
+    template <typename T>
+    hrgb PackedTexture<T>::sample(float u, float v) const {
+        const size_t w = this->width();
+        const size_t h = this->height();
+        const size_t fc = floatChannel();
+        const float fx = RE::camp(u * w - 0.5f, 0.0f, static_cast<float>(w - 1));
+        const float fy = RE::camp(v * h - 0.5f, 0.0f, static_cast<float>(h - 1));
+        const size_t x0 = static_cast<size_t>(fx);
+        const size_t y0 = static_cast<size_t>(fy);
+        const size_t y1 = std::min(y0 + 1, h - 1);
+        const size_t n = (x0 + 1 < w) ? 2 : 1;
+        const float dx = fx - x0;
+        const float dy = fy - y0;
+
+        // 两行各解码两个像素，一次批量转换代替四次单像素解码
+        float row0[8] = {}, row1[8] = {};
+        loadRow(y0, x0, n, row0);
+        loadRow(y1, x0, n, row1);
+        const size_t right = (n == 2) ? fc : 0;
+        hrgb out;
+        for (size_t k = 0; k < 3; k++) {
+            const size_t ck = std::min(k, fc - 1);
+            const float top = row0[ck] + (row0[right + ck] - row0[ck]) * dx;
+            const float bottom = row1[ck] + (row1[right + ck] - row1[ck]) * dx;
+            out[k] = top + (bottom - top) * dy;
+        }
+        return out;
+    }
+
+    template <typename T>
+    void PackedTexture<T>::loadRow(size_t y, size_t x, size_t count, float* out) const {
+        PackedFormat<T>::decode(this->data() + this->getIndex(x, y), out, count * this->channel());
+    }
+
+    template <typename T>
+    void PackedTexture<T>::storeRow(size_t y, size_t x, size_t count, const float* in) {
+        PackedFormat<T>::encode(in, this->data() + this->getIndex(x, y), count * this->channel());
+    }
+
+    template <typename T>
+    void PackedTexture<T>::copyFrom(const HDRTexture& src) {
+        const size_t w = std::min(src.width(), this->width());
+        const size_t h = std::min(src.height(), this->height());
+        const float* in = src.data();
+#pragma omp parallel for
+        for (int64_t y = 0; y < static_cast<int64_t>(h); y++) {
+            storeRow(y, 0, w, in + src.getIndex(0, y));
+        }
+    }
+
+    template <typename T>
+    void PackedTexture<T>::copyTo(HDRTexture& dst) const {
+        const size_t w = std::min(dst.width(), this->width());
+        const size_t h = std::min(dst.height(), this->height());
+        float* out = dst.data();
+#pragma omp parallel for
+        for (int64_t y = 0; y < static_cast<int64_t>(h); y++) {
+            loadRow(y, 0, w, out + dst.getIndex(0, y));
+        }
+    }
+
+    template <typename T>
+    template <typename FN_T>
+    void PackedTexture<T>::transformRows(FN_T fn) {
+        const size_t w = this->width();
+        const size_t rowFloats = w * floatChannel() + 4; // SIMD 打包路径会多读写一个像素
+#pragma omp parallel
+        {
+            std::vector<float> row(rowFloats);
+#pragma omp for
+            for (int64_t y = 0; y < static_cast<int64_t>(this->height()); y++) {
+                loadRow(y, 0, w, row.data());
+                fn(row.data(), w, static_cast<size_t>(y));
+                storeRow(y, 0, w, row.data());
+            }
+        }
+    }
+
+    template <typename T>
+    void PackedTexture<T>::init() {
+        this->setZero();
+    }
+}
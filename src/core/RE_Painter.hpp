@@ -1,5 +1,7 @@
 #pragma once
 #include "RE_Geometry2D.hpp"
+#include "RE_OIT.hpp"
+#include "RE_Text.hpp"
 #include "RE_Texture.hpp"
 #include "RE_includes.h"
 
@@ -21,8 +23,20 @@ namespace RE {
         void drawPixel(size_t index, const rgb& color);
         void drawPixelSafe(size_t x, size_t y, const rgb& color);
 
+        // HDR 颜色，用于 Painter<float> 向 HDRTexture 绘制
+        void drawPixel(size_t x, size_t y, hrgba color);
+        void drawPixel(size_t index, hrgba color);
+        void drawPixelSafe(size_t x, size_t y, hrgba color);
+        void drawPixel(size_t x, size_t y, const hrgb& color);
+        void drawPixel(size_t index, const hrgb& color);
+        void drawPixelSafe(size_t x, size_t y, const hrgb& color);
+
         void clearImage();
 
+        // 把逐元素表达式的结果写入整张纹理，如 apply(texture * tint + glow)
+        template <typename E>
+        void apply(const BufferExpr<E>& expr);
+
         template <typename Color_T>
         void drawScanline(size_t x, size_t y, size_t width, Color_T color);
 
@@ -46,13 +60,44 @@ namespace RE {
         template <typename Color_T>
         void drawPolygonEmpty(Polygon2D& p, Color_T color);
 
+        // 抗锯齿填充矢量路径，tolerance 为曲线展平的最大误差（像素）
+        // 覆盖率按扫描段用 SIMD 与纹理混合；设置了 OIT 时按覆盖率缩放 alpha 后记录片元
+        template <typename Color_T>
+        void fillPath(const Path2D& path, Color_T color, FillRule rule = fillNonZero, float tolerance = 0.25f);
+
+        // 绘制文字，(x, y) 为第一行基线的起点，'\n' 换行；字形取自 atlas 的缓存，未命中时才光栅化
+        template <typename Color_T>
+        void drawText(GlyphAtlas& atlas, const Font& font, float size, float x, float y, std::string_view text, Color_T color);
+        // 一次绘制整批文字：先串行查找字形，再按行带并行混合
+        void drawText(GlyphAtlas& atlas, const TextBatch& batch);
+
         template <typename Color_T>
         void drawCircle(int originX, int originY, int radius, Color_T color);
 
         template <typename Color_T>
         void drawCircleEmpty(int originX, int originY, int radius, Color_T color);
 
+        // 把 src 按 1:1 画到 (x, y)，超出纹理的部分被裁掉。src 与目标可以是 3 或 4 通道，不同时自动转换，没有 alpha 的视为不透明
+        // blend 为 true 时按 src 的 alpha 混合，否则直接覆盖；格式相同且不需要混合时逐行 memcpy
+        void drawImage(const TextureBase<T>& src, int64_t x, int64_t y, bool blend = true);
+        // 缩放到目标矩形 (x, y, width, height)，filter 为 nearest 或 bilinear（bicubic 按 bilinear 处理）
+        void drawImage(const TextureBase<T>& src, int64_t x, int64_t y, int64_t width, int64_t height, TextureFilter filter = bilinear, bool blend = true);
+        // 只画 src 的子矩形 (srcX, srcY, srcWidth, srcHeight)，用于精灵图集；源和目标尺寸相同时走 1:1 复制
+        void drawImage(const TextureBase<T>& src, int64_t srcX, int64_t srcY, int64_t srcWidth, int64_t srcHeight,
+                       int64_t x, int64_t y, int64_t width, int64_t height, TextureFilter filter = bilinear, bool blend = true);
+        // 仿射变换（旋转、缩放、错切）：transform 把 src 的像素坐标映射到目标像素坐标，只使用前两行
+        // 每行先解出落在 src 内的区间，区间内源坐标按固定步长递增
+        void drawImage(const TextureBase<T>& src, const glm::mat3& transform, TextureFilter filter = bilinear, bool blend = true);
+
         rgba alphaMix(const rgba& src, const rgba& dst);
+        hrgba alphaMix(const hrgba& src, const hrgba& dst);
+
+        // OIT 模式：设置缓冲后带 alpha 的绘制（rgba / hrgba）不再立即混合，而是按 setDepth 的深度记录片元
+        // 不透明的 rgb 绘制不受影响；多个线程可以各用一个 Painter 同时向同一个缓冲绘制
+        void setOIT(OITBuffer* buffer);
+        void setDepth(float depth);
+        // 把片元排序合成到纹理上并清空缓冲
+        void resolveOIT();
 
         
 
@@ -69,8 +114,50 @@ namespace RE {
     private:
         ImageView<T>* imageView;
         TextureBase<T>& texture;
+        OITBuffer* oit = nullptr;
+        float depth = 0.0f;
+
+        PathRasterizer rasterizer;
+
+        // 排好版、等待混合的字形
+        struct TextQuad {
+            int32_t x, y; // 目标上的左上角
+            AtlasGlyph glyph;
+            uint32_t color; // textColors 的下标
+        };
+        static constexpr int64_t TEXT_BAND = 32;
+        static constexpr size_t TEXT_PARALLEL_QUADS = 256;
+        std::vector<TextQuad> textQuads;
+        std::vector<hrgba> textColors;
+        std::vector<std::vector<uint32_t>> textBands;
+
+        void layoutText(GlyphAtlas& atlas, const Font& font, float size, float x, float y, std::string_view text, uint32_t color);
+        // 混合所有排好的字形；字形少时串行，多时按 TEXT_BAND 行分带并行，带内保持绘制顺序
+        void flushText(const GlyphAtlas& atlas);
+        void blitGlyph(const GlyphAtlas& atlas, const TextQuad& quad, int64_t rowBegin, int64_t rowEnd, float* line);
+
+        // drawImage 的中间结果统一为 4 通道的一行像素，超过 IMAGE_PARALLEL_PIXELS 时按行并行
+        static constexpr int64_t IMAGE_PARALLEL_PIXELS = 1 << 16;
+        std::vector<T> imageRow;
+        std::vector<int32_t> imageColumns;
+        std::vector<float> imageWeights;
+
+        bool checkImageFormat(const TextureBase<T>& src);
+        // row(int64_t y, T* buffer)，buffer 可以放下 count 个 4 通道像素
+        template <typename Row>
+        void forEachImageRow(int64_t y0, int64_t y1, size_t count, Row&& row);
+        static void expandImageRow(const T* src, size_t channel, size_t count, T* rgbaRow);
+        // 把一行 4 通道的源像素写到目标 (x, y) 开始的 count 个像素
+        void storeImageRow(size_t x, size_t y, size_t count, const T* rgbaRow, bool blend);
+        // 双线性插值出一个 4 通道像素，p0 / p1 为上下两行，x0 / x1 为左右两列
+        RE_FORCEINLINE static void bilinearPixel(const T* p0, const T* p1, size_t sc, int32_t x0, int32_t x1, float fx, float fy, T* out);
 
         inline void paintStart();
+        // dst += (color - dst) * coverage * alpha，color 与纹理同量纲（uint8 为 0~255，float 为 0~1）
+        void compositeSpan(size_t x, size_t y, size_t count, const float* coverage, const hrgba& color, float alpha);
+        // Bresenham 直线，先按纹理范围算出可见的那一段再逐点绘制，裁剪不改变被绘制的像素
+        template <typename Color_T>
+        void drawLineClipped(int64_t x1, int64_t y1, int64_t x2, int64_t y2, Color_T color);
     };
 }
 
@@ -80,11 +167,15 @@ namespace RE {
     template <typename T>
     Painter<T>::~Painter() {
         imageView->update();
-        imageView->changed = false;
     };
     template <typename T>
     void Painter<T>::drawPixel(size_t x, size_t y, rgba color) {
+        RE_PROFILE_SCOPE_DETAIL("Painter::drawPixel");
         paintStart();
+        if (oit != nullptr) {
+            oit->insert(x, y, color, depth);
+            return;
+        }
         const size_t index = texture.getIndex(x, y);
         color = alphaMix(texture.getRGBA(x, y), color);
 
@@ -95,7 +186,12 @@ namespace RE {
     }
     template <typename T>
     void Painter<T>::drawPixel(size_t index, rgba color) {
+        RE_PROFILE_SCOPE_DETAIL("Painter::drawPixel");
         paintStart();
+        if (oit != nullptr) {
+            oit->insert(texture.getCol(index), texture.getRow(index), color, depth);
+            return;
+        }
         color = alphaMix(texture.getRGBA(index), color);
 
         texture.data()[index] = color.r;
@@ -105,7 +201,12 @@ namespace RE {
     }
     template <typename T>
     void Painter<T>::drawPixelSafe(size_t x, size_t y, rgba color) {
+        RE_PROFILE_SCOPE_DETAIL("Painter::drawPixelSafe");
         paintStart();
+        if (oit != nullptr) {
+            oit->insert(x, y, color, depth);
+            return;
+        }
         if (x < texture.width() && x > 0 && y > 0 && y < texture.height()) {
             const size_t index = texture.getIndex(x, y);
             color = alphaMix(texture.getRGBA(x, y), color);
@@ -119,6 +220,7 @@ namespace RE {
 
     template <typename T>
     void Painter<T>::drawPixel(size_t x, size_t y, const rgb& color) {
+        RE_PROFILE_SCOPE_DETAIL("Painter::drawPixel");
         paintStart();
         const size_t&& index = texture.getIndex(x, y);
 
@@ -129,6 +231,7 @@ namespace RE {
 
     template <typename T>
     void Painter<T>::drawPixel(size_t index, const rgb& color) {
+        RE_PROFILE_SCOPE_DETAIL("Painter::drawPixel");
         paintStart();
         texture.data()[index] = color.r;
         texture.data()[index + 1] = color.g;
@@ -137,6 +240,7 @@ namespace RE {
 
     template <typename T>
     void Painter<T>::drawPixelSafe(size_t x, size_t y, const rgb& color) {
+        RE_PROFILE_SCOPE_DETAIL("Painter::drawPixelSafe");
         paintStart();
         if (x < texture.width() && x >= 0 && y >= 0 && y < texture.height()) {
             const size_t&& index = texture.getIndex(x, y);
@@ -147,15 +251,117 @@ namespace RE {
         }
     }
 
+    template <typename T>
+    void Painter<T>::drawPixel(size_t x, size_t y, hrgba color) {
+        RE_PROFILE_SCOPE_DETAIL("Painter::drawPixel");
+        paintStart();
+        if (oit != nullptr) {
+            oit->insert(x, y, color, depth);
+            return;
+        }
+        const size_t index = texture.getIndex(x, y);
+        color = alphaMix(hrgba(texture.getRGBA(x, y)), color);
+
+        texture.data()[index] = color.r;
+        texture.data()[index + 1] = color.g;
+        texture.data()[index + 2] = color.b;
+        texture.data()[index + 3] = color.a;
+    }
+
+    template <typename T>
+    void Painter<T>::drawPixel(size_t index, hrgba color) {
+        RE_PROFILE_SCOPE_DETAIL("Painter::drawPixel");
+        paintStart();
+        if (oit != nullptr) {
+            oit->insert(texture.getCol(index), texture.getRow(index), color, depth);
+            return;
+        }
+        color = alphaMix(hrgba(texture.getRGBA(index)), color);
+
+        texture.data()[index] = color.r;
+        texture.data()[index + 1] = color.g;
+        texture.data()[index + 2] = color.b;
+        texture.data()[index + 3] = color.a;
+    }
+
+    template <typename T>
+    void Painter<T>::drawPixelSafe(size_t x, size_t y, hrgba color) {
+        RE_PROFILE_SCOPE_DETAIL("Painter::drawPixelSafe");
+        paintStart();
+        if (x < texture.width() && y < texture.height()) {
+            drawPixel(x, y, color);
+        }
+    }
+
+    template <typename T>
+    void Painter<T>::drawPixel(size_t x, size_t y, const hrgb& color) {
+        RE_PROFILE_SCOPE_DETAIL("Painter::drawPixel");
+        paintStart();
+        const size_t index = texture.getIndex(x, y);
+
+        texture.data()[index] = color.r;
+        texture.data()[index + 1] = color.g;
+        texture.data()[index + 2] = color.b;
+    }
+
+    template <typename T>
+    void Painter<T>::drawPixel(size_t index, const hrgb& color) {
+        RE_PROFILE_SCOPE_DETAIL("Painter::drawPixel");
+        paintStart();
+        texture.data()[index] = color.r;
+        texture.data()[index + 1] = color.g;
+        texture.data()[index + 2] = color.b;
+    }
+
+    template <typename T>
+    void Painter<T>::drawPixelSafe(size_t x, size_t y, const hrgb& color) {
+        RE_PROFILE_SCOPE_DETAIL("Painter::drawPixelSafe");
+        paintStart();
+        if (x < texture.width() && y < texture.height()) {
+            drawPixel(x, y, color);
+        }
+    }
+
     template <typename T>
     void Painter<T>::clearImage() {
+        RE_PROFILE_SCOPE("Painter::clearImage");
         paintStart();
         texture.setZero();
     }
 
+    template <typename T>
+    void Painter<T>::setOIT(OITBuffer* buffer) {
+        oit = buffer;
+    }
+
+    template <typename T>
+    void Painter<T>::setDepth(float d) {
+        depth = d;
+    }
+
+    template <typename T>
+    void Painter<T>::resolveOIT() {
+        RE_PROFILE_SCOPE("Painter::resolveOIT");
+        if (oit == nullptr) {
+            return;
+        }
+        paintStart();
+        oit->resolve(texture);
+        oit->clear();
+    }
+
+    template <typename T>
+    template <typename E>
+    void Painter<T>::apply(const BufferExpr<E>& expr) {
+        RE_PROFILE_SCOPE("Painter::apply");
+        paintStart();
+        evaluate(texture, expr);
+    }
+
     template <typename T>
     template <typename Color_T>
     void Painter<T>::drawScanline(size_t x, size_t y, size_t width, Color_T color) {
+        RE_PROFILE_SCOPE_DETAIL("Painter::drawScanline");
         paintStart();
         for (size_t i = 0; i < width; i++) {
             drawPixel(x + i, y, color);
@@ -170,83 +376,76 @@ namespace RE {
     template <typename T>
     template <typename Color_T>
     void Painter<T>::drawLine(int64_t x1, int64_t y1, int64_t x2, int64_t y2, Color_T color) {
+        RE_PROFILE_SCOPE("Painter::drawLine");
         paintStart();
-        const int64_t dx = llabs(x2 - x1);
-        const int64_t dy = llabs(y2 - y1);
-
-        const int64_t stepX = (x2 == x1) ? 0 : (x2 - x1) / dx;
-        const int64_t stepY = (y2 == y1) ? 0 : (y2 - y1) / dy;
-
-        int64_t xi = x1;
-        int64_t yi = y1;
-
-        if (dx > dy) {
-            int64_t isDelta = 2 * dy - dx;
-
-            while (xi != x2 + stepX) {
-                drawPixel(xi, yi, color);
-                if (isDelta < 0) {
-                    isDelta += 2 * dy;
-                } else {
-                    yi += stepY;
-                    isDelta = isDelta + 2 * dy - 2 * dx;
-                }
-                xi += stepX;
-            }
-        } else {
-            int64_t isDelta = 2 * dx - dy;
-
-            while (yi != y2 + stepY) {
-                drawPixel(xi, yi, color);
-                if (isDelta < 0) {
-                    isDelta += 2 * dx;
-                } else {
-                    xi += stepX;
-                    isDelta = isDelta + 2 * dx - 2 * dy;
-                }
-                yi += stepY;
-            }
-        }
+        drawLineClipped(x1, y1, x2, y2, color);
     }
 
     template <typename T>
     template <typename Color_T>
     void Painter<T>::drawLineSafe(int64_t x1, int64_t y1, int64_t x2, int64_t y2, Color_T color) {
+        RE_PROFILE_SCOPE("Painter::drawLineSafe");
         paintStart();
+        drawLineClipped(x1, y1, x2, y2, color);
+    }
+
+    template <typename T>
+    template <typename Color_T>
+    void Painter<T>::drawLineClipped(int64_t x1, int64_t y1, int64_t x2, int64_t y2, Color_T color) {
+        const int64_t w = static_cast<int64_t>(texture.width());
+        const int64_t h = static_cast<int64_t>(texture.height());
         const int64_t dx = llabs(x2 - x1);
         const int64_t dy = llabs(y2 - y1);
+        if (w == 0 || h == 0 || (dx == 0 && dy == 0)) {
+            return;
+        }
+        // 主轴记为 u，次轴记为 v：第 k 步 u = u1 + su * k，v = v1 + sv * m(k)，m(k) = floor((2 dv k + du) / (2 du))
+        const bool xMajor = dx > dy;
+        const int64_t du = xMajor ? dx : dy, dv = xMajor ? dy : dx;
+        const int64_t u1 = xMajor ? x1 : y1, v1 = xMajor ? y1 : x1;
+        const int64_t su = (xMajor ? x2 - x1 : y2 - y1) >= 0 ? 1 : -1;
+        const int64_t sv = (xMajor ? y2 - y1 : x2 - x1) >= 0 ? 1 : -1;
+        const int64_t uSize = xMajor ? w : h, vSize = xMajor ? h : w;
 
-        const int64_t stepX = (x2 == x1) ? 0 : (x2 - x1) / dx;
-        const int64_t stepY = (y2 == y1) ? 0 : (y2 - y1) / dy;
-
-        int64_t xi = x1;
-        int64_t yi = y1;
-
-        if (dx > dy) {
-            int64_t isDelta = 2 * dy - dx;
+        auto floorDiv = [](int64_t a, int64_t b) { return a / b - (a % b != 0 && (a < 0) != (b < 0)); };
+        auto ceilDiv = [](int64_t a, int64_t b) { return a / b + (a % b != 0 && (a < 0) == (b < 0)); };
+        // start + step * n 落在 [0, size) 内的 n 的范围
+        auto inside = [](int64_t start, int64_t step, int64_t size, int64_t& lo, int64_t& hi) {
+            lo = step > 0 ? -start : start - (size - 1);
+            hi = step > 0 ? size - 1 - start : start;
+        };
+        int64_t kLo, kHi, mLo, mHi;
+        inside(u1, su, uSize, kLo, kHi);
+        inside(v1, sv, vSize, mLo, mHi);
+        kLo = std::max<int64_t>(kLo, 0);
+        kHi = std::min(kHi, du);
+        mLo = std::max<int64_t>(mLo, 0);
+        mHi = std::min(mHi, dv);
+        if (kLo > kHi || mLo > mHi) {
+            return;
+        }
+        if (dv > 0) {
+            // m(k) >= mLo 且 m(k) <= mHi 对应的 k 区间
+            kLo = std::max(kLo, ceilDiv(2 * du * mLo - du, 2 * dv));
+            kHi = std::min(kHi, ceilDiv(2 * du * (mHi + 1) - du, 2 * dv) - 1);
+        }
 
-            while (xi != x2 + stepX) {
-                drawPixelSafe(xi, yi, color);
-                if (isDelta < 0) {
-                    isDelta += 2 * dy;
-                } else {
-                    yi += stepY;
-                    isDelta = isDelta + 2 * dy - 2 * dx;
-                }
-                xi += stepX;
+        // 从 kLo 处的 Bresenham 状态开始，与从端点逐步走过来完全一致
+        int64_t m = floorDiv(2 * dv * kLo + du, 2 * du);
+        int64_t delta = 2 * dv * (kLo + 1) - du - 2 * du * m;
+        for (int64_t k = kLo; k <= kHi; k++) {
+            const int64_t u = u1 + su * k;
+            const int64_t v = v1 + sv * m;
+            if (xMajor) {
+                drawPixel(u, v, color);
+            } else {
+                drawPixel(v, u, color);
             }
-        } else {
-            int64_t isDelta = 2 * dx - dy;
-
-            while (yi != y2 + stepY) {
-                drawPixelSafe(xi, yi, color);
-                if (isDelta < 0) {
-                    isDelta += 2 * dx;
-                } else {
-                    xi += stepX;
-                    isDelta = isDelta + 2 * dx - 2 * dy;
-                }
-                yi += stepY;
+            if (delta < 0) {
+                delta += 2 * dv;
+            } else {
+                m++;
+                delta += 2 * dv - 2 * du;
             }
         }
     }
@@ -254,6 +453,7 @@ namespace RE {
     template <typename T>
     template <typename Color_T>
     void Painter<T>::drawRectEmpty(size_t x, size_t y, size_t width, size_t height, Color_T color) {
+        RE_PROFILE_SCOPE("Painter::drawRectEmpty");
         paintStart();
         drawScanline(x, y, width - 1, color);
         drawScanline(x, y + height - 1, width, color);
@@ -266,6 +466,7 @@ namespace RE {
     template <typename T>
     template <typename Color_T>
     void Painter<T>::drawRect(size_t x, size_t y, size_t width, size_t height, Color_T color) {
+        RE_PROFILE_SCOPE("Painter::drawRect");
         paintStart();
         for (size_t i = 0; i < width; i++) {
             for (size_t j = 0; j < height; j++) {
@@ -277,6 +478,7 @@ namespace RE {
     template <typename T>
     template <typename Color_T>
     void Painter<T>::drawPolygon(Polygon2D& p, Color_T color) {
+        RE_PROFILE_SCOPE("Painter::drawPolygon");
         paintStart();
         const Range2D range = p.range();
         for (size_t y = range[1]; y < range[3]; y++) {
@@ -298,6 +500,7 @@ namespace RE {
     template <typename T>
     template <typename Color_T>
     void Painter<T>::drawPolygonEmpty(Polygon2D& p, Color_T color) {
+        RE_PROFILE_SCOPE("Painter::drawPolygonEmpty");
         paintStart();
         const std::vector<Line2D> lineList = p.getLineList();
         for (auto& l : lineList) {
@@ -308,6 +511,7 @@ namespace RE {
     template <typename T>
     template <typename Color_T>
     void Painter<T>::drawCircle(int originX, int originY, int radius, Color_T color) {
+        RE_PROFILE_SCOPE("Painter::drawCircle");
         paintStart();
         const int r2 = radius * radius;
         int x = radius, y = 0;
@@ -338,6 +542,7 @@ namespace RE {
     template <typename T>
     template <typename Color_T>
     void Painter<T>::drawCircleEmpty(int originX, int originY, int radius, Color_T color) {
+        RE_PROFILE_SCOPE("Painter::drawCircleEmpty");
         paintStart();
         const int r2 = radius * radius;
         int x = radius, y = 0;
@@ -365,6 +570,663 @@ namespace RE {
         }
     }
 
+    template <typename T>
+    template <typename Color_T>
+    void Painter<T>::fillPath(const Path2D& path, Color_T color, FillRule rule, float tolerance) {
+        RE_PROFILE_SCOPE("Painter::fillPath");
+        paintStart();
+        if (path.empty() || texture.width() == 0 || texture.height() == 0) {
+            return;
+        }
+        const hrgba normalized = normalizeColor(color);
+        const float alpha = camp(normalized.a, 0.0f, 1.0f);
+        const hrgba scaled = std::is_same_v<T, uint8_t> ? normalized * 255.0f : normalized;
+
+        rasterizer.reset(texture.width(), texture.height());
+        rasterizer.addPath(path, tolerance);
+        rasterizer.sweep(rule, [&](size_t y, size_t x, size_t count, const float* coverage) {
+            if (oit != nullptr) {
+                for (size_t i = 0; i < count; i++) {
+                    if (coverage[i] > 0.0f) {
+                        oit->insert(x + i, y, hrgba(hrgb(normalized), alpha * coverage[i]), depth);
+                    }
+                }
+                return;
+            }
+            compositeSpan(x, y, count, coverage, scaled, alpha);
+        });
+    }
+
+    template <typename T>
+    template <typename Color_T>
+    void Painter<T>::drawText(GlyphAtlas& atlas, const Font& font, float size, float x, float y, std::string_view text, Color_T color) {
+        RE_PROFILE_SCOPE("Painter::drawText");
+        paintStart();
+        atlas.beginBatch();
+        textColors.assign(1, normalizeColor(color));
+        layoutText(atlas, font, size, x, y, text, 0);
+        flushText(atlas);
+    }
+
+    template <typename T>
+    void Painter<T>::drawText(GlyphAtlas& atlas, const TextBatch& batch) {
+        RE_PROFILE_SCOPE("Painter::drawTextBatch");
+        paintStart();
+        atlas.beginBatch();
+        textColors.clear();
+        for (const auto& label : batch.labels) {
+            const uint32_t color = static_cast<uint32_t>(textColors.size());
+            textColors.push_back(label.color);
+            layoutText(atlas, *label.font, label.size, label.x, label.y, std::string_view(batch.text).substr(label.textOffset, label.textLength), color);
+        }
+        flushText(atlas);
+    }
+
+    template <typename T>
+    void Painter<T>::layoutText(GlyphAtlas& atlas, const Font& font, float size, float x, float y, std::string_view text, uint32_t color) {
+        const float w = static_cast<float>(texture.width());
+        const float h = static_cast<float>(texture.height());
+        font.layout(text, size, [&](int glyph, float penX, float penY) {
+            // 基线取整，水平位置保留量化后的亚像素
+            const float gx = x + penX;
+            const float gy = std::round(y + penY);
+            // 明显在纹理外的字形不查缓存
+            if (gx > w || gx < -2.0f * size || gy < -size || gy > h + 2.0f * size) {
+                return;
+            }
+            float ix = std::floor(gx);
+            int subpixel = static_cast<int>((gx - ix) * GlyphAtlas::SUBPIXEL_STEPS + 0.5f);
+            if (subpixel == GlyphAtlas::SUBPIXEL_STEPS) {
+                ix += 1.0f;
+                subpixel = 0;
+            }
+            const AtlasGlyph* g = atlas.acquire(font, glyph, size, subpixel);
+            if (g == nullptr) {
+                // 图集被本批字形占满：先把已排好的字形画掉，再开新的一批
+                flushText(atlas);
+                atlas.beginBatch();
+                g = atlas.acquire(font, glyph, size, subpixel);
+                if (g == nullptr) {
+                    return;
+                }
+            }
+            if (g->empty()) {
+                return;
+            }
+            textQuads.push_back({static_cast<int32_t>(ix) + g->offsetX, static_cast<int32_t>(gy) + g->offsetY, *g, color});
+        });
+    }
+
+    template <typename T>
+    void Painter<T>::flushText(const GlyphAtlas& atlas) {
+        RE_PROFILE_SCOPE("Painter::flushText");
+        if (textQuads.empty()) {
+            return;
+        }
+        const int64_t h = static_cast<int64_t>(texture.height());
+        const size_t lineLength = atlas.texture().width();
+        if (textQuads.size() < TEXT_PARALLEL_QUADS) {
+            std::vector<float> line(lineLength);
+            for (const auto& quad : textQuads) {
+                blitGlyph(atlas, quad, 0, h, line.data());
+            }
+            textQuads.clear();
+            return;
+        }
+
+        const int64_t bandCount = (h + TEXT_BAND - 1) / TEXT_BAND;
+        textBands.resize(bandCount);
+        for (auto& band : textBands) {
+            band.clear();
+        }
+        for (uint32_t i = 0; i < textQuads.size(); i++) {
+            const int64_t y0 = std::max<int64_t>(textQuads[i].y, 0);
+            const int64_t y1 = std::min<int64_t>(textQuads[i].y + textQuads[i].glyph.height, h);
+            for (int64_t b = y0 / TEXT_BAND; y0 < y1 && b <= (y1 - 1) / TEXT_BAND; b++) {
+                textBands[b].push_back(i);
+            }
+        }
+#pragma omp parallel
+        {
+            std::vector<float> line(lineLength);
+#pragma omp for schedule(dynamic)
+            for (int64_t b = 0; b < bandCount; b++) {
+                for (const uint32_t i : textBands[b]) {
+                    blitGlyph(atlas, textQuads[i], b * TEXT_BAND, (b + 1) * TEXT_BAND, line.data());
+                }
+            }
+        }
+        textQuads.clear();
+    }
+
+    template <typename T>
+    void Painter<T>::blitGlyph(const GlyphAtlas& atlas, const TextQuad& quad, int64_t rowBegin, int64_t rowEnd, float* line) {
+        const int64_t x0 = std::max<int64_t>(quad.x, 0);
+        const int64_t x1 = std::min<int64_t>(quad.x + quad.glyph.width, texture.width());
+        const int64_t y0 = std::max<int64_t>({quad.y, rowBegin, 0});
+        const int64_t y1 = std::min<int64_t>({quad.y + quad.glyph.height, rowEnd, static_cast<int64_t>(texture.height())});
+        if (x0 >= x1 || y0 >= y1) {
+            return;
+        }
+        const hrgba& normalized = textColors[quad.color];
+        const float alpha = camp(normalized.a, 0.0f, 1.0f);
+        const hrgba scaled = std::is_same_v<T, uint8_t> ? normalized * 255.0f : normalized;
+        const size_t count = static_cast<size_t>(x1 - x0);
+        const Texture& source = atlas.texture();
+        for (int64_t y = y0; y < y1; y++) {
+            const uint8_t* src = source.data() + source.getIndex(quad.glyph.x + (x0 - quad.x), quad.glyph.y + (y - quad.y));
+            for (size_t i = 0; i < count; i++) {
+                line[i] = src[i] * (1.0f / 255.0f);
+            }
+            if (oit != nullptr) {
+                for (size_t i = 0; i < count; i++) {
+                    if (line[i] > 0.0f) {
+                        oit->insert(x0 + i, y, hrgba(hrgb(normalized), alpha * line[i]), depth);
+                    }
+                }
+                continue;
+            }
+            compositeSpan(x0, y, count, line, scaled, alpha);
+        }
+    }
+
+    template <typename T>
+    void Painter<T>::compositeSpan(size_t x, size_t y, size_t count, const float* coverage, const hrgba& color, float alpha) {
+        RE_PROFILE_SCOPE_DETAIL("Painter::compositeSpan");
+        const size_t c = texture.channel();
+        T* row = texture.data() + texture.getIndex(x, y);
+        size_t i = 0;
+        if (c == 4) {
+            if constexpr (std::is_same_v<T, uint8_t>) {
+#if defined(RE_SIMD_AVX2)
+                // 8 个像素一组，每个 __m256 处理 2 个像素
+                const __m256 src2 = _mm256_setr_ps(color.r, color.g, color.b, color.a, color.r, color.g, color.b, color.a);
+                const __m256 alpha8 = _mm256_set1_ps(alpha);
+                const __m256 half8 = _mm256_set1_ps(0.5f);
+                for (; i + 8 <= count; i += 8) {
+                    const __m256 k8 = _mm256_mul_ps(_mm256_loadu_ps(coverage + i), alpha8);
+                    for (int j = 0; j < 4; j++) {
+                        uint8_t* p = row + (i + 2 * j) * 4;
+                        const __m256 d = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(p))));
+                        const __m256 k = _mm256_permutevar8x32_ps(k8, _mm256_setr_epi32(2 * j, 2 * j, 2 * j, 2 * j, 2 * j + 1, 2 * j + 1, 2 * j + 1, 2 * j + 1));
+                        const __m256 r = _mm256_add_ps(_mm256_add_ps(d, _mm256_mul_ps(_mm256_sub_ps(src2, d), k)), half8);
+                        const __m256i ri = _mm256_cvttps_epi32(r);
+                        const __m128i w = _mm_packs_epi32(_mm256_castsi256_si128(ri), _mm256_extracti128_si256(ri, 1));
+                        _mm_storel_epi64(reinterpret_cast<__m128i*>(p), _mm_packus_epi16(w, w));
+                    }
+                }
+#endif
+#if defined(RE_SIMD_SSE2)
+                const __m128 src = _mm_setr_ps(color.r, color.g, color.b, color.a);
+                const __m128 alpha4 = _mm_set1_ps(alpha);
+                const __m128 half4 = _mm_set1_ps(0.5f);
+                const __m128i zero = _mm_setzero_si128();
+                auto blend = [&](__m128i d16, __m128 k) {
+                    const __m128 d = _mm_cvtepi32_ps(d16);
+                    return _mm_cvttps_epi32(_mm_add_ps(_mm_add_ps(d, _mm_mul_ps(_mm_sub_ps(src, d), k)), half4));
+                };
+                for (; i + 4 <= count; i += 4) {
+                    uint8_t* p = row + i * 4;
+                    const __m128 k4 = _mm_mul_ps(_mm_loadu_ps(coverage + i), alpha4);
+                    const __m128i px = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+                    const __m128i lo = _mm_unpacklo_epi8(px, zero);
+                    const __m128i hi = _mm_unpackhi_epi8(px, zero);
+                    const __m128i r0 = blend(_mm_unpacklo_epi16(lo, zero), _mm_shuffle_ps(k4, k4, _MM_SHUFFLE(0, 0, 0, 0)));
+                    const __m128i r1 = blend(_mm_unpackhi_epi16(lo, zero), _mm_shuffle_ps(k4, k4, _MM_SHUFFLE(1, 1, 1, 1)));
+                    const __m128i r2 = blend(_mm_unpacklo_epi16(hi, zero), _mm_shuffle_ps(k4, k4, _MM_SHUFFLE(2, 2, 2, 2)));
+                    const __m128i r3 = blend(_mm_unpackhi_epi16(hi, zero), _mm_shuffle_ps(k4, k4, _MM_SHUFFLE(3, 3, 3, 3)));
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(p), _mm_packus_epi16(_mm_packs_epi32(r0, r1), _mm_packs_epi32(r2, r3)));
+                }
+#endif
+            } else {
+#if defined(RE_SIMD_AVX2)
+                const __m256 src2 = _mm256_setr_ps(color.r, color.g, color.b, color.a, color.r, color.g, color.b, color.a);
+                for (; i + 2 <= count; i += 2) {
+                    float* p = row + i * 4;
+                    const __m256 k = _mm256_setr_m128(_mm_set1_ps(coverage[i] * alpha), _mm_set1_ps(coverage[i + 1] * alpha));
+                    const __m256 d = _mm256_loadu_ps(p);
+                    _mm256_storeu_ps(p, _mm256_add_ps(d, _mm256_mul_ps(_mm256_sub_ps(src2, d), k)));
+                }
+#endif
+#if defined(RE_SIMD_SSE2)
+                const __m128 src = _mm_setr_ps(color.r, color.g, color.b, color.a);
+                for (; i < count; i++) {
+                    float* p = row + i * 4;
+                    const __m128 d = _mm_loadu_ps(p);
+                    _mm_storeu_ps(p, _mm_add_ps(d, _mm_mul_ps(_mm_sub_ps(src, d), _mm_set1_ps(coverage[i] * alpha))));
+                }
+#endif
+            }
+        }
+        // 标量回退，同时处理尾部像素和非 4 通道的纹理
+        const size_t channels = std::min<size_t>(c, 4);
+        const float rounding = std::is_same_v<T, uint8_t> ? 0.5f : 0.0f;
+        for (; i < count; i++) {
+            const float k = coverage[i] * alpha;
+            T* p = row + i * c;
+            for (size_t ch = 0; ch < channels; ch++) {
+                const float d = static_cast<float>(p[ch]);
+                p[ch] = static_cast<T>(d + (color[ch] - d) * k + rounding);
+            }
+        }
+    }
+
+    template <typename T>
+    bool Painter<T>::checkImageFormat(const TextureBase<T>& src) {
+        const size_t sc = src.channel(), dc = texture.channel();
+        if ((sc != 3 && sc != 4) || (dc != 3 && dc != 4)) {
+            std::cerr << "Painter::drawImage Error: only 3 or 4 channel textures are supported (" << sc << " -> " << dc << ")" << std::endl;
+            return false;
+        }
+        return src.width() > 0 && src.height() > 0;
+    }
+
+    template <typename T>
+    template <typename Row>
+    void Painter<T>::forEachImageRow(int64_t y0, int64_t y1, size_t count, Row&& row) {
+        if ((y1 - y0) * static_cast<int64_t>(count) < IMAGE_PARALLEL_PIXELS) {
+            imageRow.resize(count * 4);
+            for (int64_t y = y0; y < y1; y++) {
+                row(y, imageRow.data());
+            }
+            return;
+        }
+#pragma omp parallel
+        {
+            std::vector<T> buffer(count * 4);
+#pragma omp for schedule(static)
+            for (int64_t y = y0; y < y1; y++) {
+                row(y, buffer.data());
+            }
+        }
+    }
+
+    template <typename T>
+    void Painter<T>::expandImageRow(const T* src, size_t channel, size_t count, T* rgbaRow) {
+        if (channel == 4) {
+            memcpy(rgbaRow, src, count * 4 * sizeof(T));
+            return;
+        }
+        constexpr T opaque = std::is_same_v<T, uint8_t> ? T(255) : T(1);
+        for (size_t i = 0; i < count; i++) {
+            rgbaRow[i * 4] = src[i * 3];
+            rgbaRow[i * 4 + 1] = src[i * 3 + 1];
+            rgbaRow[i * 4 + 2] = src[i * 3 + 2];
+            rgbaRow[i * 4 + 3] = opaque;
+        }
+    }
+
+    template <typename T>
+    void Painter<T>::storeImageRow(size_t x, size_t y, size_t count, const T* rgbaRow, bool blend) {
+        const size_t dc = texture.channel();
+        T* dst = texture.data() + texture.getIndex(x, y);
+        constexpr float alphaScale = std::is_same_v<T, uint8_t> ? 1.0f / 255.0f : 1.0f;
+        constexpr float rounding = std::is_same_v<T, uint8_t> ? 0.5f : 0.0f;
+        if (oit != nullptr && blend) {
+            for (size_t i = 0; i < count; i++) {
+                const T* s = rgbaRow + i * 4;
+                if (s[3] > T(0)) {
+                    oit->insert(x + i, y, hrgba(s[0], s[1], s[2], s[3]) * alphaScale, depth);
+                }
+            }
+            return;
+        }
+        if (!blend) {
+            if (dc == 4) {
+                memcpy(dst, rgbaRow, count * 4 * sizeof(T));
+            } else {
+                for (size_t i = 0; i < count; i++) {
+                    dst[i * 3] = rgbaRow[i * 4];
+                    dst[i * 3 + 1] = rgbaRow[i * 4 + 1];
+                    dst[i * 3 + 2] = rgbaRow[i * 4 + 2];
+                }
+            }
+            return;
+        }
+
+        size_t i = 0;
+        if (dc == 4) {
+            if constexpr (std::is_same_v<T, uint8_t>) {
+#if defined(RE_SIMD_SSE2)
+                const __m128i zero = _mm_setzero_si128();
+                const __m128i alphaMask = _mm_set1_epi32(static_cast<int>(0xff000000u));
+                const __m128 inv255 = _mm_set1_ps(1.0f / 255.0f);
+                const __m128 half4 = _mm_set1_ps(0.5f);
+                auto blendPixel = [&](__m128i s32, __m128i d32) {
+                    const __m128 sf = _mm_cvtepi32_ps(s32);
+                    const __m128 df = _mm_cvtepi32_ps(d32);
+                    const __m128 a = _mm_mul_ps(_mm_shuffle_ps(sf, sf, _MM_SHUFFLE(3, 3, 3, 3)), inv255);
+                    return _mm_cvttps_epi32(_mm_add_ps(_mm_add_ps(df, _mm_mul_ps(_mm_sub_ps(sf, df), a)), half4));
+                };
+                for (; i + 4 <= count; i += 4) {
+                    const __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rgbaRow + i * 4));
+                    const int alpha = _mm_movemask_epi8(_mm_cmpeq_epi32(_mm_and_si128(s, alphaMask), alphaMask));
+                    // 4 个像素都不透明时直接覆盖，都全透明时跳过，结果与逐像素混合相同
+                    if (alpha == 0xffff) {
+                        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * 4), s);
+                        continue;
+                    }
+                    if (_mm_movemask_epi8(_mm_cmpeq_epi32(_mm_and_si128(s, alphaMask), zero)) == 0xffff) {
+                        continue;
+                    }
+                    const __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dst + i * 4));
+                    const __m128i sLo = _mm_unpacklo_epi8(s, zero), sHi = _mm_unpackhi_epi8(s, zero);
+                    const __m128i dLo = _mm_unpacklo_epi8(d, zero), dHi = _mm_unpackhi_epi8(d, zero);
+                    const __m128i r0 = blendPixel(_mm_unpacklo_epi16(sLo, zero), _mm_unpacklo_epi16(dLo, zero));
+                    const __m128i r1 = blendPixel(_mm_unpackhi_epi16(sLo, zero), _mm_unpackhi_epi16(dLo, zero));
+                    const __m128i r2 = blendPixel(_mm_unpacklo_epi16(sHi, zero), _mm_unpacklo_epi16(dHi, zero));
+                    const __m128i r3 = blendPixel(_mm_unpackhi_epi16(sHi, zero), _mm_unpackhi_epi16(dHi, zero));
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * 4), _mm_packus_epi16(_mm_packs_epi32(r0, r1), _mm_packs_epi32(r2, r3)));
+                }
+#endif
+            } else {
+#if defined(RE_SIMD_AVX2)
+                for (; i + 2 <= count; i += 2) {
+                    const __m256 s = _mm256_loadu_ps(rgbaRow + i * 4);
+                    const __m256 d = _mm256_loadu_ps(dst + i * 4);
+                    const __m256 a = _mm256_shuffle_ps(s, s, _MM_SHUFFLE(3, 3, 3, 3));
+                    _mm256_storeu_ps(dst + i * 4, _mm256_add_ps(d, _mm256_mul_ps(_mm256_sub_ps(s, d), a)));
+                }
+#endif
+#if defined(RE_SIMD_SSE2)
+                for (; i < count; i++) {
+                    const __m128 s = _mm_loadu_ps(rgbaRow + i * 4);
+                    const __m128 d = _mm_loadu_ps(dst + i * 4);
+                    const __m128 a = _mm_shuffle_ps(s, s, _MM_SHUFFLE(3, 3, 3, 3));
+                    _mm_storeu_ps(dst + i * 4, _mm_add_ps(d, _mm_mul_ps(_mm_sub_ps(s, d), a)));
+                }
+#endif
+            }
+        }
+        // 标量回退，同时处理尾部像素和 3 通道的目标
+        const size_t channels = std::min<size_t>(dc, 4);
+        for (; i < count; i++) {
+            const T* s = rgbaRow + i * 4;
+            T* d = dst + i * dc;
+            const float a = s[3] * alphaScale;
+            for (size_t ch = 0; ch < channels; ch++) {
+                const float df = static_cast<float>(d[ch]);
+                d[ch] = static_cast<T>(df + (static_cast<float>(s[ch]) - df) * a + rounding);
+            }
+        }
+    }
+
+    template <typename T>
+    void Painter<T>::bilinearPixel(const T* p0, const T* p1, size_t sc, int32_t x0, int32_t x1, float fx, float fy, T* out) {
+#if defined(RE_SIMD_SSE2)
+        if (sc == 4) {
+            auto load = [](const T* p) {
+                if constexpr (std::is_same_v<T, uint8_t>) {
+                    int32_t bits;
+                    memcpy(&bits, p, 4);
+                    const __m128i zero = _mm_setzero_si128();
+                    return _mm_cvtepi32_ps(_mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(bits), zero), zero));
+                } else {
+                    return _mm_loadu_ps(p);
+                }
+            };
+            const __m128 wx = _mm_set1_ps(fx), wy = _mm_set1_ps(fy);
+            const __m128 a = load(p0 + x0 * 4), b = load(p0 + x1 * 4);
+            const __m128 c = load(p1 + x0 * 4), d = load(p1 + x1 * 4);
+            const __m128 top = _mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(b, a), wx));
+            const __m128 bottom = _mm_add_ps(c, _mm_mul_ps(_mm_sub_ps(d, c), wx));
+            const __m128 r = _mm_add_ps(top, _mm_mul_ps(_mm_sub_ps(bottom, top), wy));
+            if constexpr (std::is_same_v<T, uint8_t>) {
+                const __m128i ri = _mm_cvttps_epi32(_mm_add_ps(r, _mm_set1_ps(0.5f)));
+                const __m128i w = _mm_packs_epi32(ri, ri);
+                const int32_t bits = _mm_cvtsi128_si32(_mm_packus_epi16(w, w));
+                memcpy(out, &bits, 4);
+            } else {
+                _mm_storeu_ps(out, r);
+            }
+            return;
+        }
+#endif
+        constexpr float rounding = std::is_same_v<T, uint8_t> ? 0.5f : 0.0f;
+        constexpr T opaque = std::is_same_v<T, uint8_t> ? T(255) : T(1);
+        for (size_t ch = 0; ch < sc; ch++) {
+            const float a = p0[x0 * sc + ch], b = p0[x1 * sc + ch];
+            const float c = p1[x0 * sc + ch], d = p1[x1 * sc + ch];
+            const float top = a + (b - a) * fx;
+            const float bottom = c + (d - c) * fx;
+            out[ch] = static_cast<T>(top + (bottom - top) * fy + rounding);
+        }
+        if (sc == 3) {
+            out[3] = opaque;
+        }
+    }
+
+    template <typename T>
+    void Painter<T>::drawImage(const TextureBase<T>& src, int64_t x, int64_t y, bool blend) {
+        drawImage(src, 0, 0, src.width(), src.height(), x, y, src.width(), src.height(), nearest, blend);
+    }
+
+    template <typename T>
+    void Painter<T>::drawImage(const TextureBase<T>& src, int64_t x, int64_t y, int64_t width, int64_t height, TextureFilter filter, bool blend) {
+        drawImage(src, 0, 0, src.width(), src.height(), x, y, width, height, filter, blend);
+    }
+
+    template <typename T>
+    void Painter<T>::drawImage(const TextureBase<T>& src, int64_t srcX, int64_t srcY, int64_t srcWidth, int64_t srcHeight,
+                               int64_t x, int64_t y, int64_t width, int64_t height, TextureFilter filter, bool blend) {
+        RE_PROFILE_SCOPE("Painter::drawImage");
+        paintStart();
+        if (!checkImageFormat(src) || width <= 0 || height <= 0) {
+            return;
+        }
+        // 源矩形裁剪到 src 内
+        const int64_t sx0 = std::max<int64_t>(srcX, 0), sy0 = std::max<int64_t>(srcY, 0);
+        const int64_t sx1 = std::min<int64_t>(srcX + srcWidth, src.width()), sy1 = std::min<int64_t>(srcY + srcHeight, src.height());
+        if (sx0 >= sx1 || sy0 >= sy1) {
+            return;
+        }
+        srcX = sx0;
+        srcY = sy0;
+        srcWidth = sx1 - sx0;
+        srcHeight = sy1 - sy0;
+        const size_t sc = src.channel(), dc = texture.channel();
+        // 不透明的 3 通道图混合等同于覆盖
+        blend = blend && sc == 4;
+
+        const int64_t x0 = std::max<int64_t>(x, 0);
+        const int64_t y0 = std::max<int64_t>(y, 0);
+        const int64_t x1 = std::min<int64_t>(x + width, texture.width());
+        const int64_t y1 = std::min<int64_t>(y + height, texture.height());
+        if (x0 >= x1 || y0 >= y1) {
+            return;
+        }
+        const size_t count = static_cast<size_t>(x1 - x0);
+
+        // 1:1 不需要采样，格式相同时直接整行复制
+        if (srcWidth == width && srcHeight == height) {
+            forEachImageRow(y0, y1, count, [&](int64_t dy, T* row) {
+                const T* s = src.data() + src.getIndex(srcX + x0 - x, srcY + dy - y);
+                if (sc == dc && !blend) {
+                    memcpy(texture.data() + texture.getIndex(x0, dy), s, count * sc * sizeof(T));
+                    return;
+                }
+                if (sc == 4) {
+                    storeImageRow(x0, dy, count, s, blend);
+                    return;
+                }
+                expandImageRow(s, sc, count, row);
+                storeImageRow(x0, dy, count, row, blend);
+            });
+            return;
+        }
+        const float scaleX = static_cast<float>(srcWidth) / width;
+        const float scaleY = static_cast<float>(srcHeight) / height;
+
+        // 每列的源坐标只算一次：nearest 为列号，bilinear 为左右两列和权重
+        imageColumns.resize(count * 2);
+        imageWeights.resize(count);
+        for (size_t i = 0; i < count; i++) {
+            const float u = (static_cast<float>(x0 - x + static_cast<int64_t>(i)) + 0.5f) * scaleX;
+            if (filter == nearest) {
+                imageColumns[i] = static_cast<int32_t>(std::min<int64_t>(static_cast<int64_t>(u), srcWidth - 1) + srcX);
+                continue;
+            }
+            const float fu = std::max(u - 0.5f, 0.0f);
+            const int64_t c0 = std::min<int64_t>(static_cast<int64_t>(fu), srcWidth - 1);
+            imageColumns[i * 2] = static_cast<int32_t>(c0 + srcX);
+            imageColumns[i * 2 + 1] = static_cast<int32_t>(std::min<int64_t>(c0 + 1, srcWidth - 1) + srcX);
+            imageWeights[i] = std::min(fu - static_cast<float>(c0), 1.0f);
+        }
+
+        forEachImageRow(y0, y1, count, [&](int64_t dy, T* row) {
+            const float v = (static_cast<float>(dy - y) + 0.5f) * scaleY;
+            if (filter == nearest) {
+                const int64_t r = std::min<int64_t>(static_cast<int64_t>(v), srcHeight - 1) + srcY;
+                const T* s = src.data() + src.getIndex(0, r);
+                size_t i = 0;
+                if (sc == 4) {
+                    if constexpr (std::is_same_v<T, uint8_t>) {
+#if defined(RE_SIMD_AVX2)
+                        // 4 通道 uint8 的像素正好是一个 int32，8 个像素一次 gather
+                        for (; i + 8 <= count; i += 8) {
+                            const __m256i index = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(imageColumns.data() + i));
+                            _mm256_storeu_si256(reinterpret_cast<__m256i*>(row + i * 4), _mm256_i32gather_epi32(reinterpret_cast<const int*>(s), index, 4));
+                        }
+#endif
+                    }
+                    for (; i < count; i++) {
+                        memcpy(row + i * 4, s + static_cast<size_t>(imageColumns[i]) * 4, 4 * sizeof(T));
+                    }
+                } else {
+                    constexpr T opaque = std::is_same_v<T, uint8_t> ? T(255) : T(1);
+                    for (; i < count; i++) {
+                        const T* p = s + static_cast<size_t>(imageColumns[i]) * 3;
+                        row[i * 4] = p[0];
+                        row[i * 4 + 1] = p[1];
+                        row[i * 4 + 2] = p[2];
+                        row[i * 4 + 3] = opaque;
+                    }
+                }
+            } else {
+                const float fv = std::max(v - 0.5f, 0.0f);
+                const int64_t r0 = std::min<int64_t>(static_cast<int64_t>(fv), srcHeight - 1);
+                const int64_t r1 = std::min<int64_t>(r0 + 1, srcHeight - 1);
+                const float fy = std::min(fv - static_cast<float>(r0), 1.0f);
+                const T* p0 = src.data() + src.getIndex(0, r0 + srcY);
+                const T* p1 = src.data() + src.getIndex(0, r1 + srcY);
+                for (size_t i = 0; i < count; i++) {
+                    bilinearPixel(p0, p1, sc, imageColumns[i * 2], imageColumns[i * 2 + 1], imageWeights[i], fy, row + i * 4);
+                }
+            }
+            storeImageRow(x0, dy, count, row, blend);
+        });
+    }
+
+    template <typename T>
+    void Painter<T>::drawImage(const TextureBase<T>& src, const glm::mat3& transform, TextureFilter filter, bool blend) {
+        RE_PROFILE_SCOPE("Painter::drawImageAffine");
+        paintStart();
+        if (!checkImageFormat(src)) {
+            return;
+        }
+        // dst = A * src + t，求逆得到目标像素到源像素的映射
+        const float a = transform[0][0], b = transform[1][0], tx = transform[2][0];
+        const float c = transform[0][1], d = transform[1][1], ty = transform[2][1];
+        const float det = a * d - b * c;
+        if (std::abs(det) < 1e-12f) {
+            return;
+        }
+        const float ia = d / det, ib = -b / det, ic = -c / det, id = a / det;
+        const float itx = -(ia * tx + ib * ty), ity = -(ic * tx + id * ty);
+        const float sw = static_cast<float>(src.width()), sh = static_cast<float>(src.height());
+
+        // 目标上的包围盒
+        float minX = tx, maxX = tx, minY = ty, maxY = ty;
+        for (const glm::vec2 corner : {glm::vec2(sw, 0.0f), glm::vec2(0.0f, sh), glm::vec2(sw, sh)}) {
+            const float px = a * corner.x + b * corner.y + tx;
+            const float py = c * corner.x + d * corner.y + ty;
+            minX = std::min(minX, px);
+            maxX = std::max(maxX, px);
+            minY = std::min(minY, py);
+            maxY = std::max(maxY, py);
+        }
+        const int64_t x0 = std::max<int64_t>(static_cast<int64_t>(std::floor(minX)), 0);
+        const int64_t y0 = std::max<int64_t>(static_cast<int64_t>(std::floor(minY)), 0);
+        const int64_t x1 = std::min<int64_t>(static_cast<int64_t>(std::ceil(maxX)) + 1, texture.width());
+        const int64_t y1 = std::min<int64_t>(static_cast<int64_t>(std::ceil(maxY)) + 1, texture.height());
+        if (x0 >= x1 || y0 >= y1) {
+            return;
+        }
+        const size_t sc = src.channel();
+        blend = blend && sc == 4;
+
+        forEachImageRow(y0, y1, static_cast<size_t>(x1 - x0), [&](int64_t dy, T* row) {
+            // 行首像素中心的源坐标，沿 x 每步加 (ia, ic)
+            const float py = static_cast<float>(dy) + 0.5f;
+            auto sourceAt = [&](int64_t dx) {
+                const float px = static_cast<float>(dx) + 0.5f;
+                return glm::vec2(ia * px + ib * py + itx, ic * px + id * py + ity);
+            };
+            auto inside = [&](int64_t dx) {
+                const glm::vec2 uv = sourceAt(dx);
+                return uv.x >= 0.0f && uv.x < sw && uv.y >= 0.0f && uv.y < sh;
+            };
+            // 解出本行落在 src 内的区间，再在两端逐像素修正浮点误差
+            float lo = static_cast<float>(x0), hi = static_cast<float>(x1);
+            auto limit = [&](float start, float step, float extent) {
+                if (step == 0.0f) {
+                    if (start < 0.0f || start >= extent) {
+                        hi = lo;
+                    }
+                    return;
+                }
+                float t0 = (0.0f - start) / step, t1 = (extent - start) / step;
+                if (t0 > t1) {
+                    std::swap(t0, t1);
+                }
+                lo = std::max(lo, t0 - 0.5f);
+                hi = std::min(hi, t1 + 0.5f);
+            };
+            const glm::vec2 origin = sourceAt(0) - glm::vec2(ia, ic) * 0.5f;
+            limit(origin.x, ia, sw);
+            limit(origin.y, ic, sh);
+            if (hi <= lo) {
+                return;
+            }
+            int64_t begin = std::max<int64_t>(static_cast<int64_t>(std::floor(lo)), x0);
+            int64_t end = std::min<int64_t>(static_cast<int64_t>(std::ceil(hi)), x1);
+            while (begin < end && !inside(begin)) {
+                begin++;
+            }
+            while (end > begin && !inside(end - 1)) {
+                end--;
+            }
+            if (begin >= end) {
+                return;
+            }
+
+            const size_t count = static_cast<size_t>(end - begin);
+            glm::vec2 uv = sourceAt(begin);
+            const int64_t maxCol = static_cast<int64_t>(src.width()) - 1, maxRow = static_cast<int64_t>(src.height()) - 1;
+            constexpr T opaque = std::is_same_v<T, uint8_t> ? T(255) : T(1);
+            for (size_t i = 0; i < count; i++, uv.x += ia, uv.y += ic) {
+                if (filter == nearest) {
+                    const int64_t col = std::clamp<int64_t>(static_cast<int64_t>(uv.x), 0, maxCol);
+                    const int64_t r = std::clamp<int64_t>(static_cast<int64_t>(uv.y), 0, maxRow);
+                    const T* p = src.data() + src.getIndex(col, r);
+                    memcpy(row + i * 4, p, sc * sizeof(T));
+                    if (sc == 3) {
+                        row[i * 4 + 3] = opaque;
+                    }
+                    continue;
+                }
+                const float fu = std::max(uv.x - 0.5f, 0.0f), fv = std::max(uv.y - 0.5f, 0.0f);
+                const int64_t c0 = std::min<int64_t>(static_cast<int64_t>(fu), maxCol);
+                const int64_t r0 = std::min<int64_t>(static_cast<int64_t>(fv), maxRow);
+                const T* p0 = src.data() + src.getIndex(0, r0);
+                const T* p1 = src.data() + src.getIndex(0, std::min<int64_t>(r0 + 1, maxRow));
+                bilinearPixel(p0, p1, sc, static_cast<int32_t>(c0), static_cast<int32_t>(std::min<int64_t>(c0 + 1, maxCol)),
+                              std::min(fu - static_cast<float>(c0), 1.0f), std::min(fv - static_cast<float>(r0), 1.0f), row + i * 4);
+            }
+            storeImageRow(begin, dy, count, row, blend);
+        });
+    }
+
     template <typename T>
     rgba Painter<T>::alphaMix(const rgba& src, const rgba& dst) {
         const float alpha = src.a / 255.0f;
@@ -378,6 +1240,13 @@ namespace RE {
         return {r, g, b, a};
     }
 
+    template <typename T>
+    hrgba Painter<T>::alphaMix(const hrgba& src, const hrgba& dst) {
+        const float alpha = src.a;
+        const float invAlpha = 1.0f - alpha;
+        return src * alpha + dst * invAlpha;
+    }
+
     template <typename T>
     inline void Painter<T>::paintStart() {
         imageView->changed = true;
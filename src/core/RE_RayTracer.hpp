@@ -0,0 +1,956 @@
+#pragma once
+#include "RE_includes.h"
+#include "RE_Geometry3D.hpp"
+#include "RE_Renderer.hpp"
+
+namespace RE {
+    namespace raytrace {
+        // 光线包的宽度与 SIMD 宽度一致
+#if defined(RE_SIMD_AVX2)
+        constexpr size_t PACKET = 8;
+#else
+        constexpr size_t PACKET = 4;
+#endif
+    }
+
+    // 光线：direction 不要求归一化，t 以 direction 的长度为单位
+    struct Ray {
+        glm::vec3 origin = glm::vec3(0.0f);
+        float tMin = 0.0f;
+        glm::vec3 direction = glm::vec3(0.0f, 0.0f, -1.0f);
+        float tMax = std::numeric_limits<float>::infinity();
+    };
+
+    // 交点：(u, v) 为重心坐标，交点 = (1 - u - v) * p0 + u * p1 + v * p2
+    struct RayHit {
+        static constexpr uint32_t MISS = 0xffffffffu;
+        float t = std::numeric_limits<float>::infinity();
+        float u = 0.0f;
+        float v = 0.0f;
+        uint32_t triangle = MISS; // Mesh 中的三角形下标
+
+        bool hit() const;
+    };
+
+    // 一起遍历的一组光线（SoA），tMax < tMin 的通道视为无效
+    struct alignas(32) RayPacket {
+        float ox[raytrace::PACKET], oy[raytrace::PACKET], oz[raytrace::PACKET];
+        float dx[raytrace::PACKET], dy[raytrace::PACKET], dz[raytrace::PACKET];
+        float tMin[raytrace::PACKET], tMax[raytrace::PACKET];
+
+        void set(size_t lane, const Ray& ray);
+        void disable(size_t lane);
+        Ray ray(size_t lane) const;
+    };
+
+    // 三角形 BVH：分桶 SAH 建树（上层并行分桶，下层子树并行构建），4 叉节点按 SoA 存放包围盒，
+    // 叶子为最多 4 个三角形打包成的 SoA 块，一条光线一次 SIMD 测试 4 个子节点或 4 个三角形
+    class TriangleBVH {
+    public:
+        static constexpr uint32_t INVALID = 0xffffffffu;
+        static constexpr uint32_t LEAF_SIZE = 4;
+        // 超过该深度后改为按数量对半分，保证遍历栈不会溢出
+        static constexpr uint32_t MAX_DEPTH = 48;
+        static constexpr size_t STACK_SIZE = 256;
+        // 不超过该数量的子树作为一个任务并行构建
+        static constexpr uint32_t JOB_SIZE = 8192;
+
+        // 只拷贝 Mesh 的顶点位置，建树后 Mesh 的修改不会反映到 BVH
+        void build(const Mesh& mesh);
+        void clear();
+
+        size_t nodeCount() const;
+        size_t triangleCount() const;
+        AABB bounds() const;
+
+        // 最近交点，没有相交时返回 false 且 hit 不变
+        bool intersect(const Ray& ray, RayHit& hit) const;
+        // 任意交点即返回，用于阴影、AO 等只关心是否被遮挡的光线
+        bool occluded(const Ray& ray) const;
+        // 光线包一起遍历，适合方向相近的主光线，hits 为 raytrace::PACKET 个结果
+        void intersect(const RayPacket& packet, RayHit* hits) const;
+
+    private:
+        // count[i] > 0 时为叶子，child[i] 为 TriangleBlock 下标；否则 child[i] 为节点下标，INVALID 表示空槽
+        struct alignas(16) Node {
+            float minX[4], minY[4], minZ[4];
+            float maxX[4], maxY[4], maxZ[4];
+            uint32_t child[4];
+            uint32_t count[4];
+        };
+
+        // Möller-Trumbore 需要的顶点和两条边，空位的边为 0（行列式为 0，不会相交）
+        struct alignas(16) TriangleBlock {
+            float v0x[4], v0y[4], v0z[4];
+            float e1x[4], e1y[4], e1z[4];
+            float e2x[4], e2y[4], e2z[4];
+            uint32_t id[4];
+        };
+
+        struct BuildJob {
+            uint32_t begin, end, depth;
+            uint32_t node, slot;
+        };
+
+        struct StackEntry {
+            uint32_t child, count;
+            float t;
+        };
+
+        std::vector<Node> nodes;
+        std::vector<TriangleBlock> blocks;
+        size_t _triangleCount = 0;
+
+        // 建树时的临时数据
+        const Mesh* source = nullptr;
+        std::vector<AABB> triangleBounds;
+        std::vector<glm::vec3> centroids;
+        std::vector<uint32_t> refs;
+
+        uint32_t buildNode(uint32_t begin, uint32_t end, uint32_t depth, std::vector<Node>& outNodes, std::vector<TriangleBlock>& outBlocks, std::vector<BuildJob>* jobs);
+        uint32_t split(uint32_t begin, uint32_t end, uint32_t depth);
+        uint32_t makeLeaf(uint32_t begin, uint32_t end, std::vector<TriangleBlock>& outBlocks) const;
+        AABB rangeBounds(uint32_t begin, uint32_t end) const;
+        static void setSlot(Node& node, uint32_t slot, const AABB& box, uint32_t child, uint32_t count);
+
+        // 返回与光线相交的子节点掩码，tNear 为各子节点的进入距离
+        static uint32_t intersectNode(const Node& node, const glm::vec3& origin, const glm::vec3& invDir, float tMin, float tMax, float* tNear);
+        // 返回块内最近交点的通道（-1 表示不相交），t 只在更近时更新
+        static int intersectBlock(const TriangleBlock& block, const Ray& ray, float tMin, float& t, float& u, float& v);
+        template <bool ANY_HIT>
+        bool traverse(const Ray& ray, RayHit& hit) const;
+    };
+
+    // 光线追踪的片元，与 RasterFragment 对应，交给着色函数计算颜色
+    struct RayFragment {
+        size_t x, y;
+        Ray ray;
+        RayHit hit;
+    };
+
+    // 按 tile 并行的离线光线追踪：输出到 HDRTexture，之后与光栅化共用 resolveHDR、后处理和显示流程
+    // 每个 tile 内按光线包发射主光线（AVX2 为 4x2 像素，其余为 2x2），二次光线由着色函数通过 bvh() 发射
+    class RayTracer {
+    public:
+        static constexpr size_t TILE = 16;
+
+        // 对 mesh 建 BVH，mesh 在渲染期间需要保持有效（着色时读取法线等属性）
+        void setScene(const Mesh* mesh);
+        const Mesh* scene() const;
+        const TriangleBVH& bvh() const;
+
+        // 与 VertexStage 相同的 projection * view，深度范围为 [0, w]
+        void setCamera(const glm::mat4& viewProjection);
+        // 每个像素的采样数，采样位置为 jitterSequence 序列，结果取平均
+        void setSamplesPerPixel(uint32_t samples);
+
+        // 屏幕坐标（y 向下，像素中心为 +0.5）对应的主光线，从近平面射向远平面，方向已归一化
+        Ray primaryRay(float x, float y, size_t width, size_t height) const;
+        // 交点处插值后的法线，Mesh 没有法线时为几何法线
+        glm::vec3 normal(const RayHit& hit) const;
+
+        // shader(const RayFragment&) -> hrgba，未命中时也会调用（hit.hit() 为 false），可用于背景
+        template <typename SHADER_T>
+        void render(HDRTexture& target, SHADER_T shader) const;
+        // 默认着色：法线与视线夹角的余弦，未命中为黑色
+        void render(HDRTexture& target) const;
+
+    private:
+        const Mesh* mesh = nullptr;
+        TriangleBVH _bvh;
+        glm::mat4 inverseViewProjection = glm::mat4(1.0f);
+        uint32_t samples = 1;
+    };
+}
+
+namespace RE {
+    namespace raytrace {
+        // 方向分量为 0 时用极小值代替，避免 0 * inf 产生 NaN
+        inline glm::vec3 safeInverse(const glm::vec3& d) {
+            constexpr float EPS = 1e-20f;
+            glm::vec3 r;
+            for (int i = 0; i < 3; i++) {
+                r[i] = 1.0f / (std::abs(d[i]) < EPS ? std::copysign(EPS, d[i]) : d[i]);
+            }
+            return r;
+        }
+
+#if defined(RE_SIMD_AVX2)
+        using vfloat = __m256;
+        RE_FORCEINLINE vfloat vset(float x) { return _mm256_set1_ps(x); }
+        RE_FORCEINLINE vfloat vbits(uint32_t x) { return _mm256_castsi256_ps(_mm256_set1_epi32(static_cast<int>(x))); }
+        RE_FORCEINLINE vfloat vload(const float* p) { return _mm256_load_ps(p); }
+        RE_FORCEINLINE void vstore(float* p, vfloat a) { _mm256_store_ps(p, a); }
+        RE_FORCEINLINE vfloat vadd(vfloat a, vfloat b) { return _mm256_add_ps(a, b); }
+        RE_FORCEINLINE vfloat vsub(vfloat a, vfloat b) { return _mm256_sub_ps(a, b); }
+        RE_FORCEINLINE vfloat vmul(vfloat a, vfloat b) { return _mm256_mul_ps(a, b); }
+        RE_FORCEINLINE vfloat vdiv(vfloat a, vfloat b) { return _mm256_div_ps(a, b); }
+        RE_FORCEINLINE vfloat vmin(vfloat a, vfloat b) { return _mm256_min_ps(a, b); }
+        RE_FORCEINLINE vfloat vmax(vfloat a, vfloat b) { return _mm256_max_ps(a, b); }
+        RE_FORCEINLINE vfloat vlt(vfloat a, vfloat b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+        RE_FORCEINLINE vfloat vle(vfloat a, vfloat b) { return _mm256_cmp_ps(a, b, _CMP_LE_OQ); }
+        RE_FORCEINLINE vfloat vneq(vfloat a, vfloat b) { return _mm256_cmp_ps(a, b, _CMP_NEQ_OQ); }
+        RE_FORCEINLINE vfloat vand(vfloat a, vfloat b) { return _mm256_and_ps(a, b); }
+        // mask ? a : b
+        RE_FORCEINLINE vfloat vselect(vfloat mask, vfloat a, vfloat b) { return _mm256_blendv_ps(b, a, mask); }
+        RE_FORCEINLINE uint32_t vmask(vfloat a) { return static_cast<uint32_t>(_mm256_movemask_ps(a)); }
+#elif defined(RE_SIMD_SSE2)
+        using vfloat = __m128;
+        RE_FORCEINLINE vfloat vset(float x) { return _mm_set1_ps(x); }
+        RE_FORCEINLINE vfloat vbits(uint32_t x) { return _mm_castsi128_ps(_mm_set1_epi32(static_cast<int>(x))); }
+        RE_FORCEINLINE vfloat vload(const float* p) { return _mm_load_ps(p); }
+        RE_FORCEINLINE void vstore(float* p, vfloat a) { _mm_store_ps(p, a); }
+        RE_FORCEINLINE vfloat vadd(vfloat a, vfloat b) { return _mm_add_ps(a, b); }
+        RE_FORCEINLINE vfloat vsub(vfloat a, vfloat b) { return _mm_sub_ps(a, b); }
+        RE_FORCEINLINE vfloat vmul(vfloat a, vfloat b) { return _mm_mul_ps(a, b); }
+        RE_FORCEINLINE vfloat vdiv(vfloat a, vfloat b) { return _mm_div_ps(a, b); }
+        RE_FORCEINLINE vfloat vmin(vfloat a, vfloat b) { return _mm_min_ps(a, b); }
+        RE_FORCEINLINE vfloat vmax(vfloat a, vfloat b) { return _mm_max_ps(a, b); }
+        RE_FORCEINLINE vfloat vlt(vfloat a, vfloat b) { return _mm_cmplt_ps(a, b); }
+        RE_FORCEINLINE vfloat vle(vfloat a, vfloat b) { return _mm_cmple_ps(a, b); }
+        RE_FORCEINLINE vfloat vneq(vfloat a, vfloat b) { return _mm_cmpneq_ps(a, b); }
+        RE_FORCEINLINE vfloat vand(vfloat a, vfloat b) { return _mm_and_ps(a, b); }
+        RE_FORCEINLINE vfloat vselect(vfloat mask, vfloat a, vfloat b) { return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); }
+        RE_FORCEINLINE uint32_t vmask(vfloat a) { return static_cast<uint32_t>(_mm_movemask_ps(a)); }
+#endif
+    }
+
+    inline bool RayHit::hit() const {
+        return triangle != MISS;
+    }
+
+    inline void RayPacket::set(size_t lane, const Ray& ray) {
+        ox[lane] = ray.origin.x;
+        oy[lane] = ray.origin.y;
+        oz[lane] = ray.origin.z;
+        dx[lane] = ray.direction.x;
+        dy[lane] = ray.direction.y;
+        dz[lane] = ray.direction.z;
+        tMin[lane] = ray.tMin;
+        tMax[lane] = ray.tMax;
+    }
+
+    inline void RayPacket::disable(size_t lane) {
+        set(lane, Ray());
+        tMin[lane] = 1.0f;
+        tMax[lane] = -1.0f;
+    }
+
+    inline Ray RayPacket::ray(size_t lane) const {
+        Ray r;
+        r.origin = glm::vec3(ox[lane], oy[lane], oz[lane]);
+        r.direction = glm::vec3(dx[lane], dy[lane], dz[lane]);
+        r.tMin = tMin[lane];
+        r.tMax = tMax[lane];
+        return r;
+    }
+
+    inline void TriangleBVH::clear() {
+        nodes.clear();
+        blocks.clear();
+        _triangleCount = 0;
+    }
+
+    inline size_t TriangleBVH::nodeCount() const {
+        return nodes.size();
+    }
+
+    inline size_t TriangleBVH::triangleCount() const {
+        return _triangleCount;
+    }
+
+    inline AABB TriangleBVH::bounds() const {
+        AABB box;
+        if (!nodes.empty()) {
+            const Node& root = nodes[0];
+            for (uint32_t s = 0; s < 4; s++) {
+                if (root.child[s] != INVALID) {
+                    box.expand(AABB(glm::vec3(root.minX[s], root.minY[s], root.minZ[s]), glm::vec3(root.maxX[s], root.maxY[s], root.maxZ[s])));
+                }
+            }
+        }
+        return box;
+    }
+
+    inline void TriangleBVH::build(const Mesh& mesh) {
+        RE_PROFILE_SCOPE("TriangleBVH::build");
+        clear();
+        source = &mesh;
+        const uint32_t count = static_cast<uint32_t>(mesh.triangleCount());
+        _triangleCount = count;
+        triangleBounds.resize(count);
+        centroids.resize(count);
+        refs.resize(count);
+        const uint32_t* indices = mesh.indices();
+#pragma omp parallel for schedule(static)
+        for (int64_t t = 0; t < static_cast<int64_t>(count); t++) {
+            AABB box;
+            for (int k = 0; k < 3; k++) {
+                box.expand(mesh.position(indices[t * 3 + k]));
+            }
+            triangleBounds[t] = box;
+            centroids[t] = box.center();
+            refs[t] = static_cast<uint32_t>(t);
+        }
+
+        if (count > 0) {
+            // 上层串行划分（划分本身并行分桶），不超过 JOB_SIZE 的子树各自独立构建，最后拼接
+            std::vector<BuildJob> jobs;
+            nodes.reserve(count / 2 + 1);
+            blocks.reserve(count / 2 + 1);
+            buildNode(0, count, 0, nodes, blocks, &jobs);
+
+            std::vector<std::vector<Node>> jobNodes(jobs.size());
+            std::vector<std::vector<TriangleBlock>> jobBlocks(jobs.size());
+#pragma omp parallel for schedule(dynamic)
+            for (int64_t j = 0; j < static_cast<int64_t>(jobs.size()); j++) {
+                const BuildJob& job = jobs[j];
+                buildNode(job.begin, job.end, job.depth, jobNodes[j], jobBlocks[j], nullptr);
+            }
+            for (size_t j = 0; j < jobs.size(); j++) {
+                const uint32_t nodeOffset = static_cast<uint32_t>(nodes.size());
+                const uint32_t blockOffset = static_cast<uint32_t>(blocks.size());
+                for (Node node : jobNodes[j]) {
+                    for (uint32_t s = 0; s < 4; s++) {
+                        if (node.child[s] != INVALID) {
+                            node.child[s] += node.count[s] > 0 ? blockOffset : nodeOffset;
+                        }
+                    }
+                    nodes.push_back(node);
+                }
+                blocks.insert(blocks.end(), jobBlocks[j].begin(), jobBlocks[j].end());
+                // 任务子树的根是其局部数组中的第 0 个节点
+                nodes[jobs[j].node].child[jobs[j].slot] = nodeOffset;
+            }
+        }
+
+        source = nullptr;
+        std::vector<AABB>().swap(triangleBounds);
+        std::vector<glm::vec3>().swap(centroids);
+        std::vector<uint32_t>().swap(refs);
+    }
+
+    inline void TriangleBVH::setSlot(Node& node, uint32_t s, const AABB& box, uint32_t child, uint32_t count) {
+        node.minX[s] = box.min.x;
+        node.minY[s] = box.min.y;
+        node.minZ[s] = box.min.z;
+        node.maxX[s] = box.max.x;
+        node.maxY[s] = box.max.y;
+        node.maxZ[s] = box.max.z;
+        node.child[s] = child;
+        node.count[s] = count;
+    }
+
+    inline AABB TriangleBVH::rangeBounds(uint32_t begin, uint32_t end) const {
+        AABB box;
+        for (uint32_t i = begin; i < end; i++) {
+            box.expand(triangleBounds[refs[i]]);
+        }
+        return box;
+    }
+
+    inline uint32_t TriangleBVH::buildNode(uint32_t begin, uint32_t end, uint32_t depth, std::vector<Node>& outNodes, std::vector<TriangleBlock>& outBlocks,
+                                           std::vector<BuildJob>* jobs) {
+        const uint32_t index = static_cast<uint32_t>(outNodes.size());
+        outNodes.emplace_back();
+
+        // 反复二分当前最大的区间，直到凑满 4 个子节点或者都已不超过叶子容量
+        uint32_t ranges[4][2] = {{begin, end}};
+        uint32_t n = 1;
+        while (n < 4) {
+            uint32_t pick = n, largest = LEAF_SIZE;
+            for (uint32_t r = 0; r < n; r++) {
+                if (ranges[r][1] - ranges[r][0] > largest) {
+                    largest = ranges[r][1] - ranges[r][0];
+                    pick = r;
+                }
+            }
+            if (pick == n) {
+                break;
+            }
+            const uint32_t mid = split(ranges[pick][0], ranges[pick][1], depth);
+            ranges[n][0] = mid;
+            ranges[n][1] = ranges[pick][1];
+            ranges[pick][1] = mid;
+            n++;
+        }
+
+        for (uint32_t s = 0; s < 4; s++) {
+            if (s >= n) {
+                setSlot(outNodes[index], s, AABB(), INVALID, 0);
+                continue;
+            }
+            const uint32_t b = ranges[s][0], e = ranges[s][1];
+            const AABB box = rangeBounds(b, e);
+            if (e - b <= LEAF_SIZE) {
+                const uint32_t block = makeLeaf(b, e, outBlocks);
+                setSlot(outNodes[index], s, box, block, e - b);
+            } else if (jobs != nullptr && e - b <= JOB_SIZE) {
+                // 子节点下标在任务完成后回填
+                jobs->push_back({b, e, depth + 1, index, s});
+                setSlot(outNodes[index], s, box, INVALID, 0);
+            } else {
+                // 递归时 outNodes 可能扩容，不能持有节点的引用
+                const uint32_t child = buildNode(b, e, depth + 1, outNodes, outBlocks, jobs);
+                setSlot(outNodes[index], s, box, child, 0);
+            }
+        }
+        return index;
+    }
+
+    inline uint32_t TriangleBVH::split(uint32_t begin, uint32_t end, uint32_t depth) {
+        // 分桶 SAH：三个轴各 16 个桶；上层的大区间并行分桶，任务内部（已在并行区域中）串行执行
+        constexpr int BINS = 16;
+        constexpr uint32_t PARALLEL_THRESHOLD = 1 << 16;
+        const bool parallel = end - begin >= PARALLEL_THRESHOLD;
+
+        AABB centerBounds;
+#pragma omp parallel if (parallel)
+        {
+            AABB local;
+#pragma omp for schedule(static) nowait
+            for (int64_t i = begin; i < static_cast<int64_t>(end); i++) {
+                local.expand(centroids[refs[i]]);
+            }
+#pragma omp critical
+            centerBounds.expand(local);
+        }
+        const glm::vec3 extent = centerBounds.max - centerBounds.min;
+        int axis = 0;
+        for (int a = 1; a < 3; a++) {
+            if (extent[a] > extent[axis]) {
+                axis = a;
+            }
+        }
+
+        int bestAxis = -1, bestBin = 0;
+        glm::vec3 scale(0.0f);
+        for (int a = 0; a < 3; a++) {
+            scale[a] = extent[a] > 0.0f ? BINS / extent[a] : 0.0f;
+        }
+        auto binOf = [&](uint32_t ref, int a) { return std::min(BINS - 1, static_cast<int>((centroids[ref][a] - centerBounds.min[a]) * scale[a])); };
+
+        if (depth < MAX_DEPTH && extent[axis] > 0.0f) {
+            struct Bins {
+                AABB box[3][BINS];
+                uint32_t count[3][BINS];
+            };
+            Bins bins{};
+#pragma omp parallel if (parallel)
+            {
+                Bins local{};
+#pragma omp for schedule(static) nowait
+                for (int64_t i = begin; i < static_cast<int64_t>(end); i++) {
+                    const uint32_t ref = refs[i];
+                    for (int a = 0; a < 3; a++) {
+                        const int b = binOf(ref, a);
+                        local.box[a][b].expand(triangleBounds[ref]);
+                        local.count[a][b]++;
+                    }
+                }
+#pragma omp critical
+                for (int a = 0; a < 3; a++) {
+                    for (int b = 0; b < BINS; b++) {
+                        bins.box[a][b].expand(local.box[a][b]);
+                        bins.count[a][b] += local.count[a][b];
+                    }
+                }
+            }
+
+            float bestCost = std::numeric_limits<float>::max();
+            for (int a = 0; a < 3; a++) {
+                if (!(extent[a] > 0.0f)) {
+                    continue;
+                }
+                float rightArea[BINS];
+                uint32_t rightCount[BINS];
+                AABB acc;
+                uint32_t accCount = 0;
+                for (int b = BINS - 1; b > 0; b--) {
+                    acc.expand(bins.box[a][b]);
+                    accCount += bins.count[a][b];
+                    rightArea[b] = acc.area();
+                    rightCount[b] = accCount;
+                }
+                acc = AABB();
+                accCount = 0;
+                for (int b = 0; b < BINS - 1; b++) {
+                    acc.expand(bins.box[a][b]);
+                    accCount += bins.count[a][b];
+                    if (accCount == 0 || rightCount[b + 1] == 0) {
+                        continue;
+                    }
+                    const float c = acc.area() * accCount + rightArea[b + 1] * rightCount[b + 1];
+                    if (c < bestCost) {
+                        bestCost = c;
+                        bestAxis = a;
+                        bestBin = b;
+                    }
+                }
+            }
+        }
+
+        if (bestAxis >= 0) {
+            const auto mid = std::partition(refs.begin() + begin, refs.begin() + end, [&](uint32_t ref) { return binOf(ref, bestAxis) <= bestBin; });
+            const uint32_t m = static_cast<uint32_t>(mid - refs.begin());
+            if (m > begin && m < end) {
+                return m;
+            }
+        }
+        // 没有合适的 SAH 划分或者树过深：沿最长轴按数量对半分
+        const uint32_t mid = begin + (end - begin) / 2;
+        std::nth_element(refs.begin() + begin, refs.begin() + mid, refs.begin() + end,
+                         [&](uint32_t a, uint32_t b) { return centroids[a][axis] < centroids[b][axis]; });
+        return mid;
+    }
+
+    inline uint32_t TriangleBVH::makeLeaf(uint32_t begin, uint32_t end, std::vector<TriangleBlock>& outBlocks) const {
+        TriangleBlock block{};
+        const uint32_t* indices = source->indices();
+        for (uint32_t k = 0; k < 4; k++) {
+            if (begin + k >= end) {
+                block.id[k] = INVALID;
+                continue;
+            }
+            const uint32_t t = refs[begin + k];
+            const glm::vec3 p0 = source->position(indices[t * 3]);
+            const glm::vec3 e1 = source->position(indices[t * 3 + 1]) - p0;
+            const glm::vec3 e2 = source->position(indices[t * 3 + 2]) - p0;
+            block.v0x[k] = p0.x;
+            block.v0y[k] = p0.y;
+            block.v0z[k] = p0.z;
+            block.e1x[k] = e1.x;
+            block.e1y[k] = e1.y;
+            block.e1z[k] = e1.z;
+            block.e2x[k] = e2.x;
+            block.e2y[k] = e2.y;
+            block.e2z[k] = e2.z;
+            block.id[k] = t;
+        }
+        outBlocks.push_back(block);
+        return static_cast<uint32_t>(outBlocks.size() - 1);
+    }
+
+    inline uint32_t TriangleBVH::intersectNode(const Node& node, const glm::vec3& o, const glm::vec3& inv, float tMin, float tMax, float* tNear) {
+        uint32_t mask = 0;
+#if defined(RE_SIMD_SSE2)
+        const __m128 ox = _mm_set1_ps(o.x), oy = _mm_set1_ps(o.y), oz = _mm_set1_ps(o.z);
+        const __m128 ix = _mm_set1_ps(inv.x), iy = _mm_set1_ps(inv.y), iz = _mm_set1_ps(inv.z);
+        const __m128 x0 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.minX), ox), ix), x1 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.maxX), ox), ix);
+        const __m128 y0 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.minY), oy), iy), y1 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.maxY), oy), iy);
+        const __m128 z0 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.minZ), oz), iz), z1 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.maxZ), oz), iz);
+        const __m128 enter = _mm_max_ps(_mm_max_ps(_mm_min_ps(x0, x1), _mm_min_ps(y0, y1)), _mm_max_ps(_mm_min_ps(z0, z1), _mm_set1_ps(tMin)));
+        const __m128 exit = _mm_min_ps(_mm_min_ps(_mm_max_ps(x0, x1), _mm_max_ps(y0, y1)), _mm_min_ps(_mm_max_ps(z0, z1), _mm_set1_ps(tMax)));
+        _mm_storeu_ps(tNear, enter);
+        mask = static_cast<uint32_t>(_mm_movemask_ps(_mm_cmple_ps(enter, exit)));
+#else
+        for (uint32_t s = 0; s < 4; s++) {
+            const float x0 = (node.minX[s] - o.x) * inv.x, x1 = (node.maxX[s] - o.x) * inv.x;
+            const float y0 = (node.minY[s] - o.y) * inv.y, y1 = (node.maxY[s] - o.y) * inv.y;
+            const float z0 = (node.minZ[s] - o.z) * inv.z, z1 = (node.maxZ[s] - o.z) * inv.z;
+            const float enter = std::max({std::min(x0, x1), std::min(y0, y1), std::min(z0, z1), tMin});
+            const float exit = std::min({std::max(x0, x1), std::max(y0, y1), std::max(z0, z1), tMax});
+            tNear[s] = enter;
+            mask |= (enter <= exit ? 1u : 0u) << s;
+        }
+#endif
+        // 空槽的包围盒为空盒，仍可能得到 enter <= exit，需要单独去掉
+        for (uint32_t s = 0; s < 4; s++) {
+            if (node.child[s] == INVALID) {
+                mask &= ~(1u << s);
+            }
+        }
+        return mask;
+    }
+
+    inline int TriangleBVH::intersectBlock(const TriangleBlock& block, const Ray& ray, float tMin, float& t, float& u, float& v) {
+        alignas(16) float tt[4], uu[4], vv[4];
+        uint32_t mask = 0;
+#if defined(RE_SIMD_SSE2)
+        const __m128 dX = _mm_set1_ps(ray.direction.x), dY = _mm_set1_ps(ray.direction.y), dZ = _mm_set1_ps(ray.direction.z);
+        const __m128 e1x = _mm_load_ps(block.e1x), e1y = _mm_load_ps(block.e1y), e1z = _mm_load_ps(block.e1z);
+        const __m128 e2x = _mm_load_ps(block.e2x), e2y = _mm_load_ps(block.e2y), e2z = _mm_load_ps(block.e2z);
+        // p = d x e2
+        const __m128 px = _mm_sub_ps(_mm_mul_ps(dY, e2z), _mm_mul_ps(dZ, e2y));
+        const __m128 py = _mm_sub_ps(_mm_mul_ps(dZ, e2x), _mm_mul_ps(dX, e2z));
+        const __m128 pz = _mm_sub_ps(_mm_mul_ps(dX, e2y), _mm_mul_ps(dY, e2x));
+        const __m128 det = _mm_add_ps(_mm_add_ps(_mm_mul_ps(e1x, px), _mm_mul_ps(e1y, py)), _mm_mul_ps(e1z, pz));
+        const __m128 invDet = _mm_div_ps(_mm_set1_ps(1.0f), det);
+        const __m128 sx = _mm_sub_ps(_mm_set1_ps(ray.origin.x), _mm_load_ps(block.v0x));
+        const __m128 sy = _mm_sub_ps(_mm_set1_ps(ray.origin.y), _mm_load_ps(block.v0y));
+        const __m128 sz = _mm_sub_ps(_mm_set1_ps(ray.origin.z), _mm_load_ps(block.v0z));
+        const __m128 bu = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(sx, px), _mm_mul_ps(sy, py)), _mm_mul_ps(sz, pz)), invDet);
+        // q = s x e1
+        const __m128 qx = _mm_sub_ps(_mm_mul_ps(sy, e1z), _mm_mul_ps(sz, e1y));
+        const __m128 qy = _mm_sub_ps(_mm_mul_ps(sz, e1x), _mm_mul_ps(sx, e1z));
+        const __m128 qz = _mm_sub_ps(_mm_mul_ps(sx, e1y), _mm_mul_ps(sy, e1x));
+        const __m128 bv = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dX, qx), _mm_mul_ps(dY, qy)), _mm_mul_ps(dZ, qz)), invDet);
+        const __m128 dist = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(e2x, qx), _mm_mul_ps(e2y, qy)), _mm_mul_ps(e2z, qz)), invDet);
+        const __m128 zero = _mm_setzero_ps();
+        __m128 ok = _mm_and_ps(_mm_cmpneq_ps(det, zero), _mm_and_ps(_mm_cmpge_ps(bu, zero), _mm_cmpge_ps(bv, zero)));
+        ok = _mm_and_ps(ok, _mm_cmple_ps(_mm_add_ps(bu, bv), _mm_set1_ps(1.0f)));
+        ok = _mm_and_ps(ok, _mm_and_ps(_mm_cmpgt_ps(dist, _mm_set1_ps(tMin)), _mm_cmplt_ps(dist, _mm_set1_ps(t))));
+        mask = static_cast<uint32_t>(_mm_movemask_ps(ok));
+        if (mask == 0) {
+            return -1;
+        }
+        _mm_store_ps(tt, dist);
+        _mm_store_ps(uu, bu);
+        _mm_store_ps(vv, bv);
+#else
+        const glm::vec3& d = ray.direction;
+        for (int k = 0; k < 4; k++) {
+            const glm::vec3 e1(block.e1x[k], block.e1y[k], block.e1z[k]), e2(block.e2x[k], block.e2y[k], block.e2z[k]);
+            const glm::vec3 p(d.y * e2.z - d.z * e2.y, d.z * e2.x - d.x * e2.z, d.x * e2.y - d.y * e2.x);
+            const float det = e1.x * p.x + e1.y * p.y + e1.z * p.z;
+            if (det == 0.0f) {
+                continue;
+            }
+            const float invDet = 1.0f / det;
+            const glm::vec3 s = ray.origin - glm::vec3(block.v0x[k], block.v0y[k], block.v0z[k]);
+            const glm::vec3 q(s.y * e1.z - s.z * e1.y, s.z * e1.x - s.x * e1.z, s.x * e1.y - s.y * e1.x);
+            uu[k] = (s.x * p.x + s.y * p.y + s.z * p.z) * invDet;
+            vv[k] = (d.x * q.x + d.y * q.y + d.z * q.z) * invDet;
+            tt[k] = (e2.x * q.x + e2.y * q.y + e2.z * q.z) * invDet;
+            if (uu[k] >= 0.0f && vv[k] >= 0.0f && uu[k] + vv[k] <= 1.0f && tt[k] > tMin && tt[k] < t) {
+                mask |= 1u << k;
+            }
+        }
+        if (mask == 0) {
+            return -1;
+        }
+#endif
+        int best = -1;
+        for (int k = 0; k < 4; k++) {
+            if ((mask >> k) & 1 && tt[k] < t) {
+                t = tt[k];
+                u = uu[k];
+                v = vv[k];
+                best = k;
+            }
+        }
+        return best;
+    }
+
+    template <bool ANY_HIT>
+    bool TriangleBVH::traverse(const Ray& ray, RayHit& hit) const {
+        if (nodes.empty()) {
+            return false;
+        }
+        const glm::vec3 inv = raytrace::safeInverse(ray.direction);
+        float t = ray.tMax, u = 0.0f, v = 0.0f;
+        uint32_t triangle = INVALID;
+        StackEntry stack[STACK_SIZE];
+        size_t sp = 0;
+        stack[sp++] = {0, 0, ray.tMin};
+        while (sp > 0) {
+            const StackEntry e = stack[--sp];
+            if (e.t > t) {
+                continue;
+            }
+            if (e.count > 0) {
+                const TriangleBlock& block = blocks[e.child];
+                const int lane = intersectBlock(block, ray, ray.tMin, t, u, v);
+                if (lane >= 0) {
+                    triangle = block.id[lane];
+                    if (ANY_HIT) {
+                        break;
+                    }
+                }
+                continue;
+            }
+            const Node& node = nodes[e.child];
+            float tNear[4];
+            const uint32_t mask = intersectNode(node, ray.origin, inv, ray.tMin, t, tNear);
+            // 相交的子节点按进入距离排序，远的先入栈
+            uint32_t slots[4];
+            int n = 0;
+            for (uint32_t s = 0; s < 4; s++) {
+                if (!((mask >> s) & 1)) {
+                    continue;
+                }
+                int j = n++;
+                for (; j > 0 && tNear[slots[j - 1]] > tNear[s]; j--) {
+                    slots[j] = slots[j - 1];
+                }
+                slots[j] = s;
+            }
+            for (int i = n - 1; i >= 0; i--) {
+                stack[sp++] = {node.child[slots[i]], node.count[slots[i]], tNear[slots[i]]};
+            }
+        }
+        if (triangle == INVALID) {
+            return false;
+        }
+        hit.t = t;
+        hit.u = u;
+        hit.v = v;
+        hit.triangle = triangle;
+        return true;
+    }
+
+    inline bool TriangleBVH::intersect(const Ray& ray, RayHit& hit) const {
+        return traverse<false>(ray, hit);
+    }
+
+    inline bool TriangleBVH::occluded(const Ray& ray) const {
+        RayHit hit;
+        return traverse<true>(ray, hit);
+    }
+
+    inline void TriangleBVH::intersect(const RayPacket& packet, RayHit* hits) const {
+        using namespace raytrace;
+        for (size_t k = 0; k < PACKET; k++) {
+            hits[k] = RayHit();
+        }
+#if defined(RE_SIMD_NONE)
+        // 没有 SIMD 时逐条追踪
+        for (size_t k = 0; k < PACKET; k++) {
+            const Ray r = packet.ray(k);
+            if (r.tMax >= r.tMin) {
+                intersect(r, hits[k]);
+            }
+        }
+#else
+        if (nodes.empty()) {
+            return;
+        }
+        alignas(32) float ix[PACKET], iy[PACKET], iz[PACKET];
+        for (size_t k = 0; k < PACKET; k++) {
+            const glm::vec3 inv = safeInverse(glm::vec3(packet.dx[k], packet.dy[k], packet.dz[k]));
+            ix[k] = inv.x;
+            iy[k] = inv.y;
+            iz[k] = inv.z;
+        }
+        const vfloat ox = vload(packet.ox), oy = vload(packet.oy), oz = vload(packet.oz);
+        const vfloat dX = vload(packet.dx), dY = vload(packet.dy), dZ = vload(packet.dz);
+        const vfloat invX = vload(ix), invY = vload(iy), invZ = vload(iz);
+        const vfloat tMin = vload(packet.tMin);
+        const vfloat zero = vset(0.0f), one = vset(1.0f);
+        // 每条光线当前最近的交点，tMax 随命中缩短
+        vfloat tMax = vload(packet.tMax), hitU = zero, hitV = zero, hitId = vbits(INVALID);
+        alignas(32) float lanes[PACKET];
+        auto horizontalMax = [&](vfloat a) {
+            vstore(lanes, a);
+            return *std::max_element(lanes, lanes + PACKET);
+        };
+        float packetMax = horizontalMax(tMax);
+
+        StackEntry stack[STACK_SIZE];
+        size_t sp = 0;
+        stack[sp++] = {0, 0, -std::numeric_limits<float>::infinity()};
+        while (sp > 0) {
+            const StackEntry e = stack[--sp];
+            if (e.t > packetMax) {
+                continue;
+            }
+            if (e.count > 0) {
+                // 一个三角形对整包光线测试，Möller-Trumbore
+                const TriangleBlock& block = blocks[e.child];
+                for (uint32_t k = 0; k < e.count; k++) {
+                    const vfloat e1x = vset(block.e1x[k]), e1y = vset(block.e1y[k]), e1z = vset(block.e1z[k]);
+                    const vfloat e2x = vset(block.e2x[k]), e2y = vset(block.e2y[k]), e2z = vset(block.e2z[k]);
+                    const vfloat px = vsub(vmul(dY, e2z), vmul(dZ, e2y));
+                    const vfloat py = vsub(vmul(dZ, e2x), vmul(dX, e2z));
+                    const vfloat pz = vsub(vmul(dX, e2y), vmul(dY, e2x));
+                    const vfloat det = vadd(vadd(vmul(e1x, px), vmul(e1y, py)), vmul(e1z, pz));
+                    const vfloat invDet = vdiv(one, det);
+                    const vfloat sx = vsub(ox, vset(block.v0x[k])), sy = vsub(oy, vset(block.v0y[k])), sz = vsub(oz, vset(block.v0z[k]));
+                    const vfloat bu = vmul(vadd(vadd(vmul(sx, px), vmul(sy, py)), vmul(sz, pz)), invDet);
+                    const vfloat qx = vsub(vmul(sy, e1z), vmul(sz, e1y));
+                    const vfloat qy = vsub(vmul(sz, e1x), vmul(sx, e1z));
+                    const vfloat qz = vsub(vmul(sx, e1y), vmul(sy, e1x));
+                    const vfloat bv = vmul(vadd(vadd(vmul(dX, qx), vmul(dY, qy)), vmul(dZ, qz)), invDet);
+                    const vfloat dist = vmul(vadd(vadd(vmul(e2x, qx), vmul(e2y, qy)), vmul(e2z, qz)), invDet);
+                    vfloat ok = vand(vneq(det, zero), vand(vle(zero, bu), vle(zero, bv)));
+                    ok = vand(ok, vand(vle(vadd(bu, bv), one), vand(vlt(tMin, dist), vlt(dist, tMax))));
+                    if (vmask(ok) == 0) {
+                        continue;
+                    }
+                    tMax = vselect(ok, dist, tMax);
+                    hitU = vselect(ok, bu, hitU);
+                    hitV = vselect(ok, bv, hitV);
+                    hitId = vselect(ok, vbits(block.id[k]), hitId);
+                }
+                packetMax = horizontalMax(tMax);
+                continue;
+            }
+
+            const Node& node = nodes[e.child];
+            uint32_t slots[4];
+            float keys[4];
+            int n = 0;
+            for (uint32_t s = 0; s < 4; s++) {
+                if (node.child[s] == INVALID) {
+                    continue;
+                }
+                const vfloat x0 = vmul(vsub(vset(node.minX[s]), ox), invX), x1 = vmul(vsub(vset(node.maxX[s]), ox), invX);
+                const vfloat y0 = vmul(vsub(vset(node.minY[s]), oy), invY), y1 = vmul(vsub(vset(node.maxY[s]), oy), invY);
+                const vfloat z0 = vmul(vsub(vset(node.minZ[s]), oz), invZ), z1 = vmul(vsub(vset(node.maxZ[s]), oz), invZ);
+                const vfloat enter = vmax(vmax(vmin(x0, x1), vmin(y0, y1)), vmax(vmin(z0, z1), tMin));
+                const vfloat exit = vmin(vmin(vmax(x0, x1), vmax(y0, y1)), vmin(vmax(z0, z1), tMax));
+                const uint32_t mask = vmask(vle(enter, exit));
+                if (mask == 0) {
+                    continue;
+                }
+                // 排序键为包内相交光线中最小的进入距离
+                vstore(lanes, enter);
+                float key = std::numeric_limits<float>::infinity();
+                for (size_t k = 0; k < PACKET; k++) {
+                    if ((mask >> k) & 1) {
+                        key = std::min(key, lanes[k]);
+                    }
+                }
+                int j = n++;
+                for (; j > 0 && keys[j - 1] > key; j--) {
+                    keys[j] = keys[j - 1];
+                    slots[j] = slots[j - 1];
+                }
+                keys[j] = key;
+                slots[j] = s;
+            }
+            for (int i = n - 1; i >= 0; i--) {
+                stack[sp++] = {node.child[slots[i]], node.count[slots[i]], keys[i]};
+            }
+        }
+
+        alignas(32) float outT[PACKET], outU[PACKET], outV[PACKET], outId[PACKET];
+        vstore(outT, tMax);
+        vstore(outU, hitU);
+        vstore(outV, hitV);
+        vstore(outId, hitId);
+        for (size_t k = 0; k < PACKET; k++) {
+            uint32_t id;
+            std::memcpy(&id, &outId[k], sizeof(id));
+            if (id != INVALID) {
+                hits[k].t = outT[k];
+                hits[k].u = outU[k];
+                hits[k].v = outV[k];
+                hits[k].triangle = id;
+            }
+        }
+#endif
+    }
+
+    inline void RayTracer::setScene(const Mesh* m) {
+        mesh = m;
+        if (mesh != nullptr) {
+            _bvh.build(*mesh);
+        } else {
+            _bvh.clear();
+        }
+    }
+
+    inline const Mesh* RayTracer::scene() const {
+        return mesh;
+    }
+
+    inline const TriangleBVH& RayTracer::bvh() const {
+        return _bvh;
+    }
+
+    inline void RayTracer::setCamera(const glm::mat4& viewProjection) {
+        inverseViewProjection = glm::inverse(viewProjection);
+    }
+
+    inline void RayTracer::setSamplesPerPixel(uint32_t s) {
+        samples = std::max(1u, s);
+    }
+
+    inline Ray RayTracer::primaryRay(float x, float y, size_t width, size_t height) const {
+        // 与 VertexStage 的视口变换互逆：屏幕 y 向下，NDC y 向上
+        const float nx = x / width * 2.0f - 1.0f;
+        const float ny = 1.0f - y / height * 2.0f;
+        glm::vec4 p0 = inverseViewProjection * glm::vec4(nx, ny, 0.0f, 1.0f);
+        glm::vec4 p1 = inverseViewProjection * glm::vec4(nx, ny, 1.0f, 1.0f);
+        const glm::vec3 a = glm::vec3(p0) / p0.w, b = glm::vec3(p1) / p1.w;
+        Ray ray;
+        ray.origin = a;
+        ray.tMax = glm::length(b - a);
+        ray.direction = (b - a) / ray.tMax;
+        return ray;
+    }
+
+    inline glm::vec3 RayTracer::normal(const RayHit& hit) const {
+        const uint32_t* indices = mesh->indices() + hit.triangle * 3;
+        if (mesh->hasNormals()) {
+            const glm::vec3 n = mesh->normal(indices[0]) * (1.0f - hit.u - hit.v) + mesh->normal(indices[1]) * hit.u + mesh->normal(indices[2]) * hit.v;
+            const float len = glm::length(n);
+            if (len > 0.0f) {
+                return n / len;
+            }
+        }
+        const glm::vec3 p0 = mesh->position(indices[0]);
+        return glm::normalize(glm::cross(mesh->position(indices[1]) - p0, mesh->position(indices[2]) - p0));
+    }
+
+    template <typename SHADER_T>
+    void RayTracer::render(HDRTexture& target, SHADER_T shader) const {
+        RE_PROFILE_SCOPE("RayTracer::render");
+        using raytrace::PACKET;
+        // 光线包覆盖的像素块：8 条光线为 4x2，4 条光线为 2x2
+        constexpr size_t PACKET_W = PACKET / 2, PACKET_H = 2;
+        const size_t width = target.width(), height = target.height();
+        const size_t channel = std::min<size_t>(target.channel(), 4);
+        const size_t tilesX = (width + TILE - 1) / TILE;
+        const size_t tilesY = (height + TILE - 1) / TILE;
+        const float weight = 1.0f / samples;
+
+#pragma omp parallel for schedule(dynamic)
+        for (int64_t tile = 0; tile < static_cast<int64_t>(tilesX * tilesY); tile++) {
+            const size_t x0 = (tile % tilesX) * TILE;
+            const size_t y0 = (tile / tilesX) * TILE;
+            const size_t x1 = std::min(x0 + TILE, width);
+            const size_t y1 = std::min(y0 + TILE, height);
+            hrgba accum[TILE * TILE];
+            std::fill(accum, accum + TILE * TILE, hrgba(0.0f));
+            RayPacket packet;
+            RayHit hits[PACKET];
+
+            for (uint32_t s = 0; s < samples; s++) {
+                const glm::vec2 offset = samples > 1 ? jitterSequence(s, samples) : glm::vec2(0.0f);
+                for (size_t py = y0; py < y1; py += PACKET_H) {
+                    for (size_t px = x0; px < x1; px += PACKET_W) {
+                        for (size_t k = 0; k < PACKET; k++) {
+                            const size_t x = px + k % PACKET_W, y = py + k / PACKET_W;
+                            if (x < x1 && y < y1) {
+                                packet.set(k, primaryRay(x + 0.5f + offset.x, y + 0.5f + offset.y, width, height));
+                            } else {
+                                packet.disable(k);
+                            }
+                        }
+                        _bvh.intersect(packet, hits);
+                        for (size_t k = 0; k < PACKET; k++) {
+                            const size_t x = px + k % PACKET_W, y = py + k / PACKET_W;
+                            if (x < x1 && y < y1) {
+                                const RayFragment fragment{x, y, packet.ray(k), hits[k]};
+                                accum[(y - y0) * TILE + (x - x0)] += hrgba(shader(fragment)) * weight;
+                            }
+                        }
+                    }
+                }
+            }
+
+            float* out = target.data();
+            for (size_t y = y0; y < y1; y++) {
+                for (size_t x = x0; x < x1; x++) {
+                    const hrgba& c = accum[(y - y0) * TILE + (x - x0)];
+                    float* pixel = out + target.getIndex(x, y);
+                    for (size_t k = 0; k < channel; k++) {
+                        pixel[k] = c[static_cast<int>(k)];
+                    }
+                }
+            }
+        }
+    }
+
+    inline void RayTracer::render(HDRTexture& target) const {
+        render(target, [this](const RayFragment& f) {
+            if (!f.hit.hit()) {
+                return hrgba(0.0f, 0.0f, 0.0f, 1.0f);
+            }
+            const float c = std::abs(glm::dot(normal(f.hit), f.ray.direction));
+            return hrgba(c, c, c, 1.0f);
+        });
+    }
+}
@@ -0,0 +1,287 @@
+#pragma once
+#include "RE_includes.h"
+#include "RE_Buffer3D.hpp"
+#include "RE_Texture.hpp"
+
+namespace RE {
+    // 多重采样的采样位置（相对像素中心，单位为像素），2x/4x/8x 使用旋转网格，1x 为像素中心
+    const glm::vec2* samplePattern(size_t samples);
+
+    // 多重采样渲染目标
+    // 每个像素的采样颜色统一按 4 通道存放（一个采样正好是一个 SIMD 单元），深度每个采样单独保存
+    // 压缩：像素被完整覆盖时只写第 0 个采样并标记为 uniform，resolve 时直接拷贝；部分覆盖时才展开成逐采样存储
+    template <typename T>
+    class MultisampleTarget {
+    public:
+        static constexpr size_t SAMPLE_CHANNEL = 4;
+        static constexpr size_t MAX_SAMPLES = 8;
+
+        MultisampleTarget();
+        MultisampleTarget(size_t width, size_t height, size_t samples);
+
+        void setSize(size_t width, size_t height, size_t samples);
+        // uint8_t 目标的颜色按 [0, 1] 给出
+        void clear(hrgba color, float depth = 1.0f);
+
+        size_t width() const;
+        size_t height() const;
+        size_t samples() const;
+        const glm::vec2* samplePositions() const;
+
+        bool uniform(size_t x, size_t y) const;
+        T* sampleData(size_t x, size_t y);              // samples * SAMPLE_CHANNEL 个元素
+        float* depthData(size_t x, size_t y);           // samples 个深度
+        const T* sampleData(size_t x, size_t y) const;
+        const float* depthData(size_t x, size_t y) const;
+
+        // 所有采样写同一个颜色（压缩存储）
+        void writeUniform(size_t x, size_t y, const T* color);
+        // 只写 mask 中的采样，uniform 像素会先展开
+        void writeSamples(size_t x, size_t y, uint32_t mask, const T* color);
+
+        // 平均各采样到 dst（通道数取 dst 的，最多 4），按行多线程，uniform 像素直接拷贝
+        void resolve(TextureBase<T>& dst) const;
+
+        Buffer3D<T>& colorBuffer();
+        Buffer3D<float>& depthBuffer();
+
+    private:
+        size_t _samples = 1;
+        Buffer3D<T> color{0, 0, 0};
+        Buffer3D<float> depth{0, 0, 0};
+        Buffer3D<uint8_t> uniformFlag{0, 0, 0};
+
+        void expand(size_t x, size_t y);
+        static void resolvePixel(const T* in, T* out, size_t samples, size_t channel);
+    };
+}
+
+namespace RE {
+    inline const glm::vec2* samplePattern(size_t samples) {
+        // 与 D3D 标准采样位置一致（1/16 像素为单位）
+        static const glm::vec2 pattern1[] = {{0.0f, 0.0f}};
+        static const glm::vec2 pattern2[] = {{4 / 16.0f, 4 / 16.0f}, {-4 / 16.0f, -4 / 16.0f}};
+        static const glm::vec2 pattern4[] = {{-2 / 16.0f, -6 / 16.0f}, {6 / 16.0f, -2 / 16.0f}, {-6 / 16.0f, 2 / 16.0f}, {2 / 16.0f, 6 / 16.0f}};
+        static const glm::vec2 pattern8[] = {{1 / 16.0f, -3 / 16.0f}, {-1 / 16.0f, 3 / 16.0f}, {5 / 16.0f, 1 / 16.0f}, {-3 / 16.0f, -5 / 16.0f},
+                                             {-5 / 16.0f, 5 / 16.0f}, {-7 / 16.0f, -1 / 16.0f}, {3 / 16.0f, 7 / 16.0f}, {7 / 16.0f, -7 / 16.0f}};
+        switch (samples) {
+        case 2:
+            return pattern2;
+        case 4:
+            return pattern4;
+        case 8:
+            return pattern8;
+        default:
+            return pattern1;
+        }
+    }
+
+    template <typename T>
+    MultisampleTarget<T>::MultisampleTarget() {}
+
+    template <typename T>
+    MultisampleTarget<T>::MultisampleTarget(size_t width, size_t height, size_t samples) {
+        setSize(width, height, samples);
+    }
+
+    template <typename T>
+    void MultisampleTarget<T>::setSize(size_t width, size_t height, size_t samples) {
+        if (samples != 1 && samples != 2 && samples != 4 && samples != 8) {
+            std::cerr << "MultisampleTarget Error: unsupported sample count " << samples << ", using 4" << std::endl;
+            samples = 4;
+        }
+        _samples = samples;
+        color.setSize(width, height, samples * SAMPLE_CHANNEL);
+        depth.setSize(width, height, samples);
+        uniformFlag.setSize(width, height, 1);
+    }
+
+    template <typename T>
+    void MultisampleTarget<T>::clear(hrgba c, float d) {
+        const float unit = std::is_integral_v<T> ? 255.0f : 1.0f;
+        T value[SAMPLE_CHANNEL];
+        for (size_t k = 0; k < SAMPLE_CHANNEL; k++) {
+            value[k] = std::is_integral_v<T> ? static_cast<T>(RE::camp(c[k], 0.0f, 1.0f) * unit + 0.5f) : static_cast<T>(c[k]);
+        }
+        const int64_t h = static_cast<int64_t>(height());
+#pragma omp parallel for
+        for (int64_t y = 0; y < h; y++) {
+            for (size_t x = 0; x < width(); x++) {
+                memcpy(sampleData(x, y), value, sizeof(value));
+            }
+            std::fill(depth.data() + depth.getIndex(0, y), depth.data() + depth.getIndex(0, y + 1), d);
+            memset(uniformFlag.data() + uniformFlag.getIndex(0, y), 1, width());
+        }
+    }
+
+    template <typename T>
+    size_t MultisampleTarget<T>::width() const {
+        return color.width();
+    }
+
+    template <typename T>
+    size_t MultisampleTarget<T>::height() const {
+        return color.height();
+    }
+
+    template <typename T>
+    size_t MultisampleTarget<T>::samples() const {
+        return _samples;
+    }
+
+    template <typename T>
+    const glm::vec2* MultisampleTarget<T>::samplePositions() const {
+        return samplePattern(_samples);
+    }
+
+    template <typename T>
+    bool MultisampleTarget<T>::uniform(size_t x, size_t y) const {
+        return uniformFlag.data()[y * width() + x] != 0;
+    }
+
+    template <typename T>
+    T* MultisampleTarget<T>::sampleData(size_t x, size_t y) {
+        return color.data() + color.getIndex(x, y);
+    }
+
+    template <typename T>
+    const T* MultisampleTarget<T>::sampleData(size_t x, size_t y) const {
+        return color.data() + color.getIndex(x, y);
+    }
+
+    template <typename T>
+    float* MultisampleTarget<T>::depthData(size_t x, size_t y) {
+        return depth.data() + depth.getIndex(x, y);
+    }
+
+    template <typename T>
+    const float* MultisampleTarget<T>::depthData(size_t x, size_t y) const {
+        return depth.data() + depth.getIndex(x, y);
+    }
+
+    template <typename T>
+    void MultisampleTarget<T>::expand(size_t x, size_t y) {
+        uint8_t& flag = uniformFlag.data()[y * width() + x];
+        if (flag == 0) {
+            return;
+        }
+        T* s = sampleData(x, y);
+        for (size_t i = 1; i < _samples; i++) {
+            memcpy(s + i * SAMPLE_CHANNEL, s, SAMPLE_CHANNEL * sizeof(T));
+        }
+        flag = 0;
+    }
+
+    template <typename T>
+    void MultisampleTarget<T>::writeUniform(size_t x, size_t y, const T* c) {
+        memcpy(sampleData(x, y), c, SAMPLE_CHANNEL * sizeof(T));
+        uniformFlag.data()[y * width() + x] = 1;
+    }
+
+    template <typename T>
+    void MultisampleTarget<T>::writeSamples(size_t x, size_t y, uint32_t mask, const T* c) {
+        const uint32_t full = (1u << _samples) - 1;
+        if ((mask & full) == full) {
+            writeUniform(x, y, c);
+            return;
+        }
+        expand(x, y);
+        T* s = sampleData(x, y);
+        for (size_t i = 0; i < _samples; i++) {
+            if (mask & (1u << i)) {
+                memcpy(s + i * SAMPLE_CHANNEL, c, SAMPLE_CHANNEL * sizeof(T));
+            }
+        }
+    }
+
+    template <typename T>
+    void MultisampleTarget<T>::resolvePixel(const T* in, T* out, size_t samples, size_t channel) {
+        if constexpr (std::is_same_v<T, uint8_t>) {
+#if defined(RE_SIMD_SSE2)
+            // 每 16 字节是 4 个采样，先扩展到 16 位累加，再把 4 个采样的和折叠到一起
+            if (samples >= 4) {
+                const __m128i zero = _mm_setzero_si128();
+                __m128i sum = zero;
+                for (size_t i = 0; i < samples; i += 4) {
+                    const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i * SAMPLE_CHANNEL));
+                    sum = _mm_add_epi16(sum, _mm_add_epi16(_mm_unpacklo_epi8(v, zero), _mm_unpackhi_epi8(v, zero)));
+                }
+                sum = _mm_add_epi16(sum, _mm_srli_si128(sum, 8));
+                const int shift = (samples == 8) ? 3 : 2;
+                sum = _mm_srli_epi16(_mm_add_epi16(sum, _mm_set1_epi16(static_cast<short>(samples / 2))), shift);
+                const uint32_t packed = static_cast<uint32_t>(_mm_cvtsi128_si32(_mm_packus_epi16(sum, sum)));
+                uint8_t bytes[4];
+                memcpy(bytes, &packed, 4);
+                memcpy(out, bytes, channel);
+                return;
+            }
+#endif
+            for (size_t k = 0; k < channel; k++) {
+                uint32_t sum = 0;
+                for (size_t i = 0; i < samples; i++) {
+                    sum += in[i * SAMPLE_CHANNEL + k];
+                }
+                out[k] = static_cast<uint8_t>((sum + samples / 2) / samples);
+            }
+        } else if constexpr (std::is_same_v<T, float>) {
+#if defined(RE_SIMD_SSE2)
+            __m128 sum = _mm_loadu_ps(in);
+            for (size_t i = 1; i < samples; i++) {
+                sum = _mm_add_ps(sum, _mm_loadu_ps(in + i * SAMPLE_CHANNEL));
+            }
+            float result[4];
+            _mm_storeu_ps(result, _mm_mul_ps(sum, _mm_set1_ps(1.0f / samples)));
+            memcpy(out, result, channel * sizeof(float));
+#else
+            for (size_t k = 0; k < channel; k++) {
+                float sum = 0.0f;
+                for (size_t i = 0; i < samples; i++) {
+                    sum += in[i * SAMPLE_CHANNEL + k];
+                }
+                out[k] = sum / samples;
+            }
+#endif
+        } else {
+            for (size_t k = 0; k < channel; k++) {
+                double sum = 0.0;
+                for (size_t i = 0; i < samples; i++) {
+                    sum += in[i * SAMPLE_CHANNEL + k];
+                }
+                out[k] = static_cast<T>(sum / samples);
+            }
+        }
+    }
+
+    template <typename T>
+    void MultisampleTarget<T>::resolve(TextureBase<T>& dst) const {
+        const size_t w = width(), h = height();
+        const size_t c = std::min<size_t>(dst.channel() == 0 ? 3 : dst.channel(), SAMPLE_CHANNEL);
+        if (dst.width() != w || dst.height() != h || dst.channel() != c) {
+            dst.setSize(w, h, c);
+        }
+        T* out = dst.data();
+#pragma omp parallel for
+        for (int64_t y = 0; y < static_cast<int64_t>(h); y++) {
+            const uint8_t* flags = uniformFlag.data() + y * w;
+            T* target = out + dst.getIndex(0, y);
+            for (size_t x = 0; x < w; x++) {
+                const T* s = sampleData(x, y);
+                if (flags[x] || _samples == 1) {
+                    memcpy(target + x * c, s, c * sizeof(T));
+                } else {
+                    resolvePixel(s, target + x * c, _samples, c);
+                }
+            }
+        }
+    }
+
+    template <typename T>
+    Buffer3D<T>& MultisampleTarget<T>::colorBuffer() {
+        return color;
+    }
+
+    template <typename T>
+    Buffer3D<float>& MultisampleTarget<T>::depthBuffer() {
+        return depth;
+    }
+}
@@ -0,0 +1,254 @@
+#pragma once
+#include "RE_includes.h"
+#include "RE_RenderTarget.hpp"
+
+namespace RE {
+    // 光栅化输入的顶点：position.xy 为屏幕像素坐标，z 为 [0, 1] 深度（越小越近），w 为 1 / w_clip（透视校正插值用）
+    struct RasterVertex {
+        glm::vec4 position = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+        hrgba color = hrgba(1.0f);
+        glm::vec2 velocity = glm::vec2(0.0f); // 屏幕空间运动向量（当前帧 - 上一帧，像素），写入速度缓冲
+    };
+
+    // 每个像素着色一次时传给着色函数的信息，b0/b1/b2 为透视校正后的重心坐标
+    struct RasterFragment {
+        size_t x, y;
+        float b0, b1, b2;
+        float depth;
+    };
+
+    // 第 index 帧的亚像素抖动（Halton(2, 3) 序列，范围 [-0.5, 0.5)），用于时间抗锯齿
+    glm::vec2 jitterSequence(uint32_t index, uint32_t period = 16);
+
+    // 三角形光栅化到多重采样目标
+    // 覆盖与深度按采样计算，着色每个像素只做一次（像素中心未覆盖时取第一个被覆盖的采样位置）
+    template <typename T>
+    class Rasterizer {
+    public:
+        explicit Rasterizer(MultisampleTarget<T>* target);
+
+        void setTarget(MultisampleTarget<T>* target);
+        void setCullBackFace(bool cull); // 屏幕空间顺时针（y 向下）为正面
+        void setDepthTest(bool test);
+        // 所有顶点的屏幕坐标加上该偏移（像素），运动向量不受影响
+        void setJitter(glm::vec2 jitter);
+        glm::vec2 jitter() const;
+        // 速度缓冲（与目标同尺寸，2 通道），每个被绘制的像素写入插值后的运动向量，nullptr 关闭
+        void setVelocityTarget(Buffer3D<float>* velocity);
+
+        // 顶点颜色插值
+        void drawTriangle(const RasterVertex& v0, const RasterVertex& v1, const RasterVertex& v2);
+        // shader(const RasterFragment&) -> hrgba
+        template <typename SHADER_T>
+        void drawTriangle(const RasterVertex& v0, const RasterVertex& v1, const RasterVertex& v2, SHADER_T shader);
+
+    private:
+        MultisampleTarget<T>* target;
+        bool cullBackFace = false;
+        bool depthTest = true;
+        glm::vec2 _jitter = glm::vec2(0.0f);
+        Buffer3D<float>* velocityTarget = nullptr;
+    };
+}
+
+namespace RE {
+    inline glm::vec2 jitterSequence(uint32_t index, uint32_t period) {
+        auto halton = [](uint32_t i, uint32_t base) {
+            float f = 1.0f, r = 0.0f;
+            for (; i > 0; i /= base) {
+                f /= base;
+                r += f * (i % base);
+            }
+            return r;
+        };
+        // 从 1 开始，避开 (0, 0)
+        const uint32_t i = (period == 0 ? index : index % period) + 1;
+        return glm::vec2(halton(i, 2), halton(i, 3)) - 0.5f;
+    }
+
+    template <typename T>
+    Rasterizer<T>::Rasterizer(MultisampleTarget<T>* target) : target(target) {}
+
+    template <typename T>
+    void Rasterizer<T>::setTarget(MultisampleTarget<T>* t) {
+        target = t;
+    }
+
+    template <typename T>
+    void Rasterizer<T>::setCullBackFace(bool cull) {
+        cullBackFace = cull;
+    }
+
+    template <typename T>
+    void Rasterizer<T>::setDepthTest(bool test) {
+        depthTest = test;
+    }
+
+    template <typename T>
+    void Rasterizer<T>::setJitter(glm::vec2 jitter) {
+        _jitter = jitter;
+    }
+
+    template <typename T>
+    glm::vec2 Rasterizer<T>::jitter() const {
+        return _jitter;
+    }
+
+    template <typename T>
+    void Rasterizer<T>::setVelocityTarget(Buffer3D<float>* velocity) {
+        velocityTarget = velocity;
+    }
+
+    template <typename T>
+    void Rasterizer<T>::drawTriangle(const RasterVertex& v0, const RasterVertex& v1, const RasterVertex& v2) {
+        drawTriangle(v0, v1, v2, [&](const RasterFragment& f) {
+            return v0.color * f.b0 + v1.color * f.b1 + v2.color * f.b2;
+        });
+    }
+
+    template <typename T>
+    template <typename SHADER_T>
+    void Rasterizer<T>::drawTriangle(const RasterVertex& v0, const RasterVertex& v1, const RasterVertex& v2, SHADER_T shader) {
+        const glm::vec4 offset(_jitter.x, _jitter.y, 0.0f, 0.0f);
+        const glm::vec4 jittered[3] = {v0.position + offset, v1.position + offset, v2.position + offset};
+        const glm::vec4* p[3] = {&jittered[0], &jittered[1], &jittered[2]};
+        // 边函数 E_ab(x, y) = A * x + B * y + C，三条边分别对着顶点 2、0、1
+        float area = (p[1]->x - p[0]->x) * (p[2]->y - p[0]->y) - (p[1]->y - p[0]->y) * (p[2]->x - p[0]->x);
+        if (area == 0.0f || !(area == area) || (cullBackFace && area < 0.0f)) {
+            return;
+        }
+        // 逆时针时交换两个顶点，保证面积为正，重心坐标再换回来
+        int order[3] = {0, 1, 2};
+        if (area < 0.0f) {
+            std::swap(order[1], order[2]);
+            area = -area;
+        }
+        const glm::vec4& a = *p[order[0]];
+        const glm::vec4& b = *p[order[1]];
+        const glm::vec4& c = *p[order[2]];
+
+        struct Edge {
+            float A, B, C;
+            bool inclusive; // 共享边的归属规则：A > 0，或 A == 0 且 B > 0 的边包含边上的采样
+        };
+        auto makeEdge = [](const glm::vec4& from, const glm::vec4& to) {
+            Edge e;
+            e.A = from.y - to.y;
+            e.B = to.x - from.x;
+            e.C = -(e.A * from.x + e.B * from.y);
+            e.inclusive = e.A > 0.0f || (e.A == 0.0f && e.B > 0.0f);
+            return e;
+        };
+        // edges[i] 对应重心坐标 i（与顶点 i 相对的边）
+        const Edge edges[3] = {makeEdge(b, c), makeEdge(c, a), makeEdge(a, b)};
+        const float invArea = 1.0f / area;
+
+        const int64_t w = static_cast<int64_t>(target->width());
+        const int64_t h = static_cast<int64_t>(target->height());
+        const int64_t minX = std::max<int64_t>(0, static_cast<int64_t>(std::floor(std::min({a.x, b.x, c.x}))));
+        const int64_t minY = std::max<int64_t>(0, static_cast<int64_t>(std::floor(std::min({a.y, b.y, c.y}))));
+        const int64_t maxX = std::min<int64_t>(w - 1, static_cast<int64_t>(std::ceil(std::max({a.x, b.x, c.x}))));
+        const int64_t maxY = std::min<int64_t>(h - 1, static_cast<int64_t>(std::ceil(std::max({a.y, b.y, c.y}))));
+        if (minX > maxX || minY > maxY) {
+            return;
+        }
+
+        const size_t samples = target->samples();
+        const glm::vec2* pattern = target->samplePositions();
+        // 采样相对像素中心的边函数增量
+        float sampleOffset[3][MultisampleTarget<T>::MAX_SAMPLES];
+        for (int i = 0; i < 3; i++) {
+            for (size_t s = 0; s < samples; s++) {
+                sampleOffset[i][s] = edges[i].A * pattern[s].x + edges[i].B * pattern[s].y;
+            }
+        }
+        const float unit = std::is_integral_v<T> ? 255.0f : 1.0f;
+        const float z[3] = {a.z, b.z, c.z};
+        const float invW[3] = {a.w, b.w, c.w};
+
+        for (int64_t y = minY; y <= maxY; y++) {
+            const float cy = y + 0.5f;
+            for (int64_t x = minX; x <= maxX; x++) {
+                const float cx = x + 0.5f;
+                float e[3];
+                for (int i = 0; i < 3; i++) {
+                    e[i] = edges[i].A * cx + edges[i].B * cy + edges[i].C;
+                }
+
+                // 覆盖与深度测试
+                uint32_t mask = 0;
+                int firstSample = -1;
+                float* depth = target->depthData(x, y);
+                float sampleZ[MultisampleTarget<T>::MAX_SAMPLES];
+                for (size_t s = 0; s < samples; s++) {
+                    bool inside = true;
+                    float l[3];
+                    for (int i = 0; i < 3 && inside; i++) {
+                        const float v = e[i] + sampleOffset[i][s];
+                        inside = v > 0.0f || (v == 0.0f && edges[i].inclusive);
+                        l[i] = v * invArea;
+                    }
+                    if (!inside) {
+                        continue;
+                    }
+                    sampleZ[s] = l[0] * z[0] + l[1] * z[1] + l[2] * z[2];
+                    if (depthTest && !(sampleZ[s] < depth[s])) {
+                        continue;
+                    }
+                    mask |= 1u << s;
+                    if (firstSample < 0) {
+                        firstSample = static_cast<int>(s);
+                    }
+                }
+                if (mask == 0) {
+                    continue;
+                }
+
+                // 着色点：像素中心在三角形内时用中心，否则用第一个通过的采样
+                float l[3] = {e[0] * invArea, e[1] * invArea, e[2] * invArea};
+                if (l[0] < 0.0f || l[1] < 0.0f || l[2] < 0.0f) {
+                    for (int i = 0; i < 3; i++) {
+                        l[i] = (e[i] + sampleOffset[i][firstSample]) * invArea;
+                    }
+                }
+                // 透视校正：按 1/w 加权后归一化
+                float pw[3] = {l[0] * invW[0], l[1] * invW[1], l[2] * invW[2]};
+                const float sum = pw[0] + pw[1] + pw[2];
+                if (sum != 0.0f) {
+                    pw[0] /= sum;
+                    pw[1] /= sum;
+                    pw[2] /= sum;
+                }
+                // 换回调用者的顶点顺序
+                float bary[3];
+                bary[order[0]] = pw[0];
+                bary[order[1]] = pw[1];
+                bary[order[2]] = pw[2];
+                const RasterFragment fragment{static_cast<size_t>(x), static_cast<size_t>(y), bary[0], bary[1], bary[2],
+                                              l[0] * z[0] + l[1] * z[1] + l[2] * z[2]};
+                const hrgba color = shader(fragment);
+
+                T packed[MultisampleTarget<T>::SAMPLE_CHANNEL];
+                for (size_t k = 0; k < MultisampleTarget<T>::SAMPLE_CHANNEL; k++) {
+                    if constexpr (std::is_integral_v<T>) {
+                        packed[k] = static_cast<T>(RE::camp(color[k], 0.0f, 1.0f) * unit + 0.5f);
+                    } else {
+                        packed[k] = static_cast<T>(color[k]);
+                    }
+                }
+                target->writeSamples(x, y, mask, packed);
+                for (size_t s = 0; s < samples; s++) {
+                    if (mask & (1u << s)) {
+                        depth[s] = sampleZ[s];
+                    }
+                }
+                if (velocityTarget != nullptr && static_cast<size_t>(x) < velocityTarget->width() && static_cast<size_t>(y) < velocityTarget->height()) {
+                    const glm::vec2 v = v0.velocity * bary[0] + v1.velocity * bary[1] + v2.velocity * bary[2];
+                    float* out = velocityTarget->data() + velocityTarget->getIndex(x, y);
+                    out[0] = v.x;
+                    out[1] = v.y;
+                }
+            }
+        }
+    }
+}
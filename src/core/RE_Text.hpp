@@ -0,0 +1,515 @@
+#pragma once
+#include "RE_includes.h"
+#include "RE_Texture.hpp"
+#include "RE_file.h"
+#include <string_view>
+
+namespace RE {
+    // 解码 text[i] 开始的一个 UTF-8 字符并前进 i，非法序列返回 U+FFFD
+    uint32_t decodeUTF8(std::string_view text, size_t& i);
+
+    // TTF 字体，文件通过内存映射常驻。size 均为像素高度（ascent - descent）
+    // ASCII 的字形编号、步进和字距在加载时预先查好，排版热路径不再访问字体表
+    class Font {
+    public:
+        Font() = default;
+        Font(const Font&) = delete;
+        Font& operator=(const Font&) = delete;
+
+        bool loadFromFile(const char* filename, int index = 0);
+        // 复制一份数据，data 调用后即可释放
+        bool loadFromMemory(const uint8_t* data, size_t size, int index = 0);
+        bool valid() const;
+        // 每次成功加载都会分配新的 id，用于字形缓存的 key，重新加载后旧字形不会再被命中
+        uint16_t id() const;
+
+        float scale(float size) const;
+        float ascent(float size) const;
+        float descent(float size) const;
+        float lineHeight(float size) const;
+
+        int glyphIndex(uint32_t codepoint) const;
+        float advance(int glyph, float size) const;
+        float kerning(int left, int right, float size) const;
+
+        // 排版：visit(int glyph, float x, float y)，(x, y) 为字形的笔位置，相对第一行基线的起点；'\n' 换行
+        template <typename Visit>
+        void layout(std::string_view text, float size, Visit&& visit) const;
+        // 文字的宽度和总高度（行数 * 行高）
+        glm::vec2 measure(std::string_view text, float size) const;
+
+    private:
+        static constexpr uint32_t ASCII_COUNT = 128;
+
+        MappedFile file;
+        std::vector<uint8_t> memory;
+        stbtt_fontinfo info{};
+        bool _valid = false;
+        uint16_t _id = 0;
+        int ascentUnits = 0, descentUnits = 0, lineGapUnits = 0;
+        int asciiGlyph[ASCII_COUNT] = {};
+        int asciiAdvance[ASCII_COUNT] = {};
+        std::vector<int16_t> asciiKern; // 字体没有字距表时为空
+
+        bool init(const uint8_t* data, int index);
+
+        friend class GlyphAtlas;
+    };
+
+    // 缓存中的一个字形：图集中的矩形，以及位图左上角相对于笔位置（取整后）的偏移
+    struct AtlasGlyph {
+        uint16_t x = 0, y = 0;
+        uint16_t width = 0, height = 0;
+        int16_t offsetX = 0, offsetY = 0;
+
+        bool empty() const;
+    };
+
+    // 所有字体、字号共享的单通道字形图集，按 LRU 淘汰
+    // 图集按行（shelf）分配，每行切成同样大小的方格，字形按 8 像素取整后的尺寸放进对应的行；
+    // 没有空格也无法开新行时，先淘汰同尺寸里最久未用的字形，再回收最久未用的整行
+    // 水平亚像素位置量化为 SUBPIXEL_STEPS 级，字号量化到 1/64 像素，同一字形在不同位置能命中同一份缓存
+    class GlyphAtlas {
+    public:
+        static constexpr int SUBPIXEL_STEPS = 4;
+        static constexpr uint32_t SLOT_ALIGN = 8;
+        // 空白字形不占图集，单独按 LRU 保留这么多个
+        static constexpr size_t MAX_BLANKS = 1024;
+
+        explicit GlyphAtlas(size_t width = 1024, size_t height = 1024);
+
+        const Texture& texture() const;
+        // 开始新的一批绘制，本批已经用过的字形在批内不会被淘汰
+        void beginBatch();
+        // 查找或光栅化字形，subpixel 为 [0, SUBPIXEL_STEPS) 的水平亚像素位置
+        // 返回 nullptr 表示图集已被本批字形占满，或字形比整个图集还大；不是线程安全的
+        const AtlasGlyph* acquire(const Font& font, int glyph, float size, int subpixel);
+        void clear();
+
+        size_t glyphCount() const;
+        size_t hits() const;
+        size_t misses() const;
+        size_t evictions() const;
+
+    private:
+        struct Shelf {
+            uint32_t y, height, slotSize;
+            uint64_t lastUse;
+            std::vector<uint64_t> keys; // 每个方格中的字形，0 表示空闲
+            uint32_t used;
+        };
+        struct Entry {
+            AtlasGlyph glyph;
+            uint64_t lastUse;
+            uint32_t shelf, slot;
+            std::list<uint64_t>* lruList;
+            std::list<uint64_t>::iterator lru;
+        };
+
+        Texture atlas;
+        std::vector<Shelf> shelves;
+        uint32_t nextShelfY = 0;
+        std::unordered_map<uint64_t, Entry> entries;
+        // 按方格尺寸分组的 LRU 链表，表头为最近使用
+        std::unordered_map<uint32_t, std::list<uint64_t>> lruLists;
+        std::list<uint64_t> blankLru;
+        uint64_t batch = 1;
+        size_t _hits = 0, _misses = 0, _evictions = 0;
+
+        static uint64_t makeKey(uint16_t font, int glyph, uint32_t size64, int subpixel);
+        bool allocate(uint32_t slotSize, uint32_t& shelf, uint32_t& slot);
+        void evict(uint64_t key);
+    };
+
+    // 一批文字，绘制时统一查找字形再并行混合，适合每帧上千条的 HUD 标签
+    class TextBatch {
+    public:
+        template <typename Color_T>
+        void add(const Font& font, float size, float x, float y, std::string_view text, Color_T color);
+        void clear();
+        size_t size() const;
+
+    private:
+        struct Label {
+            const Font* font;
+            float size;
+            float x, y;
+            size_t textOffset, textLength;
+            hrgba color; // 0~1
+        };
+        std::vector<Label> labels;
+        std::string text;
+
+        template <typename T>
+        friend class Painter;
+    };
+}
+
+namespace RE {
+    inline uint32_t decodeUTF8(std::string_view text, size_t& i) {
+        const uint8_t c = static_cast<uint8_t>(text[i++]);
+        if (c < 0x80) {
+            return c;
+        }
+        int extra;
+        uint32_t cp;
+        if ((c & 0xe0) == 0xc0) {
+            extra = 1;
+            cp = c & 0x1f;
+        } else if ((c & 0xf0) == 0xe0) {
+            extra = 2;
+            cp = c & 0x0f;
+        } else if ((c & 0xf8) == 0xf0) {
+            extra = 3;
+            cp = c & 0x07;
+        } else {
+            return 0xfffd;
+        }
+        for (int k = 0; k < extra; k++) {
+            if (i >= text.size() || (static_cast<uint8_t>(text[i]) & 0xc0) != 0x80) {
+                return 0xfffd;
+            }
+            cp = (cp << 6) | (static_cast<uint8_t>(text[i++]) & 0x3f);
+        }
+        return cp;
+    }
+
+    inline bool Font::loadFromFile(const char* filename, int index) {
+        if (!file.open(filename)) {
+            std::cerr << "Font Error: can not open " << filename << std::endl;
+            return false;
+        }
+        memory.clear();
+        return init(file.data(), index);
+    }
+
+    inline bool Font::loadFromMemory(const uint8_t* data, size_t size, int index) {
+        file.close();
+        memory.assign(data, data + size);
+        return init(memory.data(), index);
+    }
+
+    inline bool Font::init(const uint8_t* data, int index) {
+        RE_PROFILE_SCOPE("Font::init");
+        _valid = false;
+        const int offset = stbtt_GetFontOffsetForIndex(data, index);
+        if (offset < 0 || !stbtt_InitFont(&info, data, offset)) {
+            std::cerr << "Font Error: invalid font data" << std::endl;
+            return false;
+        }
+        stbtt_GetFontVMetrics(&info, &ascentUnits, &descentUnits, &lineGapUnits);
+        for (uint32_t c = 0; c < ASCII_COUNT; c++) {
+            asciiGlyph[c] = stbtt_FindGlyphIndex(&info, static_cast<int>(c));
+            int lsb;
+            stbtt_GetGlyphHMetrics(&info, asciiGlyph[c], &asciiAdvance[c], &lsb);
+        }
+        asciiKern.clear();
+        if (info.kern != 0 || info.gpos != 0) {
+            asciiKern.resize(ASCII_COUNT * ASCII_COUNT);
+            for (uint32_t a = 0; a < ASCII_COUNT; a++) {
+                for (uint32_t b = 0; b < ASCII_COUNT; b++) {
+                    asciiKern[a * ASCII_COUNT + b] = static_cast<int16_t>(stbtt_GetGlyphKernAdvance(&info, asciiGlyph[a], asciiGlyph[b]));
+                }
+            }
+        }
+        // 0 保留给未加载的字体
+        static std::atomic<uint16_t> counter{1};
+        do {
+            _id = counter.fetch_add(1, std::memory_order_relaxed);
+        } while (_id == 0);
+        _valid = true;
+        return true;
+    }
+
+    inline bool Font::valid() const {
+        return _valid;
+    }
+
+    inline uint16_t Font::id() const {
+        return _id;
+    }
+
+    inline float Font::scale(float size) const {
+        return stbtt_ScaleForPixelHeight(&info, size);
+    }
+
+    inline float Font::ascent(float size) const {
+        return ascentUnits * scale(size);
+    }
+
+    inline float Font::descent(float size) const {
+        return descentUnits * scale(size);
+    }
+
+    inline float Font::lineHeight(float size) const {
+        return (ascentUnits - descentUnits + lineGapUnits) * scale(size);
+    }
+
+    inline int Font::glyphIndex(uint32_t codepoint) const {
+        if (codepoint < ASCII_COUNT) {
+            return asciiGlyph[codepoint];
+        }
+        return stbtt_FindGlyphIndex(&info, static_cast<int>(codepoint));
+    }
+
+    inline float Font::advance(int glyph, float size) const {
+        int adv, lsb;
+        stbtt_GetGlyphHMetrics(&info, glyph, &adv, &lsb);
+        return adv * scale(size);
+    }
+
+    inline float Font::kerning(int left, int right, float size) const {
+        if (asciiKern.empty()) {
+            return 0.0f;
+        }
+        return stbtt_GetGlyphKernAdvance(&info, left, right) * scale(size);
+    }
+
+    template <typename Visit>
+    void Font::layout(std::string_view text, float size, Visit&& visit) const {
+        if (!_valid) {
+            return;
+        }
+        const float s = scale(size);
+        const float line = lineHeight(size);
+        const bool kern = !asciiKern.empty();
+        float penX = 0.0f, penY = 0.0f;
+        uint32_t prev = 0xffffffffu;
+        int prevGlyph = -1;
+        size_t i = 0;
+        while (i < text.size()) {
+            const uint32_t cp = decodeUTF8(text, i);
+            if (cp == '\n') {
+                penX = 0.0f;
+                penY += line;
+                prevGlyph = -1;
+                continue;
+            }
+            int glyph, adv;
+            if (cp < ASCII_COUNT) {
+                glyph = asciiGlyph[cp];
+                adv = asciiAdvance[cp];
+            } else {
+                int lsb;
+                glyph = stbtt_FindGlyphIndex(&info, static_cast<int>(cp));
+                stbtt_GetGlyphHMetrics(&info, glyph, &adv, &lsb);
+            }
+            if (kern && prevGlyph >= 0) {
+                const int k = (cp < ASCII_COUNT && prev < ASCII_COUNT) ? asciiKern[prev * ASCII_COUNT + cp] : stbtt_GetGlyphKernAdvance(&info, prevGlyph, glyph);
+                penX += k * s;
+            }
+            visit(glyph, penX, penY);
+            penX += adv * s;
+            prev = cp;
+            prevGlyph = glyph;
+        }
+    }
+
+    inline glm::vec2 Font::measure(std::string_view text, float size) const {
+        if (!_valid || text.empty()) {
+            return glm::vec2(0.0f);
+        }
+        float width = 0.0f;
+        layout(text, size, [&](int glyph, float x, float y) {
+            width = std::max(width, x + advance(glyph, size));
+        });
+        const size_t lines = std::count(text.begin(), text.end(), '\n') + 1;
+        return {width, lines * lineHeight(size)};
+    }
+
+    inline bool AtlasGlyph::empty() const {
+        return width == 0 || height == 0;
+    }
+
+    inline GlyphAtlas::GlyphAtlas(size_t width, size_t height) : atlas(width, height, 1) {
+        atlas.setZero();
+    }
+
+    inline const Texture& GlyphAtlas::texture() const {
+        return atlas;
+    }
+
+    inline void GlyphAtlas::beginBatch() {
+        batch++;
+    }
+
+    inline uint64_t GlyphAtlas::makeKey(uint16_t font, int glyph, uint32_t size64, int subpixel) {
+        return (static_cast<uint64_t>(font) << 48) | (static_cast<uint64_t>(glyph & 0xffff) << 32) | (static_cast<uint64_t>(size64 & 0xffffff) << 8) | static_cast<uint64_t>(subpixel);
+    }
+
+    inline const AtlasGlyph* GlyphAtlas::acquire(const Font& font, int glyph, float size, int subpixel) {
+        const uint32_t size64 = static_cast<uint32_t>(camp(std::round(size * 64.0f), 1.0f, 16777215.0f));
+        const uint64_t key = makeKey(font.id(), glyph, size64, subpixel);
+        auto it = entries.find(key);
+        if (it != entries.end()) {
+            Entry& e = it->second;
+            e.lastUse = batch;
+            if (!e.glyph.empty()) {
+                shelves[e.shelf].lastUse = batch;
+            }
+            e.lruList->splice(e.lruList->begin(), *e.lruList, e.lru);
+            _hits++;
+            return &e.glyph;
+        }
+
+        RE_PROFILE_SCOPE("GlyphAtlas::rasterize");
+        _misses++;
+        const float s = font.scale(size64 / 64.0f);
+        const float shift = static_cast<float>(subpixel) / SUBPIXEL_STEPS;
+        int x0, y0, x1, y1;
+        stbtt_GetGlyphBitmapBoxSubpixel(&font.info, glyph, s, s, shift, 0.0f, &x0, &y0, &x1, &y1);
+        Entry e{};
+        e.lastUse = batch;
+        if (x1 <= x0 || y1 <= y0) {
+            // 空白字形也缓存，避免每次都去查字体；字形按值取走，淘汰时不必考虑本批
+            if (blankLru.size() >= MAX_BLANKS) {
+                evict(blankLru.back());
+            }
+            blankLru.push_front(key);
+            e.lruList = &blankLru;
+            e.lru = blankLru.begin();
+            return &entries.emplace(key, e).first->second.glyph;
+        }
+
+        const uint32_t w = static_cast<uint32_t>(x1 - x0), h = static_cast<uint32_t>(y1 - y0);
+        const uint32_t slotSize = (std::max(w, h) + SLOT_ALIGN - 1) / SLOT_ALIGN * SLOT_ALIGN;
+        if (slotSize > std::min(atlas.width(), atlas.height())) {
+            std::cerr << "GlyphAtlas Error: glyph larger than atlas (" << w << "x" << h << ")" << std::endl;
+            return nullptr;
+        }
+        if (!allocate(slotSize, e.shelf, e.slot)) {
+            return nullptr;
+        }
+        Shelf& shelf = shelves[e.shelf];
+        e.glyph.x = static_cast<uint16_t>(e.slot * shelf.slotSize);
+        e.glyph.y = static_cast<uint16_t>(shelf.y);
+        e.glyph.width = static_cast<uint16_t>(w);
+        e.glyph.height = static_cast<uint16_t>(h);
+        e.glyph.offsetX = static_cast<int16_t>(x0);
+        e.glyph.offsetY = static_cast<int16_t>(y0);
+        shelf.keys[e.slot] = key;
+        shelf.used++;
+        shelf.lastUse = batch;
+        e.lruList = &lruLists[slotSize];
+        e.lruList->push_front(key);
+        e.lru = e.lruList->begin();
+
+        uint8_t* dst = atlas.data() + atlas.getIndex(e.glyph.x, e.glyph.y);
+        stbtt_MakeGlyphBitmapSubpixel(&font.info, dst, static_cast<int>(w), static_cast<int>(h), static_cast<int>(atlas.width()), s, s, shift, 0.0f, glyph);
+        return &entries.emplace(key, e).first->second.glyph;
+    }
+
+    inline bool GlyphAtlas::allocate(uint32_t slotSize, uint32_t& shelfIndex, uint32_t& slot) {
+        auto take = [&](uint32_t index) {
+            Shelf& shelf = shelves[index];
+            for (uint32_t i = 0; i < shelf.keys.size(); i++) {
+                if (shelf.keys[i] == 0) {
+                    shelfIndex = index;
+                    slot = i;
+                    return true;
+                }
+            }
+            return false;
+        };
+        // 1. 同尺寸行里的空格
+        for (uint32_t i = 0; i < shelves.size(); i++) {
+            if (shelves[i].slotSize == slotSize && shelves[i].used < shelves[i].keys.size() && take(i)) {
+                return true;
+            }
+        }
+        // 2. 开新行
+        if (nextShelfY + slotSize <= atlas.height()) {
+            shelves.push_back({nextShelfY, slotSize, slotSize, batch, std::vector<uint64_t>(atlas.width() / slotSize, 0), 0});
+            nextShelfY += slotSize;
+            return take(static_cast<uint32_t>(shelves.size() - 1));
+        }
+        // 3. 淘汰同尺寸里最久未用的字形，直接复用它的方格
+        auto lru = lruLists.find(slotSize);
+        if (lru != lruLists.end() && !lru->second.empty()) {
+            const Entry& victim = entries.find(lru->second.back())->second;
+            if (victim.lastUse != batch) {
+                shelfIndex = victim.shelf;
+                slot = victim.slot;
+                evict(lru->second.back());
+                return true;
+            }
+        }
+        // 4. 回收最久未用、高度足够的整行，改成新的方格尺寸
+        uint32_t best = 0xffffffffu;
+        for (uint32_t i = 0; i < shelves.size(); i++) {
+            const Shelf& shelf = shelves[i];
+            if (shelf.height >= slotSize && shelf.lastUse != batch && (best == 0xffffffffu || shelf.lastUse < shelves[best].lastUse)) {
+                best = i;
+            }
+        }
+        if (best == 0xffffffffu) {
+            return false;
+        }
+        Shelf& shelf = shelves[best];
+        for (const uint64_t key : shelf.keys) {
+            if (key != 0) {
+                evict(key);
+            }
+        }
+        shelf.slotSize = slotSize;
+        shelf.keys.assign(atlas.width() / slotSize, 0);
+        shelf.used = 0;
+        return take(best);
+    }
+
+    inline void GlyphAtlas::evict(uint64_t key) {
+        auto it = entries.find(key);
+        if (it == entries.end()) {
+            return;
+        }
+        Entry& e = it->second;
+        if (!e.glyph.empty()) {
+            Shelf& shelf = shelves[e.shelf];
+            shelf.keys[e.slot] = 0;
+            shelf.used--;
+        }
+        e.lruList->erase(e.lru);
+        entries.erase(it);
+        _evictions++;
+    }
+
+    inline void GlyphAtlas::clear() {
+        entries.clear();
+        lruLists.clear();
+        blankLru.clear();
+        shelves.clear();
+        nextShelfY = 0;
+        atlas.setZero();
+    }
+
+    inline size_t GlyphAtlas::glyphCount() const {
+        return entries.size();
+    }
+
+    inline size_t GlyphAtlas::hits() const {
+        return _hits;
+    }
+
+    inline size_t GlyphAtlas::misses() const {
+        return _misses;
+    }
+
+    inline size_t GlyphAtlas::evictions() const {
+        return _evictions;
+    }
+
+    template <typename Color_T>
+    void TextBatch::add(const Font& font, float size, float x, float y, std::string_view str, Color_T color) {
+        labels.push_back({&font, size, x, y, text.size(), str.size(), normalizeColor(color)});
+        text.append(str);
+    }
+
+    inline void TextBatch::clear() {
+        labels.clear();
+        text.clear();
+    }
+
+    inline size_t TextBatch::size() const {
+        return labels.size();
+    }
+}
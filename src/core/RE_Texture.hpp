@@ -16,6 +16,7 @@ namespace RE {
         TextureBase(size_t width, size_t height, size_t channel);
         TextureBase(T* arr, size_t width, size_t height, size_t channel);
         ~TextureBase();
+        using Buffer3D<T>::operator=; // 表达式赋值
     };
 
     template <>
@@ -25,13 +26,17 @@ namespace RE {
         TextureBase(size_t width, size_t height, size_t channel);
         TextureBase(uint8_t* arr, size_t width, size_t height, size_t channel);
         ~TextureBase();
+        using Buffer3D<uint8_t>::operator=; // 表达式赋值
 
         void init();
         rgb getRGB(size_t x, size_t y);
         rgb getRGB(size_t index);
         rgba getRGBA(size_t x, size_t y);
         rgba getRGBA(size_t index);
-        void writePicture(const char* filename);
+        // 解码图片直接作为数据，不经过中间拷贝，失败时返回 false
+        bool readPicture(const char* filename);
+        // 按扩展名写出 png/bmp/tga/jpg，失败时返回 false
+        bool writePicture(const char* filename);
         static TextureBase<uint8_t>* loadPicture(const char* filename);
     };
 
@@ -42,9 +47,12 @@ namespace RE {
         TextureBase(size_t width, size_t height, size_t channel);
         TextureBase(float* arr, size_t width, size_t height, size_t channel);
         ~TextureBase();
+        using Buffer3D<float>::operator=; // 表达式赋值
 
         hrgb getRGB(size_t x, size_t y);
+        hrgb getRGB(size_t index);
         hrgba getRGBA(size_t x, size_t y);
+        hrgba getRGBA(size_t index);
         void setPixel(size_t x, size_t y, hrgb color);
         void setPixel(size_t index, hrgb color);
         void setPixel(size_t x, size_t y, hrgba color);
@@ -55,6 +63,14 @@ namespace RE {
     using Texture = TextureBase<uint8_t>;
     using HDRTexture = TextureBase<float>;
 
+    // 2x2 盒式滤波降采样到 dst，dst 尺寸为 src 的一半（最小为 1）
+    template <typename T>
+    void downsampleHalf(const TextureBase<T>& src, TextureBase<T>& dst);
+
+    // 把 rgba / rgb / hrgba / hrgb 统一成 0~1 的 hrgba，不带 alpha 的颜色视为不透明
+    template <typename Color_T>
+    hrgba normalizeColor(const Color_T& color);
+
     enum UndersamplingFix {
         none = 0,
         mipmap,
@@ -71,18 +87,33 @@ namespace RE {
         bicubic,
     };
 
+    template <typename T>
+    class VirtualTexture;
+
     template <typename T = uint8_t>
     class ImageView {
     public:
+        using Color_T = glm::vec<3, T>; // uint8_t 时为 rgb，float 时为 hrgb
+
         ImageView(UndersamplingFix uf = RE::UndersamplingFix::mipmap, TextureWrap tw = clamp, TextureFilter tf = nearest);
         ImageView(const ImageView&) = delete;
         ImageView(ImageView&&) = delete;
         ImageView& operator=(const ImageView&) = delete;
         ImageView& operator=(ImageView&&) = delete;
         ~ImageView();
+        // 重建 mip 链 / 各向异性纹理并清除 changed 标记，可在多线程中调用
         void update();
         TextureBase<T>& getTexture();
-        rgb getPixel(float u, float v);
+        // lod 为 mip 等级，非整数时取最近的一级
+        Color_T getPixel(float u, float v, float lod = 0.0f);
+
+        // level 0 为原始纹理，之后每级尺寸减半
+        size_t mipLevelCount() const;
+        TextureBase<T>& getMipLevel(size_t level);
+
+        // 虚拟纹理模式：设置后采样全部走分页的 VirtualTexture，传 nullptr 退出
+        void setVirtualTexture(std::shared_ptr<VirtualTexture<T>> vt);
+        std::shared_ptr<VirtualTexture<T>> getVirtualTexture();
 
     private:
         class Sampler {
@@ -95,28 +126,33 @@ namespace RE {
             Sampler& operator=(Sampler&&) = delete;
             Sampler(ImageView<T>* iv, TextureWrap tw = clamp, TextureFilter tf = nearest);
             ~Sampler();
-            rgb getPixel(float u, float v);
+            Color_T getPixel(float u, float v, float lod);
 
         private:
             ImageView<T>* imageView;
-            glm::u64vec2 uv2xy(glm::vec2 uv);
+            glm::u64vec2 uv2xy(glm::vec2 uv, const TextureBase<T>& tex);
             glm::vec2 wrapUV(float u, float v);
 
-            std::function<rgb(float, float)> nearestFilter;
-            std::function<rgb(float, float)> bilinearFilter;
-            std::function<rgb(float, float)> bicubicFilter;
+            std::function<Color_T(TextureBase<T>&, float, float)> nearestFilter;
+            std::function<Color_T(TextureBase<T>&, float, float)> bilinearFilter;
+            std::function<Color_T(TextureBase<T>&, float, float)> bicubicFilter;
         };
 
         template <typename TN>
         friend class Painter;
+        friend class TextureFile;
 
         TextureBase<T> texture;
-        TextureBase<T> mipmap;
+        std::vector<TextureBase<T>> mipmap; // level 1 ~ n
         TextureBase<T> anisotropy;
+        std::shared_ptr<VirtualTexture<T>> virtualTexture;
         Sampler* sampler;
         UndersamplingFix ufx;
-        bool changed;
+        std::atomic<bool> changed;
+        std::mutex updateMutex;
 
+        void rebuild();
+        void updateIfChanged(); // 仅在 changed 时重建，多个采样线程只重建一次
         void updateMipmap();
         void updateAnisotropy();
     };
@@ -165,19 +201,47 @@ namespace RE {
         return rgba(_data[index], _data[index + 1], _data[index + 2], _data[index + 3]);
     }
 
-    void TextureBase<uint8_t>::writePicture(const char* filename) {
+    bool TextureBase<uint8_t>::readPicture(const char* filename) {
         int width, height, channel;
         stbi_uc* pixels = stbi_load(filename, &width, &height, &channel, 0);
-        setSize(width, height, channel);
-        memcpy(_data.data(), pixels, sizeof(uint8_t) * width * height * channel);
-        stbi_image_free(pixels);
+        if (pixels == nullptr) {
+            std::cerr << "stbi_load Error: " << filename << ": " << stbi_failure_reason() << std::endl;
+            return false;
+        }
+        adopt(pixels, width, height, channel, [](uint8_t* p) { stbi_image_free(p); });
+        return true;
+    }
+
+    bool TextureBase<uint8_t>::writePicture(const char* filename) {
+        const char* dot = strrchr(filename, '.');
+        std::string ext = (dot == nullptr) ? ".png" : dot;
+        std::transform(ext.begin(), ext.end(), ext.begin(), [](char ch) { return static_cast<char>(tolower(ch)); });
+
+        const int w = static_cast<int>(width());
+        const int h = static_cast<int>(height());
+        const int c = static_cast<int>(channel());
+        int ok = 0;
+        if (ext == ".png") {
+            ok = stbi_write_png(filename, w, h, c, _data.data(), w * c);
+        } else if (ext == ".bmp") {
+            ok = stbi_write_bmp(filename, w, h, c, _data.data());
+        } else if (ext == ".tga") {
+            ok = stbi_write_tga(filename, w, h, c, _data.data());
+        } else if (ext == ".jpg" || ext == ".jpeg") {
+            ok = stbi_write_jpg(filename, w, h, c, _data.data(), 95);
+        }
+        if (!ok) {
+            std::cerr << "writePicture Error: " << filename << std::endl;
+        }
+        return ok != 0;
     }
 
     TextureBase<uint8_t>* TextureBase<uint8_t>::loadPicture(const char* filename) {
-        int width, height, channel;
-        stbi_uc* pixels = stbi_load(filename, &width, &height, &channel, 0);
-        auto out = new TextureBase<uint8_t>(pixels, width, height, channel);
-        stbi_image_free(pixels);
+        auto out = new TextureBase<uint8_t>();
+        if (!out->readPicture(filename)) {
+            delete out;
+            return nullptr;
+        }
         return out;
     }
 
@@ -194,11 +258,19 @@ namespace RE {
         return hrgb(_data[index], _data[index + 1], _data[index + 2]);
     }
 
+    hrgb TextureBase<float>::getRGB(size_t index) {
+        return hrgb(_data[index], _data[index + 1], _data[index + 2]);
+    }
+
     hrgba TextureBase<float>::getRGBA(size_t x, size_t y) {
         const size_t index = getIndex(x, y);
         return hrgba(_data[index], _data[index + 1], _data[index + 2], _data[index + 3]);
     }
 
+    hrgba TextureBase<float>::getRGBA(size_t index) {
+        return hrgba(_data[index], _data[index + 1], _data[index + 2], _data[index + 3]);
+    }
+
     void TextureBase<float>::setPixel(size_t x, size_t y, hrgb color) {
         const size_t index = getIndex(x, y);
         _data[index] = color.r;
@@ -231,6 +303,50 @@ namespace RE {
         this->setZero();
     }
 
+    template <typename T>
+    void downsampleHalf(const TextureBase<T>& src, TextureBase<T>& dst) {
+        const size_t sw = src.width();
+        const size_t sh = src.height();
+        const size_t c = src.channel();
+        const size_t dw = std::max<size_t>(sw / 2, 1);
+        const size_t dh = std::max<size_t>(sh / 2, 1);
+        dst.setSize(dw, dh, c);
+
+        const T* in = src.data();
+        T* out = dst.data();
+#pragma omp parallel for
+        for (int64_t y = 0; y < static_cast<int64_t>(dh); y++) {
+            const size_t y0 = std::min<size_t>(y * 2, sh - 1);
+            const size_t y1 = std::min<size_t>(y * 2 + 1, sh - 1);
+            for (size_t x = 0; x < dw; x++) {
+                const size_t x0 = std::min<size_t>(x * 2, sw - 1);
+                const size_t x1 = std::min<size_t>(x * 2 + 1, sw - 1);
+                for (size_t k = 0; k < c; k++) {
+                    const float sum = static_cast<float>(in[(y0 * sw + x0) * c + k]) + static_cast<float>(in[(y0 * sw + x1) * c + k]) +
+                                      static_cast<float>(in[(y1 * sw + x0) * c + k]) + static_cast<float>(in[(y1 * sw + x1) * c + k]);
+                    if constexpr (std::is_integral_v<T>) {
+                        out[(y * dw + x) * c + k] = static_cast<T>(sum * 0.25f + 0.5f);
+                    } else {
+                        out[(y * dw + x) * c + k] = static_cast<T>(sum * 0.25f);
+                    }
+                }
+            }
+        }
+    }
+
+    template <typename Color_T>
+    hrgba normalizeColor(const Color_T& color) {
+        if constexpr (std::is_same_v<Color_T, rgba>) {
+            return hrgba(color) / 255.0f;
+        } else if constexpr (std::is_same_v<Color_T, rgb>) {
+            return hrgba(hrgb(color) / 255.0f, 1.0f);
+        } else if constexpr (std::is_same_v<Color_T, hrgb>) {
+            return hrgba(color, 1.0f);
+        } else {
+            return hrgba(color);
+        }
+    }
+
     template <typename T>
     ImageView<T>::ImageView(UndersamplingFix uf, TextureWrap tw, TextureFilter tf) : ufx(uf), sampler(new Sampler(this, tw, tf)), changed(false) {}
 
@@ -241,6 +357,23 @@ namespace RE {
 
     template <typename T>
     void ImageView<T>::update() {
+        std::lock_guard<std::mutex> lock(updateMutex);
+        rebuild();
+        changed.store(false, std::memory_order_release);
+    }
+
+    template <typename T>
+    void ImageView<T>::updateIfChanged() {
+        std::lock_guard<std::mutex> lock(updateMutex);
+        if (!changed.load(std::memory_order_acquire)) {
+            return; // 其他线程已经重建完成
+        }
+        rebuild();
+        changed.store(false, std::memory_order_release);
+    }
+
+    template <typename T>
+    void ImageView<T>::rebuild() {
         switch (ufx) {
         case RE::UndersamplingFix::none:
             break;
@@ -259,43 +392,63 @@ namespace RE {
     }
 
     template <typename T>
-    rgb ImageView<T>::getPixel(float u, float v) {
-        return sampler->getPixel(u, v);
+    typename ImageView<T>::Color_T ImageView<T>::getPixel(float u, float v, float lod) {
+        return sampler->getPixel(u, v, lod);
+    }
+
+    template <typename T>
+    size_t ImageView<T>::mipLevelCount() const {
+        return mipmap.size() + 1;
+    }
+
+    template <typename T>
+    TextureBase<T>& ImageView<T>::getMipLevel(size_t level) {
+        return (level == 0) ? texture : mipmap[level - 1];
+    }
+
+    template <typename T>
+    void ImageView<T>::setVirtualTexture(std::shared_ptr<VirtualTexture<T>> vt) {
+        virtualTexture = std::move(vt);
+    }
+
+    template <typename T>
+    std::shared_ptr<VirtualTexture<T>> ImageView<T>::getVirtualTexture() {
+        return virtualTexture;
     }
 
     template <typename T>
     ImageView<T>::Sampler::Sampler(ImageView<T>* iv, TextureWrap tw, TextureFilter tf) : imageView(iv), wrap(tw), filter(tf) {
-        nearestFilter = [this](float u, float v) -> rgb {
-            const glm::u64vec2 xy = uv2xy(wrapUV(u, v));
-            return imageView->texture.getRGB(xy.x, xy.y);
+        nearestFilter = [this](TextureBase<T>& tex, float u, float v) -> Color_T {
+            const glm::u64vec2 xy = uv2xy(wrapUV(u, v), tex);
+            return tex.getRGB(xy.x, xy.y);
         };
 
-        bilinearFilter = [this](float u, float v) -> rgb {
+        bilinearFilter = [this](TextureBase<T>& tex, float u, float v) -> Color_T {
             const glm::vec2 uv = wrapUV(u, v);
-            const size_t w = imageView->texture.width();
-            const size_t h = imageView->texture.height();
+            const size_t w = tex.width();
+            const size_t h = tex.height();
             const glm::vec2 dxy{std::fmod(uv.x * w, 1), std::fmod(uv.y * h, 1)};
-            const glm::u64vec2 xy = uv2xy(uv);
+            const glm::u64vec2 xy = uv2xy(uv, tex);
 
-            const size_t clampXAdd = std::min(xy.x + 1, w - 1);
-            const size_t clampYAdd = std::min(xy.y + 1, h - 1);
+            const size_t clampXAdd = std::min<size_t>(xy.x + 1, w - 1);
+            const size_t clampYAdd = std::min<size_t>(xy.y + 1, h - 1);
 
-            const rgb nearestGrid[4] = {
-                imageView->texture.getRGB(xy.x, xy.y),
-                imageView->texture.getRGB(clampXAdd, xy.y),
-                imageView->texture.getRGB(xy.x, clampYAdd),
-                imageView->texture.getRGB(clampXAdd, clampYAdd),
+            const Color_T nearestGrid[4] = {
+                tex.getRGB(xy.x, xy.y),
+                tex.getRGB(clampXAdd, xy.y),
+                tex.getRGB(xy.x, clampYAdd),
+                tex.getRGB(clampXAdd, clampYAdd),
             };
 
-            const rgb insertGrid[2] = {
+            const Color_T insertGrid[2] = {
                 RE::lerp(nearestGrid[0], nearestGrid[1], dxy.x),
                 RE::lerp(nearestGrid[2], nearestGrid[3], dxy.x)};
 
             return RE::lerp(insertGrid[0], insertGrid[1], dxy.y);
         };
 
-        bicubicFilter = [this](float u, float v) -> rgb {
-            return rgb(0, 0, 0);
+        bicubicFilter = [this](TextureBase<T>& tex, float u, float v) -> Color_T {
+            return Color_T(0, 0, 0);
         };
     }
 
@@ -303,26 +456,33 @@ namespace RE {
     ImageView<T>::Sampler::~Sampler() {}
 
     template <typename T>
-    rgb ImageView<T>::Sampler::getPixel(float u, float v) {
-        if (imageView->changed) {
-            imageView->update();
+    typename ImageView<T>::Color_T ImageView<T>::Sampler::getPixel(float u, float v, float lod) {
+        RE_PROFILE_SCOPE_DETAIL("Sampler::getPixel");
+        if (imageView->virtualTexture) {
+            return imageView->virtualTexture->sample(wrapUV(u, v), lod, filter);
+        }
+        if (imageView->changed.load(std::memory_order_acquire)) {
+            imageView->updateIfChanged();
         }
+        const size_t level = std::min<size_t>(static_cast<size_t>(std::max(lod + 0.5f, 0.0f)), imageView->mipLevelCount() - 1);
+        TextureBase<T>& tex = imageView->getMipLevel(level);
         switch (filter) {
         case nearest:
-            return nearestFilter(u, v);
+            return nearestFilter(tex, u, v);
         case bilinear:
-            return bilinearFilter(u, v);
+            return bilinearFilter(tex, u, v);
         case bicubic:
-            return bicubicFilter(u, v);
+            return bicubicFilter(tex, u, v);
         }
+        return nearestFilter(tex, u, v);
     }
 
     template <typename T>
-    glm::u64vec2 ImageView<T>::Sampler::uv2xy(glm::vec2 uv) {
-        const size_t w = imageView->texture.width();
-        const size_t h = imageView->texture.height();
-        size_t x = uv.x * w;
-        size_t y = uv.y * h;
+    glm::u64vec2 ImageView<T>::Sampler::uv2xy(glm::vec2 uv, const TextureBase<T>& tex) {
+        const size_t w = tex.width();
+        const size_t h = tex.height();
+        size_t x = std::min<size_t>(static_cast<size_t>(uv.x * w), w - 1);
+        size_t y = std::min<size_t>(static_cast<size_t>(uv.y * h), h - 1);
         return glm::u64vec2(x, y);
     }
 
@@ -341,9 +501,23 @@ namespace RE {
 
     template <typename T>
     void ImageView<T>::updateMipmap() {
+        RE_PROFILE_SCOPE("ImageView::updateMipmap");
+        size_t levels = 0;
+        for (size_t w = texture.width(), h = texture.height(); w > 1 || h > 1; w /= 2, h /= 2) {
+            levels++;
+        }
+        mipmap.resize(levels);
+        const TextureBase<T>* prev = &texture;
+        for (auto& level : mipmap) {
+            downsampleHalf(*prev, level);
+            prev = &level;
+        }
     }
 
     template <typename T>
     void ImageView<T>::updateAnisotropy() {
     }
-}
\ No newline at end of file
+}
+
+// ImageView 的虚拟纹理模式需要完整的 VirtualTexture 定义
+#include "RE_VirtualTexture.hpp"
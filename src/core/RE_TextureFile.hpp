@@ -0,0 +1,266 @@
+#pragma once
+#include "RE_includes.h"
+#include "RE_file.h"
+#include "RE_Texture.hpp"
+
+namespace RE {
+    enum TextureElementType : uint32_t {
+        unknownElement = 0,
+        uint8Element,
+        float32Element,
+    };
+
+    template <typename T>
+    struct TextureElement {
+        static constexpr TextureElementType type = unknownElement;
+    };
+    template <>
+    struct TextureElement<uint8_t> {
+        static constexpr TextureElementType type = uint8Element;
+    };
+    template <>
+    struct TextureElement<float> {
+        static constexpr TextureElementType type = float32Element;
+    };
+
+    enum TextureLayout : uint32_t {
+        interleavedRowMajor = 0, // 与 Buffer3D 一致：行优先，通道交错
+    };
+
+    // .retx 文件结构：
+    // | TextureFileHeader | TextureFileLevel * levelCount | padding | level 0 | padding | level 1 | ...
+    // 每一级的数据都按 pageSize 对齐，可以直接映射成 Buffer3D 的存储
+    struct TextureFileHeader {
+        char magic[4];
+        uint32_t version;
+        uint32_t width;
+        uint32_t height;
+        uint32_t channel;
+        uint32_t elementType;
+        uint32_t elementSize;
+        uint32_t layout;
+        uint32_t levelCount;
+        uint32_t pageSize;
+    };
+
+    struct TextureFileLevel {
+        uint64_t offset;
+        uint64_t byteSize;
+        uint32_t width;
+        uint32_t height;
+    };
+
+    class TextureFile {
+    public:
+        static constexpr char MAGIC[4] = {'R', 'E', 'T', 'X'};
+        static constexpr uint32_t VERSION = 1;
+        static constexpr uint32_t PAGE_SIZE = 4096;
+
+        TextureFile() = default;
+        ~TextureFile() = default;
+        TextureFile(const TextureFile&) = delete;
+        TextureFile& operator=(const TextureFile&) = delete;
+
+        // 写出纹理和它的完整 mip 链（ImageView 的 mip 链过期时会先重建）
+        template <typename T>
+        static bool write(const char* filename, ImageView<T>& view);
+        template <typename T>
+        static bool write(const char* filename, const TextureBase<T>& texture);
+
+        // 映射文件，只校验头部，不读取也不解码像素
+        static std::shared_ptr<TextureFile> open(const char* filename);
+
+        // 把各级数据零拷贝地挂到 ImageView 上，页面在首次采样时才调入内存
+        template <typename T>
+        static bool load(const char* filename, ImageView<T>& view);
+        template <typename T>
+        bool bind(ImageView<T>& view);
+
+        const TextureFileHeader& header() const;
+        size_t levelCount() const;
+        const TextureFileLevel& level(size_t index) const;
+        uint8_t* levelData(size_t index);
+
+    private:
+        MappedFile file;
+        TextureFileHeader* _header = nullptr;
+        TextureFileLevel* _levels = nullptr;
+        std::weak_ptr<TextureFile> self;
+
+        template <typename T>
+        static bool writeLevels(const char* filename, const std::vector<const TextureBase<T>*>& levels);
+        template <typename T>
+        void adoptLevel(size_t index, TextureBase<T>& dst);
+    };
+}
+
+namespace RE {
+    template <typename T>
+    bool TextureFile::write(const char* filename, ImageView<T>& view) {
+        // 与其他 mip 更新路径一样持有 updateMutex，写出期间 mip 链也不会被采样线程重建
+        std::lock_guard<std::mutex> lock(view.updateMutex);
+        if (view.changed || view.mipLevelCount() == 1) {
+            view.updateMipmap();
+            if (view.ufx == UndersamplingFix::mipmap) {
+                view.changed = false;
+            }
+        }
+        std::vector<const TextureBase<T>*> levels;
+        for (size_t i = 0; i < view.mipLevelCount(); i++) {
+            levels.push_back(&view.getMipLevel(i));
+        }
+        return writeLevels<T>(filename, levels);
+    }
+
+    template <typename T>
+    bool TextureFile::write(const char* filename, const TextureBase<T>& texture) {
+        std::vector<TextureBase<T>> chain;
+        std::vector<const TextureBase<T>*> levels{&texture};
+        size_t count = 0;
+        for (size_t w = texture.width(), h = texture.height(); w > 1 || h > 1; w /= 2, h /= 2) {
+            count++;
+        }
+        chain.resize(count);
+        for (size_t i = 0; i < count; i++) {
+            downsampleHalf(*levels.back(), chain[i]);
+            levels.push_back(&chain[i]);
+        }
+        return writeLevels<T>(filename, levels);
+    }
+
+    template <typename T>
+    bool TextureFile::writeLevels(const char* filename, const std::vector<const TextureBase<T>*>& levels) {
+        static_assert(TextureElement<T>::type != unknownElement, "TextureFile: unsupported element type");
+        FILE* out = fopen(filename, "wb");
+        if (out == nullptr) {
+            std::cerr << "TextureFile Error: can not open " << filename << std::endl;
+            return false;
+        }
+
+        TextureFileHeader header;
+        memcpy(header.magic, MAGIC, sizeof(MAGIC));
+        header.version = VERSION;
+        header.width = static_cast<uint32_t>(levels[0]->width());
+        header.height = static_cast<uint32_t>(levels[0]->height());
+        header.channel = static_cast<uint32_t>(levels[0]->channel());
+        header.elementType = TextureElement<T>::type;
+        header.elementSize = sizeof(T);
+        header.layout = interleavedRowMajor;
+        header.levelCount = static_cast<uint32_t>(levels.size());
+        header.pageSize = PAGE_SIZE;
+
+        std::vector<TextureFileLevel> table(levels.size());
+        uint64_t offset = sizeof(TextureFileHeader) + sizeof(TextureFileLevel) * levels.size();
+        for (size_t i = 0; i < levels.size(); i++) {
+            offset = (offset + PAGE_SIZE - 1) / PAGE_SIZE * PAGE_SIZE;
+            table[i].offset = offset;
+            table[i].byteSize = levels[i]->length() * sizeof(T);
+            table[i].width = static_cast<uint32_t>(levels[i]->width());
+            table[i].height = static_cast<uint32_t>(levels[i]->height());
+            offset += table[i].byteSize;
+        }
+
+        size_t written = fwrite(&header, sizeof(header), 1, out) * sizeof(header);
+        written += fwrite(table.data(), sizeof(TextureFileLevel), table.size(), out) * sizeof(TextureFileLevel);
+        bool ok = written == sizeof(header) + sizeof(TextureFileLevel) * table.size();
+        for (size_t i = 0; i < levels.size() && ok; i++) {
+            written = padFileTo(out, written, PAGE_SIZE);
+            written += fwrite(levels[i]->data(), 1, table[i].byteSize, out);
+            ok = written == table[i].offset + table[i].byteSize;
+        }
+        fclose(out);
+        if (!ok) {
+            std::cerr << "TextureFile Error: write failed " << filename << std::endl;
+        }
+        return ok;
+    }
+
+    inline std::shared_ptr<TextureFile> TextureFile::open(const char* filename) {
+        auto out = std::make_shared<TextureFile>();
+        out->self = out;
+        // 写时复制映射：Painter 可以直接在映射上绘制，而不会改动文件
+        if (!out->file.open(filename, true)) {
+            return nullptr;
+        }
+        const size_t size = out->file.size();
+        if (size < sizeof(TextureFileHeader)) {
+            std::cerr << "TextureFile Error: truncated header " << filename << std::endl;
+            return nullptr;
+        }
+        out->_header = reinterpret_cast<TextureFileHeader*>(out->file.data());
+        const TextureFileHeader& h = *out->_header;
+        if (memcmp(h.magic, MAGIC, sizeof(MAGIC)) != 0 || h.version != VERSION || h.layout != interleavedRowMajor) {
+            std::cerr << "TextureFile Error: bad header " << filename << std::endl;
+            return nullptr;
+        }
+        if (size < sizeof(TextureFileHeader) + sizeof(TextureFileLevel) * h.levelCount) {
+            std::cerr << "TextureFile Error: truncated level table " << filename << std::endl;
+            return nullptr;
+        }
+        out->_levels = reinterpret_cast<TextureFileLevel*>(out->file.data() + sizeof(TextureFileHeader));
+        for (size_t i = 0; i < h.levelCount; i++) {
+            const TextureFileLevel& l = out->_levels[i];
+            // 写成减法和除法，避免损坏的 offset + byteSize 或 width * height * 像素大小回绕后通过检查
+            const uint64_t pixelBytes = uint64_t(h.channel) * h.elementSize;
+            const uint64_t pixels = pixelBytes == 0 ? 0 : l.byteSize / pixelBytes;
+            if (l.offset > size || l.byteSize > size - l.offset || l.width == 0 || l.height == 0 || pixels == 0 ||
+                pixels * pixelBytes != l.byteSize || pixels % l.width != 0 || pixels / l.width != l.height) {
+                std::cerr << "TextureFile Error: bad level " << i << " in " << filename << std::endl;
+                return nullptr;
+            }
+            // level 0 与头部尺寸一致，之后每级减半（最小为 1），与 downsampleHalf 一致
+            const uint32_t expectW = (i == 0) ? h.width : std::max<uint32_t>(out->_levels[i - 1].width / 2, 1);
+            const uint32_t expectH = (i == 0) ? h.height : std::max<uint32_t>(out->_levels[i - 1].height / 2, 1);
+            if (l.width != expectW || l.height != expectH) {
+                std::cerr << "TextureFile Error: bad level size " << i << " in " << filename << std::endl;
+                return nullptr;
+            }
+        }
+        return out;
+    }
+
+    template <typename T>
+    bool TextureFile::load(const char* filename, ImageView<T>& view) {
+        std::shared_ptr<TextureFile> file = open(filename);
+        return file != nullptr && file->bind(view);
+    }
+
+    template <typename T>
+    bool TextureFile::bind(ImageView<T>& view) {
+        if (_header->elementType != TextureElement<T>::type || _header->elementSize != sizeof(T) || _header->levelCount == 0) {
+            std::cerr << "TextureFile Error: element type mismatch" << std::endl;
+            return false;
+        }
+        adoptLevel(0, view.texture);
+        view.mipmap.resize(_header->levelCount - 1);
+        for (size_t i = 1; i < _header->levelCount; i++) {
+            adoptLevel(i, view.mipmap[i - 1]);
+        }
+        view.changed = false; // mip 链已经在文件里
+        return true;
+    }
+
+    template <typename T>
+    void TextureFile::adoptLevel(size_t index, TextureBase<T>& dst) {
+        // 每一级都持有文件的引用，最后一级释放时才解除映射
+        std::shared_ptr<TextureFile> keep = self.lock();
+        T* ptr = reinterpret_cast<T*>(levelData(index));
+        dst.adopt(ptr, _levels[index].width, _levels[index].height, _header->channel, [keep](T*) {});
+    }
+
+    inline const TextureFileHeader& TextureFile::header() const {
+        return *_header;
+    }
+
+    inline size_t TextureFile::levelCount() const {
+        return _header->levelCount;
+    }
+
+    inline const TextureFileLevel& TextureFile::level(size_t index) const {
+        return _levels[index];
+    }
+
+    inline uint8_t* TextureFile::levelData(size_t index) {
+        return file.data() + _levels[index].offset;
+    }
+}
@@ -0,0 +1,219 @@
+#pragma once
+#include "RE_includes.h"
+#include "RE_Texture.hpp"
+#include "RE_ThreadPool.h"
+
+namespace RE {
+    using TextureHandle = std::shared_ptr<Texture>;
+    using TextureFuture = std::shared_future<TextureHandle>;
+
+    // 按字节预算做 LRU 淘汰的纹理缓存，被淘汰的纹理在外部仍持有 handle 时不会被释放
+    class TextureCache {
+    public:
+        explicit TextureCache(size_t byteBudget);
+        ~TextureCache();
+        TextureCache(const TextureCache&) = delete;
+        TextureCache(TextureCache&&) = delete;
+        TextureCache& operator=(const TextureCache&) = delete;
+        TextureCache& operator=(TextureCache&&) = delete;
+
+        // 命中时移到 LRU 头部，未命中返回 nullptr
+        TextureHandle find(const std::string& key);
+        void insert(const std::string& key, TextureHandle texture);
+        void erase(const std::string& key);
+        void clear();
+
+        void setBudget(size_t byteBudget);
+        size_t budget() const;
+        size_t usedBytes() const;
+        size_t size() const;
+
+        static size_t byteSize(const Texture& texture);
+
+    private:
+        struct Entry {
+            std::string key;
+            TextureHandle texture;
+            size_t bytes;
+        };
+
+        std::list<Entry> lru;
+        std::unordered_map<std::string, std::list<Entry>::iterator> index;
+        mutable std::mutex lock;
+        size_t _budget;
+        size_t _used;
+
+        void evict();
+    };
+
+    // 在线程池上并行解码图片，同一文件的并发请求共享同一个 future
+    class TextureLoader {
+    public:
+        TextureLoader(ThreadPool& pool = ThreadPool::global(), size_t cacheBudget = 512ull << 20);
+        ~TextureLoader();
+        TextureLoader(const TextureLoader&) = delete;
+        TextureLoader(TextureLoader&&) = delete;
+        TextureLoader& operator=(const TextureLoader&) = delete;
+        TextureLoader& operator=(TextureLoader&&) = delete;
+
+        // 解码失败时 future 的结果为 nullptr
+        TextureFuture load(const std::string& filename);
+        std::vector<TextureFuture> loadAll(const std::vector<std::string>& filenames);
+
+        TextureCache& cache();
+
+    private:
+        ThreadPool& pool;
+        TextureCache _cache;
+        std::unordered_map<std::string, TextureFuture> pending;
+        std::mutex pendingLock;
+
+        TextureHandle decode(const std::string& filename);
+    };
+}
+
+namespace RE {
+    inline TextureCache::TextureCache(size_t byteBudget) : _budget(byteBudget), _used(0) {}
+
+    inline TextureCache::~TextureCache() {}
+
+    inline TextureHandle TextureCache::find(const std::string& key) {
+        std::lock_guard<std::mutex> guard(lock);
+        auto it = index.find(key);
+        if (it == index.end()) {
+            return nullptr;
+        }
+        lru.splice(lru.begin(), lru, it->second);
+        return it->second->texture;
+    }
+
+    inline void TextureCache::insert(const std::string& key, TextureHandle texture) {
+        if (texture == nullptr) {
+            return;
+        }
+        const size_t bytes = byteSize(*texture);
+        std::lock_guard<std::mutex> guard(lock);
+        auto it = index.find(key);
+        if (it != index.end()) {
+            _used -= it->second->bytes;
+            lru.erase(it->second);
+            index.erase(it);
+        }
+        if (bytes > _budget) {
+            return; // 单张纹理超出预算时不缓存
+        }
+        lru.push_front(Entry{key, std::move(texture), bytes});
+        index[key] = lru.begin();
+        _used += bytes;
+        evict();
+    }
+
+    inline void TextureCache::erase(const std::string& key) {
+        std::lock_guard<std::mutex> guard(lock);
+        auto it = index.find(key);
+        if (it != index.end()) {
+            _used -= it->second->bytes;
+            lru.erase(it->second);
+            index.erase(it);
+        }
+    }
+
+    inline void TextureCache::clear() {
+        std::lock_guard<std::mutex> guard(lock);
+        lru.clear();
+        index.clear();
+        _used = 0;
+    }
+
+    inline void TextureCache::setBudget(size_t byteBudget) {
+        std::lock_guard<std::mutex> guard(lock);
+        _budget = byteBudget;
+        evict();
+    }
+
+    inline size_t TextureCache::budget() const {
+        std::lock_guard<std::mutex> guard(lock);
+        return _budget;
+    }
+
+    inline size_t TextureCache::usedBytes() const {
+        std::lock_guard<std::mutex> guard(lock);
+        return _used;
+    }
+
+    inline size_t TextureCache::size() const {
+        std::lock_guard<std::mutex> guard(lock);
+        return lru.size();
+    }
+
+    inline size_t TextureCache::byteSize(const Texture& texture) {
+        return texture.length() * sizeof(uint8_t);
+    }
+
+    inline void TextureCache::evict() {
+        while (_used > _budget && !lru.empty()) {
+            _used -= lru.back().bytes;
+            index.erase(lru.back().key);
+            lru.pop_back();
+        }
+    }
+
+    inline TextureLoader::TextureLoader(ThreadPool& pool, size_t cacheBudget) : pool(pool), _cache(cacheBudget) {}
+
+    inline TextureLoader::~TextureLoader() {
+        // 等待还在解码的任务，避免它们访问已析构的 loader
+        std::vector<TextureFuture> inFlight;
+        {
+            std::lock_guard<std::mutex> guard(pendingLock);
+            for (auto& i : pending) {
+                inFlight.push_back(i.second);
+            }
+        }
+        for (auto& f : inFlight) {
+            f.wait();
+        }
+    }
+
+    inline TextureFuture TextureLoader::load(const std::string& filename) {
+        if (TextureHandle cached = _cache.find(filename)) {
+            std::promise<TextureHandle> ready;
+            ready.set_value(std::move(cached));
+            return ready.get_future().share();
+        }
+
+        // 持锁提交，保证任务结束时从 pending 删除的一定是这次插入的 future
+        std::lock_guard<std::mutex> guard(pendingLock);
+        auto it = pending.find(filename);
+        if (it != pending.end()) {
+            return it->second;
+        }
+        TextureFuture result = pool.submit([this, filename]() { return decode(filename); }).share();
+        pending.emplace(filename, result);
+        return result;
+    }
+
+    inline std::vector<TextureFuture> TextureLoader::loadAll(const std::vector<std::string>& filenames) {
+        std::vector<TextureFuture> out;
+        out.reserve(filenames.size());
+        for (auto& f : filenames) {
+            out.push_back(load(f));
+        }
+        return out;
+    }
+
+    inline TextureCache& TextureLoader::cache() {
+        return _cache;
+    }
+
+    inline TextureHandle TextureLoader::decode(const std::string& filename) {
+        auto texture = std::make_shared<Texture>();
+        if (!texture->readPicture(filename.c_str())) {
+            texture = nullptr;
+        }
+        _cache.insert(filename, texture);
+
+        std::lock_guard<std::mutex> guard(pendingLock);
+        pending.erase(filename);
+        return texture;
+    }
+}
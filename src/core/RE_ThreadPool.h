@@ -1,129 +1,115 @@
 #pragma once
-#include "RE_Init.h"
-
-// namespace RE {
-//     class SpinLock {
-//     private:
-//         std::atomic_flag flag = ATOMIC_FLAG_INIT;
-
-//     public:
-//         SpinLock() {}
-
-//         void lock() {
-//             while (flag.test_and_set(std::memory_order_acquire)) {
-//                 // 如果锁已经被其他线程占用，则自旋等待
-//                 std::this_thread::yield();
-//             }
-//         }
-
-//         void unlock() {
-//             flag.clear(std::memory_order_release);
-//         }
-
-//         bool tryLocked() {
-//             return flag.test_and_set(std::memory_order_acquire);
-//         }
-//     };
-
-//     class primaryThread {
-//     public:
-//         primaryThread() :stop(false), empty(true) {
-//             std::thread thr(mainloop, this);
-//             thr.detach();
-//         }
-//         ~primaryThread() {
-//             for (auto& i : workQue) {
-//                 delete i;
-//             }
-//         }
-//         bool tryAddTask(std::function<void()>* task) {
-//             //REDebug << task;
-//             if (lck.tryLocked()) {
-//                 workQue.push_back(task);
-//                 empty = false;
-//                 lck.unlock();
-//                 //REDebug << std::boolalpha << true;
-//                 return true;
-//             } else {
-//                 //REDebug << std::boolalpha << false;
-//                 return false;
-//             }
-//         }
-//         void _stopThread() {
-//             stop = true;
-//         }
-//     private:
-//         bool stop;
-//         bool empty;
-//         std::deque<std::function<void()>*> workQue;
-//         std::thread::id id;
-//         SpinLock lck;
-
-//         std::function<void()>* getTask() {
-//             lck.lock();
-//             std::function<void()>* out = workQue.front();
-//             workQue.pop_front();
-//             empty = workQue.empty();
-//             lck.unlock();
-//             return out;
-//         };
-
-//         static void mainloop(primaryThread* threadManager) {
-//             threadManager->id = std::this_thread::get_id();
-//             while (!threadManager->stop) {
-//                 if (!threadManager->empty) {
-//                     std::function<void()>* task = threadManager->getTask();
-//                     try {
-//                         (*task)();
-//                         delete task;
-//                     } catch (const std::runtime_error& e) {
-//                         std::cerr << "Caught exception: " << e.what() << std::endl;
-//                         REDebug << task;
-//                     }
-//                 } else {
-//                     std::this_thread::yield();
-//                 }
-//             }
-//             delete threadManager;
-//         }
-//     };
-
-
-//     class ThreadPool {
-//     public:
-//         ThreadPool() {
-//             int coreNum = getCoreNumber();
-//             std::cout << "Number of CPU cores: " << coreNum << std::endl;
-
-//             for (size_t i = 0; i < /*coreNum - 4*/6; i++) {
-//                 createThread();
-//             }
-//         }
-//         ~ThreadPool() {
-//             for (auto& i : threadList) {
-//                 i->_stopThread(); // 子线程终止会自动删除primaryThread对象
-//             }
-//         }
-
-//         void submit(std::function<void()> task) {
-//             size_t i = 0;
-//             size_t max = threadList.size();
-//             std::function<void()>* fptr = new std::function<void()>(task); //函数对象禁止拷贝
-
-//             while (!threadList[i]->tryAddTask(fptr)) {
-//                 i = (i < max - 1) ? (i + 1) : (0);
-//             }
-//         }
-//     private:
-//         std::vector<primaryThread*> threadList;
-
-//         void createThread() {
-//             auto newthread = new primaryThread();
-//             threadList.push_back(newthread);
-//         }
-
-//         int getCoreNumber() {
-//             return std::thread::hardware_concurrency();
-//         }
-//     }threadPool;
-// }
\ No newline at end of file
+#include "RE_includes.h"
+
+namespace RE {
+    class ThreadPool {
+    public:
+        // threadCount 为 0 时使用硬件线程数
+        explicit ThreadPool(size_t threadCount = 0);
+        ~ThreadPool();
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool(ThreadPool&&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+        ThreadPool& operator=(ThreadPool&&) = delete;
+
+        template <typename FN_T, typename... Args>
+        auto submit(FN_T&& func, Args&&... args) -> std::future<std::invoke_result_t<FN_T, Args...>>;
+
+        size_t size() const;
+
+        // 等待队列清空且所有任务执行完毕
+        void wait();
+
+        // 全局线程池，首次调用时创建
+        static ThreadPool& global();
+
+    private:
+        std::vector<std::thread> workers;
+        std::deque<std::function<void()>> tasks;
+        std::mutex taskLock;
+        std::condition_variable taskReady;
+        std::condition_variable taskDone;
+        size_t running;
+        bool stop;
+
+        void mainloop();
+    };
+}
+
+namespace RE {
+    inline ThreadPool::ThreadPool(size_t threadCount) : running(0), stop(false) {
+        if (threadCount == 0) {
+            threadCount = std::max(1u, std::thread::hardware_concurrency());
+        }
+        workers.reserve(threadCount);
+        for (size_t i = 0; i < threadCount; i++) {
+            workers.emplace_back(&ThreadPool::mainloop, this);
+        }
+    }
+
+    inline ThreadPool::~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(taskLock);
+            stop = true;
+        }
+        taskReady.notify_all();
+        for (auto& t : workers) {
+            t.join();
+        }
+    }
+
+    template <typename FN_T, typename... Args>
+    auto ThreadPool::submit(FN_T&& func, Args&&... args) -> std::future<std::invoke_result_t<FN_T, Args...>> {
+        using Result_T = std::invoke_result_t<FN_T, Args...>;
+        // std::function 要求可拷贝，所以 packaged_task 放在 shared_ptr 里
+        auto task = std::make_shared<std::packaged_task<Result_T()>>(
+            std::bind(std::forward<FN_T>(func), std::forward<Args>(args)...));
+        std::future<Result_T> result = task->get_future();
+        {
+            std::lock_guard<std::mutex> lock(taskLock);
+            tasks.emplace_back([task]() { (*task)(); });
+        }
+        taskReady.notify_one();
+        return result;
+    }
+
+    inline size_t ThreadPool::size() const {
+        return workers.size();
+    }
+
+    inline void ThreadPool::wait() {
+        std::unique_lock<std::mutex> lock(taskLock);
+        taskDone.wait(lock, [this]() { return tasks.empty() && running == 0; });
+    }
+
+    inline ThreadPool& ThreadPool::global() {
+        static ThreadPool pool;
+        return pool;
+    }
+
+    inline void ThreadPool::mainloop() {
+        while (true) {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(taskLock);
+                taskReady.wait(lock, [this]() { return stop || !tasks.empty(); });
+                if (stop && tasks.empty()) {
+                    return;
+                }
+                task = std::move(tasks.front());
+                tasks.pop_front();
+                running++;
+            }
+
+            task(); // 异常由 packaged_task 转交给 future
+
+            {
+                std::lock_guard<std::mutex> lock(taskLock);
+                running--;
+                if (tasks.empty() && running == 0) {
+                    taskDone.notify_all();
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,220 @@
+#pragma once
+#include "RE_includes.h"
+#include "RE_Texture.hpp"
+
+namespace RE {
+    enum ToneMapOperator {
+        linearClamp = 0,
+        reinhard,
+        reinhardExtended,
+        acesFilmic,
+    };
+
+    struct ToneMapSettings {
+        ToneMapOperator op = acesFilmic;
+        float exposure = 1.0f;
+        float whitePoint = 4.0f; // reinhardExtended 中映射到 1 的亮度
+    };
+
+    // 线性 [0, 1] 到 8 位 sRGB 的查找表，4096 级足够让每个 8 位输出值都能被命中
+    class SRGBTable {
+    public:
+        static constexpr size_t SIZE = 4096;
+        static const uint8_t* get();
+        static uint8_t encode(float linear);
+        static float decode(uint8_t srgb);
+
+    private:
+        static float encodeExact(float linear);
+    };
+
+    float toneMap(float x, const ToneMapSettings& settings);
+
+    // 色调映射并编码成 sRGB，按 tile 多线程处理，src 与 dst 尺寸需相同，通道数可以是 3 或 4
+    // 第 4 通道视为线性 alpha，不做色调映射也不做 sRGB 编码
+    void resolveHDR(const HDRTexture& src, Texture& dst, const ToneMapSettings& settings = ToneMapSettings());
+
+    // 对连续 count 个 float 做色调映射和编码，channel 为 4 时每个像素的第 4 个值按 alpha 处理
+    void toneMapSpan(const float* in, uint8_t* out, size_t count, size_t channel, const ToneMapSettings& settings);
+}
+
+namespace RE {
+    inline const uint8_t* SRGBTable::get() {
+        static const std::vector<uint8_t> table = []() {
+            std::vector<uint8_t> t(SIZE);
+            for (size_t i = 0; i < SIZE; i++) {
+                t[i] = static_cast<uint8_t>(encodeExact(i / static_cast<float>(SIZE - 1)) * 255.0f + 0.5f);
+            }
+            return t;
+        }();
+        return table.data();
+    }
+
+    inline uint8_t SRGBTable::encode(float linear) {
+        const float x = RE::camp(linear, 0.0f, 1.0f);
+        return get()[static_cast<size_t>(x * (SIZE - 1) + 0.5f)];
+    }
+
+    inline float SRGBTable::decode(uint8_t srgb) {
+        static const std::vector<float> table = []() {
+            std::vector<float> t(256);
+            for (size_t i = 0; i < 256; i++) {
+                const float c = i / 255.0f;
+                t[i] = (c <= 0.04045f) ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+            }
+            return t;
+        }();
+        return table[srgb];
+    }
+
+    inline float SRGBTable::encodeExact(float linear) {
+        return (linear <= 0.0031308f) ? linear * 12.92f : 1.055f * std::pow(linear, 1.0f / 2.4f) - 0.055f;
+    }
+
+    inline float toneMap(float x, const ToneMapSettings& settings) {
+        x = std::max(x * settings.exposure, 0.0f);
+        switch (settings.op) {
+        case linearClamp:
+            break;
+        case reinhard:
+            x = x / (1.0f + x);
+            break;
+        case reinhardExtended:
+            x = x * (1.0f + x / (settings.whitePoint * settings.whitePoint)) / (1.0f + x);
+            break;
+        case acesFilmic:
+            // Narkowicz 2015 的 ACES 拟合
+            x = (x * (2.51f * x + 0.03f)) / (x * (2.43f * x + 0.59f) + 0.14f);
+            break;
+        }
+        return std::min(x, 1.0f);
+    }
+
+#if defined(RE_SIMD_AVX2)
+    RE_FORCEINLINE __m256 toneMap8(__m256 x, const ToneMapSettings& settings) {
+        const __m256 one = _mm256_set1_ps(1.0f);
+        x = _mm256_max_ps(_mm256_mul_ps(x, _mm256_set1_ps(settings.exposure)), _mm256_setzero_ps());
+        switch (settings.op) {
+        case linearClamp:
+            break;
+        case reinhard:
+            x = _mm256_div_ps(x, _mm256_add_ps(one, x));
+            break;
+        case reinhardExtended: {
+            const __m256 invW2 = _mm256_set1_ps(1.0f / (settings.whitePoint * settings.whitePoint));
+            x = _mm256_div_ps(_mm256_mul_ps(x, _mm256_add_ps(one, _mm256_mul_ps(x, invW2))), _mm256_add_ps(one, x));
+            break;
+        }
+        case acesFilmic: {
+            const __m256 num = _mm256_mul_ps(x, _mm256_add_ps(_mm256_mul_ps(x, _mm256_set1_ps(2.51f)), _mm256_set1_ps(0.03f)));
+            const __m256 den = _mm256_add_ps(_mm256_mul_ps(x, _mm256_add_ps(_mm256_mul_ps(x, _mm256_set1_ps(2.43f)), _mm256_set1_ps(0.59f))), _mm256_set1_ps(0.14f));
+            x = _mm256_div_ps(num, den);
+            break;
+        }
+        }
+        return _mm256_min_ps(x, one);
+    }
+#elif defined(RE_SIMD_SSE2)
+    RE_FORCEINLINE __m128 toneMap4(__m128 x, const ToneMapSettings& settings) {
+        const __m128 one = _mm_set1_ps(1.0f);
+        x = _mm_max_ps(_mm_mul_ps(x, _mm_set1_ps(settings.exposure)), _mm_setzero_ps());
+        switch (settings.op) {
+        case linearClamp:
+            break;
+        case reinhard:
+            x = _mm_div_ps(x, _mm_add_ps(one, x));
+            break;
+        case reinhardExtended: {
+            const __m128 invW2 = _mm_set1_ps(1.0f / (settings.whitePoint * settings.whitePoint));
+            x = _mm_div_ps(_mm_mul_ps(x, _mm_add_ps(one, _mm_mul_ps(x, invW2))), _mm_add_ps(one, x));
+            break;
+        }
+        case acesFilmic: {
+            const __m128 num = _mm_mul_ps(x, _mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(2.51f)), _mm_set1_ps(0.03f)));
+            const __m128 den = _mm_add_ps(_mm_mul_ps(x, _mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(2.43f)), _mm_set1_ps(0.59f))), _mm_set1_ps(0.14f));
+            x = _mm_div_ps(num, den);
+            break;
+        }
+        }
+        return _mm_min_ps(x, one);
+    }
+#endif
+
+    inline void toneMapSpan(const float* in, uint8_t* out, size_t count, size_t channel, const ToneMapSettings& settings) {
+        const uint8_t* lut = SRGBTable::get();
+        size_t i = 0;
+#if defined(RE_SIMD_AVX2)
+        const __m256 scale = _mm256_set1_ps(SRGBTable::SIZE - 1);
+        alignas(32) int32_t idx[8];
+        for (; i + 8 <= count; i += 8) {
+            const __m256 x = toneMap8(_mm256_loadu_ps(in + i), settings);
+            _mm256_store_si256(reinterpret_cast<__m256i*>(idx), _mm256_cvtps_epi32(_mm256_mul_ps(x, scale)));
+            for (size_t k = 0; k < 8; k++) {
+                out[i + k] = lut[idx[k]];
+            }
+        }
+#elif defined(RE_SIMD_SSE2)
+        const __m128 scale = _mm_set1_ps(SRGBTable::SIZE - 1);
+        alignas(16) int32_t idx[4];
+        for (; i + 4 <= count; i += 4) {
+            const __m128 x = toneMap4(_mm_loadu_ps(in + i), settings);
+            _mm_store_si128(reinterpret_cast<__m128i*>(idx), _mm_cvtps_epi32(_mm_mul_ps(x, scale)));
+            out[i] = lut[idx[0]];
+            out[i + 1] = lut[idx[1]];
+            out[i + 2] = lut[idx[2]];
+            out[i + 3] = lut[idx[3]];
+        }
+#endif
+        for (; i < count; i++) {
+            out[i] = lut[static_cast<size_t>(toneMap(in[i], settings) * (SRGBTable::SIZE - 1) + 0.5f)];
+        }
+
+        if (channel == 4) {
+            for (size_t a = 3; a < count; a += 4) {
+                out[a] = static_cast<uint8_t>(RE::camp(in[a], 0.0f, 1.0f) * 255.0f + 0.5f);
+            }
+        }
+    }
+
+    inline void resolveHDR(const HDRTexture& src, Texture& dst, const ToneMapSettings& settings) {
+        constexpr size_t TILE = 64;
+        const size_t w = std::min(src.width(), dst.width());
+        const size_t h = std::min(src.height(), dst.height());
+        const size_t sc = src.channel();
+        const size_t dc = dst.channel();
+        // 重排缓冲按每像素最多 4 个通道分配
+        if (sc == 0 || sc > 4 || dc == 0 || dc > 4) {
+            std::cerr << "resolveHDR Error: unsupported channel count " << sc << " -> " << dc << std::endl;
+            return;
+        }
+        const size_t tilesX = (w + TILE - 1) / TILE;
+        const size_t tilesY = (h + TILE - 1) / TILE;
+        const float* in = src.data();
+        uint8_t* out = dst.data();
+
+#pragma omp parallel for schedule(dynamic)
+        for (int64_t tile = 0; tile < static_cast<int64_t>(tilesX * tilesY); tile++) {
+            const size_t x0 = (tile % tilesX) * TILE;
+            const size_t y0 = (tile / tilesX) * TILE;
+            const size_t x1 = std::min(x0 + TILE, w);
+            const size_t y1 = std::min(y0 + TILE, h);
+            uint8_t repack[TILE * 4];
+
+            for (size_t y = y0; y < y1; y++) {
+                const float* row = in + src.getIndex(x0, y);
+                uint8_t* target = out + dst.getIndex(x0, y);
+                if (sc == dc) {
+                    toneMapSpan(row, target, (x1 - x0) * sc, sc, settings);
+                    continue;
+                }
+                // 通道数不同（如 RGBA 的 HDR 输出到 RGB24 窗口）时先映射再重排
+                toneMapSpan(row, repack, (x1 - x0) * sc, sc, settings);
+                for (size_t x = 0; x < x1 - x0; x++) {
+                    for (size_t k = 0; k < dc; k++) {
+                        target[x * dc + k] = (k < sc) ? repack[x * sc + k] : 255;
+                    }
+                }
+            }
+        }
+    }
+}
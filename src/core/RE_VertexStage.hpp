@@ -0,0 +1,673 @@
+#pragma once
+#include "RE_includes.h"
+#include "RE_Geometry3D.hpp"
+#include "RE_Renderer.hpp"
+
+namespace RE {
+    // 视口：NDC 映射到屏幕像素（y 向下），NDC 深度 [0, 1] 映射到 [minDepth, maxDepth]
+    struct Viewport {
+        float x = 0.0f;
+        float y = 0.0f;
+        float width = 1.0f;
+        float height = 1.0f;
+        float minDepth = 0.0f;
+        float maxDepth = 1.0f;
+    };
+
+    // 顶点在裁剪空间里的位置码，每一位表示在对应平面的外侧
+    enum ClipCode : uint32_t {
+        clipLeft = 1 << 0,
+        clipRight = 1 << 1,
+        clipBottom = 1 << 2,
+        clipTop = 1 << 3,
+        clipNear = 1 << 4,
+        clipFar = 1 << 5,
+        clipGuardBand = 1 << 6, // 超出保护带，屏幕坐标过大，需要真正裁剪
+        clipFrustum = clipLeft | clipRight | clipBottom | clipTop | clipNear | clipFar,
+    };
+
+    struct CullSettings {
+        bool frustum = true;       // 三个顶点都在同一个平面外侧时剔除
+        bool backFace = false;     // 剔除屏幕空间面积为负的三角形，与 Rasterizer::setCullBackFace 的约定一致
+        bool degenerate = true;    // 剔除面积为 0（或 NaN）的三角形
+        bool smallTriangle = true; // 剔除包围盒内不含像素中心的三角形；使用 MSAA 或亚像素抖动时应关闭
+        float guardBand = 4.0f;    // 保护带为视口的多少倍（NDC），只有跨过近平面或超出保护带的三角形才会被裁剪
+    };
+
+    struct CullStats {
+        size_t triangles = 0;
+        size_t frustum = 0;
+        size_t backFace = 0;
+        size_t degenerate = 0;
+        size_t small = 0;
+        size_t clipped = 0;       // 需要裁剪的三角形数
+        size_t clippedOutput = 0; // 裁剪后输出的三角形数
+    };
+
+    // 裁剪产生的三角形，position 的约定与 RasterVertex::position 相同
+    // weight[i] 为第 i 个顶点相对原三角形三个顶点（source）的重心权重，用于插值属性
+    struct ClippedTriangle {
+        uint32_t source[3];
+        glm::vec4 position[3];
+        glm::vec3 weight[3];
+
+        RasterVertex vertex(size_t index, hrgba color = hrgba(1.0f)) const;
+    };
+
+    // 顶点阶段的输出，变换后的顶点按 SoA 存放，约定与 RasterVertex::position 相同：
+    // x / y 为屏幕像素坐标，z 为深度，w 为 1 / w_clip
+    // source 是每个输出顶点对应的网格顶点下标，用于取法线、纹理坐标等属性；indices 为指向输出顶点的三角形列表
+    // indices 只包含通过剔除且不需要裁剪的三角形，裁剪后的三角形单独放在 clipped 里
+    struct VertexBatch {
+        std::vector<float> x, y, z, w;
+        std::vector<uint32_t> source;
+        std::vector<uint32_t> indices;
+        std::vector<ClippedTriangle> clipped;
+
+        size_t vertexCount() const;
+        size_t triangleCount() const;
+        void resize(size_t vertexCount, size_t indexCount);
+        void clear();
+        RasterVertex vertex(size_t index, hrgba color = hrgba(1.0f)) const;
+    };
+
+    // 批量顶点变换：按索引块分给各线程，每块用一个以网格顶点下标为键的 post-transform 缓存去掉重复变换，
+    // 未命中的顶点收集起来按 8 / 4 个一组以 SoA 形式做矩阵变换、透视除法和视口映射，同时算出位置码
+    // 随后在同一块内按 8 / 4 个三角形一组做剔除，极少数跨过近平面或超出保护带的三角形才进入裁剪
+    class VertexStage {
+    public:
+        static constexpr size_t CACHE_SIZE = 256;  // 直接映射，必须是 2 的幂
+        static constexpr size_t CHUNK = 3 * 4096;  // 每个任务处理的索引数
+
+        void setTransform(const glm::mat4& mvp);
+        void setViewport(const Viewport& viewport);
+        void setCulling(const CullSettings& settings);
+        const glm::mat4& transform() const;
+        const Viewport& viewport() const;
+        const CullSettings& culling() const;
+
+        // 处理整个网格，结果写入 out（覆盖原内容）
+        void process(const Mesh& mesh, VertexBatch& out);
+        // 上一次 process 的索引数与实际变换的顶点数，二者之比为缓存命中带来的节省
+        size_t lastIndexCount() const;
+        size_t lastTransformCount() const;
+        const CullStats& lastCullStats() const;
+
+    private:
+        glm::mat4 mvp = glm::mat4(1.0f);
+        Viewport _viewport;
+        CullSettings _culling;
+        size_t indexCount = 0;
+        size_t transformCount = 0;
+        CullStats stats;
+    };
+
+    namespace vertex {
+        enum TriangleClass : uint8_t {
+            triangleVisible = 0,
+            triangleFrustum,
+            triangleBackFace,
+            triangleDegenerate,
+            triangleSmall,
+            triangleClip,
+        };
+
+        // n 个顶点的 SoA 变换：in 为物体空间坐标，out 为屏幕坐标、深度与 1 / w_clip，out 可以与 in 重叠
+        // outCode 不为 nullptr 时同时写出 ClipCode
+        void transformSoA(const float* inX, const float* inY, const float* inZ, size_t n, const glm::mat4& m, const Viewport& vp, float* outX, float* outY,
+                          float* outZ, float* outW, float guardBand = 4.0f, uint32_t* outCode = nullptr);
+        // count 个三角形的分类（TriangleClass），优先级：视锥 > 裁剪 > 退化 > 背面 > 小三角形
+        void classifyTriangles(const uint32_t* indices, size_t count, const float* x, const float* y, const uint32_t* code, const CullSettings& settings,
+                               uint8_t* out);
+        // 在齐次裁剪空间里把三角形裁成多边形（近平面，以及 planes 含 clipGuardBand 时的保护带），扇形拆分后追加到 out，返回输出的三角形数
+        size_t clipTriangle(const glm::vec4 clip[3], const uint32_t source[3], uint32_t planes, const Viewport& vp, const CullSettings& settings,
+                            std::vector<ClippedTriangle>& out);
+    }
+}
+
+namespace RE {
+    inline RasterVertex ClippedTriangle::vertex(size_t i, hrgba color) const {
+        RasterVertex v;
+        v.position = position[i];
+        v.color = color;
+        return v;
+    }
+
+    inline size_t VertexBatch::vertexCount() const {
+        return x.size();
+    }
+
+    inline size_t VertexBatch::triangleCount() const {
+        return indices.size() / 3;
+    }
+
+    inline void VertexBatch::resize(size_t vertexCount, size_t indexCount) {
+        x.resize(vertexCount);
+        y.resize(vertexCount);
+        z.resize(vertexCount);
+        w.resize(vertexCount);
+        source.resize(vertexCount);
+        indices.resize(indexCount);
+    }
+
+    inline void VertexBatch::clear() {
+        resize(0, 0);
+        clipped.clear();
+    }
+
+    inline RasterVertex VertexBatch::vertex(size_t i, hrgba color) const {
+        RasterVertex v;
+        v.position = glm::vec4(x[i], y[i], z[i], w[i]);
+        v.color = color;
+        return v;
+    }
+
+    inline void VertexStage::setTransform(const glm::mat4& m) {
+        mvp = m;
+    }
+
+    inline void VertexStage::setViewport(const Viewport& vp) {
+        _viewport = vp;
+    }
+
+    inline void VertexStage::setCulling(const CullSettings& settings) {
+        _culling = settings;
+    }
+
+    inline const glm::mat4& VertexStage::transform() const {
+        return mvp;
+    }
+
+    inline const Viewport& VertexStage::viewport() const {
+        return _viewport;
+    }
+
+    inline const CullSettings& VertexStage::culling() const {
+        return _culling;
+    }
+
+    inline size_t VertexStage::lastIndexCount() const {
+        return indexCount;
+    }
+
+    inline size_t VertexStage::lastTransformCount() const {
+        return transformCount;
+    }
+
+    inline const CullStats& VertexStage::lastCullStats() const {
+        return stats;
+    }
+
+    inline void vertex::transformSoA(const float* inX, const float* inY, const float* inZ, size_t n, const glm::mat4& m, const Viewport& vp, float* outX,
+                                     float* outY, float* outZ, float* outW, float guardBand, uint32_t* outCode) {
+        // screen.x = (ndc.x * 0.5 + 0.5) * width + x，screen.y = (0.5 - ndc.y * 0.5) * height + y
+        const float sx = vp.width * 0.5f, ox = vp.x + vp.width * 0.5f;
+        const float sy = -vp.height * 0.5f, oy = vp.y + vp.height * 0.5f;
+        const float sz = vp.maxDepth - vp.minDepth, oz = vp.minDepth;
+        size_t i = 0;
+#if defined(RE_SIMD_AVX2)
+        {
+            __m256 c[4][4];
+            for (int col = 0; col < 4; col++) {
+                for (int row = 0; row < 4; row++) {
+                    c[col][row] = _mm256_set1_ps(m[col][row]);
+                }
+            }
+            const __m256 zero = _mm256_setzero_ps();
+            const __m256 one = _mm256_set1_ps(1.0f);
+            const __m256 guard = _mm256_set1_ps(guardBand);
+            const __m256 absMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+            const __m256 vsx = _mm256_set1_ps(sx), vox = _mm256_set1_ps(ox);
+            const __m256 vsy = _mm256_set1_ps(sy), voy = _mm256_set1_ps(oy);
+            const __m256 vsz = _mm256_set1_ps(sz), voz = _mm256_set1_ps(oz);
+            auto bit = [](__m256 mask, uint32_t b) { return _mm256_and_si256(_mm256_castps_si256(mask), _mm256_set1_epi32(b)); };
+            for (; i + 8 <= n; i += 8) {
+                const __m256 px = _mm256_loadu_ps(inX + i);
+                const __m256 py = _mm256_loadu_ps(inY + i);
+                const __m256 pz = _mm256_loadu_ps(inZ + i);
+                __m256 clip[4];
+                for (int row = 0; row < 4; row++) {
+                    clip[row] = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(c[0][row], px), _mm256_mul_ps(c[1][row], py)),
+                                              _mm256_add_ps(_mm256_mul_ps(c[2][row], pz), c[3][row]));
+                }
+                if (outCode != nullptr) {
+                    const __m256 w = clip[3];
+                    const __m256 negW = _mm256_sub_ps(zero, w);
+                    const __m256 gw = _mm256_mul_ps(guard, w);
+                    __m256i code = _mm256_or_si256(bit(_mm256_cmp_ps(clip[0], negW, _CMP_LT_OQ), clipLeft), bit(_mm256_cmp_ps(clip[0], w, _CMP_GT_OQ), clipRight));
+                    code = _mm256_or_si256(code, bit(_mm256_cmp_ps(clip[1], negW, _CMP_LT_OQ), clipBottom));
+                    code = _mm256_or_si256(code, bit(_mm256_cmp_ps(clip[1], w, _CMP_GT_OQ), clipTop));
+                    code = _mm256_or_si256(code, bit(_mm256_or_ps(_mm256_cmp_ps(clip[2], zero, _CMP_LT_OQ), _mm256_cmp_ps(w, zero, _CMP_LE_OQ)), clipNear));
+                    code = _mm256_or_si256(code, bit(_mm256_cmp_ps(clip[2], w, _CMP_GT_OQ), clipFar));
+                    const __m256 outside = _mm256_or_ps(_mm256_cmp_ps(_mm256_and_ps(clip[0], absMask), gw, _CMP_GT_OQ),
+                                                        _mm256_cmp_ps(_mm256_and_ps(clip[1], absMask), gw, _CMP_GT_OQ));
+                    code = _mm256_or_si256(code, bit(outside, clipGuardBand));
+                    _mm256_storeu_si256(reinterpret_cast<__m256i*>(outCode + i), code);
+                }
+                const __m256 invW = _mm256_div_ps(one, clip[3]);
+                _mm256_storeu_ps(outX + i, _mm256_add_ps(_mm256_mul_ps(_mm256_mul_ps(clip[0], invW), vsx), vox));
+                _mm256_storeu_ps(outY + i, _mm256_add_ps(_mm256_mul_ps(_mm256_mul_ps(clip[1], invW), vsy), voy));
+                _mm256_storeu_ps(outZ + i, _mm256_add_ps(_mm256_mul_ps(_mm256_mul_ps(clip[2], invW), vsz), voz));
+                _mm256_storeu_ps(outW + i, invW);
+            }
+        }
+#endif
+#if defined(RE_SIMD_SSE2)
+        {
+            __m128 c[4][4];
+            for (int col = 0; col < 4; col++) {
+                for (int row = 0; row < 4; row++) {
+                    c[col][row] = _mm_set1_ps(m[col][row]);
+                }
+            }
+            const __m128 zero = _mm_setzero_ps();
+            const __m128 one = _mm_set1_ps(1.0f);
+            const __m128 guard = _mm_set1_ps(guardBand);
+            const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+            const __m128 vsx = _mm_set1_ps(sx), vox = _mm_set1_ps(ox);
+            const __m128 vsy = _mm_set1_ps(sy), voy = _mm_set1_ps(oy);
+            const __m128 vsz = _mm_set1_ps(sz), voz = _mm_set1_ps(oz);
+            auto bit = [](__m128 mask, uint32_t b) { return _mm_and_si128(_mm_castps_si128(mask), _mm_set1_epi32(b)); };
+            for (; i + 4 <= n; i += 4) {
+                const __m128 px = _mm_loadu_ps(inX + i);
+                const __m128 py = _mm_loadu_ps(inY + i);
+                const __m128 pz = _mm_loadu_ps(inZ + i);
+                __m128 clip[4];
+                for (int row = 0; row < 4; row++) {
+                    clip[row] = _mm_add_ps(_mm_add_ps(_mm_mul_ps(c[0][row], px), _mm_mul_ps(c[1][row], py)), _mm_add_ps(_mm_mul_ps(c[2][row], pz), c[3][row]));
+                }
+                if (outCode != nullptr) {
+                    const __m128 w = clip[3];
+                    const __m128 negW = _mm_sub_ps(zero, w);
+                    const __m128 gw = _mm_mul_ps(guard, w);
+                    __m128i code = _mm_or_si128(bit(_mm_cmplt_ps(clip[0], negW), clipLeft), bit(_mm_cmpgt_ps(clip[0], w), clipRight));
+                    code = _mm_or_si128(code, bit(_mm_cmplt_ps(clip[1], negW), clipBottom));
+                    code = _mm_or_si128(code, bit(_mm_cmpgt_ps(clip[1], w), clipTop));
+                    code = _mm_or_si128(code, bit(_mm_or_ps(_mm_cmplt_ps(clip[2], zero), _mm_cmple_ps(w, zero)), clipNear));
+                    code = _mm_or_si128(code, bit(_mm_cmpgt_ps(clip[2], w), clipFar));
+                    const __m128 outside = _mm_or_ps(_mm_cmpgt_ps(_mm_and_ps(clip[0], absMask), gw), _mm_cmpgt_ps(_mm_and_ps(clip[1], absMask), gw));
+                    code = _mm_or_si128(code, bit(outside, clipGuardBand));
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(outCode + i), code);
+                }
+                const __m128 invW = _mm_div_ps(one, clip[3]);
+                _mm_storeu_ps(outX + i, _mm_add_ps(_mm_mul_ps(_mm_mul_ps(clip[0], invW), vsx), vox));
+                _mm_storeu_ps(outY + i, _mm_add_ps(_mm_mul_ps(_mm_mul_ps(clip[1], invW), vsy), voy));
+                _mm_storeu_ps(outZ + i, _mm_add_ps(_mm_mul_ps(_mm_mul_ps(clip[2], invW), vsz), voz));
+                _mm_storeu_ps(outW + i, invW);
+            }
+        }
+#endif
+        for (; i < n; i++) {
+            const glm::vec4 clip = m * glm::vec4(inX[i], inY[i], inZ[i], 1.0f);
+            if (outCode != nullptr) {
+                const float gw = guardBand * clip.w;
+                outCode[i] = (clip.x < -clip.w ? clipLeft : 0) | (clip.x > clip.w ? clipRight : 0) | (clip.y < -clip.w ? clipBottom : 0) |
+                             (clip.y > clip.w ? clipTop : 0) | (clip.z < 0.0f || clip.w <= 0.0f ? clipNear : 0) | (clip.z > clip.w ? clipFar : 0) |
+                             (std::abs(clip.x) > gw || std::abs(clip.y) > gw ? clipGuardBand : 0);
+            }
+            const float invW = 1.0f / clip.w;
+            outX[i] = clip.x * invW * sx + ox;
+            outY[i] = clip.y * invW * sy + oy;
+            outZ[i] = clip.z * invW * sz + oz;
+            outW[i] = invW;
+        }
+    }
+
+    inline void vertex::classifyTriangles(const uint32_t* indices, size_t count, const float* x, const float* y, const uint32_t* code,
+                                          const CullSettings& settings, uint8_t* out) {
+        const uint32_t frustumMask = settings.frustum ? clipFrustum : 0u;
+        size_t t = 0;
+#if defined(RE_SIMD_AVX2)
+        {
+            const __m256i offsets = _mm256_setr_epi32(0, 3, 6, 9, 12, 15, 18, 21);
+            const __m256i zeroI = _mm256_setzero_si256();
+            const __m256i vFrustum = _mm256_set1_epi32(frustumMask);
+            const __m256i vClip = _mm256_set1_epi32(clipNear | clipGuardBand);
+            const __m256 zero = _mm256_setzero_ps();
+            const __m256 half = _mm256_set1_ps(0.5f);
+            const __m256 enableBack = _mm256_castsi256_ps(_mm256_set1_epi32(settings.backFace ? -1 : 0));
+            const __m256 enableDegenerate = _mm256_castsi256_ps(_mm256_set1_epi32(settings.degenerate ? -1 : 0));
+            const __m256 enableSmall = _mm256_castsi256_ps(_mm256_set1_epi32(settings.smallTriangle ? -1 : 0));
+            auto select = [](__m256i result, __m256 mask, int value) {
+                return _mm256_blendv_epi8(result, _mm256_set1_epi32(value), _mm256_castps_si256(mask));
+            };
+            for (; t + 8 <= count; t += 8) {
+                const int* base = reinterpret_cast<const int*>(indices + t * 3);
+                const __m256i i0 = _mm256_i32gather_epi32(base, offsets, 4);
+                const __m256i i1 = _mm256_i32gather_epi32(base + 1, offsets, 4);
+                const __m256i i2 = _mm256_i32gather_epi32(base + 2, offsets, 4);
+                const int* codes = reinterpret_cast<const int*>(code);
+                const __m256i c0 = _mm256_i32gather_epi32(codes, i0, 4);
+                const __m256i c1 = _mm256_i32gather_epi32(codes, i1, 4);
+                const __m256i c2 = _mm256_i32gather_epi32(codes, i2, 4);
+                const __m256i andCode = _mm256_and_si256(_mm256_and_si256(c0, c1), c2);
+                const __m256i orCode = _mm256_or_si256(_mm256_or_si256(c0, c1), c2);
+                const __m256 frustum = _mm256_castsi256_ps(_mm256_xor_si256(_mm256_cmpeq_epi32(_mm256_and_si256(andCode, vFrustum), zeroI), _mm256_set1_epi32(-1)));
+                const __m256 needClip = _mm256_castsi256_ps(_mm256_xor_si256(_mm256_cmpeq_epi32(_mm256_and_si256(orCode, vClip), zeroI), _mm256_set1_epi32(-1)));
+
+                const __m256 x0 = _mm256_i32gather_ps(x, i0, 4), y0 = _mm256_i32gather_ps(y, i0, 4);
+                const __m256 x1 = _mm256_i32gather_ps(x, i1, 4), y1 = _mm256_i32gather_ps(y, i1, 4);
+                const __m256 x2 = _mm256_i32gather_ps(x, i2, 4), y2 = _mm256_i32gather_ps(y, i2, 4);
+                const __m256 area = _mm256_sub_ps(_mm256_mul_ps(_mm256_sub_ps(x1, x0), _mm256_sub_ps(y2, y0)), _mm256_mul_ps(_mm256_sub_ps(y1, y0), _mm256_sub_ps(x2, x0)));
+                const __m256 degenerate = _mm256_and_ps(_mm256_cmp_ps(area, zero, _CMP_EQ_UQ), enableDegenerate);
+                const __m256 back = _mm256_and_ps(_mm256_cmp_ps(area, zero, _CMP_LT_OQ), enableBack);
+                // 包围盒内没有像素中心：floor(max - 0.5) < min - 0.5
+                const __m256 minX = _mm256_sub_ps(_mm256_min_ps(_mm256_min_ps(x0, x1), x2), half);
+                const __m256 maxX = _mm256_sub_ps(_mm256_max_ps(_mm256_max_ps(x0, x1), x2), half);
+                const __m256 minY = _mm256_sub_ps(_mm256_min_ps(_mm256_min_ps(y0, y1), y2), half);
+                const __m256 maxY = _mm256_sub_ps(_mm256_max_ps(_mm256_max_ps(y0, y1), y2), half);
+                const __m256 small = _mm256_and_ps(_mm256_or_ps(_mm256_cmp_ps(_mm256_floor_ps(maxX), minX, _CMP_LT_OQ), _mm256_cmp_ps(_mm256_floor_ps(maxY), minY, _CMP_LT_OQ)),
+                                                   enableSmall);
+
+                // 从低优先级到高优先级依次覆盖
+                __m256i result = zeroI;
+                result = select(result, small, triangleSmall);
+                result = select(result, back, triangleBackFace);
+                result = select(result, degenerate, triangleDegenerate);
+                result = select(result, needClip, triangleClip);
+                result = select(result, frustum, triangleFrustum);
+                alignas(32) int32_t lanes[8];
+                _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), result);
+                for (int k = 0; k < 8; k++) {
+                    out[t + k] = static_cast<uint8_t>(lanes[k]);
+                }
+            }
+        }
+#endif
+#if defined(RE_SIMD_SSE2)
+        {
+            const __m128 zero = _mm_setzero_ps();
+            const __m128 half = _mm_set1_ps(0.5f);
+            const __m128 one = _mm_set1_ps(1.0f);
+            const __m128 enableBack = _mm_castsi128_ps(_mm_set1_epi32(settings.backFace ? -1 : 0));
+            const __m128 enableDegenerate = _mm_castsi128_ps(_mm_set1_epi32(settings.degenerate ? -1 : 0));
+            const __m128 enableSmall = _mm_castsi128_ps(_mm_set1_epi32(settings.smallTriangle ? -1 : 0));
+            // SSE2 没有 floor：截断后对大于原值的结果减 1（坐标已在保护带内，不会超出 int32）
+            auto floor4 = [&](__m128 v) {
+                const __m128 t = _mm_cvtepi32_ps(_mm_cvttps_epi32(v));
+                return _mm_sub_ps(t, _mm_and_ps(_mm_cmpgt_ps(t, v), one));
+            };
+            for (; t + 4 <= count; t += 4) {
+                alignas(16) float vx[3][4], vy[3][4];
+                uint32_t andCode[4], orCode[4];
+                for (int k = 0; k < 4; k++) {
+                    const uint32_t* tri = indices + (t + k) * 3;
+                    for (int j = 0; j < 3; j++) {
+                        vx[j][k] = x[tri[j]];
+                        vy[j][k] = y[tri[j]];
+                    }
+                    andCode[k] = code[tri[0]] & code[tri[1]] & code[tri[2]];
+                    orCode[k] = code[tri[0]] | code[tri[1]] | code[tri[2]];
+                }
+                const __m128 x0 = _mm_load_ps(vx[0]), x1 = _mm_load_ps(vx[1]), x2 = _mm_load_ps(vx[2]);
+                const __m128 y0 = _mm_load_ps(vy[0]), y1 = _mm_load_ps(vy[1]), y2 = _mm_load_ps(vy[2]);
+                const __m128 area = _mm_sub_ps(_mm_mul_ps(_mm_sub_ps(x1, x0), _mm_sub_ps(y2, y0)), _mm_mul_ps(_mm_sub_ps(y1, y0), _mm_sub_ps(x2, x0)));
+                const __m128 degenerate = _mm_and_ps(_mm_cmpeq_ps(area, zero), enableDegenerate);
+                const __m128 unordered = _mm_and_ps(_mm_cmpunord_ps(area, area), enableDegenerate);
+                const __m128 back = _mm_and_ps(_mm_cmplt_ps(area, zero), enableBack);
+                const __m128 minX = _mm_sub_ps(_mm_min_ps(_mm_min_ps(x0, x1), x2), half);
+                const __m128 maxX = _mm_sub_ps(_mm_max_ps(_mm_max_ps(x0, x1), x2), half);
+                const __m128 minY = _mm_sub_ps(_mm_min_ps(_mm_min_ps(y0, y1), y2), half);
+                const __m128 maxY = _mm_sub_ps(_mm_max_ps(_mm_max_ps(y0, y1), y2), half);
+                const __m128 small = _mm_and_ps(_mm_or_ps(_mm_cmplt_ps(floor4(maxX), minX), _mm_cmplt_ps(floor4(maxY), minY)), enableSmall);
+                const int degenerateBits = _mm_movemask_ps(_mm_or_ps(degenerate, unordered));
+                const int backBits = _mm_movemask_ps(back);
+                const int smallBits = _mm_movemask_ps(small);
+                for (int k = 0; k < 4; k++) {
+                    uint8_t c = triangleVisible;
+                    if (andCode[k] & frustumMask) {
+                        c = triangleFrustum;
+                    } else if (orCode[k] & (clipNear | clipGuardBand)) {
+                        c = triangleClip;
+                    } else if (degenerateBits >> k & 1) {
+                        c = triangleDegenerate;
+                    } else if (backBits >> k & 1) {
+                        c = triangleBackFace;
+                    } else if (smallBits >> k & 1) {
+                        c = triangleSmall;
+                    }
+                    out[t + k] = c;
+                }
+            }
+        }
+#endif
+        for (; t < count; t++) {
+            const uint32_t* tri = indices + t * 3;
+            const uint32_t andCode = code[tri[0]] & code[tri[1]] & code[tri[2]];
+            const uint32_t orCode = code[tri[0]] | code[tri[1]] | code[tri[2]];
+            const float x0 = x[tri[0]], x1 = x[tri[1]], x2 = x[tri[2]];
+            const float y0 = y[tri[0]], y1 = y[tri[1]], y2 = y[tri[2]];
+            const float area = (x1 - x0) * (y2 - y0) - (y1 - y0) * (x2 - x0);
+            uint8_t c = triangleVisible;
+            if (andCode & frustumMask) {
+                c = triangleFrustum;
+            } else if (orCode & (clipNear | clipGuardBand)) {
+                c = triangleClip;
+            } else if (settings.degenerate && !(area != 0.0f)) {
+                c = triangleDegenerate;
+            } else if (settings.backFace && area < 0.0f) {
+                c = triangleBackFace;
+            } else if (settings.smallTriangle && (std::floor(std::max({x0, x1, x2}) - 0.5f) < std::min({x0, x1, x2}) - 0.5f ||
+                                                  std::floor(std::max({y0, y1, y2}) - 0.5f) < std::min({y0, y1, y2}) - 0.5f)) {
+                c = triangleSmall;
+            }
+            out[t] = c;
+        }
+    }
+
+    inline size_t vertex::clipTriangle(const glm::vec4 clip[3], const uint32_t source[3], uint32_t planes, const Viewport& vp, const CullSettings& settings,
+                                       std::vector<ClippedTriangle>& out) {
+        struct ClipVertex {
+            glm::vec4 p;
+            glm::vec3 weight;
+        };
+        // 三角形最多被 5 个平面各增加一个顶点
+        constexpr size_t MAX_VERTICES = 8;
+        ClipVertex buffer[2][MAX_VERTICES];
+        size_t count = 3;
+        for (int i = 0; i < 3; i++) {
+            buffer[0][i] = ClipVertex{clip[i], glm::vec3(i == 0, i == 1, i == 2)};
+        }
+
+        // 平面用 dot(plane, p) >= 0 表示内侧
+        const float g = settings.guardBand;
+        glm::vec4 clipPlanes[5];
+        size_t planeCount = 0;
+        clipPlanes[planeCount++] = glm::vec4(0.0f, 0.0f, 1.0f, 0.0f); // z >= 0
+        if (planes & clipGuardBand) {
+            clipPlanes[planeCount++] = glm::vec4(1.0f, 0.0f, 0.0f, g);  // x >= -g w
+            clipPlanes[planeCount++] = glm::vec4(-1.0f, 0.0f, 0.0f, g); // x <= g w
+            clipPlanes[planeCount++] = glm::vec4(0.0f, 1.0f, 0.0f, g);
+            clipPlanes[planeCount++] = glm::vec4(0.0f, -1.0f, 0.0f, g);
+        }
+        int current = 0;
+        for (size_t k = 0; k < planeCount && count >= 3; k++) {
+            const ClipVertex* in = buffer[current];
+            ClipVertex* next = buffer[current ^ 1];
+            size_t nextCount = 0;
+            for (size_t i = 0; i < count; i++) {
+                const ClipVertex& a = in[i];
+                const ClipVertex& b = in[(i + 1) % count];
+                const float da = glm::dot(clipPlanes[k], a.p);
+                const float db = glm::dot(clipPlanes[k], b.p);
+                if (da >= 0.0f) {
+                    next[nextCount++] = a;
+                }
+                if ((da >= 0.0f) != (db >= 0.0f)) {
+                    const float t = da / (da - db);
+                    next[nextCount++] = ClipVertex{a.p + (b.p - a.p) * t, a.weight + (b.weight - a.weight) * t};
+                }
+            }
+            count = nextCount;
+            current ^= 1;
+        }
+        if (count < 3) {
+            return 0;
+        }
+
+        const ClipVertex* polygon = buffer[current];
+        glm::vec4 screen[MAX_VERTICES];
+        for (size_t i = 0; i < count; i++) {
+            const glm::vec4& p = polygon[i].p;
+            const float invW = 1.0f / p.w;
+            screen[i] = glm::vec4((p.x * invW * 0.5f + 0.5f) * vp.width + vp.x, (0.5f - p.y * invW * 0.5f) * vp.height + vp.y,
+                                  vp.minDepth + p.z * invW * (vp.maxDepth - vp.minDepth), invW);
+        }
+        size_t emitted = 0;
+        for (size_t i = 1; i + 1 < count; i++) {
+            const glm::vec4& a = screen[0];
+            const glm::vec4& b = screen[i];
+            const glm::vec4& c = screen[i + 1];
+            const float area = (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+            if ((settings.degenerate && !(area != 0.0f)) || (settings.backFace && area < 0.0f)) {
+                continue;
+            }
+            ClippedTriangle tri;
+            for (int k = 0; k < 3; k++) {
+                tri.source[k] = source[k];
+            }
+            tri.position[0] = a;
+            tri.position[1] = b;
+            tri.position[2] = c;
+            tri.weight[0] = polygon[0].weight;
+            tri.weight[1] = polygon[i].weight;
+            tri.weight[2] = polygon[i + 1].weight;
+            out.push_back(tri);
+            emitted++;
+        }
+        return emitted;
+    }
+
+    inline void VertexStage::process(const Mesh& mesh, VertexBatch& out) {
+        RE_PROFILE_SCOPE("VertexStage::process");
+        const size_t total = mesh.triangleCount() * 3;
+        const size_t chunkCount = (total + CHUNK - 1) / CHUNK;
+        const uint32_t* indices = mesh.indices();
+        const float* px = mesh.stream(streamPositionX);
+        const float* py = mesh.stream(streamPositionY);
+        const float* pz = mesh.stream(streamPositionZ);
+        std::vector<VertexBatch> chunks(chunkCount);
+        std::vector<CullStats> chunkStats(chunkCount);
+
+#pragma omp parallel
+        {
+            uint32_t tag[CACHE_SIZE], slot[CACHE_SIZE];
+            std::vector<uint32_t> codes;
+            std::vector<uint8_t> classes;
+#pragma omp for schedule(dynamic)
+            for (int64_t c = 0; c < static_cast<int64_t>(chunkCount); c++) {
+                const size_t first = c * CHUNK;
+                const size_t count = std::min(CHUNK, total - first);
+                VertexBatch& batch = chunks[c];
+                batch.indices.resize(count);
+                batch.source.clear();
+                std::fill(tag, tag + CACHE_SIZE, UINT32_MAX);
+                // 缓存查找：命中时复用块内已有的输出顶点，未命中时分配新的输出顶点
+                for (size_t i = 0; i < count; i++) {
+                    const uint32_t index = indices[first + i];
+                    const size_t line = index & (CACHE_SIZE - 1);
+                    if (tag[line] != index) {
+                        tag[line] = index;
+                        slot[line] = static_cast<uint32_t>(batch.source.size());
+                        batch.source.push_back(index);
+                    }
+                    batch.indices[i] = slot[line];
+                }
+                // 未命中的顶点集中收集后整体变换，变换在原地完成
+                const size_t n = batch.source.size();
+                batch.x.resize(n);
+                batch.y.resize(n);
+                batch.z.resize(n);
+                batch.w.resize(n);
+                codes.resize(n);
+                for (size_t i = 0; i < n; i++) {
+                    const uint32_t s = batch.source[i];
+                    batch.x[i] = px[s];
+                    batch.y[i] = py[s];
+                    batch.z[i] = pz[s];
+                }
+                vertex::transformSoA(batch.x.data(), batch.y.data(), batch.z.data(), n, mvp, _viewport, batch.x.data(), batch.y.data(), batch.z.data(),
+                                     batch.w.data(), _culling.guardBand, codes.data());
+
+                // 剔除：可见三角形原地压缩，需要裁剪的从网格重新取裁剪空间坐标
+                const size_t triangles = count / 3;
+                classes.resize(triangles);
+                vertex::classifyTriangles(batch.indices.data(), triangles, batch.x.data(), batch.y.data(), codes.data(), _culling, classes.data());
+                CullStats& s = chunkStats[c];
+                s.triangles = triangles;
+                size_t kept = 0;
+                for (size_t t = 0; t < triangles; t++) {
+                    const uint32_t* tri = batch.indices.data() + t * 3;
+                    switch (classes[t]) {
+                    case vertex::triangleVisible:
+                        batch.indices[kept * 3] = tri[0];
+                        batch.indices[kept * 3 + 1] = tri[1];
+                        batch.indices[kept * 3 + 2] = tri[2];
+                        kept++;
+                        break;
+                    case vertex::triangleFrustum:
+                        s.frustum++;
+                        break;
+                    case vertex::triangleBackFace:
+                        s.backFace++;
+                        break;
+                    case vertex::triangleDegenerate:
+                        s.degenerate++;
+                        break;
+                    case vertex::triangleSmall:
+                        s.small++;
+                        break;
+                    case vertex::triangleClip: {
+                        const uint32_t source[3] = {batch.source[tri[0]], batch.source[tri[1]], batch.source[tri[2]]};
+                        glm::vec4 clip[3];
+                        for (int k = 0; k < 3; k++) {
+                            clip[k] = mvp * glm::vec4(px[source[k]], py[source[k]], pz[source[k]], 1.0f);
+                        }
+                        s.clipped++;
+                        s.clippedOutput += vertex::clipTriangle(clip, source, codes[tri[0]] | codes[tri[1]] | codes[tri[2]], _viewport, _culling, batch.clipped);
+                        break;
+                    }
+                    }
+                }
+                batch.indices.resize(kept * 3);
+            }
+        }
+
+        // 各块首尾相接，索引加上块的顶点偏移
+        std::vector<size_t> vertexOffset(chunkCount + 1, 0), indexOffset(chunkCount + 1, 0);
+        stats = CullStats();
+        for (size_t c = 0; c < chunkCount; c++) {
+            vertexOffset[c + 1] = vertexOffset[c] + chunks[c].source.size();
+            indexOffset[c + 1] = indexOffset[c] + chunks[c].indices.size();
+            stats.triangles += chunkStats[c].triangles;
+            stats.frustum += chunkStats[c].frustum;
+            stats.backFace += chunkStats[c].backFace;
+            stats.degenerate += chunkStats[c].degenerate;
+            stats.small += chunkStats[c].small;
+            stats.clipped += chunkStats[c].clipped;
+            stats.clippedOutput += chunkStats[c].clippedOutput;
+        }
+        out.resize(vertexOffset.back(), indexOffset.back());
+        out.clipped.clear();
+        for (size_t c = 0; c < chunkCount; c++) {
+            out.clipped.insert(out.clipped.end(), chunks[c].clipped.begin(), chunks[c].clipped.end());
+        }
+#pragma omp parallel for schedule(dynamic)
+        for (int64_t c = 0; c < static_cast<int64_t>(chunkCount); c++) {
+            const VertexBatch& batch = chunks[c];
+            const size_t base = vertexOffset[c];
+            const size_t n = batch.source.size();
+            std::copy_n(batch.x.data(), n, out.x.data() + base);
+            std::copy_n(batch.y.data(), n, out.y.data() + base);
+            std::copy_n(batch.z.data(), n, out.z.data() + base);
+            std::copy_n(batch.w.data(), n, out.w.data() + base);
+            std::copy_n(batch.source.data(), n, out.source.data() + base);
+            uint32_t* dst = out.indices.data() + indexOffset[c];
+            for (size_t i = 0; i < batch.indices.size(); i++) {
+                dst[i] = static_cast<uint32_t>(base + batch.indices[i]);
+            }
+        }
+        indexCount = total;
+        transformCount = vertexOffset.back();
+    }
+}
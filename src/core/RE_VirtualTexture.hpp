@@ -0,0 +1,492 @@
+#pragma once
+#include "RE_includes.h"
+#include "RE_Texture.hpp"
+#include "RE_TextureFile.hpp"
+
+namespace RE {
+    // 虚拟纹理的页面来源，readPage 只会在后台流式线程上调用
+    template <typename T>
+    class PageSource {
+    public:
+        virtual ~PageSource() = default;
+        virtual size_t width() = 0;
+        virtual size_t height() = 0;
+        virtual size_t channel() = 0;
+        virtual size_t levelCount() = 0;
+        // 把 level 上第 (pageX, pageY) 页写入 dst（pageSize * pageSize * channel），超出纹理的部分复制边缘像素
+        virtual bool readPage(size_t level, size_t pageX, size_t pageY, size_t pageSize, T* dst) = 0;
+
+    protected:
+        // 从行优先交错的 level 数据中拷出一页
+        static void copyPage(const T* src, size_t w, size_t h, size_t c, size_t pageX, size_t pageY, size_t pageSize, T* dst);
+    };
+
+    // 从 .retx 映射读取页面，只有被请求的行会被调入内存
+    template <typename T>
+    class TextureFilePageSource : public PageSource<T> {
+    public:
+        explicit TextureFilePageSource(std::shared_ptr<TextureFile> file);
+        size_t width() override;
+        size_t height() override;
+        size_t channel() override;
+        size_t levelCount() override;
+        bool readPage(size_t level, size_t pageX, size_t pageY, size_t pageSize, T* dst) override;
+
+    private:
+        std::shared_ptr<TextureFile> file;
+    };
+
+    // PNG/JPEG 回退路径：首次请求时整张解码并生成 mip 链
+    class PictureSource : public PageSource<uint8_t> {
+    public:
+        // 只读取图片头部，文件无法识别或尺寸为 0 时返回 nullptr
+        static std::shared_ptr<PictureSource> open(const char* filename);
+        size_t width() override;
+        size_t height() override;
+        size_t channel() override;
+        size_t levelCount() override;
+        bool readPage(size_t level, size_t pageX, size_t pageY, size_t pageSize, uint8_t* dst) override;
+
+    private:
+        std::string filename;
+        int _width, _height, _channel;
+        std::vector<Texture> levels;
+        bool decoded;
+
+        explicit PictureSource(const char* filename);
+        bool decode();
+    };
+
+    // 分页纹理：固定大小的页面放在物理页池里，用每级一张间接表定位
+    // 采样时记录反馈，endFrame 把缺失的页交给后台线程加载，未驻留的页回退到更粗的 mip
+    template <typename T>
+    class VirtualTexture {
+    public:
+        using Color_T = glm::vec<3, T>;
+
+        VirtualTexture(std::shared_ptr<PageSource<T>> source, size_t pageSize = 128, size_t capacity = 256);
+        ~VirtualTexture();
+        VirtualTexture(const VirtualTexture&) = delete;
+        VirtualTexture(VirtualTexture&&) = delete;
+        VirtualTexture& operator=(const VirtualTexture&) = delete;
+        VirtualTexture& operator=(VirtualTexture&&) = delete;
+
+        // uv 需已经过 wrap 处理，可以多线程并发调用
+        Color_T sample(glm::vec2 uv, float lod, TextureFilter filter = nearest);
+
+        // 每帧调用一次，须在本帧的采样全部结束后调用：收集反馈、更新 LRU、为缺页腾出槽位并提交请求
+        // 淘汰只在这里进行，本帧解析到的页（含回退页）先刷新 lastUsed 再淘汰，所以本帧用过的页不会被换出，
+        // 而被换出的页此时也没有采样线程在读；后台线程只会把新页写进空闲槽
+        void endFrame();
+
+        // 来源为空或尺寸为 0 时构造失败，采样恒返回黑色
+        bool valid() const;
+
+        size_t width() const;
+        size_t height() const;
+        size_t levelCount() const;
+        size_t pageSize() const;
+        size_t capacity() const;
+        size_t residentPages() const;
+        size_t pendingPages();
+
+    private:
+        struct Level {
+            size_t width, height;
+            size_t pagesX, pagesY;
+            std::vector<std::atomic<int32_t>> indirection; // 页 -> 物理槽，-1 表示未驻留
+            std::vector<std::atomic<uint32_t>> feedback;   // 本帧被采样过的页位图
+        };
+
+        struct Slot {
+            uint32_t level;
+            uint32_t page;
+            uint64_t lastUsed;
+            bool pinned;
+            bool used;
+        };
+
+        std::shared_ptr<PageSource<T>> source;
+        size_t _pageSize;
+        size_t _channel;
+        std::vector<Level> levels;
+        Buffer3D<T> pool; // pageSize x (pageSize * capacity)
+        std::vector<Slot> slots;
+        std::mutex slotLock;
+        std::atomic<size_t> resident;
+        uint64_t frame;
+
+        std::deque<uint64_t> requests;
+        std::unordered_map<uint64_t, bool> queued;
+        std::mutex requestLock;
+        std::condition_variable requestReady;
+        std::thread streamer;
+        bool stop;
+
+        static uint64_t pageKey(size_t level, size_t page);
+        static void markFeedback(Level& l, size_t page);
+        bool loadPage(size_t level, size_t page, std::vector<T>& scratch, bool pinned);
+        int32_t acquireSlot();
+        void evictUnused(size_t needed);
+        Color_T fetch(int32_t slot, size_t tx, size_t ty);
+        void streamLoop();
+    };
+}
+
+namespace RE {
+    template <typename T>
+    void PageSource<T>::copyPage(const T* src, size_t w, size_t h, size_t c, size_t pageX, size_t pageY, size_t pageSize, T* dst) {
+        const size_t x0 = pageX * pageSize;
+        const size_t y0 = pageY * pageSize;
+        const size_t cols = std::min(pageSize, w - x0);
+        for (size_t ty = 0; ty < pageSize; ty++) {
+            const size_t y = std::min(y0 + ty, h - 1);
+            T* row = dst + ty * pageSize * c;
+            memcpy(row, src + (y * w + x0) * c, sizeof(T) * cols * c);
+            for (size_t tx = cols; tx < pageSize; tx++) {
+                memcpy(row + tx * c, row + (cols - 1) * c, sizeof(T) * c);
+            }
+        }
+    }
+
+    template <typename T>
+    TextureFilePageSource<T>::TextureFilePageSource(std::shared_ptr<TextureFile> f) : file(std::move(f)) {}
+    template <typename T>
+    size_t TextureFilePageSource<T>::width() { return file->header().width; }
+    template <typename T>
+    size_t TextureFilePageSource<T>::height() { return file->header().height; }
+    template <typename T>
+    size_t TextureFilePageSource<T>::channel() { return file->header().channel; }
+    template <typename T>
+    size_t TextureFilePageSource<T>::levelCount() { return file->header().levelCount; }
+
+    template <typename T>
+    bool TextureFilePageSource<T>::readPage(size_t level, size_t pageX, size_t pageY, size_t pageSize, T* dst) {
+        if (level >= levelCount() || file->header().elementType != TextureElement<T>::type) {
+            return false;
+        }
+        const TextureFileLevel& l = file->level(level);
+        this->copyPage(reinterpret_cast<const T*>(file->levelData(level)), l.width, l.height, channel(), pageX, pageY, pageSize, dst);
+        return true;
+    }
+
+    inline PictureSource::PictureSource(const char* f) : filename(f), _width(0), _height(0), _channel(0), decoded(false) {}
+
+    inline std::shared_ptr<PictureSource> PictureSource::open(const char* filename) {
+        std::shared_ptr<PictureSource> out(new PictureSource(filename));
+        if (!stbi_info(filename, &out->_width, &out->_height, &out->_channel)) {
+            std::cerr << "PictureSource Error: " << filename << ": " << stbi_failure_reason() << std::endl;
+            return nullptr;
+        }
+        if (out->_width <= 0 || out->_height <= 0 || out->_channel <= 0) {
+            std::cerr << "PictureSource Error: empty image " << filename << std::endl;
+            return nullptr;
+        }
+        return out;
+    }
+    inline size_t PictureSource::width() { return _width; }
+    inline size_t PictureSource::height() { return _height; }
+    inline size_t PictureSource::channel() { return _channel; }
+
+    inline size_t PictureSource::levelCount() {
+        size_t count = 1;
+        for (size_t w = _width, h = _height; w > 1 || h > 1; w /= 2, h /= 2) {
+            count++;
+        }
+        return count;
+    }
+
+    inline bool PictureSource::readPage(size_t level, size_t pageX, size_t pageY, size_t pageSize, uint8_t* dst) {
+        if (!decoded && !decode()) {
+            return false;
+        }
+        const Texture& l = levels[level];
+        copyPage(l.data(), l.width(), l.height(), l.channel(), pageX, pageY, pageSize, dst);
+        return true;
+    }
+
+    inline bool PictureSource::decode() {
+        levels.resize(levelCount());
+        if (!levels[0].readPicture(filename.c_str())) {
+            return false;
+        }
+        for (size_t i = 1; i < levels.size(); i++) {
+            downsampleHalf(levels[i - 1], levels[i]);
+        }
+        decoded = true;
+        return true;
+    }
+
+    template <typename T>
+    VirtualTexture<T>::VirtualTexture(std::shared_ptr<PageSource<T>> src, size_t pageSize, size_t capacity)
+        : source(std::move(src)), _pageSize(pageSize), _channel(0), pool(0, 0, 0), resident(0), frame(0), stop(false) {
+        // 尺寸为 0 的来源会让页面计算在 size_t 上下溢，直接拒绝
+        if (!source || source->width() == 0 || source->height() == 0 || source->channel() == 0 || source->levelCount() == 0 || pageSize == 0) {
+            std::cerr << "VirtualTexture Error: empty page source" << std::endl;
+            return;
+        }
+        _channel = source->channel();
+        levels = std::vector<Level>(source->levelCount());
+        size_t w = source->width(), h = source->height();
+        size_t pinned = 0;
+        for (auto& l : levels) {
+            l.width = w;
+            l.height = h;
+            l.pagesX = (w + pageSize - 1) / pageSize;
+            l.pagesY = (h + pageSize - 1) / pageSize;
+            l.indirection = std::vector<std::atomic<int32_t>>(l.pagesX * l.pagesY);
+            l.feedback = std::vector<std::atomic<uint32_t>>((l.pagesX * l.pagesY + 31) / 32);
+            for (auto& i : l.indirection) {
+                i.store(-1, std::memory_order_relaxed);
+            }
+            pinned += (l.pagesX * l.pagesY == 1) ? 1 : 0;
+            w = std::max<size_t>(w / 2, 1);
+            h = std::max<size_t>(h / 2, 1);
+        }
+
+        // 至少给 mip 尾部之外再留一些可替换的槽
+        capacity = std::max(capacity, pinned + 4);
+        pool.setSize(pageSize, pageSize * capacity, _channel);
+        slots.resize(capacity, Slot{0, 0, 0, false, false});
+
+        // 单页就能放下的 mip 尾部常驻，保证任何采样都有可回退的页
+        std::vector<T> scratch(pageSize * pageSize * _channel);
+        for (size_t i = 0; i < levels.size(); i++) {
+            if (levels[i].pagesX * levels[i].pagesY == 1) {
+                loadPage(i, 0, scratch, true);
+            }
+        }
+
+        streamer = std::thread(&VirtualTexture<T>::streamLoop, this);
+    }
+
+    template <typename T>
+    VirtualTexture<T>::~VirtualTexture() {
+        {
+            std::lock_guard<std::mutex> lock(requestLock);
+            stop = true;
+        }
+        requestReady.notify_all();
+        if (streamer.joinable()) {
+            streamer.join();
+        }
+    }
+
+    template <typename T>
+    typename VirtualTexture<T>::Color_T VirtualTexture<T>::sample(glm::vec2 uv, float lod, TextureFilter filter) {
+        if (levels.empty()) {
+            return Color_T(0);
+        }
+        size_t level = std::min<size_t>(static_cast<size_t>(std::max(lod + 0.5f, 0.0f)), levels.size() - 1);
+        const size_t requestedLevel = level;
+        for (; level < levels.size(); level++) {
+            Level& l = levels[level];
+            // 与 ImageView 的采样一致：最近邻取 floor(uv * size)，双线性以像素中心为准
+            const float offset = (filter == bilinear) ? 0.5f : 0.0f;
+            const float fx = uv.x * l.width - offset;
+            const float fy = uv.y * l.height - offset;
+            const size_t x = std::min<size_t>(static_cast<size_t>(std::max(fx, 0.0f)), l.width - 1);
+            const size_t y = std::min<size_t>(static_cast<size_t>(std::max(fy, 0.0f)), l.height - 1);
+            const size_t px = x / _pageSize;
+            const size_t py = y / _pageSize;
+            const size_t page = py * l.pagesX + px;
+
+            // 想要的那一级记录反馈用于缺页请求
+            if (level == requestedLevel) {
+                markFeedback(l, page);
+            }
+            const int32_t slot = l.indirection[page].load(std::memory_order_acquire);
+            if (slot < 0) {
+                continue;
+            }
+            // 实际采样的回退页同样记录，endFrame 会在淘汰前刷新它的 lastUsed
+            if (level != requestedLevel) {
+                markFeedback(l, page);
+            }
+            const size_t tx = x - px * _pageSize;
+            const size_t ty = y - py * _pageSize;
+            if (filter != bilinear) {
+                return fetch(slot, tx, ty);
+            }
+
+            // 双线性只在页内插值，页边界处退化为边缘复制
+            const size_t pageW = std::min(_pageSize, l.width - px * _pageSize);
+            const size_t pageH = std::min(_pageSize, l.height - py * _pageSize);
+            const size_t tx1 = std::min(tx + 1, pageW - 1);
+            const size_t ty1 = std::min(ty + 1, pageH - 1);
+            const float dx = RE::camp(fx - std::floor(fx), 0.0f, 1.0f);
+            const float dy = RE::camp(fy - std::floor(fy), 0.0f, 1.0f);
+            const glm::vec3 c00(fetch(slot, tx, ty)), c10(fetch(slot, tx1, ty));
+            const glm::vec3 c01(fetch(slot, tx, ty1)), c11(fetch(slot, tx1, ty1));
+            const glm::vec3 top = c00 + (c10 - c00) * dx;
+            const glm::vec3 bottom = c01 + (c11 - c01) * dx;
+            return Color_T(top + (bottom - top) * dy);
+        }
+        return Color_T(0);
+    }
+
+    template <typename T>
+    void VirtualTexture<T>::endFrame() {
+        std::vector<uint64_t> missing;
+        {
+            std::lock_guard<std::mutex> lock(slotLock);
+            frame++;
+            for (size_t li = 0; li < levels.size(); li++) {
+                Level& l = levels[li];
+                for (size_t wi = 0; wi < l.feedback.size(); wi++) {
+                    uint32_t bits = l.feedback[wi].exchange(0, std::memory_order_relaxed);
+                    while (bits) {
+                        const size_t page = wi * 32 + std::countr_zero(bits);
+                        bits &= bits - 1;
+                        const int32_t slot = l.indirection[page].load(std::memory_order_relaxed);
+                        if (slot >= 0) {
+                            slots[slot].lastUsed = frame;
+                        } else {
+                            missing.push_back(pageKey(li, page));
+                        }
+                    }
+                }
+            }
+            // 本帧用到的页都已刷新，可以安全地换出其余的页
+            evictUnused(missing.size());
+        }
+        if (missing.empty()) {
+            return;
+        }
+
+        // 粗糙级优先，先让回退画面尽快变清晰
+        std::sort(missing.begin(), missing.end(), std::greater<uint64_t>());
+        {
+            std::lock_guard<std::mutex> lock(requestLock);
+            for (uint64_t key : missing) {
+                if (queued.emplace(key, true).second) {
+                    requests.push_back(key);
+                }
+            }
+        }
+        requestReady.notify_one();
+    }
+
+    template <typename T>
+    bool VirtualTexture<T>::valid() const { return !levels.empty(); }
+    template <typename T>
+    size_t VirtualTexture<T>::width() const { return levels.empty() ? 0 : levels[0].width; }
+    template <typename T>
+    size_t VirtualTexture<T>::height() const { return levels.empty() ? 0 : levels[0].height; }
+    template <typename T>
+    size_t VirtualTexture<T>::levelCount() const { return levels.size(); }
+    template <typename T>
+    size_t VirtualTexture<T>::pageSize() const { return _pageSize; }
+    template <typename T>
+    size_t VirtualTexture<T>::capacity() const { return slots.size(); }
+    template <typename T>
+    size_t VirtualTexture<T>::residentPages() const { return resident.load(std::memory_order_relaxed); }
+
+    template <typename T>
+    size_t VirtualTexture<T>::pendingPages() {
+        std::lock_guard<std::mutex> lock(requestLock);
+        return queued.size();
+    }
+
+    template <typename T>
+    uint64_t VirtualTexture<T>::pageKey(size_t level, size_t page) {
+        return (static_cast<uint64_t>(level) << 40) | page;
+    }
+
+    template <typename T>
+    void VirtualTexture<T>::markFeedback(Level& l, size_t page) {
+        std::atomic<uint32_t>& word = l.feedback[page / 32];
+        const uint32_t bit = 1u << (page % 32);
+        if (!(word.load(std::memory_order_relaxed) & bit)) {
+            word.fetch_or(bit, std::memory_order_relaxed);
+        }
+    }
+
+    template <typename T>
+    bool VirtualTexture<T>::loadPage(size_t level, size_t page, std::vector<T>& scratch, bool pinned) {
+        Level& l = levels[level];
+        if (l.indirection[page].load(std::memory_order_relaxed) >= 0) {
+            return true;
+        }
+        // 读盘/解码在锁外进行
+        if (!source->readPage(level, page % l.pagesX, page / l.pagesX, _pageSize, scratch.data())) {
+            return false;
+        }
+
+        std::lock_guard<std::mutex> lock(slotLock);
+        const int32_t slot = acquireSlot();
+        if (slot < 0) {
+            return false; // 没有空闲槽（工作集超过页池容量），等 endFrame 换出旧页后下一帧再请求
+        }
+        T* dst = pool.data() + static_cast<size_t>(slot) * _pageSize * _pageSize * _channel;
+        memcpy(dst, scratch.data(), sizeof(T) * scratch.size());
+        slots[slot] = Slot{static_cast<uint32_t>(level), static_cast<uint32_t>(page), frame, pinned, true};
+        l.indirection[page].store(slot, std::memory_order_release);
+        resident.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    template <typename T>
+    int32_t VirtualTexture<T>::acquireSlot() {
+        // 后台线程只取空闲槽，采样线程可能正在读的页不会在这里被覆盖
+        for (size_t i = 0; i < slots.size(); i++) {
+            if (!slots[i].used) {
+                return static_cast<int32_t>(i);
+            }
+        }
+        return -1;
+    }
+
+    template <typename T>
+    void VirtualTexture<T>::evictUnused(size_t needed) {
+        size_t free = 0;
+        std::vector<int32_t> candidates;
+        for (size_t i = 0; i < slots.size(); i++) {
+            if (!slots[i].used) {
+                free++;
+            } else if (!slots[i].pinned && slots[i].lastUsed < frame) {
+                candidates.push_back(static_cast<int32_t>(i));
+            }
+        }
+        if (free >= needed) {
+            return;
+        }
+        const size_t count = std::min(needed - free, candidates.size());
+        std::partial_sort(candidates.begin(), candidates.begin() + count, candidates.end(),
+                          [this](int32_t a, int32_t b) { return slots[a].lastUsed < slots[b].lastUsed; });
+        for (size_t i = 0; i < count; i++) {
+            Slot& victim = slots[candidates[i]];
+            levels[victim.level].indirection[victim.page].store(-1, std::memory_order_release);
+            victim.used = false;
+            resident.fetch_sub(1, std::memory_order_relaxed);
+        }
+    }
+
+    template <typename T>
+    typename VirtualTexture<T>::Color_T VirtualTexture<T>::fetch(int32_t slot, size_t tx, size_t ty) {
+        const T* p = pool.data() + ((static_cast<size_t>(slot) * _pageSize + ty) * _pageSize + tx) * _channel;
+        return Color_T(p[0], p[_channel > 1 ? 1 : 0], p[_channel > 2 ? 2 : 0]);
+    }
+
+    template <typename T>
+    void VirtualTexture<T>::streamLoop() {
+        std::vector<T> scratch(_pageSize * _pageSize * _channel);
+        while (true) {
+            uint64_t key;
+            {
+                std::unique_lock<std::mutex> lock(requestLock);
+                requestReady.wait(lock, [this]() { return stop || !requests.empty(); });
+                if (stop) {
+                    return;
+                }
+                key = requests.front();
+                requests.pop_front();
+            }
+            loadPage(static_cast<size_t>(key >> 40), static_cast<size_t>(key & ((1ull << 40) - 1)), scratch, false);
+            {
+                std::lock_guard<std::mutex> lock(requestLock);
+                queued.erase(key);
+            }
+        }
+    }
+}
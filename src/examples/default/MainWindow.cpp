@@ -1,8 +1,18 @@
 #define RE_EXTEND_NOISE_GENERATOR
 #define RE_EXTEND_MS_WINDOWS_AMD64
 #include "RE_Init.h"
+#include <sstream>
+#include <string_view>
 
 int main(int argc, char* argv[]) {
+    // 传入 --profile 时开启性能分析：每 5 秒通过日志输出帧时间和各区段统计，退出时写出 RE_trace.json
+    bool profiling = false;
+    for (int i = 1; i < argc; i++) {
+        if (std::string_view(argv[i]) == "--profile") {
+            profiling = true;
+        }
+    }
+
     // 初始化SDL
     initSDLVideo();
     int refreshRate = GetRefreshRate();
@@ -36,15 +46,33 @@ int main(int argc, char* argv[]) {
         pt.drawPixel(i, RE::rgb(0xff, 0xff, 0xff));
     }
 
+    // 调制用的坐标渐变：g = x % 256，b = y % 256，只需生成一次
+    RE::Texture ramp(width, height, IMAGE_CHANNELS);
+    for (size_t y = 0; y < height; y++) {
+        for (size_t x = 0; x < width; x++) {
+            uint8_t* p = ramp.data() + ramp.getIndex(x, y);
+            p[0] = 255;
+            p[1] = static_cast<uint8_t>(x % 256);
+            p[2] = static_cast<uint8_t>(y % 256);
+        }
+    }
+
+    // 噪声背景按动态分辨率渲染到较小的视口，再放大到呈现缓冲
+    RE::ImageView<uint8_t> sceneView(RE::UndersamplingFix::none, RE::TextureWrap::clamp, RE::TextureFilter::nearest);
+    RE::Painter<uint8_t> scene(&sceneView);
+    RE::DynamicResolutionSettings resolutionSettings;
+    resolutionSettings.targetFrameTime = 1000.0f / refreshRate;
+    RE::DynamicResolution resolution(resolutionSettings);
+
     // 主循环
     bool quit = false;
     SDL_Event e;
-    const Uint32 frameDelay = 1000 / refreshRate;
-    Uint32 frameStart;
-    int frameTime;
+    RE::FramePacer pacer(refreshRate);
+    RE::Profiler::setEnabled(profiling);
+    double lastReport = RE::FramePacer::now();
 
     while (!quit) {
-        frameStart = SDL_GetTicks64();
+        pacer.beginFrame();
 
         // 处理事件
         while (SDL_PollEvent(&e) != 0) {
@@ -53,29 +81,20 @@ int main(int argc, char* argv[]) {
             }
         }
 
-        RE::generateFractalPerlinNoise<uint8_t>(&pt);
+        const glm::uvec2 viewport = resolution.viewport(width, height);
+        if (sceneView.getTexture().width() != viewport.x || sceneView.getTexture().height() != viewport.y) {
+            scene.setSize(viewport.x, viewport.y, IMAGE_CHANNELS);
+        }
+        RE::generateFractalPerlinNoise<uint8_t>(&scene);
+        RE::upscaleBilinear(sceneView.getTexture(), imageView->getTexture());
 
         // 在这里进行渲染
-        // 在image数组中填充示例数据，这里用一些简单的颜色来模拟图像数据
+        // 颜色调制：红色随时间渐变，绿色 / 蓝色按坐标渐变，一次融合的遍历完成
         auto t = SDL_GetTicks64();
         int zq = 2000;
-
-        int ts = 5;
-        int rg = IMAGE_SIZE * IMAGE_CHANNELS / ts;
-        for (size_t k = 0; k < ts; k++) {
-            for (size_t i = k * rg; i < (k + 1) * rg - 400; i += IMAGE_CHANNELS) {
-                RE::rgb color(0.0f);
-                if (static_cast<int>(t / zq) % 2) {
-                    color.r = RE::lerp(0, 256, (t % zq) / static_cast<float>(zq)) * imageView->getTexture().data()[i] / 256; // 红色
-                } else {
-                    color.r = RE::lerp(256, 0, (t % zq) / static_cast<float>(zq)) * imageView->getTexture().data()[i] / 256; // 红色
-                }
-                color.g = imageView->getTexture().getCol(i) % 256 * imageView->getTexture().data()[i + 1] / 256;
-                color.b = imageView->getTexture().getRow(i) % 256 * imageView->getTexture().data()[i + 2] / 256;
-
-                pt.drawPixel(i, color);
-            }
-        }
+        const float phase = (t % zq) / static_cast<float>(zq);
+        const float fade = (static_cast<int>(t / zq) % 2) ? phase : 1.0f - phase;
+        pt.apply(imageView->getTexture() * ramp * RE::channels(RE::rgb(static_cast<uint8_t>(fade * 255.0f), 255, 255)));
 
         const float delta = t % 3600 / 10;
         for (float i = delta; i <= 90 + delta; i += 10) {
@@ -96,13 +115,30 @@ int main(int argc, char* argv[]) {
         // 更新窗口
         window.present();
 
-        // 控制帧率
-        frameTime = SDL_GetTicks() - frameStart;
-        if (frameTime < frameDelay) {
-            SDL_Delay((frameDelay - frameTime) * 10);
+        // 控制帧率：等到本帧的截止时间，工作耗时反馈给动态分辨率
+        resolution.update(static_cast<float>(pacer.wait()));
+        if (profiling) {
+            RE::Profiler::instance().endFrame();
+            if (RE::FramePacer::now() - lastReport > 5000.0) {
+                const RE::FrameStats stats = pacer.stats();
+                std::ostringstream report;
+                report << "Frame time avg " << stats.average << " ms, p50 " << stats.p50 << " ms, p99 " << stats.p99 << " ms, max " << stats.max
+                       << " ms, scale " << resolution.scale() << "\n"
+                       << RE::Profiler::instance().summaryText();
+                std::string text = report.str();
+                if (!text.empty() && text.back() == '\n') {
+                    text.pop_back();
+                }
+                RELogInfo << text;
+                lastReport = RE::FramePacer::now();
+            }
         }
     }
 
+    if (profiling) {
+        RE::Profiler::instance().writeChromeTrace("RE_trace.json");
+    }
+
     // 清理SDL
     quitSDL();
     return 0;
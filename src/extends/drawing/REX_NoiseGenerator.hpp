@@ -69,6 +69,7 @@ namespace RE {
 
     template <typename T>
     void generateCommonNoise(RE::Painter<T>* painter, size_t seed = 0) {
+        RE_PROFILE_SCOPE("generateCommonNoise");
         painter->paintStart();
         for (size_t i = 0; i < painter->texture.area(); i++) {
             const T value = static_cast<T>(rand() % 256);
@@ -78,6 +79,7 @@ namespace RE {
 
     template <typename T>
     void generatePerlinNoise(RE::Painter<T>* painter, size_t freq) {
+        RE_PROFILE_SCOPE("generatePerlinNoise");
         painter->paintStart();
         for (size_t i = 0; i < painter->texture.length(); i += painter->texture.channel()) {
             const size_t x = painter->texture.getCol(i);
@@ -89,6 +91,7 @@ namespace RE {
 
     template <typename T>
     void generateFractalPerlinNoise(RE::Painter<T>* painter) {
+        RE_PROFILE_SCOPE("generateFractalPerlinNoise");
         painter->paintStart();
         for (size_t i = 0; i < painter->texture.length(); i += painter->texture.channel()) {
             const size_t x = painter->texture.getCol(i);
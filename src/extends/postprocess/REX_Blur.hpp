@@ -0,0 +1,493 @@
+#pragma once
+#include "RE_includes.h"
+#include "RE_Texture.hpp"
+
+namespace RE {
+    // 一维卷积核，长度为奇数，中心对齐
+    using Kernel1D = std::vector<float>;
+
+    // 归一化的高斯核，半径取 ceil(3 * sigma)
+    Kernel1D gaussianKernel(float sigma);
+
+    // 可分离卷积：先水平后垂直，边缘 clamp，src 与 dst 可以是同一张纹理
+    // 8 位纹理中间结果用 float 保存，写回时四舍五入并饱和
+    template <typename T>
+    void convolveSeparable(const TextureBase<T>& src, TextureBase<T>& dst, const Kernel1D& kernelX, const Kernel1D& kernelY);
+
+    // 高斯模糊，sigma 较小时直接卷积，较大时用三次盒式模糊近似（每像素开销与半径无关）
+    template <typename T>
+    void gaussianBlur(const TextureBase<T>& src, TextureBase<T>& dst, float sigma);
+
+    // 盒式模糊，窗口宽度为 2 * radius + 1
+    template <typename T>
+    void boxBlur(const TextureBase<T>& src, TextureBase<T>& dst, size_t radius);
+
+    struct BloomSettings {
+        float threshold = 1.0f; // 亮度超过该值的部分才参与泛光
+        float knee = 0.5f;      // 阈值附近的软过渡宽度
+        float intensity = 0.05f;
+        size_t levels = 5;      // 降采样链长度，每级分辨率减半
+        float sigma = 1.5f;     // 每一级的模糊半径（以该级像素为单位）
+    };
+
+    // 泛光：亮部提取 -> 逐级降采样并模糊 -> 逐级上采样累加 -> 叠加回原图，只用于 HDR
+    void bloom(HDRTexture& image, const BloomSettings& settings = BloomSettings());
+
+    namespace blur {
+        // 以下为各个 pass 共用的行级 SIMD 运算，n 为 float 个数
+        void madd(float* out, const float* in, float k, size_t n);          // out += k * in
+        void scale(float* out, const float* in, float k, size_t n);         // out = k * in
+        void slide(float* acc, const float* add, const float* sub, size_t n); // acc += add - sub
+        // out = sum(weights[j] * inputs[j])，每段输出在寄存器里累加完所有抽头再写回
+        void weightedSum(float* out, const float* const* inputs, const float* weights, size_t taps, size_t n);
+
+        template <typename T>
+        void loadRow(const T* in, float* out, size_t n);
+        template <typename T>
+        void storeRow(const float* in, T* out, size_t n);
+
+        // 整幅图在 float 缓冲上的水平 / 垂直 pass，in 与 out 不能重叠
+        void convolveRows(const float* in, float* out, size_t w, size_t h, size_t c, const Kernel1D& kernel);
+        void convolveColumns(const float* in, float* out, size_t w, size_t h, size_t c, const Kernel1D& kernel);
+        void boxRows(const float* in, float* out, size_t w, size_t h, size_t c, size_t radius);
+        void boxColumns(const float* in, float* out, size_t w, size_t h, size_t c, size_t radius);
+
+        void upsampleAdd(const HDRTexture& small, HDRTexture& big, float weight);
+    }
+}
+
+namespace RE {
+    inline Kernel1D gaussianKernel(float sigma) {
+        const int radius = std::max(1, static_cast<int>(std::ceil(sigma * 3.0f)));
+        Kernel1D kernel(radius * 2 + 1);
+        float sum = 0.0f;
+        for (int i = -radius; i <= radius; i++) {
+            kernel[i + radius] = std::exp(-(i * i) / (2.0f * sigma * sigma));
+            sum += kernel[i + radius];
+        }
+        for (float& k : kernel) {
+            k /= sum;
+        }
+        return kernel;
+    }
+
+    inline void blur::madd(float* out, const float* in, float k, size_t n) {
+        size_t i = 0;
+#if defined(RE_SIMD_AVX2)
+        const __m256 vk = _mm256_set1_ps(k);
+        for (; i + 8 <= n; i += 8) {
+            _mm256_storeu_ps(out + i, _mm256_add_ps(_mm256_loadu_ps(out + i), _mm256_mul_ps(vk, _mm256_loadu_ps(in + i))));
+        }
+#elif defined(RE_SIMD_SSE2)
+        const __m128 vk = _mm_set1_ps(k);
+        for (; i + 4 <= n; i += 4) {
+            _mm_storeu_ps(out + i, _mm_add_ps(_mm_loadu_ps(out + i), _mm_mul_ps(vk, _mm_loadu_ps(in + i))));
+        }
+#endif
+        for (; i < n; i++) {
+            out[i] += k * in[i];
+        }
+    }
+
+    inline void blur::scale(float* out, const float* in, float k, size_t n) {
+        size_t i = 0;
+#if defined(RE_SIMD_AVX2)
+        const __m256 vk = _mm256_set1_ps(k);
+        for (; i + 8 <= n; i += 8) {
+            _mm256_storeu_ps(out + i, _mm256_mul_ps(vk, _mm256_loadu_ps(in + i)));
+        }
+#elif defined(RE_SIMD_SSE2)
+        const __m128 vk = _mm_set1_ps(k);
+        for (; i + 4 <= n; i += 4) {
+            _mm_storeu_ps(out + i, _mm_mul_ps(vk, _mm_loadu_ps(in + i)));
+        }
+#endif
+        for (; i < n; i++) {
+            out[i] = k * in[i];
+        }
+    }
+
+    inline void blur::slide(float* acc, const float* add, const float* sub, size_t n) {
+        size_t i = 0;
+#if defined(RE_SIMD_AVX2)
+        for (; i + 8 <= n; i += 8) {
+            _mm256_storeu_ps(acc + i, _mm256_add_ps(_mm256_loadu_ps(acc + i), _mm256_sub_ps(_mm256_loadu_ps(add + i), _mm256_loadu_ps(sub + i))));
+        }
+#elif defined(RE_SIMD_SSE2)
+        for (; i + 4 <= n; i += 4) {
+            _mm_storeu_ps(acc + i, _mm_add_ps(_mm_loadu_ps(acc + i), _mm_sub_ps(_mm_loadu_ps(add + i), _mm_loadu_ps(sub + i))));
+        }
+#endif
+        for (; i < n; i++) {
+            acc[i] += add[i] - sub[i];
+        }
+    }
+
+    inline void blur::weightedSum(float* out, const float* const* inputs, const float* weights, size_t taps, size_t n) {
+        size_t i = 0;
+#if defined(RE_SIMD_AVX2)
+        for (; i + 16 <= n; i += 16) {
+            __m256 a0 = _mm256_setzero_ps(), a1 = _mm256_setzero_ps();
+            for (size_t j = 0; j < taps; j++) {
+                const __m256 k = _mm256_set1_ps(weights[j]);
+                a0 = _mm256_add_ps(a0, _mm256_mul_ps(k, _mm256_loadu_ps(inputs[j] + i)));
+                a1 = _mm256_add_ps(a1, _mm256_mul_ps(k, _mm256_loadu_ps(inputs[j] + i + 8)));
+            }
+            _mm256_storeu_ps(out + i, a0);
+            _mm256_storeu_ps(out + i + 8, a1);
+        }
+#elif defined(RE_SIMD_SSE2)
+        for (; i + 8 <= n; i += 8) {
+            __m128 a0 = _mm_setzero_ps(), a1 = _mm_setzero_ps();
+            for (size_t j = 0; j < taps; j++) {
+                const __m128 k = _mm_set1_ps(weights[j]);
+                a0 = _mm_add_ps(a0, _mm_mul_ps(k, _mm_loadu_ps(inputs[j] + i)));
+                a1 = _mm_add_ps(a1, _mm_mul_ps(k, _mm_loadu_ps(inputs[j] + i + 4)));
+            }
+            _mm_storeu_ps(out + i, a0);
+            _mm_storeu_ps(out + i + 4, a1);
+        }
+#endif
+        for (; i < n; i++) {
+            float sum = 0.0f;
+            for (size_t j = 0; j < taps; j++) {
+                sum += weights[j] * inputs[j][i];
+            }
+            out[i] = sum;
+        }
+    }
+
+    template <typename T>
+    void blur::loadRow(const T* in, float* out, size_t n) {
+        if constexpr (std::is_same_v<T, float>) {
+            memcpy(out, in, n * sizeof(float));
+        } else {
+            for (size_t i = 0; i < n; i++) {
+                out[i] = static_cast<float>(in[i]);
+            }
+        }
+    }
+
+    template <typename T>
+    void blur::storeRow(const float* in, T* out, size_t n) {
+        if constexpr (std::is_same_v<T, float>) {
+            memcpy(out, in, n * sizeof(float));
+        } else {
+            for (size_t i = 0; i < n; i++) {
+                out[i] = static_cast<T>(RE::camp(in[i] + 0.5f, 0.0f, 255.0f));
+            }
+        }
+    }
+
+    inline void blur::convolveRows(const float* in, float* out, size_t w, size_t h, size_t c, const Kernel1D& kernel) {
+        const size_t radius = kernel.size() / 2;
+        const size_t n = w * c;
+#pragma omp parallel
+        {
+            // 行两端按边缘像素扩展，之后第 j 个抽头就是整行偏移 j * c（交错通道）
+            std::vector<float> padded((w + radius * 2) * c);
+            std::vector<const float*> inputs(kernel.size());
+            for (size_t j = 0; j < kernel.size(); j++) {
+                inputs[j] = padded.data() + j * c;
+            }
+#pragma omp for
+            for (int64_t y = 0; y < static_cast<int64_t>(h); y++) {
+                const float* row = in + y * n;
+                for (size_t x = 0; x < radius; x++) {
+                    memcpy(&padded[x * c], row, c * sizeof(float));
+                    memcpy(&padded[(radius + w + x) * c], row + (w - 1) * c, c * sizeof(float));
+                }
+                memcpy(&padded[radius * c], row, n * sizeof(float));
+                weightedSum(out + y * n, inputs.data(), kernel.data(), kernel.size(), n);
+            }
+        }
+    }
+
+    inline void blur::convolveColumns(const float* in, float* out, size_t w, size_t h, size_t c, const Kernel1D& kernel) {
+        // 垂直方向不转置，直接按整行累加：每个输出行是 2r+1 个输入行的加权和，访存连续且沿行向量化
+        const int64_t radius = static_cast<int64_t>(kernel.size() / 2);
+        const size_t n = w * c;
+#pragma omp parallel
+        {
+            std::vector<const float*> inputs(kernel.size());
+#pragma omp for
+            for (int64_t y = 0; y < static_cast<int64_t>(h); y++) {
+                for (int64_t j = -radius; j <= radius; j++) {
+                    inputs[j + radius] = in + RE::camp<int64_t, int64_t>(y + j, 0, h - 1) * n;
+                }
+                weightedSum(out + y * n, inputs.data(), kernel.data(), kernel.size(), n);
+            }
+        }
+    }
+
+    inline void blur::boxRows(const float* in, float* out, size_t w, size_t h, size_t c, size_t radius) {
+        const float inv = 1.0f / (radius * 2 + 1);
+        const int64_t last = static_cast<int64_t>(w) - 1;
+        const int64_t r = static_cast<int64_t>(radius);
+        const size_t n = w * c;
+#if defined(RE_SIMD_SSE2)
+        // 每 4 行一组转置成 4 路交错，滑动窗口沿 x 走、一次处理 4 行，累加留在寄存器里
+        constexpr size_t LANES = 4;
+#else
+        constexpr size_t LANES = 1;
+#endif
+        const size_t blocks = (LANES > 1) ? h / LANES : 0;
+#pragma omp parallel
+        {
+#if defined(RE_SIMD_SSE2)
+            std::vector<float> tin(n * LANES), tout(n * LANES);
+#pragma omp for nowait
+            for (int64_t b = 0; b < static_cast<int64_t>(blocks); b++) {
+                const float* rows[LANES];
+                float* targets[LANES];
+                for (size_t i = 0; i < LANES; i++) {
+                    rows[i] = in + (b * LANES + i) * n;
+                    targets[i] = out + (b * LANES + i) * n;
+                }
+                // tin[j * 4 + i] = rows[i][j]
+                size_t j = 0;
+                for (; j + 4 <= n; j += 4) {
+                    __m128 r0 = _mm_loadu_ps(rows[0] + j), r1 = _mm_loadu_ps(rows[1] + j);
+                    __m128 r2 = _mm_loadu_ps(rows[2] + j), r3 = _mm_loadu_ps(rows[3] + j);
+                    _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+                    _mm_storeu_ps(&tin[j * 4], r0);
+                    _mm_storeu_ps(&tin[j * 4 + 4], r1);
+                    _mm_storeu_ps(&tin[j * 4 + 8], r2);
+                    _mm_storeu_ps(&tin[j * 4 + 12], r3);
+                }
+                for (; j < n; j++) {
+                    for (size_t i = 0; i < LANES; i++) {
+                        tin[j * 4 + i] = rows[i][j];
+                    }
+                }
+
+                // 累加拆成两个 __m128d，与标量路径一样用 double 避免长行上的误差累积
+                const __m128d vinv = _mm_set1_pd(inv);
+                for (size_t k = 0; k < c; k++) {
+                    auto at = [&](int64_t x) { return _mm_loadu_ps(&tin[(x * c + k) * 4]); };
+                    __m128d lo = _mm_setzero_pd(), hi = _mm_setzero_pd();
+                    for (int64_t i = -r; i <= r; i++) {
+                        const __m128 v = at(RE::camp<int64_t, int64_t>(i, 0, last));
+                        lo = _mm_add_pd(lo, _mm_cvtps_pd(v));
+                        hi = _mm_add_pd(hi, _mm_cvtps_pd(_mm_movehl_ps(v, v)));
+                    }
+                    for (int64_t x = 0; x <= last; x++) {
+                        _mm_storeu_ps(&tout[(x * c + k) * 4], _mm_movelh_ps(_mm_cvtpd_ps(_mm_mul_pd(lo, vinv)), _mm_cvtpd_ps(_mm_mul_pd(hi, vinv))));
+                        const __m128 delta = _mm_sub_ps(at(std::min<int64_t>(x + r + 1, last)), at(std::max<int64_t>(x - r, 0)));
+                        lo = _mm_add_pd(lo, _mm_cvtps_pd(delta));
+                        hi = _mm_add_pd(hi, _mm_cvtps_pd(_mm_movehl_ps(delta, delta)));
+                    }
+                }
+
+                for (j = 0; j + 4 <= n; j += 4) {
+                    __m128 r0 = _mm_loadu_ps(&tout[j * 4]), r1 = _mm_loadu_ps(&tout[j * 4 + 4]);
+                    __m128 r2 = _mm_loadu_ps(&tout[j * 4 + 8]), r3 = _mm_loadu_ps(&tout[j * 4 + 12]);
+                    _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+                    _mm_storeu_ps(targets[0] + j, r0);
+                    _mm_storeu_ps(targets[1] + j, r1);
+                    _mm_storeu_ps(targets[2] + j, r2);
+                    _mm_storeu_ps(targets[3] + j, r3);
+                }
+                for (; j < n; j++) {
+                    for (size_t i = 0; i < LANES; i++) {
+                        targets[i][j] = tout[j * 4 + i];
+                    }
+                }
+            }
+#endif
+            // 凑不满一组的行（以及无 SIMD 时的所有行）逐行处理
+            std::vector<double> acc(c);
+#pragma omp for
+            for (int64_t y = static_cast<int64_t>(blocks * LANES); y < static_cast<int64_t>(h); y++) {
+                const float* row = in + y * n;
+                float* target = out + y * n;
+                for (size_t k = 0; k < c; k++) {
+                    acc[k] = 0.0;
+                    for (int64_t i = -r; i <= r; i++) {
+                        acc[k] += row[RE::camp<int64_t, int64_t>(i, 0, last) * c + k];
+                    }
+                }
+                for (int64_t x = 0; x <= last; x++) {
+                    const size_t addX = std::min<int64_t>(x + r + 1, last);
+                    const size_t subX = std::max<int64_t>(x - r, 0);
+                    for (size_t k = 0; k < c; k++) {
+                        target[x * c + k] = static_cast<float>(acc[k] * inv);
+                        acc[k] += row[addX * c + k] - row[subX * c + k];
+                    }
+                }
+            }
+        }
+    }
+
+    inline void blur::boxColumns(const float* in, float* out, size_t w, size_t h, size_t c, size_t radius) {
+        // 按列条带并行，每条带内维护一行累加器，沿行向量化地滑动
+        constexpr size_t STRIP = 256;
+        const float inv = 1.0f / (radius * 2 + 1);
+        const size_t n = w * c;
+        const int64_t last = static_cast<int64_t>(h) - 1;
+        const size_t strips = (n + STRIP - 1) / STRIP;
+#pragma omp parallel
+        {
+            std::vector<float> acc(STRIP);
+#pragma omp for
+            for (int64_t s = 0; s < static_cast<int64_t>(strips); s++) {
+                const size_t x0 = s * STRIP;
+                const size_t len = std::min(STRIP, n - x0);
+                std::fill(acc.begin(), acc.end(), 0.0f);
+                for (int64_t i = -static_cast<int64_t>(radius); i <= static_cast<int64_t>(radius); i++) {
+                    madd(acc.data(), in + RE::camp<int64_t, int64_t>(i, 0, last) * n + x0, 1.0f, len);
+                }
+                for (int64_t y = 0; y <= last; y++) {
+                    scale(out + y * n + x0, acc.data(), inv, len);
+                    const int64_t addY = std::min<int64_t>(y + radius + 1, last);
+                    const int64_t subY = std::max<int64_t>(y - static_cast<int64_t>(radius), 0);
+                    slide(acc.data(), in + addY * n + x0, in + subY * n + x0, len);
+                }
+            }
+        }
+    }
+
+    template <typename T>
+    void convolveSeparable(const TextureBase<T>& src, TextureBase<T>& dst, const Kernel1D& kernelX, const Kernel1D& kernelY) {
+        const size_t w = src.width(), h = src.height(), c = src.channel();
+        const size_t n = w * h * c;
+        if (n == 0 || kernelX.empty() || kernelY.empty()) {
+            return;
+        }
+        std::vector<float> a(n), b(n);
+        blur::loadRow(src.data(), a.data(), n);
+        blur::convolveRows(a.data(), b.data(), w, h, c, kernelX);
+        blur::convolveColumns(b.data(), a.data(), w, h, c, kernelY);
+        if (dst.width() != w || dst.height() != h || dst.channel() != c) {
+            dst.setSize(w, h, c);
+        }
+        blur::storeRow(a.data(), dst.data(), n);
+    }
+
+    template <typename T>
+    void boxBlur(const TextureBase<T>& src, TextureBase<T>& dst, size_t radius) {
+        const size_t w = src.width(), h = src.height(), c = src.channel();
+        const size_t n = w * h * c;
+        if (n == 0) {
+            return;
+        }
+        std::vector<float> a(n), b(n);
+        blur::loadRow(src.data(), a.data(), n);
+        blur::boxRows(a.data(), b.data(), w, h, c, radius);
+        blur::boxColumns(b.data(), a.data(), w, h, c, radius);
+        if (dst.width() != w || dst.height() != h || dst.channel() != c) {
+            dst.setSize(w, h, c);
+        }
+        blur::storeRow(a.data(), dst.data(), n);
+    }
+
+    template <typename T>
+    void gaussianBlur(const TextureBase<T>& src, TextureBase<T>& dst, float sigma) {
+        // 半径较小时卷积更准确也不慢
+        if (sigma <= 4.0f) {
+            const Kernel1D kernel = gaussianKernel(std::max(sigma, 0.1f));
+            convolveSeparable(src, dst, kernel, kernel);
+            return;
+        }
+        const size_t w = src.width(), h = src.height(), c = src.channel();
+        const size_t n = w * h * c;
+        if (n == 0) {
+            return;
+        }
+        // 三次盒式模糊逼近高斯：按目标方差选两种相邻的盒宽（Kovesi 的做法）
+        constexpr int PASSES = 3;
+        const float ideal = std::sqrt(12.0f * sigma * sigma / PASSES + 1.0f);
+        int wl = static_cast<int>(ideal);
+        if (wl % 2 == 0) {
+            wl--;
+        }
+        const int wu = wl + 2;
+        const int m = static_cast<int>(std::round((12.0f * sigma * sigma - PASSES * wl * wl - 4.0f * PASSES * wl - 3.0f * PASSES) / (-4.0f * wl - 4.0f)));
+
+        std::vector<float> a(n), b(n);
+        blur::loadRow(src.data(), a.data(), n);
+        for (int i = 0; i < PASSES; i++) {
+            const size_t radius = ((i < m) ? wl : wu) / 2;
+            blur::boxRows(a.data(), b.data(), w, h, c, radius);
+            blur::boxColumns(b.data(), a.data(), w, h, c, radius);
+        }
+        if (dst.width() != w || dst.height() != h || dst.channel() != c) {
+            dst.setSize(w, h, c);
+        }
+        blur::storeRow(a.data(), dst.data(), n);
+    }
+
+    inline void blur::upsampleAdd(const HDRTexture& small, HDRTexture& big, float weight) {
+        const size_t sw = small.width(), sh = small.height();
+        const size_t bw = big.width(), bh = big.height();
+        const size_t c = std::min(small.channel(), big.channel());
+        const size_t sc = small.channel(), bc = big.channel();
+        const float sx = static_cast<float>(sw) / bw;
+        const float sy = static_cast<float>(sh) / bh;
+        const float* in = small.data();
+        float* out = big.data();
+#pragma omp parallel for
+        for (int64_t y = 0; y < static_cast<int64_t>(bh); y++) {
+            const float fy = RE::camp((y + 0.5f) * sy - 0.5f, 0.0f, static_cast<float>(sh - 1));
+            const size_t y0 = static_cast<size_t>(fy);
+            const size_t y1 = std::min(y0 + 1, sh - 1);
+            const float dy = fy - y0;
+            const float* r0 = in + y0 * sw * sc;
+            const float* r1 = in + y1 * sw * sc;
+            float* target = out + y * bw * bc;
+            for (size_t x = 0; x < bw; x++) {
+                const float fx = RE::camp((x + 0.5f) * sx - 0.5f, 0.0f, static_cast<float>(sw - 1));
+                const size_t x0 = static_cast<size_t>(fx);
+                const size_t x1 = std::min(x0 + 1, sw - 1);
+                const float dx = fx - x0;
+                for (size_t k = 0; k < c; k++) {
+                    const float top = r0[x0 * sc + k] + (r0[x1 * sc + k] - r0[x0 * sc + k]) * dx;
+                    const float bottom = r1[x0 * sc + k] + (r1[x1 * sc + k] - r1[x0 * sc + k]) * dx;
+                    target[x * bc + k] += (top + (bottom - top) * dy) * weight;
+                }
+            }
+        }
+    }
+
+    inline void bloom(HDRTexture& image, const BloomSettings& settings) {
+        const size_t w = image.width(), h = image.height(), c = image.channel();
+        if (w < 2 || h < 2 || c < 3 || settings.levels == 0) {
+            return;
+        }
+
+        // 亮部提取，二次曲线软阈值
+        HDRTexture bright(w, h, c);
+        const float* in = image.data();
+        float* out = bright.data();
+        const float knee = std::max(settings.knee, 1e-4f);
+#pragma omp parallel for
+        for (int64_t i = 0; i < static_cast<int64_t>(w * h); i++) {
+            const float* p = in + i * c;
+            const float lum = std::max(p[0], std::max(p[1], p[2]));
+            float soft = RE::camp(lum - settings.threshold + knee, 0.0f, 2.0f * knee);
+            soft = soft * soft / (4.0f * knee);
+            const float contribution = std::max(soft, lum - settings.threshold) / std::max(lum, 1e-4f);
+            for (size_t k = 0; k < c; k++) {
+                out[i * c + k] = (k < 3) ? p[k] * contribution : 0.0f;
+            }
+        }
+
+        // 逐级降采样并模糊，低分辨率级别的模糊等效于原图上的大半径模糊
+        std::vector<HDRTexture> chain(settings.levels);
+        const HDRTexture* prev = &bright;
+        size_t count = 0;
+        for (; count < settings.levels && prev->width() > 1 && prev->height() > 1; count++) {
+            downsampleHalf(*prev, chain[count]);
+            gaussianBlur(chain[count], chain[count], settings.sigma);
+            prev = &chain[count];
+        }
+
+        // 自底向上累加回上一级，最后按强度叠加回原图
+        for (size_t i = count; i-- > 1;) {
+            blur::upsampleAdd(chain[i], chain[i - 1], 1.0f);
+        }
+        if (count > 0) {
+            blur::upsampleAdd(chain[0], image, settings.intensity);
+        }
+    }
+}
@@ -0,0 +1,389 @@
+#pragma once
+#include "RE_includes.h"
+#include "RE_Texture.hpp"
+
+namespace RE {
+    // 3D 查找表调色，四面体插值
+    // 表项按 RGBA 四个 float 存储（A 仅作填充），便于一次加载一个顶点
+    class LUT3D {
+    public:
+        LUT3D();
+        explicit LUT3D(size_t size); // 恒等表
+
+        // 读取 .cube 文件（LUT_3D_SIZE / DOMAIN_MIN / DOMAIN_MAX / 数据行，r 变化最快），失败时返回 false
+        bool loadCube(const char* filename);
+        void setIdentity(size_t size);
+
+        size_t size() const;
+        bool empty() const;
+        hrgb domainMin() const;
+        hrgb domainMax() const;
+
+        // 单个颜色的标量查询，超出 domain 的输入会被 clamp
+        hrgb lookup(hrgb color) const;
+
+        // 整幅纹理调色，src 与 dst 可以是同一张纹理，通道数为 3 或 4（alpha 原样拷贝）
+        // 8 位纹理按编码值 [0, 255] 映射到 [0, 1] 查询，与 .cube 通常作用于显示空间一致
+        void apply(const Texture& src, Texture& dst) const;
+        void apply(const HDRTexture& src, HDRTexture& dst) const;
+        void apply(Texture& texture) const;
+        void apply(HDRTexture& texture) const;
+
+        // 对 SoA 排列的 count 个颜色原地调色
+        void applySpan(float* r, float* g, float* b, size_t count) const;
+
+    private:
+        size_t _size = 0;
+        std::vector<float> table;
+        hrgb _domainMin = hrgb(0.0f);
+        hrgb _domainMax = hrgb(1.0f);
+
+        const float* entry(size_t index) const;
+
+        template <typename T>
+        void applyRows(const TextureBase<T>& src, TextureBase<T>& dst) const;
+    };
+}
+
+namespace RE {
+    inline LUT3D::LUT3D() {}
+
+    inline LUT3D::LUT3D(size_t size) {
+        setIdentity(size);
+    }
+
+    inline void LUT3D::setIdentity(size_t size) {
+        _size = std::max<size_t>(size, 2);
+        _domainMin = hrgb(0.0f);
+        _domainMax = hrgb(1.0f);
+        table.assign(_size * _size * _size * 4, 0.0f);
+        const float step = 1.0f / (_size - 1);
+        for (size_t b = 0; b < _size; b++) {
+            for (size_t g = 0; g < _size; g++) {
+                for (size_t r = 0; r < _size; r++) {
+                    float* e = &table[((b * _size + g) * _size + r) * 4];
+                    e[0] = r * step;
+                    e[1] = g * step;
+                    e[2] = b * step;
+                }
+            }
+        }
+    }
+
+    inline bool LUT3D::loadCube(const char* filename) {
+        FILE* file = fopen(filename, "r");
+        if (file == nullptr) {
+            std::cerr << "LUT3D Error: can not open " << filename << std::endl;
+            return false;
+        }
+
+        size_t size = 0;
+        hrgb domainMin(0.0f), domainMax(1.0f);
+        std::vector<float> values;
+        char line[512];
+        bool ok = true;
+        while (ok && fgets(line, sizeof(line), file) != nullptr) {
+            const char* p = line;
+            while (*p == ' ' || *p == '\t') {
+                p++;
+            }
+            if (*p == '#' || *p == '\n' || *p == '\r' || *p == '\0') {
+                continue;
+            }
+            float r, g, b;
+            if (strncmp(p, "LUT_3D_SIZE", 11) == 0) {
+                size = strtoul(p + 11, nullptr, 10);
+                ok = size >= 2 && size <= 256;
+                values.reserve(size * size * size * 4);
+            } else if (strncmp(p, "LUT_1D_SIZE", 11) == 0) {
+                std::cerr << "LUT3D Error: 1D LUT is not supported " << filename << std::endl;
+                ok = false;
+            } else if (strncmp(p, "DOMAIN_MIN", 10) == 0) {
+                ok = sscanf(p + 10, "%f %f %f", &domainMin.r, &domainMin.g, &domainMin.b) == 3;
+            } else if (strncmp(p, "DOMAIN_MAX", 10) == 0) {
+                ok = sscanf(p + 10, "%f %f %f", &domainMax.r, &domainMax.g, &domainMax.b) == 3;
+            } else if (sscanf(p, "%f %f %f", &r, &g, &b) == 3) {
+                values.insert(values.end(), {r, g, b, 0.0f});
+            }
+            // TITLE 等其余关键字忽略
+        }
+        fclose(file);
+
+        if (!ok || size == 0 || values.size() != size * size * size * 4) {
+            std::cerr << "LUT3D Error: bad cube file " << filename << std::endl;
+            return false;
+        }
+        if (domainMax.r <= domainMin.r || domainMax.g <= domainMin.g || domainMax.b <= domainMin.b) {
+            std::cerr << "LUT3D Error: bad domain " << filename << std::endl;
+            return false;
+        }
+        _size = size;
+        _domainMin = domainMin;
+        _domainMax = domainMax;
+        table = std::move(values);
+        return true;
+    }
+
+    inline size_t LUT3D::size() const {
+        return _size;
+    }
+
+    inline bool LUT3D::empty() const {
+        return _size == 0;
+    }
+
+    inline hrgb LUT3D::domainMin() const {
+        return _domainMin;
+    }
+
+    inline hrgb LUT3D::domainMax() const {
+        return _domainMax;
+    }
+
+    inline const float* LUT3D::entry(size_t index) const {
+        return table.data() + index * 4;
+    }
+
+    inline hrgb LUT3D::lookup(hrgb color) const {
+        float r = color.r, g = color.g, b = color.b;
+        applySpan(&r, &g, &b, 1);
+        return hrgb(r, g, b);
+    }
+
+    inline void LUT3D::applySpan(float* r, float* g, float* b, size_t count) const {
+        if (_size == 0) {
+            return;
+        }
+        // 四面体插值：按小数部分从大到小沿三条轴走到对角顶点
+        // out = c000 + fmax * (c1 - c000) + fmid * (c2 - c1) + fmin * (c111 - c2)
+        const int32_t n = static_cast<int32_t>(_size);
+        const int32_t strideR = 1, strideG = n, strideB = n * n;
+        const int32_t strideAll = strideR + strideG + strideB;
+        const float last = static_cast<float>(n - 1);
+        const hrgb scale = last / (_domainMax - _domainMin);
+        const float* lut = table.data();
+
+        size_t i = 0;
+#if defined(RE_SIMD_AVX2)
+        const __m256 vLast = _mm256_set1_ps(last);
+        const __m256i vMaxBase = _mm256_set1_epi32(n - 2);
+        const __m256 zero = _mm256_setzero_ps();
+        const __m256i sR = _mm256_set1_epi32(strideR), sG = _mm256_set1_epi32(strideG), sB = _mm256_set1_epi32(strideB);
+        const __m256i sAll = _mm256_set1_epi32(strideAll);
+        for (; i + 8 <= count; i += 8) {
+            __m256 x[3] = {_mm256_loadu_ps(r + i), _mm256_loadu_ps(g + i), _mm256_loadu_ps(b + i)};
+            __m256i base[3];
+            __m256 f[3];
+            for (int k = 0; k < 3; k++) {
+                x[k] = _mm256_mul_ps(_mm256_sub_ps(x[k], _mm256_set1_ps(_domainMin[k])), _mm256_set1_ps(scale[k]));
+                x[k] = _mm256_min_ps(_mm256_max_ps(x[k], zero), vLast); // max 把 NaN 变成 0
+                base[k] = _mm256_min_epi32(_mm256_cvttps_epi32(x[k]), vMaxBase);
+                f[k] = _mm256_sub_ps(x[k], _mm256_cvtepi32_ps(base[k]));
+            }
+            const __m256i idx0 = _mm256_add_epi32(_mm256_add_epi32(base[0], _mm256_mullo_epi32(base[1], sG)), _mm256_mullo_epi32(base[2], sB));
+
+            const __m256 rg = _mm256_cmp_ps(f[0], f[1], _CMP_GE_OQ);
+            const __m256 rb = _mm256_cmp_ps(f[0], f[2], _CMP_GE_OQ);
+            const __m256 gb = _mm256_cmp_ps(f[1], f[2], _CMP_GE_OQ);
+            // 最大轴与最小轴
+            const __m256i rMax = _mm256_castps_si256(_mm256_and_ps(rg, rb));
+            const __m256i gMax = _mm256_castps_si256(_mm256_andnot_ps(rg, gb));
+            const __m256i rMin = _mm256_castps_si256(_mm256_andnot_ps(rg, _mm256_andnot_ps(rb, _mm256_castsi256_ps(_mm256_set1_epi32(-1)))));
+            const __m256i gMin = _mm256_castps_si256(_mm256_andnot_ps(gb, rg));
+            const __m256i off1 = _mm256_blendv_epi8(_mm256_blendv_epi8(sB, sG, gMax), sR, rMax);
+            const __m256i offMin = _mm256_blendv_epi8(_mm256_blendv_epi8(sB, sG, gMin), sR, rMin);
+            const __m256i off2 = _mm256_sub_epi32(sAll, offMin);
+
+            const __m256 fMax = _mm256_max_ps(f[0], _mm256_max_ps(f[1], f[2]));
+            const __m256 fMin = _mm256_min_ps(f[0], _mm256_min_ps(f[1], f[2]));
+            const __m256 fMid = _mm256_max_ps(_mm256_min_ps(f[0], f[1]), _mm256_min_ps(_mm256_max_ps(f[0], f[1]), f[2]));
+
+            // 每个顶点按像素加载一个 RGBA 表项再转置成 SoA，比按通道 gather 少 2/3 的访存指令
+            alignas(32) int32_t idx[4][8];
+            _mm256_store_si256(reinterpret_cast<__m256i*>(idx[0]), idx0);
+            _mm256_store_si256(reinterpret_cast<__m256i*>(idx[1]), _mm256_add_epi32(idx0, off1));
+            _mm256_store_si256(reinterpret_cast<__m256i*>(idx[2]), _mm256_add_epi32(idx0, off2));
+            _mm256_store_si256(reinterpret_cast<__m256i*>(idx[3]), _mm256_add_epi32(idx0, sAll));
+            __m256 c[4][3]; // [顶点][通道]
+            for (int v = 0; v < 4; v++) {
+                const int32_t* p = idx[v];
+                const __m256 q0 = _mm256_setr_m128(_mm_loadu_ps(lut + p[0] * 4), _mm_loadu_ps(lut + p[4] * 4));
+                const __m256 q1 = _mm256_setr_m128(_mm_loadu_ps(lut + p[1] * 4), _mm_loadu_ps(lut + p[5] * 4));
+                const __m256 q2 = _mm256_setr_m128(_mm_loadu_ps(lut + p[2] * 4), _mm_loadu_ps(lut + p[6] * 4));
+                const __m256 q3 = _mm256_setr_m128(_mm_loadu_ps(lut + p[3] * 4), _mm_loadu_ps(lut + p[7] * 4));
+                const __m256 t0 = _mm256_unpacklo_ps(q0, q1);
+                const __m256 t1 = _mm256_unpacklo_ps(q2, q3);
+                const __m256 t2 = _mm256_unpackhi_ps(q0, q1);
+                const __m256 t3 = _mm256_unpackhi_ps(q2, q3);
+                c[v][0] = _mm256_shuffle_ps(t0, t1, _MM_SHUFFLE(1, 0, 1, 0));
+                c[v][1] = _mm256_shuffle_ps(t0, t1, _MM_SHUFFLE(3, 2, 3, 2));
+                c[v][2] = _mm256_shuffle_ps(t2, t3, _MM_SHUFFLE(1, 0, 1, 0));
+            }
+            float* out[3] = {r + i, g + i, b + i};
+            for (int k = 0; k < 3; k++) {
+                __m256 o = _mm256_add_ps(c[0][k], _mm256_mul_ps(fMax, _mm256_sub_ps(c[1][k], c[0][k])));
+                o = _mm256_add_ps(o, _mm256_mul_ps(fMid, _mm256_sub_ps(c[2][k], c[1][k])));
+                o = _mm256_add_ps(o, _mm256_mul_ps(fMin, _mm256_sub_ps(c[3][k], c[2][k])));
+                _mm256_storeu_ps(out[k], o);
+            }
+        }
+#elif defined(RE_SIMD_SSE2)
+        // 没有 gather：每个顶点按像素加载一个 RGBA 表项，4x4 转置回 SoA
+        const __m128 vLast = _mm_set1_ps(last);
+        const __m128 zero = _mm_setzero_ps();
+        alignas(16) int32_t idx[4][4];
+        for (; i + 4 <= count; i += 4) {
+            __m128 x[3] = {_mm_loadu_ps(r + i), _mm_loadu_ps(g + i), _mm_loadu_ps(b + i)};
+            __m128i base[3];
+            __m128 f[3];
+            for (int k = 0; k < 3; k++) {
+                x[k] = _mm_mul_ps(_mm_sub_ps(x[k], _mm_set1_ps(_domainMin[k])), _mm_set1_ps(scale[k]));
+                x[k] = _mm_min_ps(_mm_max_ps(x[k], zero), vLast);
+                base[k] = _mm_cvttps_epi32(x[k]);
+                const __m128i over = _mm_cmpgt_epi32(base[k], _mm_set1_epi32(n - 2));
+                base[k] = _mm_sub_epi32(base[k], _mm_and_si128(over, _mm_set1_epi32(1)));
+                f[k] = _mm_sub_ps(x[k], _mm_cvtepi32_ps(base[k]));
+            }
+            // SSE2 没有 32 位乘法，基址用标量算
+            alignas(16) int32_t br[4], bg[4], bb[4];
+            _mm_store_si128(reinterpret_cast<__m128i*>(br), base[0]);
+            _mm_store_si128(reinterpret_cast<__m128i*>(bg), base[1]);
+            _mm_store_si128(reinterpret_cast<__m128i*>(bb), base[2]);
+            const __m128i idx0 = _mm_setr_epi32(br[0] + bg[0] * strideG + bb[0] * strideB, br[1] + bg[1] * strideG + bb[1] * strideB,
+                                                br[2] + bg[2] * strideG + bb[2] * strideB, br[3] + bg[3] * strideG + bb[3] * strideB);
+
+            const __m128i rg = _mm_castps_si128(_mm_cmpge_ps(f[0], f[1]));
+            const __m128i rb = _mm_castps_si128(_mm_cmpge_ps(f[0], f[2]));
+            const __m128i gb = _mm_castps_si128(_mm_cmpge_ps(f[1], f[2]));
+            const __m128i rMax = _mm_and_si128(rg, rb);
+            const __m128i gMax = _mm_andnot_si128(rg, gb);
+            const __m128i bMax = _mm_andnot_si128(_mm_or_si128(rMax, gMax), _mm_set1_epi32(-1));
+            const __m128i rMin = _mm_andnot_si128(_mm_or_si128(rg, rb), _mm_set1_epi32(-1));
+            const __m128i gMin = _mm_andnot_si128(gb, rg);
+            const __m128i bMin = _mm_andnot_si128(_mm_or_si128(rMin, gMin), _mm_set1_epi32(-1));
+            const __m128i off1 = _mm_or_si128(_mm_or_si128(_mm_and_si128(rMax, _mm_set1_epi32(strideR)), _mm_and_si128(gMax, _mm_set1_epi32(strideG))),
+                                              _mm_and_si128(bMax, _mm_set1_epi32(strideB)));
+            const __m128i offMin = _mm_or_si128(_mm_or_si128(_mm_and_si128(rMin, _mm_set1_epi32(strideR)), _mm_and_si128(gMin, _mm_set1_epi32(strideG))),
+                                                _mm_and_si128(bMin, _mm_set1_epi32(strideB)));
+            const __m128i off2 = _mm_sub_epi32(_mm_set1_epi32(strideAll), offMin);
+
+            const __m128 fMax = _mm_max_ps(f[0], _mm_max_ps(f[1], f[2]));
+            const __m128 fMin = _mm_min_ps(f[0], _mm_min_ps(f[1], f[2]));
+            const __m128 fMid = _mm_max_ps(_mm_min_ps(f[0], f[1]), _mm_min_ps(_mm_max_ps(f[0], f[1]), f[2]));
+
+            _mm_store_si128(reinterpret_cast<__m128i*>(idx[0]), idx0);
+            _mm_store_si128(reinterpret_cast<__m128i*>(idx[1]), _mm_add_epi32(idx0, off1));
+            _mm_store_si128(reinterpret_cast<__m128i*>(idx[2]), _mm_add_epi32(idx0, off2));
+            _mm_store_si128(reinterpret_cast<__m128i*>(idx[3]), _mm_add_epi32(idx0, _mm_set1_epi32(strideAll)));
+            __m128 c[4][4]; // [顶点][通道]
+            for (int v = 0; v < 4; v++) {
+                __m128 p0 = _mm_loadu_ps(lut + idx[v][0] * 4);
+                __m128 p1 = _mm_loadu_ps(lut + idx[v][1] * 4);
+                __m128 p2 = _mm_loadu_ps(lut + idx[v][2] * 4);
+                __m128 p3 = _mm_loadu_ps(lut + idx[v][3] * 4);
+                _MM_TRANSPOSE4_PS(p0, p1, p2, p3);
+                c[v][0] = p0;
+                c[v][1] = p1;
+                c[v][2] = p2;
+            }
+            float* out[3] = {r + i, g + i, b + i};
+            for (int k = 0; k < 3; k++) {
+                __m128 o = _mm_add_ps(c[0][k], _mm_mul_ps(fMax, _mm_sub_ps(c[1][k], c[0][k])));
+                o = _mm_add_ps(o, _mm_mul_ps(fMid, _mm_sub_ps(c[2][k], c[1][k])));
+                o = _mm_add_ps(o, _mm_mul_ps(fMin, _mm_sub_ps(c[3][k], c[2][k])));
+                _mm_storeu_ps(out[k], o);
+            }
+        }
+#endif
+        for (; i < count; i++) {
+            float x[3] = {r[i], g[i], b[i]};
+            int32_t base[3];
+            float f[3];
+            for (int k = 0; k < 3; k++) {
+                x[k] = (x[k] - _domainMin[k]) * scale[k];
+                x[k] = (x[k] > 0.0f) ? std::min(x[k], last) : 0.0f;
+                base[k] = std::min(static_cast<int32_t>(x[k]), n - 2);
+                f[k] = x[k] - base[k];
+            }
+            const int32_t idx0 = base[0] + base[1] * strideG + base[2] * strideB;
+            const int32_t strides[3] = {strideR, strideG, strideB};
+            // 三个轴按小数部分从大到小排序
+            int a0 = 0, a1 = 1, a2 = 2;
+            if (f[a0] < f[a1]) std::swap(a0, a1);
+            if (f[a1] < f[a2]) std::swap(a1, a2);
+            if (f[a0] < f[a1]) std::swap(a0, a1);
+            const float* c0 = entry(idx0);
+            const float* c1 = entry(idx0 + strides[a0]);
+            const float* c2 = entry(idx0 + strides[a0] + strides[a1]);
+            const float* c3 = entry(idx0 + strideAll);
+            float* out[3] = {r + i, g + i, b + i};
+            for (int k = 0; k < 3; k++) {
+                *out[k] = c0[k] + f[a0] * (c1[k] - c0[k]) + f[a1] * (c2[k] - c1[k]) + f[a2] * (c3[k] - c2[k]);
+            }
+        }
+    }
+
+    template <typename T>
+    void LUT3D::applyRows(const TextureBase<T>& src, TextureBase<T>& dst) const {
+        const size_t w = std::min(src.width(), dst.width());
+        const size_t h = std::min(src.height(), dst.height());
+        const size_t sc = src.channel();
+        const size_t dc = dst.channel();
+        if (_size == 0 || sc < 3 || dc < 3) {
+            std::cerr << "LUT3D Error: empty table or texture without RGB" << std::endl;
+            return;
+        }
+        const float toUnit = std::is_same_v<T, uint8_t> ? 1.0f / 255.0f : 1.0f;
+        const T* in = src.data();
+        T* out = dst.data();
+
+#pragma omp parallel
+        {
+            // 每行先拆成 SoA，调色后再写回交错排列
+            std::vector<float> r(w), g(w), b(w);
+#pragma omp for
+            for (int64_t y = 0; y < static_cast<int64_t>(h); y++) {
+                const T* row = in + src.getIndex(0, y);
+                for (size_t x = 0; x < w; x++) {
+                    r[x] = row[x * sc] * toUnit;
+                    g[x] = row[x * sc + 1] * toUnit;
+                    b[x] = row[x * sc + 2] * toUnit;
+                }
+                applySpan(r.data(), g.data(), b.data(), w);
+
+                T* target = out + dst.getIndex(0, y);
+                for (size_t x = 0; x < w; x++) {
+                    const T alpha = (sc == 4) ? row[x * sc + 3] : (std::is_same_v<T, uint8_t> ? T(255) : T(1));
+                    if constexpr (std::is_same_v<T, uint8_t>) {
+                        target[x * dc] = static_cast<uint8_t>(RE::camp(r[x], 0.0f, 1.0f) * 255.0f + 0.5f);
+                        target[x * dc + 1] = static_cast<uint8_t>(RE::camp(g[x], 0.0f, 1.0f) * 255.0f + 0.5f);
+                        target[x * dc + 2] = static_cast<uint8_t>(RE::camp(b[x], 0.0f, 1.0f) * 255.0f + 0.5f);
+                    } else {
+                        target[x * dc] = r[x];
+                        target[x * dc + 1] = g[x];
+                        target[x * dc + 2] = b[x];
+                    }
+                    if (dc == 4) {
+                        target[x * dc + 3] = alpha;
+                    }
+                }
+            }
+        }
+    }
+
+    inline void LUT3D::apply(const Texture& src, Texture& dst) const {
+        applyRows(src, dst);
+    }
+
+    inline void LUT3D::apply(const HDRTexture& src, HDRTexture& dst) const {
+        applyRows(src, dst);
+    }
+
+    inline void LUT3D::apply(Texture& texture) const {
+        applyRows(texture, texture);
+    }
+
+    inline void LUT3D::apply(HDRTexture& texture) const {
+        applyRows(texture, texture);
+    }
+}
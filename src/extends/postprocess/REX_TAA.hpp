@@ -0,0 +1,255 @@
+#pragma once
+#include "RE_includes.h"
+#include "RE_Texture.hpp"
+#include "RE_Renderer.hpp"
+
+namespace RE {
+    struct TAASettings {
+        float feedback = 0.9f;          // 历史帧权重，越大越平滑，拖影也越明显
+        bool neighbourhoodClamp = true; // 用当前帧 3x3 邻域的颜色范围约束历史值，抑制拖影
+        uint32_t jitterPeriod = 16;     // 抖动序列长度
+    };
+
+    // 时间抗锯齿：每帧光栅化时加亚像素抖动，再把当前帧与重投影后的历史帧混合
+    // 历史保存在 RGBA float 缓冲里，8 位输入按 [0, 1] 存放
+    // 用法：rasterizer.setJitter(taa.jitter()) -> 绘制 -> taa.resolve(...) -> taa.nextFrame()
+    class TemporalAA {
+    public:
+        TemporalAA();
+        explicit TemporalAA(const TAASettings& settings);
+
+        void setSettings(const TAASettings& settings);
+        const TAASettings& settings() const;
+
+        // 丢弃历史（镜头切换、分辨率改变时）
+        void reset();
+        void nextFrame();
+        uint32_t frameIndex() const;
+        // 本帧应加到光栅化上的抖动（像素）
+        glm::vec2 jitter() const;
+
+        // 用速度缓冲重投影，velocity 为 2 通道、单位像素（当前 - 上一帧），nullptr 表示静止
+        // current 与 output 可以是同一张纹理
+        template <typename T>
+        void resolve(const TextureBase<T>& current, const Buffer3D<float>* velocity, TextureBase<T>& output);
+        // 用深度和相机矩阵重投影（只对静态物体正确），depth 取第 0 个通道，即 NDC 深度（工程定义了 GLM_FORCE_DEPTH_ZERO_TO_ONE，范围 [0, 1]）
+        // 屏幕坐标约定与光栅化一致：x 向右、y 向下、像素中心在 +0.5
+        template <typename T>
+        void resolve(const TextureBase<T>& current, const Buffer3D<float>& depth, const glm::mat4& inverseViewProjection,
+                     const glm::mat4& previousViewProjection, TextureBase<T>& output);
+
+        const Buffer3D<float>& historyBuffer() const;
+
+    private:
+        TAASettings _settings;
+        Buffer3D<float> history{0, 0, 0};
+        Buffer3D<float> next{0, 0, 0};
+        Buffer3D<float> frame{0, 0, 0};          // 当前帧转为 RGBA float
+        Buffer3D<float> cameraVelocity{0, 0, 0}; // 由相机矩阵算出的速度
+        bool valid = false;
+        uint32_t index = 0;
+    };
+
+    namespace taa {
+        // 一个 RGBA 像素的向量运算，SSE 下一个寄存器正好装下
+#if defined(RE_SIMD_SSE2)
+        using Pixel = __m128;
+        RE_FORCEINLINE Pixel load(const float* p) { return _mm_loadu_ps(p); }
+        RE_FORCEINLINE void store(float* p, Pixel v) { _mm_storeu_ps(p, v); }
+        RE_FORCEINLINE Pixel set1(float v) { return _mm_set1_ps(v); }
+        RE_FORCEINLINE Pixel add(Pixel a, Pixel b) { return _mm_add_ps(a, b); }
+        RE_FORCEINLINE Pixel mul(Pixel a, Pixel b) { return _mm_mul_ps(a, b); }
+        RE_FORCEINLINE Pixel vmin(Pixel a, Pixel b) { return _mm_min_ps(a, b); }
+        RE_FORCEINLINE Pixel vmax(Pixel a, Pixel b) { return _mm_max_ps(a, b); }
+#else
+        using Pixel = glm::vec4;
+        RE_FORCEINLINE Pixel load(const float* p) { return Pixel(p[0], p[1], p[2], p[3]); }
+        RE_FORCEINLINE void store(float* p, Pixel v) { p[0] = v.x, p[1] = v.y, p[2] = v.z, p[3] = v.w; }
+        RE_FORCEINLINE Pixel set1(float v) { return Pixel(v); }
+        RE_FORCEINLINE Pixel add(Pixel a, Pixel b) { return a + b; }
+        RE_FORCEINLINE Pixel mul(Pixel a, Pixel b) { return a * b; }
+        RE_FORCEINLINE Pixel vmin(Pixel a, Pixel b) { return glm::min(a, b); }
+        RE_FORCEINLINE Pixel vmax(Pixel a, Pixel b) { return glm::max(a, b); }
+#endif
+        // RGBA float 缓冲的双线性采样，坐标以像素中心为整数点，边缘 clamp
+        Pixel sampleBilinear(const Buffer3D<float>& buffer, float x, float y);
+    }
+}
+
+namespace RE {
+    inline TemporalAA::TemporalAA() {}
+
+    inline TemporalAA::TemporalAA(const TAASettings& settings) : _settings(settings) {}
+
+    inline void TemporalAA::setSettings(const TAASettings& settings) {
+        _settings = settings;
+    }
+
+    inline const TAASettings& TemporalAA::settings() const {
+        return _settings;
+    }
+
+    inline void TemporalAA::reset() {
+        valid = false;
+        index = 0;
+    }
+
+    inline void TemporalAA::nextFrame() {
+        index++;
+    }
+
+    inline uint32_t TemporalAA::frameIndex() const {
+        return index;
+    }
+
+    inline glm::vec2 TemporalAA::jitter() const {
+        return jitterSequence(index, _settings.jitterPeriod);
+    }
+
+    inline const Buffer3D<float>& TemporalAA::historyBuffer() const {
+        return history;
+    }
+
+    inline taa::Pixel taa::sampleBilinear(const Buffer3D<float>& buffer, float x, float y) {
+        const int64_t w = static_cast<int64_t>(buffer.width()), h = static_cast<int64_t>(buffer.height());
+        const float fx = std::floor(x), fy = std::floor(y);
+        const float tx = x - fx, ty = y - fy;
+        const int64_t x0 = std::clamp<int64_t>(static_cast<int64_t>(fx), 0, w - 1), x1 = std::clamp<int64_t>(static_cast<int64_t>(fx) + 1, 0, w - 1);
+        const int64_t y0 = std::clamp<int64_t>(static_cast<int64_t>(fy), 0, h - 1), y1 = std::clamp<int64_t>(static_cast<int64_t>(fy) + 1, 0, h - 1);
+        const float* data = buffer.data();
+        const Pixel p00 = load(data + (y0 * w + x0) * 4), p10 = load(data + (y0 * w + x1) * 4);
+        const Pixel p01 = load(data + (y1 * w + x0) * 4), p11 = load(data + (y1 * w + x1) * 4);
+        const Pixel top = add(mul(p00, set1(1.0f - tx)), mul(p10, set1(tx)));
+        const Pixel bottom = add(mul(p01, set1(1.0f - tx)), mul(p11, set1(tx)));
+        return add(mul(top, set1(1.0f - ty)), mul(bottom, set1(ty)));
+    }
+
+    template <typename T>
+    void TemporalAA::resolve(const TextureBase<T>& current, const Buffer3D<float>* velocity, TextureBase<T>& output) {
+        const size_t w = current.width(), h = current.height(), c = current.channel();
+        if (w == 0 || h == 0 || c == 0) {
+            return;
+        }
+        if (history.width() != w || history.height() != h) {
+            history.setSize(w, h, 4);
+            next.setSize(w, h, 4);
+            valid = false;
+        }
+        if (velocity != nullptr && (velocity->width() != w || velocity->height() != h || velocity->channel() < 2)) {
+            std::cerr << "TemporalAA Error: velocity buffer size mismatch, ignored" << std::endl;
+            velocity = nullptr;
+        }
+        frame.setSize(w, h, 4);
+        const float unit = std::is_integral_v<T> ? 255.0f : 1.0f;
+
+        // 当前帧转成 RGBA float，邻域查询时每个像素只需一次加载
+        const T* in = current.data();
+#pragma omp parallel for
+        for (int64_t y = 0; y < static_cast<int64_t>(h); y++) {
+            float* dst = frame.data() + y * w * 4;
+            const T* src = in + current.getIndex(0, y);
+            for (size_t x = 0; x < w; x++) {
+                float p[4] = {0.0f, 0.0f, 0.0f, 1.0f};
+                for (size_t k = 0; k < std::min<size_t>(c, 4); k++) {
+                    p[k] = src[x * c + k] / unit;
+                }
+                if (c == 1) {
+                    p[1] = p[2] = p[0];
+                }
+                memcpy(dst + x * 4, p, sizeof(p));
+            }
+        }
+
+        if (output.width() != w || output.height() != h || output.channel() != c) {
+            output.setSize(w, h, c);
+        }
+        const bool useHistory = valid;
+        const bool clampHistory = _settings.neighbourhoodClamp;
+        const float feedback = RE::camp(_settings.feedback, 0.0f, 1.0f);
+        const taa::Pixel historyWeight = taa::set1(feedback);
+        const taa::Pixel currentWeight = taa::set1(1.0f - feedback);
+        T* out = output.data();
+
+#pragma omp parallel for
+        for (int64_t y = 0; y < static_cast<int64_t>(h); y++) {
+            const float* rows[3] = {frame.data() + std::max<int64_t>(y - 1, 0) * w * 4, frame.data() + y * w * 4,
+                                    frame.data() + std::min<int64_t>(y + 1, h - 1) * w * 4};
+            float* blended = next.data() + y * w * 4;
+            T* dst = out + output.getIndex(0, y);
+            for (size_t x = 0; x < w; x++) {
+                const taa::Pixel color = taa::load(rows[1] + x * 4);
+                taa::Pixel result = color;
+                if (useHistory) {
+                    float vx = 0.0f, vy = 0.0f;
+                    if (velocity != nullptr) {
+                        const float* v = velocity->data() + velocity->getIndex(x, y);
+                        vx = v[0];
+                        vy = v[1];
+                    }
+                    // 上一帧中的位置（像素中心为整数点）
+                    const float px = x - vx, py = y - vy;
+                    if (px > -0.5f && py > -0.5f && px < w - 0.5f && py < h - 0.5f) {
+                        taa::Pixel previous = taa::sampleBilinear(history, px, py);
+                        if (clampHistory) {
+                            const size_t xl = x > 0 ? x - 1 : 0, xr = std::min(x + 1, w - 1);
+                            taa::Pixel lo = color, hi = color;
+                            for (int r = 0; r < 3; r++) {
+                                for (size_t xi : {xl, x, xr}) {
+                                    const taa::Pixel n = taa::load(rows[r] + xi * 4);
+                                    lo = taa::vmin(lo, n);
+                                    hi = taa::vmax(hi, n);
+                                }
+                            }
+                            previous = taa::vmin(taa::vmax(previous, lo), hi);
+                        }
+                        result = taa::add(taa::mul(previous, historyWeight), taa::mul(color, currentWeight));
+                    }
+                }
+                taa::store(blended + x * 4, result);
+                float p[4];
+                taa::store(p, result);
+                for (size_t k = 0; k < std::min<size_t>(c, 4); k++) {
+                    if constexpr (std::is_integral_v<T>) {
+                        dst[x * c + k] = static_cast<T>(RE::camp(p[k], 0.0f, 1.0f) * unit + 0.5f);
+                    } else {
+                        dst[x * c + k] = static_cast<T>(p[k]);
+                    }
+                }
+            }
+        }
+        std::swap(history, next);
+        valid = true;
+    }
+
+    template <typename T>
+    void TemporalAA::resolve(const TextureBase<T>& current, const Buffer3D<float>& depth, const glm::mat4& inverseViewProjection,
+                             const glm::mat4& previousViewProjection, TextureBase<T>& output) {
+        const size_t w = current.width(), h = current.height();
+        if (depth.width() != w || depth.height() != h || depth.channel() == 0) {
+            std::cerr << "TemporalAA Error: depth buffer size mismatch" << std::endl;
+            resolve(current, nullptr, output);
+            return;
+        }
+        cameraVelocity.setSize(w, h, 2);
+        // 当前像素 -> 世界坐标 -> 上一帧屏幕坐标
+        const glm::mat4 reproject = previousViewProjection * inverseViewProjection;
+#pragma omp parallel for
+        for (int64_t y = 0; y < static_cast<int64_t>(h); y++) {
+            float* v = cameraVelocity.data() + y * w * 2;
+            const float ndcY = 1.0f - (y + 0.5f) / h * 2.0f;
+            for (size_t x = 0; x < w; x++) {
+                const float ndcZ = depth.data()[depth.getIndex(x, y)];
+                const glm::vec4 clip = reproject * glm::vec4((x + 0.5f) / w * 2.0f - 1.0f, ndcY, ndcZ, 1.0f);
+                if (clip.w <= 0.0f) {
+                    v[x * 2] = v[x * 2 + 1] = 0.0f;
+                    continue;
+                }
+                const float prevX = (clip.x / clip.w * 0.5f + 0.5f) * w;
+                const float prevY = (0.5f - clip.y / clip.w * 0.5f) * h;
+                v[x * 2] = x + 0.5f - prevX;
+                v[x * 2 + 1] = y + 0.5f - prevY;
+            }
+        }
+        resolve(current, &cameraVelocity, output);
+    }
+}
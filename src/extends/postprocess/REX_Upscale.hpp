@@ -0,0 +1,210 @@
+#pragma once
+#include "RE_includes.h"
+#include "RE_Texture.hpp"
+#include "postprocess/REX_Blur.hpp"
+
+namespace RE {
+    // 把 src 左上角 srcWidth x srcHeight 的视口放大到整个 dst，dst 尺寸不变，通道数需与 src 相同
+    // 采样按像素中心对齐，边缘 clamp
+    template <typename T>
+    void upscaleBilinear(const TextureBase<T>& src, size_t srcWidth, size_t srcHeight, TextureBase<T>& dst);
+    template <typename T>
+    void upscaleBilinear(const TextureBase<T>& src, TextureBase<T>& dst);
+
+    // 保边放大：双线性权重再乘以与最近源像素亮度差相关的衰减，边缘两侧的颜色不会互相渗透
+    // sharpness 越大边缘越硬，0 时等价于双线性
+    template <typename T>
+    void upscaleEdgeAware(const TextureBase<T>& src, size_t srcWidth, size_t srcHeight, TextureBase<T>& dst, float sharpness = 8.0f);
+    template <typename T>
+    void upscaleEdgeAware(const TextureBase<T>& src, TextureBase<T>& dst, float sharpness = 8.0f);
+
+    namespace upscale {
+        // 每个输出坐标对应的两个源下标与插值权重
+        struct Taps {
+            std::vector<uint32_t> i0, i1;
+            std::vector<float> t;
+        };
+        Taps makeTaps(size_t srcSize, size_t dstSize);
+
+        // out = a + (b - a) * t，n 为 float 个数
+        void lerpRows(const float* a, const float* b, float t, float* out, size_t n);
+        // 行内各像素的亮度，c 为 1 或 2 时取第 0 通道
+        void lumaRow(const float* in, float* out, size_t w, size_t c, float scale);
+        bool checkArgs(size_t srcW, size_t srcH, size_t srcC, size_t viewW, size_t viewH, size_t dstC);
+    }
+}
+
+namespace RE {
+    inline upscale::Taps upscale::makeTaps(size_t srcSize, size_t dstSize) {
+        Taps taps;
+        taps.i0.resize(dstSize);
+        taps.i1.resize(dstSize);
+        taps.t.resize(dstSize);
+        const float ratio = static_cast<float>(srcSize) / dstSize;
+        for (size_t i = 0; i < dstSize; i++) {
+            const float p = std::max((i + 0.5f) * ratio - 0.5f, 0.0f);
+            const size_t p0 = std::min(static_cast<size_t>(p), srcSize - 1);
+            taps.i0[i] = static_cast<uint32_t>(p0);
+            taps.i1[i] = static_cast<uint32_t>(std::min(p0 + 1, srcSize - 1));
+            taps.t[i] = p - p0;
+        }
+        return taps;
+    }
+
+    inline void upscale::lerpRows(const float* a, const float* b, float t, float* out, size_t n) {
+        size_t i = 0;
+#if defined(RE_SIMD_AVX2)
+        const __m256 vt8 = _mm256_set1_ps(t);
+        for (; i + 8 <= n; i += 8) {
+            const __m256 va = _mm256_loadu_ps(a + i);
+            _mm256_storeu_ps(out + i, _mm256_add_ps(va, _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(b + i), va), vt8)));
+        }
+#endif
+#if defined(RE_SIMD_SSE2)
+        const __m128 vt4 = _mm_set1_ps(t);
+        for (; i + 4 <= n; i += 4) {
+            const __m128 va = _mm_loadu_ps(a + i);
+            _mm_storeu_ps(out + i, _mm_add_ps(va, _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(b + i), va), vt4)));
+        }
+#endif
+        for (; i < n; i++) {
+            out[i] = a[i] + (b[i] - a[i]) * t;
+        }
+    }
+
+    inline void upscale::lumaRow(const float* in, float* out, size_t w, size_t c, float scale) {
+        if (c >= 3) {
+            for (size_t x = 0; x < w; x++) {
+                out[x] = (0.299f * in[x * c] + 0.587f * in[x * c + 1] + 0.114f * in[x * c + 2]) * scale;
+            }
+        } else {
+            for (size_t x = 0; x < w; x++) {
+                out[x] = in[x * c] * scale;
+            }
+        }
+    }
+
+    inline bool upscale::checkArgs(size_t srcW, size_t srcH, size_t srcC, size_t viewW, size_t viewH, size_t dstC) {
+        if (viewW == 0 || viewH == 0 || viewW > srcW || viewH > srcH) {
+            std::cerr << "Upscale Error: viewport " << viewW << "x" << viewH << " is outside the source texture" << std::endl;
+            return false;
+        }
+        if (srcC != dstC) {
+            std::cerr << "Upscale Error: channel mismatch" << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    template <typename T>
+    void upscaleBilinear(const TextureBase<T>& src, size_t srcWidth, size_t srcHeight, TextureBase<T>& dst) {
+        RE_PROFILE_SCOPE("upscaleBilinear");
+        const size_t c = src.channel();
+        const size_t dw = dst.width(), dh = dst.height();
+        if (!upscale::checkArgs(src.width(), src.height(), c, srcWidth, srcHeight, dst.channel()) || dw == 0 || dh == 0) {
+            return;
+        }
+        const upscale::Taps tx = upscale::makeTaps(srcWidth, dw);
+        const upscale::Taps ty = upscale::makeTaps(srcHeight, dh);
+        const size_t n = srcWidth * c;
+
+#pragma omp parallel
+        {
+            // 每个线程处理连续的输出行，相邻输出行通常落在同一对源行上，只在源行变化时重新加载
+            std::vector<float> rowA(n), rowB(n), mixed(n), out(dw * c);
+            int64_t loaded = -1;
+#pragma omp for schedule(static)
+            for (int64_t y = 0; y < static_cast<int64_t>(dh); y++) {
+                const uint32_t y0 = ty.i0[y], y1 = ty.i1[y];
+                if (loaded != y0) {
+                    blur::loadRow(src.data() + src.getIndex(0, y0), rowA.data(), n);
+                    blur::loadRow(src.data() + src.getIndex(0, y1), rowB.data(), n);
+                    loaded = y0;
+                }
+                upscale::lerpRows(rowA.data(), rowB.data(), ty.t[y], mixed.data(), n);
+                size_t x = 0;
+#if defined(RE_SIMD_SSE2)
+                // 4 通道时一个像素正好是一个寄存器
+                if (c == 4) {
+                    for (; x < dw; x++) {
+                        const __m128 a = _mm_loadu_ps(mixed.data() + tx.i0[x] * 4);
+                        const __m128 b = _mm_loadu_ps(mixed.data() + tx.i1[x] * 4);
+                        _mm_storeu_ps(out.data() + x * 4, _mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(b, a), _mm_set1_ps(tx.t[x]))));
+                    }
+                }
+#endif
+                for (; x < dw; x++) {
+                    const float* a = mixed.data() + tx.i0[x] * c;
+                    const float* b = mixed.data() + tx.i1[x] * c;
+                    const float t = tx.t[x];
+                    for (size_t k = 0; k < c; k++) {
+                        out[x * c + k] = a[k] + (b[k] - a[k]) * t;
+                    }
+                }
+                blur::storeRow(out.data(), dst.data() + dst.getIndex(0, y), dw * c);
+            }
+        }
+    }
+
+    template <typename T>
+    void upscaleBilinear(const TextureBase<T>& src, TextureBase<T>& dst) {
+        upscaleBilinear(src, src.width(), src.height(), dst);
+    }
+
+    template <typename T>
+    void upscaleEdgeAware(const TextureBase<T>& src, size_t srcWidth, size_t srcHeight, TextureBase<T>& dst, float sharpness) {
+        RE_PROFILE_SCOPE("upscaleEdgeAware");
+        const size_t c = src.channel();
+        const size_t dw = dst.width(), dh = dst.height();
+        if (!upscale::checkArgs(src.width(), src.height(), c, srcWidth, srcHeight, dst.channel()) || dw == 0 || dh == 0) {
+            return;
+        }
+        const upscale::Taps tx = upscale::makeTaps(srcWidth, dw);
+        const upscale::Taps ty = upscale::makeTaps(srcHeight, dh);
+        const size_t n = srcWidth * c;
+        // 亮度归一化到 [0, 1] 附近，sharpness 对两种纹理含义一致
+        const float lumaScale = std::is_integral_v<T> ? 1.0f / 255.0f : 1.0f;
+
+#pragma omp parallel
+        {
+            std::vector<float> rowA(n), rowB(n), lumaA(srcWidth), lumaB(srcWidth), out(dw * c);
+            int64_t loaded = -1;
+#pragma omp for schedule(static)
+            for (int64_t y = 0; y < static_cast<int64_t>(dh); y++) {
+                const uint32_t y0 = ty.i0[y], y1 = ty.i1[y];
+                if (loaded != y0) {
+                    blur::loadRow(src.data() + src.getIndex(0, y0), rowA.data(), n);
+                    blur::loadRow(src.data() + src.getIndex(0, y1), rowB.data(), n);
+                    upscale::lumaRow(rowA.data(), lumaA.data(), srcWidth, c, lumaScale);
+                    upscale::lumaRow(rowB.data(), lumaB.data(), srcWidth, c, lumaScale);
+                    loaded = y0;
+                }
+                const float fy = ty.t[y];
+                for (size_t x = 0; x < dw; x++) {
+                    const uint32_t x0 = tx.i0[x], x1 = tx.i1[x];
+                    const float fx = tx.t[x];
+                    float w[4] = {(1.0f - fx) * (1.0f - fy), fx * (1.0f - fy), (1.0f - fx) * fy, fx * fy};
+                    const float l[4] = {lumaA[x0], lumaA[x1], lumaB[x0], lumaB[x1]};
+                    // 以权重最大（最近）的源像素为参照，亮度差越大权重越小
+                    const int nearest = (fy < 0.5f ? 0 : 2) + (fx < 0.5f ? 0 : 1);
+                    float sum = 0.0f;
+                    for (int i = 0; i < 4; i++) {
+                        w[i] /= 1.0f + sharpness * std::abs(l[i] - l[nearest]);
+                        sum += w[i];
+                    }
+                    const float inv = 1.0f / sum;
+                    const float* p[4] = {rowA.data() + x0 * c, rowA.data() + x1 * c, rowB.data() + x0 * c, rowB.data() + x1 * c};
+                    for (size_t k = 0; k < c; k++) {
+                        out[x * c + k] = (p[0][k] * w[0] + p[1][k] * w[1] + p[2][k] * w[2] + p[3][k] * w[3]) * inv;
+                    }
+                }
+                blur::storeRow(out.data(), dst.data() + dst.getIndex(0, y), dw * c);
+            }
+        }
+    }
+
+    template <typename T>
+    void upscaleEdgeAware(const TextureBase<T>& src, TextureBase<T>& dst, float sharpness) {
+        upscaleEdgeAware(src, src.width(), src.height(), dst, sharpness);
+    }
+}
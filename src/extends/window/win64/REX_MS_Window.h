@@ -1,10 +1,12 @@
 #pragma once
 #include "RE_includes.h"
+#include "RE_Texture.hpp"
 
 namespace RE {
     class MSWindow {
     public:
-        MSWindow(size_t w, size_t h, const char* title = "RainbowEngine") : _width(w), _height(h) {
+        // format 为呈现缓冲的像素格式，RGB24 对应 3 通道 Texture，RGBA32 对应 4 通道
+        MSWindow(size_t w, size_t h, const char* title = "RainbowEngine", Uint32 format = SDL_PIXELFORMAT_RGB24) : _width(w), _height(h), _format(format) {
             _window = SDL_CreateWindow(title, SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, w, h, SDL_WINDOW_SHOWN);
             if (_window == nullptr) {
                 std::cerr << "SDL_CreateWindow Error: " << SDL_GetError() << std::endl;
@@ -18,7 +20,7 @@ namespace RE {
                 SDL_Quit();
             }
 
-            _texture = SDL_CreateTexture(_renderer, SDL_PIXELFORMAT_RGB24, SDL_TEXTUREACCESS_STREAMING, w, h);
+            _texture = SDL_CreateTexture(_renderer, format, SDL_TEXTUREACCESS_STREAMING, w, h);
             if (_texture == nullptr) {
                 std::cerr << "SDL_CreateTexture Error: " << SDL_GetError() << std::endl;
                 SDL_DestroyRenderer(_renderer);
@@ -33,21 +35,29 @@ namespace RE {
         };
 
         void drawToBuffer(const SDL_Rect* rect, const void* pixels, int pitch) {
+            RE_PROFILE_SCOPE("MSWindow::drawToBuffer");
             SDL_UpdateTexture(_texture, rect, pixels, pitch);
 
             SDL_RenderClear(_renderer);
             SDL_RenderCopy(_renderer, _texture, NULL, NULL);
         }
 
+        void drawToBuffer(Texture& texture) {
+            drawToBuffer(nullptr, texture.data(), static_cast<int>(texture.width() * texture.channel()));
+        }
+
         void present() {
+            RE_PROFILE_SCOPE("MSWindow::present");
             SDL_RenderPresent(_renderer);
         }
 
         size_t width() const { return _width; }
         size_t height() const { return _height; }
+        Uint32 format() const { return _format; }
 
     private:
         size_t _width, _height;
+        Uint32 _format;
         SDL_Window* _window;
         SDL_Renderer* _renderer;
         SDL_Texture* _texture;
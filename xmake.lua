@@ -27,6 +27,7 @@ target("extends")
     set_kind("headeronly")
     add_headerfiles("src/extends/window/win64/*.h")
     add_headerfiles("src/extends/drawing/*.hpp")
+    add_headerfiles("src/extends/postprocess/*.hpp")
     add_deps("base")
     add_deps("RainbowEngine")
     add_includedirs("src/extends", {public = true})
@@ -49,6 +50,17 @@ target("defaultExample")
     add_files("src/examples/default/MainWindow.cpp")
     add_packages("libsdl", "glm", "glfw", "vulkansdk", "tiny_obj_loader", "stb", "eigen", "openmp")
 
+target("benchmarks")
+    set_default(false)
+    set_kind("binary")
+    add_deps("RainbowEngine")
+    add_deps("extends")
+    set_rundir(".")
+    add_defines("SDL_MAIN_HANDLED")
+    add_files("src/benchmarks/*.cpp")
+    add_includedirs("src/benchmarks")
+    add_packages("libsdl", "glm", "glfw", "vulkansdk", "tiny_obj_loader", "stb", "eigen", "openmp")
+
 package("tiny_obj_loader")
     add_urls("https://github.com/tinyobjloader/tinyobjloader.git")
  